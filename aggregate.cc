@@ -0,0 +1,269 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+// Test runner of the executables built with BUILD_AGGREGATE_TEST: the
+// tests are linked with this file, which provides the main function and
+// sets up the test environment once for the whole process.
+
+#define ROBOPTIM_SHARED_TESTS_AGGREGATE_MAIN
+#include "common.hh"
+#include "comparison.hh"
+#include "problem-job.hh"
+#include "profile.hh"
+#include "stacked.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <ltdl.h>
+
+/// \brief Process-wide test environment.
+///
+/// The solver plug-in is loaded once and kept loaded, so that the solver
+/// factories of the tests only increment its reference count.
+struct AggregateConfiguration
+{
+  AggregateConfiguration ()
+    : plugin_ (0),
+      startupTime_ (0.)
+  {
+    std::chrono::steady_clock::time_point start
+      = std::chrono::steady_clock::now ();
+
+    setUpTestEnvironment ();
+
+    plugin_ = lt_dlopenext ("roboptim-core-plugin-" SOLVER_NAME);
+    if (!plugin_)
+      std::cerr << "failed to load the " << SOLVER_NAME << " plug-in: "
+                << lt_dlerror () << std::endl;
+
+    startupTime_ = std::chrono::duration<double>
+      (std::chrono::steady_clock::now () - start).count ();
+  }
+
+  ~AggregateConfiguration ()
+  {
+    std::cout << "Performance summary:" << std::endl;
+    ::roboptim::printPerformanceSummary
+      (std::cout, ::roboptim::performanceRecords (), startupTime_);
+
+    if (plugin_ && lt_dlclose (plugin_))
+      std::cerr << "lt_dlclose failed" << std::endl;
+    tearDownTestEnvironment ();
+  }
+
+private:
+  lt_dlhandle plugin_;
+  double startupTime_;
+};
+
+BOOST_GLOBAL_FIXTURE (AggregateConfiguration);
+
+BOOST_AUTO_TEST_SUITE (aggregate)
+
+// Solve all the registered problems on a thread pool, without Boost
+// checks on the intermediate results:
+// schittkowski_all --run_test=aggregate -- parallel [THREADS]
+BOOST_AUTO_TEST_CASE (aggregate_parallel)
+{
+  using namespace roboptim;
+
+  int argc = boost::unit_test::framework::master_test_suite ().argc;
+  char** argv = boost::unit_test::framework::master_test_suite ().argv;
+  if (argc < 2 || std::string (argv[1]) != "parallel")
+    return;
+
+  unsigned threads = (argc > 2 && std::atoi (argv[2]) > 0)
+    ? static_cast<unsigned> (std::atoi (argv[2]))
+    : defaultThreadCount (SOLVER_NAME);
+
+  std::vector<Job> jobs;
+  const problemRegistry_t& registry = problemRegistry ();
+  for (std::size_t i = 0; i < registry.size (); ++i)
+    jobs.push_back (problemJob (registry[i]));
+
+  // Long problems first, according to the previous sequential runs.
+  timings_t timings;
+#ifdef PERF_FILENAME
+  readHistoricalTimings (PERF_FILENAME, timings);
+#endif //! PERF_FILENAME
+  scheduleLongestFirst (jobs, timings);
+
+  std::chrono::steady_clock::time_point start
+    = std::chrono::steady_clock::now ();
+  std::vector<PerformanceRecord> records = runJobs (jobs, threads);
+  double wallTime = std::chrono::duration<double>
+    (std::chrono::steady_clock::now () - start).count ();
+
+  printPerformanceSummary (std::cout, records, 0.);
+
+  double solveTime = 0.;
+  for (std::size_t i = 0; i < records.size (); ++i)
+    {
+      solveTime += records[i].wallTime;
+      BOOST_CHECK_MESSAGE (records[i].status == "success",
+                           records[i].test << ": " << records[i].status);
+    }
+
+  std::cout << jobs.size () << " problems, " << threads << " threads: "
+            << wallTime << " s (sum of the solve times: " << solveTime
+            << " s)" << std::endl;
+}
+
+// Solve all the registered problems with several solver plug-ins, and
+// print the solver × problem matrix of status, time and iterations:
+// suite_all --run_test=aggregate -- matrix PLUGIN [PLUGIN...]
+//
+// The plug-ins are loaded through SolverFactory from the plug-in search
+// path, and must support the function type of this executable. Runs are
+// sequential, so that the solve times can be compared.
+BOOST_AUTO_TEST_CASE (aggregate_matrix)
+{
+  using namespace roboptim;
+
+  int argc = boost::unit_test::framework::master_test_suite ().argc;
+  char** argv = boost::unit_test::framework::master_test_suite ().argv;
+  if (argc < 2 || std::string (argv[1]) != "matrix")
+    return;
+
+  std::vector<std::string> plugins (argv + 2, argv + argc);
+  if (plugins.empty ())
+    plugins.push_back (SOLVER_NAME);
+
+  ComparisonMatrix matrix;
+  const problemRegistry_t& registry = problemRegistry ();
+  for (std::size_t s = 0; s < plugins.size (); ++s)
+    {
+      std::vector<Job> jobs;
+      for (std::size_t i = 0; i < registry.size (); ++i)
+        jobs.push_back (problemJob (registry[i], plugins[s]));
+
+      std::vector<PerformanceRecord> records = runJobs (jobs, 1);
+      for (std::size_t i = 0; i < records.size (); ++i)
+        {
+          // Errors (e.g. unknown plug-in) do not have a solver name yet.
+          records[i].solver = plugins[s];
+          WRITE_PERFORMANCE_RECORD (records[i]);
+        }
+      matrix.add (records);
+    }
+
+  printComparisonMatrix (std::cout, matrix);
+#ifdef PERF_FILENAME
+  boost::filesystem::path prefix =
+    boost::filesystem::path (PERF_FILENAME).replace_extension ();
+  writeComparisonMatrix (prefix.string () + ".matrix.csv", matrix);
+  writeSolverProfiles (std::cout, prefix, matrix);
+#endif //! PERF_FILENAME
+}
+
+// Solve the registered problems having several constraints of the same
+// kind twice: with the constraints as registered, and stacked in a single
+// function of each kind (see stackConstraints), to measure how the
+// per-constraint dispatch of the solver affects the solve time:
+// schittkowski_all --run_test=aggregate -- stacked [REPEAT]
+//
+// The fastest of REPEAT runs (default: 1) is kept for each variant. Runs
+// are sequential, so that the solve times can be compared.
+BOOST_AUTO_TEST_CASE (aggregate_stacked)
+{
+  using namespace roboptim;
+
+  int argc = boost::unit_test::framework::master_test_suite ().argc;
+  char** argv = boost::unit_test::framework::master_test_suite ().argv;
+  if (argc < 2 || std::string (argv[1]) != "stacked")
+    return;
+
+  unsigned repeat = (argc > 2 && std::atoi (argv[2]) > 0)
+    ? static_cast<unsigned> (std::atoi (argv[2])) : 1;
+
+  // The two variants are the two "solvers" of the comparison matrix.
+  const std::string variants[] =
+    {SOLVER_NAME, std::string (SOLVER_NAME) + " (stacked)"};
+
+  ComparisonMatrix matrix;
+  const problemRegistry_t& registry = problemRegistry ();
+  for (std::size_t i = 0; i < registry.size (); ++i)
+    {
+      if (!hasStackableConstraints<functionType_t> (registry[i]))
+        continue;
+
+      std::vector<Job> jobs;
+      jobs.push_back (problemJob (registry[i]));
+      jobs.push_back (problemJob (stackedDescriptor (registry[i])));
+
+      std::vector<PerformanceRecord> best;
+      for (unsigned r = 0; r < repeat; ++r)
+        {
+          std::vector<PerformanceRecord> records = runJobs (jobs, 1);
+          if (best.empty ())
+            best = records;
+          for (std::size_t j = 0; j < records.size (); ++j)
+            if (records[j].wallTime < best[j].wallTime)
+              best[j] = records[j];
+        }
+
+      for (std::size_t j = 0; j < best.size (); ++j)
+        {
+          best[j].test = registry[i].name;
+          best[j].solver = variants[j];
+        }
+      BOOST_CHECK_MESSAGE (best[1].status == "success"
+                           || best[0].status != "success",
+                           registry[i].name << ": " << best[1].status
+                           << " with stacked constraints");
+      matrix.add (best);
+    }
+
+  printComparisonMatrix (std::cout, matrix);
+#ifdef PERF_FILENAME
+  boost::filesystem::path prefix =
+    boost::filesystem::path (PERF_FILENAME).replace_extension ();
+  writeComparisonMatrix (prefix.string () + ".stacked.csv", matrix);
+#endif //! PERF_FILENAME
+}
+
+// Performance and data profiles of the runs stored in performance record
+// files, e.g. of executables built with different solvers:
+// suite_all --run_test=aggregate -- profile PREFIX FILE [FILE...]
+//
+// Writes PREFIX.<profile>.csv and the matching gnuplot scripts. Only
+// successful runs count as solved (see resultStatus).
+BOOST_AUTO_TEST_CASE (aggregate_profile)
+{
+  using namespace roboptim;
+
+  int argc = boost::unit_test::framework::master_test_suite ().argc;
+  char** argv = boost::unit_test::framework::master_test_suite ().argv;
+  if (argc < 2 || std::string (argv[1]) != "profile")
+    return;
+  BOOST_REQUIRE_MESSAGE (argc > 3, "usage: profile PREFIX FILE [FILE...]");
+
+  std::vector<PerformanceRecord> records;
+  for (int i = 3; i < argc; ++i)
+    readPerformanceRecords (argv[i], records);
+  BOOST_REQUIRE (!records.empty ());
+
+  ComparisonMatrix matrix;
+  matrix.add (records);
+  printComparisonMatrix (std::cout, matrix);
+  writeSolverProfiles (std::cout, argv[2], matrix);
+}
+
+BOOST_AUTO_TEST_SUITE_END ()
@@ -0,0 +1,398 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_ASYNC_TRACE_HH
+# define ROBOPTIM_SHARED_TESTS_ASYNC_TRACE_HH
+# include <algorithm>
+# include <atomic>
+# include <chrono>
+# include <cstddef>
+# include <iostream>
+# include <sstream>
+# include <stdexcept>
+# include <string>
+# include <thread>
+# include <vector>
+
+# include <boost/filesystem.hpp>
+
+# include "trace.hh"
+
+namespace roboptim
+{
+  /// \brief Bounded single-producer single-consumer queue, without locks.
+  ///
+  /// The slots are allocated once and reused: the producer fills the slot
+  /// returned by reserve () in place and publishes it, the consumer reads
+  /// the slot returned by front () and releases it with pop ().
+  ///
+  /// \tparam T slot type.
+  template <typename T>
+  class SpscRingBuffer
+  {
+  public:
+    /// \brief Create a queue.
+    ///
+    /// \param capacity number of slots, rounded up to a power of two.
+    /// \param slot initial value of the slots.
+    explicit SpscRingBuffer (std::size_t capacity, const T& slot = T ())
+      : slots_ (),
+        mask_ (0),
+        head_ (0),
+        padding_ (),
+        tail_ (0)
+    {
+      std::size_t size = 1;
+      while (size < capacity)
+        size <<= 1;
+      slots_.assign (size, slot);
+      mask_ = size - 1;
+    }
+
+    std::size_t capacity () const
+    {
+      return slots_.size ();
+    }
+
+    /// \brief Free slot to fill (producer), null if the queue is full.
+    T* reserve ()
+    {
+      std::size_t head = head_.load (std::memory_order_relaxed);
+      if (head - tail_.load (std::memory_order_acquire) == slots_.size ())
+        return 0;
+      return &slots_[head & mask_];
+    }
+
+    /// \brief Publish the slot returned by reserve () (producer).
+    void publish ()
+    {
+      head_.store (head_.load (std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+    }
+
+    /// \brief Oldest published slot (consumer), null if the queue is empty.
+    T* front ()
+    {
+      std::size_t tail = tail_.load (std::memory_order_relaxed);
+      if (tail == head_.load (std::memory_order_acquire))
+        return 0;
+      return &slots_[tail & mask_];
+    }
+
+    /// \brief Release the slot returned by front () (consumer).
+    void pop ()
+    {
+      tail_.store (tail_.load (std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+    }
+
+  private:
+    std::vector<T> slots_;
+    std::size_t mask_;
+
+    /// \brief Number of published slots (written by the producer).
+    std::atomic<std::size_t> head_;
+
+    /// \brief Keep head_ and tail_ on different cache lines.
+    char padding_[64];
+
+    /// \brief Number of released slots (written by the consumer).
+    std::atomic<std::size_t> tail_;
+  };
+
+  /// \brief Binary trace logger (see BinaryTraceLogger) writing from a
+  /// background thread.
+  ///
+  /// The iteration callback only copies the solver state into a
+  /// preallocated slot of a ring buffer; a writer thread serializes the
+  /// records and writes them to `<path>/trace.bin'. The trace format is
+  /// the same as BinaryTraceLogger's.
+  ///
+  /// When the buffer is full, the callback waits for the writer at most
+  /// maxWait (backpressure), then drops the iteration. Dropped iterations
+  /// leave gaps in the iteration numbers of the trace, and their number is
+  /// written at the end of the trace and returned by dropped ().
+  ///
+  /// Errors of the writer thread (e.g. a full disk) stop the writing of
+  /// the trace, but not the solver: the following records are discarded,
+  /// and the error is returned by error () and reported on the standard
+  /// error output when the logger is destroyed.
+  ///
+  /// \tparam S solver type.
+  template <typename S>
+  class AsyncTraceLogger
+  {
+  public:
+    typedef S solver_t;
+    typedef typename solver_t::problem_t problem_t;
+    typedef typename solver_t::solverState_t solverState_t;
+    typedef typename solver_t::callback_t callback_t;
+
+    /// \brief Create a trace for a solver and start its writer thread.
+    ///
+    /// \param solver solver to trace.
+    /// \param path directory of the trace.
+    /// \param selfRegister whether to register the iteration callback.
+    /// \param capacity number of buffered iterations (0: as many as fit in
+    /// 64 MiB, between 2 and 1024).
+    /// \param maxWait maximum time the callback waits for a free slot.
+    AsyncTraceLogger (solver_t& solver, const boost::filesystem::path& path,
+                      bool selfRegister = true, std::size_t capacity = 0,
+                      std::chrono::microseconds maxWait
+                      = std::chrono::microseconds (1000))
+      : writer_ (path / "trace.bin",
+                 detail::traceHeader (solver.problem (), path)),
+        buffer_ (capacity ? capacity : defaultCapacity (writer_.header ()),
+                 initialRecord (writer_.header ())),
+        maxWait_ (maxWait),
+        iteration_ (0),
+        dropped_ (0),
+        stop_ (false),
+        failed_ (false),
+        error_ (),
+        thread_ ()
+    {
+      // The thread is started last, so that it does not outlive the
+      // logger if the constructor throws.
+      if (selfRegister)
+        {
+          // Not all solvers support per-iteration callbacks.
+          try
+            {
+              solver.setIterationCallback (callback ());
+            }
+          catch (std::runtime_error&)
+            {
+            }
+        }
+
+      thread_ = std::thread (&AsyncTraceLogger::run, this);
+    }
+
+    /// \brief Write the remaining records, the number of dropped
+    /// iterations, and stop the writer thread.
+    ~AsyncTraceLogger ()
+    {
+      if (dropped_)
+        {
+          std::ostringstream ss;
+          ss << "Dropped iterations: " << dropped_;
+          push (ss.str ());
+        }
+      stop_.store (true, std::memory_order_release);
+      thread_.join ();
+
+      if (failed_)
+        std::cerr << "cannot write the trace: " << error_ << std::endl;
+    }
+
+    /// \brief Iteration callback buffering the solver state.
+    callback_t callback ()
+    {
+      IterationBuffer buffer = {this};
+      return buffer;
+    }
+
+    /// \brief Append data (result, solver...) as a TEXT record. Text
+    /// records are never dropped.
+    template <typename U>
+    AsyncTraceLogger& operator<< (const U& data)
+    {
+      std::ostringstream ss;
+      ss << data;
+      push (ss.str ());
+      return *this;
+    }
+
+    /// \brief Number of iterations dropped because the buffer was full.
+    unsigned long dropped () const
+    {
+      return dropped_;
+    }
+
+    /// \brief Number of buffered iterations.
+    std::size_t capacity () const
+    {
+      return buffer_.capacity ();
+    }
+
+    /// \brief Error of the writer thread, empty if none.
+    std::string error () const
+    {
+      return failed_.load (std::memory_order_acquire)
+        ? error_ : std::string ();
+    }
+
+  private:
+    /// \brief Iteration callback forwarding to perIterationCallback.
+    struct IterationBuffer
+    {
+      AsyncTraceLogger* logger;
+
+      void operator () (const problem_t& pb, solverState_t& state)
+      {
+        logger->perIterationCallback (pb, state);
+      }
+    };
+
+    static std::size_t defaultCapacity (const TraceHeader& header)
+    {
+      const std::size_t bytes = 64 << 20;
+      std::size_t slotSize = static_cast<std::size_t>
+        (header.inputSize + header.constraintsSize + 4) * sizeof (double);
+      return std::max<std::size_t>
+        (2, std::min<std::size_t> (1024, bytes / slotSize));
+    }
+
+    /// \brief Slot with x and the multipliers allocated, so that the
+    /// callback does not allocate.
+    static TraceRecord initialRecord (const TraceHeader& header)
+    {
+      TraceRecord record;
+      record.x.resize (static_cast<TraceRecord::index_t> (header.inputSize));
+      record.multipliers.resize
+        (static_cast<TraceRecord::index_t> (header.constraintsSize));
+      return record;
+    }
+
+    void perIterationCallback (const problem_t&, solverState_t& state)
+    {
+      boost::uint64_t iteration = iteration_++;
+
+      TraceRecord* slot = buffer_.reserve ();
+      if (!slot)
+        {
+          std::chrono::steady_clock::time_point deadline
+            = std::chrono::steady_clock::now () + maxWait_;
+          do
+            {
+              std::this_thread::yield ();
+              slot = buffer_.reserve ();
+            }
+          while (!slot && std::chrono::steady_clock::now () < deadline);
+        }
+      if (!slot)
+        {
+          ++dropped_;
+          return;
+        }
+
+      detail::traceRecord (*slot, iteration, state);
+      buffer_.publish ();
+    }
+
+    /// \brief Buffer a TEXT record, waiting for a free slot.
+    void push (const std::string& text)
+    {
+      TraceRecord* slot;
+      while (!(slot = buffer_.reserve ()))
+        std::this_thread::yield ();
+
+      slot->type = trace::TEXT;
+      slot->text = text;
+      buffer_.publish ();
+    }
+
+    /// \brief Writer thread: write the buffered records, and flush the
+    /// file when the buffer is empty.
+    ///
+    /// After an error, the records are still consumed, so that the
+    /// callback and push () do not wait for free slots forever.
+    void run ()
+    {
+      bool pending = false;
+      for (;;)
+        {
+          // Records published before stop_ are seen by front ().
+          bool stopping = stop_.load (std::memory_order_acquire);
+
+          TraceRecord* record = buffer_.front ();
+          if (record)
+            {
+              if (!failed_.load (std::memory_order_relaxed))
+                {
+                  try
+                    {
+                      writer_.write (*record);
+                      pending = true;
+                    }
+                  catch (const std::exception& e)
+                    {
+                      fail (e.what ());
+                    }
+                  catch (...)
+                    {
+                      fail ("unknown exception");
+                    }
+                }
+              buffer_.pop ();
+              continue;
+            }
+
+          if (pending && !failed_.load (std::memory_order_relaxed))
+            {
+              try
+                {
+                  writer_.flush ();
+                  if (!writer_.good ())
+                    fail ("write error");
+                }
+              catch (const std::exception& e)
+                {
+                  fail (e.what ());
+                }
+              catch (...)
+                {
+                  fail ("unknown exception");
+                }
+              pending = false;
+            }
+          if (stopping)
+            return;
+          std::this_thread::sleep_for (std::chrono::microseconds (100));
+        }
+    }
+
+    /// \brief Record an error of the writer thread.
+    void fail (const std::string& error)
+    {
+      error_ = error;
+      failed_.store (true, std::memory_order_release);
+    }
+
+    TraceWriter writer_;
+    SpscRingBuffer<TraceRecord> buffer_;
+    std::chrono::microseconds maxWait_;
+
+    /// \brief Iterations seen by the callback (solver thread).
+    boost::uint64_t iteration_;
+
+    /// \brief Iterations dropped by the callback (solver thread).
+    unsigned long dropped_;
+
+    std::atomic<bool> stop_;
+
+    /// \brief Whether the writer thread failed, and why (written by the
+    /// writer thread only, before failed_).
+    std::atomic<bool> failed_;
+    std::string error_;
+
+    std::thread thread_;
+  };
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_ASYNC_TRACE_HH
@@ -0,0 +1,656 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_AUTODIFF_HH
+# define ROBOPTIM_SHARED_TESTS_AUTODIFF_HH
+# include <algorithm>
+# include <chrono>
+# include <cmath>
+# include <cstddef>
+# include <iomanip>
+# include <iostream>
+# include <sstream>
+# include <stdexcept>
+# include <string>
+# include <vector>
+
+# include <boost/shared_ptr.hpp>
+
+# include <Eigen/SparseCore>
+
+# include <roboptim/core/twice-differentiable-function.hh>
+
+# include "registry.hh"
+# include "sparsity.hh"
+
+namespace roboptim
+{
+  /// \brief Dual number for forward-mode automatic differentiation.
+  ///
+  /// A dual number v + d ε (with ε² = 0) carries a value and its
+  /// derivative along one direction. Nested dual numbers
+  /// (Dual<Dual<double> >) carry second-order derivatives.
+  ///
+  /// Code evaluated on dual numbers has to call the mathematical functions
+  /// unqualified, so that the overloads below are found by ADL:
+  ///
+  /// \code
+  /// using std::pow;
+  /// result[0] = pow (x[0], 2) * x[1];
+  /// \endcode
+  ///
+  /// \tparam S type of the value and of the derivative.
+  template <typename S>
+  struct Dual
+  {
+    typedef S scalar_t;
+
+    Dual ()
+      : value (0.),
+        derivative (0.)
+    {}
+
+    /// \brief Constant (zero derivative).
+    Dual (double v)
+      : value (v),
+        derivative (0.)
+    {}
+
+    Dual (const S& v, const S& d)
+      : value (v),
+        derivative (d)
+    {}
+
+    template <typename B>
+    Dual& operator+= (const B& b)
+    {
+      return *this = *this + b;
+    }
+
+    template <typename B>
+    Dual& operator-= (const B& b)
+    {
+      return *this = *this - b;
+    }
+
+    template <typename B>
+    Dual& operator*= (const B& b)
+    {
+      return *this = *this * b;
+    }
+
+    template <typename B>
+    Dual& operator/= (const B& b)
+    {
+      return *this = *this / b;
+    }
+
+    /// \brief Value.
+    S value;
+
+    /// \brief Derivative of the value along the seeded direction.
+    S derivative;
+  };
+
+  template <typename S>
+  inline Dual<S> operator+ (const Dual<S>& a)
+  {
+    return a;
+  }
+
+  template <typename S>
+  inline Dual<S> operator- (const Dual<S>& a)
+  {
+    return Dual<S> (-a.value, -a.derivative);
+  }
+
+  template <typename S>
+  inline Dual<S> operator+ (const Dual<S>& a, const Dual<S>& b)
+  {
+    return Dual<S> (a.value + b.value, a.derivative + b.derivative);
+  }
+
+  template <typename S>
+  inline Dual<S> operator+ (const Dual<S>& a, double b)
+  {
+    return Dual<S> (a.value + b, a.derivative);
+  }
+
+  template <typename S>
+  inline Dual<S> operator+ (double a, const Dual<S>& b)
+  {
+    return Dual<S> (a + b.value, b.derivative);
+  }
+
+  template <typename S>
+  inline Dual<S> operator- (const Dual<S>& a, const Dual<S>& b)
+  {
+    return Dual<S> (a.value - b.value, a.derivative - b.derivative);
+  }
+
+  template <typename S>
+  inline Dual<S> operator- (const Dual<S>& a, double b)
+  {
+    return Dual<S> (a.value - b, a.derivative);
+  }
+
+  template <typename S>
+  inline Dual<S> operator- (double a, const Dual<S>& b)
+  {
+    return Dual<S> (a - b.value, -b.derivative);
+  }
+
+  template <typename S>
+  inline Dual<S> operator* (const Dual<S>& a, const Dual<S>& b)
+  {
+    return Dual<S> (a.value * b.value,
+                    a.derivative * b.value + a.value * b.derivative);
+  }
+
+  template <typename S>
+  inline Dual<S> operator* (const Dual<S>& a, double b)
+  {
+    return Dual<S> (a.value * b, a.derivative * b);
+  }
+
+  template <typename S>
+  inline Dual<S> operator* (double a, const Dual<S>& b)
+  {
+    return Dual<S> (a * b.value, a * b.derivative);
+  }
+
+  template <typename S>
+  inline Dual<S> operator/ (const Dual<S>& a, const Dual<S>& b)
+  {
+    S v = a.value / b.value;
+    return Dual<S> (v, (a.derivative - v * b.derivative) / b.value);
+  }
+
+  template <typename S>
+  inline Dual<S> operator/ (const Dual<S>& a, double b)
+  {
+    return Dual<S> (a.value / b, a.derivative / b);
+  }
+
+  template <typename S>
+  inline Dual<S> operator/ (double a, const Dual<S>& b)
+  {
+    S v = a / b.value;
+    return Dual<S> (v, -v * b.derivative / b.value);
+  }
+
+  // Comparisons only look at the values.
+# define ROBOPTIM_DUAL_COMPARISON(OP)					\
+  template <typename S>							\
+  inline bool operator OP (const Dual<S>& a, const Dual<S>& b)		\
+  {									\
+    return a.value OP b.value;						\
+  }									\
+									\
+  template <typename S>							\
+  inline bool operator OP (const Dual<S>& a, double b)			\
+  {									\
+    return a.value OP b;						\
+  }									\
+									\
+  template <typename S>							\
+  inline bool operator OP (double a, const Dual<S>& b)			\
+  {									\
+    return a OP b.value;						\
+  }
+
+  ROBOPTIM_DUAL_COMPARISON (<)
+  ROBOPTIM_DUAL_COMPARISON (<=)
+  ROBOPTIM_DUAL_COMPARISON (>)
+  ROBOPTIM_DUAL_COMPARISON (>=)
+  ROBOPTIM_DUAL_COMPARISON (==)
+  ROBOPTIM_DUAL_COMPARISON (!=)
+
+# undef ROBOPTIM_DUAL_COMPARISON
+
+  template <typename S>
+  inline Dual<S> exp (const Dual<S>& a)
+  {
+    using std::exp;
+    S e = exp (a.value);
+    return Dual<S> (e, e * a.derivative);
+  }
+
+  template <typename S>
+  inline Dual<S> log (const Dual<S>& a)
+  {
+    using std::log;
+    return Dual<S> (log (a.value), a.derivative / a.value);
+  }
+
+  template <typename S>
+  inline Dual<S> sqrt (const Dual<S>& a)
+  {
+    using std::sqrt;
+    S s = sqrt (a.value);
+    return Dual<S> (s, a.derivative / (2. * s));
+  }
+
+  template <typename S>
+  inline Dual<S> sin (const Dual<S>& a)
+  {
+    using std::sin;
+    using std::cos;
+    return Dual<S> (sin (a.value), cos (a.value) * a.derivative);
+  }
+
+  template <typename S>
+  inline Dual<S> cos (const Dual<S>& a)
+  {
+    using std::sin;
+    using std::cos;
+    return Dual<S> (cos (a.value), -sin (a.value) * a.derivative);
+  }
+
+  template <typename S>
+  inline Dual<S> asin (const Dual<S>& a)
+  {
+    using std::asin;
+    using std::sqrt;
+    return Dual<S> (asin (a.value),
+                    a.derivative / sqrt (1. - a.value * a.value));
+  }
+
+  template <typename S>
+  inline Dual<S> fabs (const Dual<S>& a)
+  {
+    return (a.value < 0.) ? -a : a;
+  }
+
+  template <typename S>
+  inline Dual<S> abs (const Dual<S>& a)
+  {
+    return fabs (a);
+  }
+
+  template <typename S>
+  inline Dual<S> pow (const Dual<S>& a, double p)
+  {
+    using std::pow;
+    if (p == 0.)
+      return Dual<S> (1.);
+    return Dual<S> (pow (a.value, p),
+                    p * pow (a.value, p - 1.) * a.derivative);
+  }
+
+  template <typename S>
+  inline Dual<S> pow (const Dual<S>& a, int p)
+  {
+    return pow (a, static_cast<double> (p));
+  }
+
+  template <typename S>
+  inline Dual<S> pow (const Dual<S>& a, const Dual<S>& b)
+  {
+    return exp (b * log (a));
+  }
+
+  template <typename S>
+  inline Dual<S> pow (double a, const Dual<S>& b)
+  {
+    using std::log;
+    return exp (b * log (a));
+  }
+
+  namespace detail
+  {
+    /// \brief Copy dense derivatives to the gradients, Jacobians and
+    /// Hessians of a matrix type.
+    template <typename T>
+    struct AutoDiffWriter
+    {
+      template <typename G, typename V>
+      static void gradient (G& grad, const V& g)
+      {
+        for (typename V::Index j = 0; j < g.size (); ++j)
+          grad[j] = g[j];
+      }
+
+      template <typename M, typename D>
+      static void matrix (M& m, const D& d)
+      {
+        m = d;
+      }
+    };
+
+    /// \brief Only the nonzero derivatives are stored in sparse matrices.
+    template <>
+    struct AutoDiffWriter<EigenMatrixSparse>
+    {
+      template <typename G, typename V>
+      static void gradient (G& grad, const V& g)
+      {
+        grad.setZero ();
+        for (typename V::Index j = 0; j < g.size (); ++j)
+          if (g[j] != 0.)
+            grad.insert (j) = g[j];
+      }
+
+      template <typename M, typename D>
+      static void matrix (M& m, const D& d)
+      {
+        m = d.sparseView ();
+      }
+    };
+  } // end of namespace detail
+
+  /// \brief Twice-differentiable function whose derivatives are computed
+  /// by forward-mode automatic differentiation.
+  ///
+  /// The function is written once, as a member template of the derived
+  /// class evaluated on doubles and on dual numbers (CRTP):
+  ///
+  /// \code
+  /// template <typename T>
+  /// struct F : public GenericAutoDiffFunction<T, F<T> >
+  /// {
+  ///   F () : GenericAutoDiffFunction<T, F<T> > (2, 1, "x₀² x₁") {}
+  ///
+  ///   template <typename S>
+  ///   void evaluate (S* result, const S* x) const
+  ///   {
+  ///     using std::pow;
+  ///     result[0] = pow (x[0], 2) * x[1];
+  ///   }
+  /// };
+  /// \endcode
+  ///
+  /// The Jacobian takes n evaluations on dual numbers (one per variable),
+  /// and each Hessian n (n + 1) / 2 evaluations on nested dual numbers.
+  /// Sparse derivatives only store the entries that are nonzero at the
+  /// evaluation point.
+  ///
+  /// \tparam T matrix type.
+  /// \tparam D derived class.
+  template <typename T, typename D>
+  class GenericAutoDiffFunction : public GenericTwiceDifferentiableFunction<T>
+  {
+  public:
+    ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+    (GenericTwiceDifferentiableFunction<T>);
+
+    typedef Dual<value_type> dual_t;
+    typedef Dual<dual_t> dual2_t;
+
+    GenericAutoDiffFunction (size_type inputSize, size_type outputSize,
+                             const std::string& name)
+      : GenericTwiceDifferentiableFunction<T> (inputSize, outputSize, name),
+        x_ (static_cast<std::size_t> (inputSize)),
+        result_ (static_cast<std::size_t> (outputSize)),
+        x2_ (static_cast<std::size_t> (inputSize)),
+        result2_ (static_cast<std::size_t> (outputSize)),
+        gradient_ (inputSize),
+        jacobian_ (outputSize, inputSize),
+        hessian_ (inputSize, inputSize)
+    {}
+
+  protected:
+    void impl_compute (result_ref result, const_argument_ref x) const
+    {
+      derived ().evaluate (result.data (), x.data ());
+    }
+
+    void impl_gradient (gradient_ref grad, const_argument_ref x,
+                        size_type functionId) const
+    {
+      std::size_t id = static_cast<std::size_t> (functionId);
+      for (size_type j = 0; j < this->inputSize (); ++j)
+        {
+          evaluateDirection (x, j);
+          gradient_[j] = result_[id].derivative;
+        }
+      detail::AutoDiffWriter<T>::gradient (grad, gradient_);
+    }
+
+    void impl_jacobian (jacobian_ref jac, const_argument_ref x) const
+    {
+      for (size_type j = 0; j < this->inputSize (); ++j)
+        {
+          evaluateDirection (x, j);
+          for (size_type i = 0; i < this->outputSize (); ++i)
+            jacobian_ (i, j) = result_[static_cast<std::size_t> (i)].derivative;
+        }
+      detail::AutoDiffWriter<T>::matrix (jac, jacobian_);
+    }
+
+    void impl_hessian (hessian_ref h, const_argument_ref x,
+                       size_type functionId) const
+    {
+      std::size_t id = static_cast<std::size_t> (functionId);
+      for (size_type i = 0; i < this->inputSize (); ++i)
+        for (size_type j = i; j < this->inputSize (); ++j)
+          {
+            // x + ε₁ eᵢ + ε₂ eⱼ: the ε₁ε₂ term is ∂²f/∂xᵢ∂xⱼ.
+            for (size_type k = 0; k < this->inputSize (); ++k)
+              x2_[static_cast<std::size_t> (k)] =
+                dual2_t (dual_t (x[k], (k == i) ? 1. : 0.),
+                         dual_t ((k == j) ? 1. : 0., 0.));
+            derived ().evaluate (&result2_[0], &x2_[0]);
+            hessian_ (i, j) = hessian_ (j, i) =
+              result2_[id].derivative.derivative;
+          }
+      detail::AutoDiffWriter<T>::matrix (h, hessian_);
+    }
+
+  private:
+    const D& derived () const
+    {
+      return static_cast<const D&> (*this);
+    }
+
+    /// \brief Evaluate the function on dual numbers, seeded with the
+    /// j-th canonical direction.
+    void evaluateDirection (const_argument_ref x, size_type j) const
+    {
+      for (size_type k = 0; k < this->inputSize (); ++k)
+        x_[static_cast<std::size_t> (k)] =
+          dual_t (x[k], (k == j) ? 1. : 0.);
+      derived ().evaluate (&result_[0], &x_[0]);
+    }
+
+    /// \brief Evaluation buffers, allocated once.
+    mutable std::vector<dual_t> x_;
+    mutable std::vector<dual_t> result_;
+    mutable std::vector<dual2_t> x2_;
+    mutable std::vector<dual2_t> result2_;
+    mutable Eigen::Matrix<value_type, Eigen::Dynamic, 1> gradient_;
+    mutable Eigen::Matrix<value_type, Eigen::Dynamic, Eigen::Dynamic>
+    jacobian_;
+    mutable Eigen::Matrix<value_type, Eigen::Dynamic, Eigen::Dynamic>
+    hessian_;
+  };
+
+  /// \brief Hand-coded and automatic derivatives of a problem.
+  struct AutoDiffComparison
+  {
+    AutoDiffComparison ()
+      : problem (),
+        gradientTime (0.),
+        autoDiffGradientTime (0.),
+        hessianTime (0.),
+        autoDiffHessianTime (0.),
+        gradientError (0.),
+        hessianError (0.)
+    {}
+
+    /// \brief Name of the problem.
+    std::string problem;
+
+    /// \brief Time needed to evaluate all the hand-coded gradients (in
+    /// seconds).
+    double gradientTime;
+
+    /// \brief Time needed to evaluate all the automatic gradients (in
+    /// seconds).
+    double autoDiffGradientTime;
+
+    /// \brief Time needed to evaluate all the hand-coded Hessians (in
+    /// seconds, 0 if some function is not twice differentiable).
+    double hessianTime;
+
+    /// \brief Time needed to evaluate all the automatic Hessians (in
+    /// seconds).
+    double autoDiffHessianTime;
+
+    /// \brief Largest difference between the Jacobians, relative to
+    /// 1 + |hand-coded value|.
+    double gradientError;
+
+    /// \brief Largest difference between the Hessians, relative to
+    /// 1 + |hand-coded value|.
+    double hessianError;
+  };
+
+  namespace detail
+  {
+    /// \brief Time needed to evaluate all the Hessians of a function
+    /// (in seconds).
+    template <typename F>
+    double hessiansTime (const F& f, const typename F::argument_t& x)
+    {
+      typedef typename F::hessian_t hessian_t;
+      typedef typename F::size_type size_type;
+
+      std::vector<hessian_t> hess
+        (static_cast<std::size_t> (f.outputSize ()),
+         hessian_t (f.inputSize (), f.inputSize ()));
+
+      // Repeat until the measure is long enough to be meaningful.
+      for (long reps = 1; ; reps *= 2)
+        {
+          std::chrono::steady_clock::time_point start
+            = std::chrono::steady_clock::now ();
+          for (long r = 0; r < reps; ++r)
+            for (size_type i = 0; i < f.outputSize (); ++i)
+              f.hessian (hess[static_cast<std::size_t> (i)], x, i);
+          double t = std::chrono::duration<double>
+            (std::chrono::steady_clock::now () - start).count ();
+          if (t > 1e-2 || reps >= (1L << 24))
+            return t / static_cast<double> (reps);
+        }
+    }
+  } // end of namespace detail
+
+  /// \brief Compare the hand-coded derivatives of a registered problem
+  /// to automatic ones, at its starting point.
+  ///
+  /// \param name registered problem (see findProblem).
+  /// \param autoDiff automatically differentiated cost and constraints, in
+  /// the order of the problem.
+  template <typename T>
+  AutoDiffComparison compareAutoDiff
+  (const std::string& name,
+   const std::vector<boost::shared_ptr<GenericTwiceDifferentiableFunction<T> > >&
+   autoDiff)
+  {
+    typedef typename Solver<T>::problem_t problem_t;
+    typedef typename problem_t::function_t function_t;
+    typedef GenericTwiceDifferentiableFunction<T> twiceDifferentiable_t;
+
+    boost::shared_ptr<problem_t> problem = findProblem (name).build<T> ();
+    const typename problem_t::argument_t& x = *problem->startingPoint ();
+
+    if (autoDiff.size () != problem->constraints ().size () + 1)
+      throw std::runtime_error ("wrong number of functions for " + name);
+
+    AutoDiffComparison comparison;
+    comparison.problem = name;
+    bool twiceDifferentiable = true;
+    for (std::size_t c = 0; c < autoDiff.size (); ++c)
+      {
+        const function_t& f = (c == 0)
+          ? problem->function () : *problem->constraints ()[c - 1];
+        const twiceDifferentiable_t& g = *autoDiff[c];
+
+        comparison.gradientTime += detail::gradientsTime (f, x, false);
+        comparison.autoDiffGradientTime += detail::gradientsTime (g, x, false);
+        comparison.gradientError =
+          std::max (comparison.gradientError,
+                    detail::derivativeError (g.jacobian (x), f.jacobian (x)));
+
+        comparison.autoDiffHessianTime += detail::hessiansTime (g, x);
+        const twiceDifferentiable_t* h =
+          dynamic_cast<const twiceDifferentiable_t*> (&f);
+        if (!h)
+          {
+            twiceDifferentiable = false;
+            continue;
+          }
+        comparison.hessianTime += detail::hessiansTime (*h, x);
+        for (typename function_t::size_type i = 0; i < f.outputSize (); ++i)
+          comparison.hessianError =
+            std::max (comparison.hessianError,
+                      detail::derivativeError (g.hessian (x, i),
+                                               h->hessian (x, i)));
+      }
+    if (!twiceDifferentiable)
+      comparison.hessianTime = 0.;
+
+    return comparison;
+  }
+
+  /// \brief Print the comparisons: evaluation time of all the gradients
+  /// and Hessians (hand-coded, automatic, and their ratio), and the
+  /// largest relative differences.
+  inline void printAutoDiffComparison
+  (std::ostream& o, const std::vector<AutoDiffComparison>& comparisons)
+  {
+    std::ostringstream ss;
+    ss << "Forward-mode automatic differentiation (ns per evaluation of all"
+       << " the derivatives):" << std::endl
+       << std::left << std::setw (16) << "problem" << std::right
+       << std::setw (12) << "gradient" << std::setw (12) << "AD"
+       << std::setw (8) << "ratio"
+       << std::setw (12) << "hessian" << std::setw (12) << "AD"
+       << std::setw (8) << "ratio"
+       << std::setw (12) << "error" << std::endl;
+
+    for (std::size_t i = 0; i < comparisons.size (); ++i)
+      {
+        const AutoDiffComparison& c = comparisons[i];
+        ss << std::left << std::setw (16) << c.problem << std::right
+           << std::fixed << std::setprecision (1)
+           << std::setw (12) << 1e9 * c.gradientTime
+           << std::setw (12) << 1e9 * c.autoDiffGradientTime
+           << std::setprecision (2)
+           << std::setw (8) << c.autoDiffGradientTime / c.gradientTime
+           << std::setprecision (1);
+        if (c.hessianTime > 0.)
+          ss << std::setw (12) << 1e9 * c.hessianTime
+             << std::setw (12) << 1e9 * c.autoDiffHessianTime
+             << std::setprecision (2)
+             << std::setw (8) << c.autoDiffHessianTime / c.hessianTime;
+        else
+          ss << std::setw (12) << "-"
+             << std::setw (12) << 1e9 * c.autoDiffHessianTime
+             << std::setw (8) << "-";
+        ss << std::scientific << std::setprecision (1)
+           << std::setw (12) << std::max (c.gradientError, c.hessianError)
+           << std::endl;
+        ss.unsetf (std::ios_base::floatfield);
+      }
+
+    o << ss.str ();
+  }
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_AUTODIFF_HH
@@ -0,0 +1,279 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_BASELINE_HH
+# define ROBOPTIM_SHARED_TESTS_BASELINE_HH
+# include <algorithm>
+# include <chrono>
+# include <cmath>
+# include <sstream>
+# include <string>
+# include <vector>
+
+# include <boost/filesystem.hpp>
+# include <boost/property_tree/json_parser.hpp>
+# include <boost/property_tree/ptree.hpp>
+
+# include "perf.hh"
+
+namespace roboptim
+{
+  /// \brief Reference performance of a test, used to detect regressions.
+  struct PerformanceBaseline
+  {
+    PerformanceBaseline ()
+      : iterations (-1),
+        computeCount (0),
+        gradientCount (0),
+        jacobianCount (0),
+        hessianCount (0),
+        wallTime (0.),
+        normalizedTime (0.)
+    {}
+
+    /// \brief Number of solver iterations (-1 if unknown).
+    long iterations;
+
+    /// \brief Evaluations summed over all the instrumented functions.
+    unsigned long computeCount;
+    unsigned long gradientCount;
+    unsigned long jacobianCount;
+    unsigned long hessianCount;
+
+    /// \brief Wall-clock solve time (in seconds).
+    double wallTime;
+
+    /// \brief Solve time divided by the reference time of the machine
+    /// (see referenceTime).
+    double normalizedTime;
+  };
+
+  /// \brief Relative tolerances of the baseline check.
+  struct BaselineTolerance
+  {
+    BaselineTolerance ()
+      : time (0.5),
+        count (0.2),
+        minTime (0.01)
+    {}
+
+    /// \brief Allowed relative increase of the normalized solve time.
+    double time;
+
+    /// \brief Allowed relative increase of iterations and evaluations.
+    double count;
+
+    /// \brief Time differences below this value (in seconds) are
+    /// considered as noise.
+    double minTime;
+  };
+
+  /// \brief Time of a fixed CPU-bound workload on this machine (in
+  /// seconds), used to normalize solve times across machines.
+  ///
+  /// The workload is run once per process (best of 5).
+  inline double referenceTime ()
+  {
+    static double time = -1.;
+    if (time > 0.)
+      return time;
+
+    for (int run = 0; run < 5; ++run)
+      {
+        std::chrono::steady_clock::time_point start
+          = std::chrono::steady_clock::now ();
+
+        // Mix of floating-point arithmetic and memory accesses.
+        std::vector<double> v (4096, 1.);
+        double acc = 0.;
+        for (int i = 0; i < 500; ++i)
+          for (std::size_t j = 1; j < v.size (); ++j)
+            {
+              v[j] = std::sqrt (v[j] + v[j - 1] * 1e-3);
+              acc += v[j];
+            }
+
+        double t = std::chrono::duration<double>
+          (std::chrono::steady_clock::now () - start).count ();
+        // Keep acc alive.
+        if (acc < 0.)
+          t = 0.;
+        if (time < 0. || t < time)
+          time = t;
+      }
+
+    return time;
+  }
+
+  /// \brief Baseline corresponding to a performance record.
+  inline PerformanceBaseline makeBaseline (const PerformanceRecord& record)
+  {
+    PerformanceBaseline b;
+    b.iterations = record.iterations;
+    for (std::size_t i = 0; i < record.functions.size (); ++i)
+      {
+        b.computeCount += record.functions[i].computeCount;
+        b.gradientCount += record.functions[i].gradientCount;
+        b.jacobianCount += record.functions[i].jacobianCount;
+        b.hessianCount += record.functions[i].hessianCount;
+      }
+    b.wallTime = record.wallTime;
+    b.normalizedTime = record.wallTime / referenceTime ();
+    return b;
+  }
+
+  namespace detail
+  {
+    typedef boost::property_tree::ptree ptree_t;
+
+    inline ptree_t::path_type baselineKey (const std::string& test)
+    {
+      // Test names may contain dots, which are ptree path separators.
+      return ptree_t::path_type (test, '/');
+    }
+
+    inline ptree_t readBaselineFile (const boost::filesystem::path& file)
+    {
+      ptree_t tree;
+      if (boost::filesystem::exists (file))
+        boost::property_tree::read_json (file.string (), tree);
+      return tree;
+    }
+  } // end of namespace detail
+
+  /// \brief Read the baseline of a test.
+  ///
+  /// \param file baseline file of the test executable.
+  /// \param test name of the test case.
+  /// \param baseline baseline read.
+  ///
+  /// \return false if there is no baseline for this test.
+  inline bool readPerformanceBaseline (const boost::filesystem::path& file,
+                                       const std::string& test,
+                                       PerformanceBaseline& baseline)
+  {
+    detail::ptree_t tree = detail::readBaselineFile (file);
+    boost::optional<detail::ptree_t&> node =
+      tree.get_child_optional (detail::baselineKey (test));
+    if (!node)
+      return false;
+
+    baseline.iterations = node->get<long> ("iterations", -1);
+    baseline.computeCount = node->get<unsigned long> ("compute", 0);
+    baseline.gradientCount = node->get<unsigned long> ("gradient", 0);
+    baseline.jacobianCount = node->get<unsigned long> ("jacobian", 0);
+    baseline.hessianCount = node->get<unsigned long> ("hessian", 0);
+    baseline.wallTime = node->get<double> ("wall_time", 0.);
+    baseline.normalizedTime = node->get<double> ("normalized_time", 0.);
+    return true;
+  }
+
+  /// \brief Store the baseline of a test, keeping the baselines of the
+  /// other tests of the file.
+  ///
+  /// \param file baseline file of the test executable.
+  /// \param record performance record of the test.
+  inline void writePerformanceBaseline (const boost::filesystem::path& file,
+                                        const PerformanceRecord& record)
+  {
+    PerformanceBaseline b = makeBaseline (record);
+
+    detail::ptree_t node;
+    node.put ("solver", record.solver);
+    node.put ("function_type", record.functionType);
+    node.put ("iterations", b.iterations);
+    node.put ("compute", b.computeCount);
+    node.put ("gradient", b.gradientCount);
+    node.put ("jacobian", b.jacobianCount);
+    node.put ("hessian", b.hessianCount);
+    node.put ("wall_time", b.wallTime);
+    node.put ("normalized_time", b.normalizedTime);
+
+    detail::ptree_t tree = detail::readBaselineFile (file);
+    tree.put_child (detail::baselineKey (record.test), node);
+
+    if (file.has_parent_path ())
+      boost::filesystem::create_directories (file.parent_path ());
+    boost::property_tree::write_json (file.string (), tree);
+  }
+
+  /// \brief Compare a run to its baseline.
+  ///
+  /// \param baseline reference performance.
+  /// \param record performance record of the run.
+  /// \param tolerance allowed regressions.
+  /// \param report description of the regressions (if any).
+  ///
+  /// \return true if the run did not regress.
+  inline bool checkPerformanceBaseline (const PerformanceBaseline& baseline,
+                                        const PerformanceRecord& record,
+                                        const BaselineTolerance& tolerance,
+                                        std::string& report)
+  {
+    PerformanceBaseline current = makeBaseline (record);
+    std::ostringstream ss;
+    bool ok = true;
+
+    // Counts: allow a relative increase, plus one for small counts.
+    struct
+    {
+      const char* name;
+      double base;
+      double value;
+    } counts[] = {
+      {"iterations", static_cast<double> (baseline.iterations),
+       static_cast<double> (current.iterations)},
+      {"compute", static_cast<double> (baseline.computeCount),
+       static_cast<double> (current.computeCount)},
+      {"gradient", static_cast<double> (baseline.gradientCount),
+       static_cast<double> (current.gradientCount)},
+      {"jacobian", static_cast<double> (baseline.jacobianCount),
+       static_cast<double> (current.jacobianCount)},
+      {"hessian", static_cast<double> (baseline.hessianCount),
+       static_cast<double> (current.hessianCount)}
+    };
+    for (std::size_t i = 0; i < sizeof (counts) / sizeof (counts[0]); ++i)
+      {
+        if (counts[i].base < 0. || counts[i].value < 0.)
+          continue;
+        if (counts[i].value > counts[i].base * (1. + tolerance.count) + 1.)
+          {
+            ss << counts[i].name << ": " << counts[i].value
+               << " (baseline: " << counts[i].base << "); ";
+            ok = false;
+          }
+      }
+
+    // Normalized time, ignoring differences that are within timer noise.
+    double maxTime = baseline.normalizedTime * (1. + tolerance.time);
+    double diff = (current.normalizedTime - baseline.normalizedTime)
+      * referenceTime ();
+    if (current.normalizedTime > maxTime && diff > tolerance.minTime)
+      {
+        ss << "normalized time: " << current.normalizedTime
+           << " (baseline: " << baseline.normalizedTime << ", +"
+           << 100. * (current.normalizedTime / baseline.normalizedTime - 1.)
+           << "%); ";
+        ok = false;
+      }
+
+    report = ss.str ();
+    return ok;
+  }
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_BASELINE_HH
@@ -0,0 +1,297 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+// Forward-mode automatic differentiation of some Schittkowski problems,
+// compared to their hand-coded derivatives. This file is linked with the
+// problems it compares to (see benchmark/CMakeLists.txt).
+
+#include "common.hh"
+#include "autodiff.hh"
+
+#include <vector>
+
+namespace roboptim
+{
+  namespace benchmark
+  {
+    namespace autodiff
+    {
+      namespace problem1
+      {
+        template <typename T>
+        struct F : public GenericAutoDiffFunction<T, F<T> >
+        {
+          F ()
+            : GenericAutoDiffFunction<T, F<T> >
+              (2, 1, "100 (x₁ - x₀²)² + (1 - x₀)²")
+          {}
+
+          template <typename S>
+          void evaluate (S* result, const S* x) const
+          {
+            using std::pow;
+            result[0] = 100 * pow (x[1] - pow (x[0], 2), 2)
+              + pow (1 - x[0], 2);
+          }
+        };
+
+        template <typename T>
+        std::vector<boost::shared_ptr<GenericTwiceDifferentiableFunction<T> > >
+        functions ()
+        {
+          std::vector<boost::shared_ptr<GenericTwiceDifferentiableFunction<T> > >
+            f;
+          f.push_back (boost::make_shared<F<T> > ());
+          return f;
+        }
+      } // end of namespace problem1
+
+      namespace problem43
+      {
+        template <typename T>
+        struct F : public GenericAutoDiffFunction<T, F<T> >
+        {
+          F ()
+            : GenericAutoDiffFunction<T, F<T> >
+              (4, 1, "x₀² + x₁² + 2x₂² + x₃² - 5x₀ - 5x₁ - 21x₂ + 7x₃")
+          {}
+
+          template <typename S>
+          void evaluate (S* result, const S* x) const
+          {
+            using std::pow;
+            result[0] = pow (x[0], 2) + pow (x[1], 2) + 2. * pow (x[2], 2)
+              + pow (x[3], 2) - 5. * x[0] - 5. * x[1] - 21. * x[2]
+              + 7. * x[3];
+          }
+        };
+
+        template <typename T>
+        struct G : public GenericAutoDiffFunction<T, G<T> >
+        {
+          G ()
+            : GenericAutoDiffFunction<T, G<T> >
+              (4, 1, "8 - x₀² - x₁² - x₂² - x₃² - x₀ + x₁ - x₂ + x₃")
+          {}
+
+          template <typename S>
+          void evaluate (S* result, const S* x) const
+          {
+            using std::pow;
+            result[0] = 8. - pow (x[0], 2) - pow (x[1], 2) - pow (x[2], 2)
+              - pow (x[3], 2) - x[0] + x[1] - x[2] + x[3];
+          }
+        };
+
+        template <typename T>
+        struct G2 : public GenericAutoDiffFunction<T, G2<T> >
+        {
+          G2 ()
+            : GenericAutoDiffFunction<T, G2<T> >
+              (4, 1, "10 - x₀² - 2x₁² - x₂² - 2x₃² + x₀ + x₃")
+          {}
+
+          template <typename S>
+          void evaluate (S* result, const S* x) const
+          {
+            using std::pow;
+            result[0] = 10. - pow (x[0], 2) - 2. * pow (x[1], 2)
+              - pow (x[2], 2) - 2. * pow (x[3], 2) + x[0] + x[3];
+          }
+        };
+
+        template <typename T>
+        struct G3 : public GenericAutoDiffFunction<T, G3<T> >
+        {
+          G3 ()
+            : GenericAutoDiffFunction<T, G3<T> >
+              (4, 1, "5 - 2x₀² - x₁² - x₂² - 2x₀ + x₁ + x₃")
+          {}
+
+          template <typename S>
+          void evaluate (S* result, const S* x) const
+          {
+            using std::pow;
+            result[0] = 5. - 2. * pow (x[0], 2) - pow (x[1], 2)
+              - pow (x[2], 2) - 2. * x[0] + x[1] + x[3];
+          }
+        };
+
+        template <typename T>
+        std::vector<boost::shared_ptr<GenericTwiceDifferentiableFunction<T> > >
+        functions ()
+        {
+          std::vector<boost::shared_ptr<GenericTwiceDifferentiableFunction<T> > >
+            f;
+          f.push_back (boost::make_shared<F<T> > ());
+          f.push_back (boost::make_shared<G<T> > ());
+          f.push_back (boost::make_shared<G2<T> > ());
+          f.push_back (boost::make_shared<G3<T> > ());
+          return f;
+        }
+      } // end of namespace problem43
+
+      namespace problem71
+      {
+        template <typename T>
+        struct F : public GenericAutoDiffFunction<T, F<T> >
+        {
+          F ()
+            : GenericAutoDiffFunction<T, F<T> >
+              (4, 1, "x₀ x₃ (x₀ + x₁ + x₂) + x₂")
+          {}
+
+          template <typename S>
+          void evaluate (S* result, const S* x) const
+          {
+            result[0] = x[0] * x[3] * (x[0] + x[1] + x[2]) + x[2];
+          }
+        };
+
+        template <typename T>
+        struct G0 : public GenericAutoDiffFunction<T, G0<T> >
+        {
+          G0 ()
+            : GenericAutoDiffFunction<T, G0<T> > (4, 1, "x₀ x₁ x₂ x₃")
+          {}
+
+          template <typename S>
+          void evaluate (S* result, const S* x) const
+          {
+            result[0] = x[0] * x[1] * x[2] * x[3];
+          }
+        };
+
+        template <typename T>
+        struct G1 : public GenericAutoDiffFunction<T, G1<T> >
+        {
+          G1 ()
+            : GenericAutoDiffFunction<T, G1<T> >
+              (4, 1, "x₀² + x₁² + x₂² + x₃²")
+          {}
+
+          template <typename S>
+          void evaluate (S* result, const S* x) const
+          {
+            result[0] = x[0] * x[0] + x[1] * x[1] + x[2] * x[2]
+              + x[3] * x[3];
+          }
+        };
+
+        template <typename T>
+        std::vector<boost::shared_ptr<GenericTwiceDifferentiableFunction<T> > >
+        functions ()
+        {
+          std::vector<boost::shared_ptr<GenericTwiceDifferentiableFunction<T> > >
+            f;
+          f.push_back (boost::make_shared<F<T> > ());
+          f.push_back (boost::make_shared<G0<T> > ());
+          f.push_back (boost::make_shared<G1<T> > ());
+          return f;
+        }
+      } // end of namespace problem71
+
+      namespace problem81
+      {
+        template <typename T>
+        struct F : public GenericAutoDiffFunction<T, F<T> >
+        {
+          F ()
+            : GenericAutoDiffFunction<T, F<T> >
+              (5, 1, "exp(x₀x₁x₂x₃x₄) - 0.5(x₀³ + x₁³ + 1)²")
+          {}
+
+          template <typename S>
+          void evaluate (S* result, const S* x) const
+          {
+            using std::exp;
+            using std::pow;
+            result[0] = exp (x[0] * x[1] * x[2] * x[3] * x[4])
+              - 0.5 * pow (pow (x[0], 3) + pow (x[1], 3) + 1, 2);
+          }
+        };
+
+        template <typename T>
+        struct G : public GenericAutoDiffFunction<T, G<T> >
+        {
+          G ()
+            : GenericAutoDiffFunction<T, G<T> >
+              (5, 3, "x₀² + x₁² + x₂² + x₃² + x₄² - 10,"
+               " x₁x₂ - 5x₃x₄, x₀³ + x₁³ + 1")
+          {}
+
+          template <typename S>
+          void evaluate (S* result, const S* x) const
+          {
+            using std::pow;
+            result[0] = x[0] * x[0] + x[1] * x[1] + x[2] * x[2]
+              + x[3] * x[3] + x[4] * x[4] - 10;
+            result[1] = x[1] * x[2] - 5 * x[3] * x[4];
+            result[2] = pow (x[0], 3) + pow (x[1], 3) + 1;
+          }
+        };
+
+        template <typename T>
+        std::vector<boost::shared_ptr<GenericTwiceDifferentiableFunction<T> > >
+        functions ()
+        {
+          std::vector<boost::shared_ptr<GenericTwiceDifferentiableFunction<T> > >
+            f;
+          f.push_back (boost::make_shared<F<T> > ());
+          f.push_back (boost::make_shared<G<T> > ());
+          return f;
+        }
+      } // end of namespace problem81
+    } // end of namespace autodiff
+  } // end of namespace benchmark
+} // end of namespace roboptim
+
+BOOST_FIXTURE_TEST_SUITE (autodiff, TestSuiteConfiguration)
+
+BOOST_AUTO_TEST_CASE (autodiff_schittkowski)
+{
+  using namespace roboptim;
+  namespace ad = roboptim::benchmark::autodiff;
+
+  std::vector<AutoDiffComparison> comparisons;
+  comparisons.push_back (compareAutoDiff<functionType_t>
+                         ("schittkowski_problem1",
+                          ad::problem1::functions<functionType_t> ()));
+  comparisons.push_back (compareAutoDiff<functionType_t>
+                         ("schittkowski_problem43",
+                          ad::problem43::functions<functionType_t> ()));
+  comparisons.push_back (compareAutoDiff<functionType_t>
+                         ("problem_71",
+                          ad::problem71::functions<functionType_t> ()));
+  comparisons.push_back (compareAutoDiff<functionType_t>
+                         ("schittkowski_problem81",
+                          ad::problem81::functions<functionType_t> ()));
+
+  printAutoDiffComparison (std::cout, comparisons);
+
+  for (std::size_t i = 0; i < comparisons.size (); ++i)
+    {
+      BOOST_CHECK_MESSAGE (comparisons[i].gradientError < 1e-9,
+                           comparisons[i].problem << ": gradient error "
+                           << comparisons[i].gradientError);
+      BOOST_CHECK_MESSAGE (comparisons[i].hessianError < 1e-9,
+                           comparisons[i].problem << ": hessian error "
+                           << comparisons[i].hessianError);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END ()
@@ -17,8 +17,26 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "finite-difference.hh"
+#include "fused.hh"
+#include "problem-job.hh"
+#include "runner.hh"
+#include "sweep.hh"
+#include "tape.hh"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#if defined __AVX__
+# include <immintrin.h>
+#elif defined __SSE2__
+# include <emmintrin.h>
+#endif //! __AVX__
 
 namespace roboptim
 {
@@ -26,9 +44,258 @@ namespace roboptim
   {
     namespace problem17
     {
+      /// \brief Kernels of the chained Rosenbrock objective.
+      ///
+      /// x holds n interleaved pairs (x₀, x₁). The vectorized kernels
+      /// load several pairs at once and deinterleave them into even (x₀)
+      /// and odd (x₁) lanes. The instruction set is selected at compile
+      /// time (AVX with -mavx/-mavx2/-march=native, SSE2 on x86-64), with
+      /// a scalar fallback elsewhere.
+      namespace kernel
+      {
+        /// \brief Instruction set used by the vectorized kernels.
+        inline const char* instructionSet ()
+        {
+#if defined __AVX2__
+          return "AVX2";
+#elif defined __AVX__
+          return "AVX";
+#elif defined __SSE2__
+          return "SSE2";
+#else
+          return "scalar";
+#endif //! __AVX2__
+        }
+
+        /// \brief Sum of 100 (x₁ - x₀²)² + (1 - x₀)² over the n pairs
+        /// (reference scalar loop).
+        inline double valueScalar (const double* x, long n)
+        {
+          double sum = 0.;
+          for (long idx = 0; idx < 2*n; idx += 2)
+          {
+            sum += 100 * (x[idx+1] - x[idx] * x[idx]) * (x[idx+1] - x[idx] * x[idx])
+              + (1 - x[idx]) * (1 - x[idx]);
+          }
+          return sum;
+        }
+
+        /// \brief Gradient of the sum, multiplied by scale (reference
+        /// scalar loop).
+        inline void gradientScalar (double* grad, const double* x, long n,
+                                    double scale)
+        {
+          for (long idx = 0; idx < 2*n; idx += 2)
+          {
+            grad[idx] = scale *
+              (400. * x[idx] * x[idx] * x[idx]
+               - 400. * x[idx] * x[idx+1] + 2 * x[idx] - 2);
+            grad[idx+1] = scale * (-200. * x[idx] * x[idx] + 200. * x[idx+1]);
+          }
+        }
+
+        /// \brief Vectorized version of valueScalar.
+        inline double value (const double* x, long n)
+        {
+          long i = 0;
+          double sum = 0.;
+#if defined __AVX__
+          const __m256d one = _mm256_set1_pd (1.);
+          const __m256d c100 = _mm256_set1_pd (100.);
+          __m256d acc = _mm256_setzero_pd ();
+          for (; i + 4 <= n; i += 4)
+          {
+            // Pairs i to i+3: even = x₀ lanes, odd = x₁ lanes (the lane
+            // order is permuted the same way for both).
+            __m256d lo = _mm256_loadu_pd (x + 2*i);
+            __m256d hi = _mm256_loadu_pd (x + 2*i + 4);
+            __m256d even = _mm256_unpacklo_pd (lo, hi);
+            __m256d odd = _mm256_unpackhi_pd (lo, hi);
+
+            __m256d d = _mm256_sub_pd (odd, _mm256_mul_pd (even, even));
+            __m256d e = _mm256_sub_pd (one, even);
+            acc = _mm256_add_pd
+              (acc, _mm256_add_pd (_mm256_mul_pd (c100, _mm256_mul_pd (d, d)),
+                                   _mm256_mul_pd (e, e)));
+          }
+          double lanes[4];
+          _mm256_storeu_pd (lanes, acc);
+          sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined __SSE2__
+          const __m128d one = _mm_set1_pd (1.);
+          const __m128d c100 = _mm_set1_pd (100.);
+          __m128d acc = _mm_setzero_pd ();
+          for (; i + 2 <= n; i += 2)
+          {
+            __m128d lo = _mm_loadu_pd (x + 2*i);
+            __m128d hi = _mm_loadu_pd (x + 2*i + 2);
+            __m128d even = _mm_unpacklo_pd (lo, hi);
+            __m128d odd = _mm_unpackhi_pd (lo, hi);
+
+            __m128d d = _mm_sub_pd (odd, _mm_mul_pd (even, even));
+            __m128d e = _mm_sub_pd (one, even);
+            acc = _mm_add_pd
+              (acc, _mm_add_pd (_mm_mul_pd (c100, _mm_mul_pd (d, d)),
+                                _mm_mul_pd (e, e)));
+          }
+          double lanes[2];
+          _mm_storeu_pd (lanes, acc);
+          sum = lanes[0] + lanes[1];
+#endif //! __AVX__
+          return sum + valueScalar (x + 2*i, n - i);
+        }
+
+        /// \brief Vectorized version of gradientScalar.
+        ///
+        /// Uses ∂/∂x₀ = -400 x₀ (x₁ - x₀²) - 2 (1 - x₀) and
+        /// ∂/∂x₁ = 200 (x₁ - x₀²).
+        inline void gradient (double* grad, const double* x, long n,
+                              double scale)
+        {
+          long i = 0;
+#if defined __AVX__
+          const __m256d one = _mm256_set1_pd (1.);
+          const __m256d cEven = _mm256_set1_pd (-400. * scale);
+          const __m256d cEvenLin = _mm256_set1_pd (-2. * scale);
+          const __m256d cOdd = _mm256_set1_pd (200. * scale);
+          for (; i + 4 <= n; i += 4)
+          {
+            __m256d lo = _mm256_loadu_pd (x + 2*i);
+            __m256d hi = _mm256_loadu_pd (x + 2*i + 4);
+            __m256d even = _mm256_unpacklo_pd (lo, hi);
+            __m256d odd = _mm256_unpackhi_pd (lo, hi);
+
+            __m256d d = _mm256_sub_pd (odd, _mm256_mul_pd (even, even));
+            __m256d e = _mm256_sub_pd (one, even);
+            __m256d gEven = _mm256_add_pd
+              (_mm256_mul_pd (cEven, _mm256_mul_pd (even, d)),
+               _mm256_mul_pd (cEvenLin, e));
+            __m256d gOdd = _mm256_mul_pd (cOdd, d);
+
+            // Interleave back: the unpack permutation is its own inverse.
+            _mm256_storeu_pd (grad + 2*i, _mm256_unpacklo_pd (gEven, gOdd));
+            _mm256_storeu_pd (grad + 2*i + 4, _mm256_unpackhi_pd (gEven, gOdd));
+          }
+#elif defined __SSE2__
+          const __m128d one = _mm_set1_pd (1.);
+          const __m128d cEven = _mm_set1_pd (-400. * scale);
+          const __m128d cEvenLin = _mm_set1_pd (-2. * scale);
+          const __m128d cOdd = _mm_set1_pd (200. * scale);
+          for (; i + 2 <= n; i += 2)
+          {
+            __m128d lo = _mm_loadu_pd (x + 2*i);
+            __m128d hi = _mm_loadu_pd (x + 2*i + 2);
+            __m128d even = _mm_unpacklo_pd (lo, hi);
+            __m128d odd = _mm_unpackhi_pd (lo, hi);
+
+            __m128d d = _mm_sub_pd (odd, _mm_mul_pd (even, even));
+            __m128d e = _mm_sub_pd (one, even);
+            __m128d gEven = _mm_add_pd
+              (_mm_mul_pd (cEven, _mm_mul_pd (even, d)),
+               _mm_mul_pd (cEvenLin, e));
+            __m128d gOdd = _mm_mul_pd (cOdd, d);
+
+            _mm_storeu_pd (grad + 2*i, _mm_unpacklo_pd (gEven, gOdd));
+            _mm_storeu_pd (grad + 2*i + 2, _mm_unpackhi_pd (gEven, gOdd));
+          }
+#endif //! __AVX__
+          gradientScalar (grad + 2*i, x + 2*i, n - i, scale);
+        }
+
+        /// \brief Sum and scaled gradient in a single pass (reference
+        /// scalar loop): x₁ - x₀² and 1 - x₀ are computed once.
+        inline double valueAndGradientScalar (double* grad, const double* x,
+                                              long n, double scale)
+        {
+          double sum = 0.;
+          for (long idx = 0; idx < 2*n; idx += 2)
+          {
+            double d = x[idx+1] - x[idx] * x[idx];
+            double e = 1 - x[idx];
+            sum += 100 * d * d + e * e;
+            grad[idx] = scale * (-400. * x[idx] * d - 2 * e);
+            grad[idx+1] = scale * 200. * d;
+          }
+          return sum;
+        }
+
+        /// \brief Vectorized version of valueAndGradientScalar: x is read
+        /// once for both the value and the gradient.
+        inline double valueAndGradient (double* grad, const double* x, long n,
+                                        double scale)
+        {
+          long i = 0;
+          double sum = 0.;
+#if defined __AVX__
+          const __m256d one = _mm256_set1_pd (1.);
+          const __m256d c100 = _mm256_set1_pd (100.);
+          const __m256d cEven = _mm256_set1_pd (-400. * scale);
+          const __m256d cEvenLin = _mm256_set1_pd (-2. * scale);
+          const __m256d cOdd = _mm256_set1_pd (200. * scale);
+          __m256d acc = _mm256_setzero_pd ();
+          for (; i + 4 <= n; i += 4)
+          {
+            __m256d lo = _mm256_loadu_pd (x + 2*i);
+            __m256d hi = _mm256_loadu_pd (x + 2*i + 4);
+            __m256d even = _mm256_unpacklo_pd (lo, hi);
+            __m256d odd = _mm256_unpackhi_pd (lo, hi);
+
+            __m256d d = _mm256_sub_pd (odd, _mm256_mul_pd (even, even));
+            __m256d e = _mm256_sub_pd (one, even);
+            acc = _mm256_add_pd
+              (acc, _mm256_add_pd (_mm256_mul_pd (c100, _mm256_mul_pd (d, d)),
+                                   _mm256_mul_pd (e, e)));
+            __m256d gEven = _mm256_add_pd
+              (_mm256_mul_pd (cEven, _mm256_mul_pd (even, d)),
+               _mm256_mul_pd (cEvenLin, e));
+            __m256d gOdd = _mm256_mul_pd (cOdd, d);
+
+            _mm256_storeu_pd (grad + 2*i, _mm256_unpacklo_pd (gEven, gOdd));
+            _mm256_storeu_pd (grad + 2*i + 4, _mm256_unpackhi_pd (gEven, gOdd));
+          }
+          double lanes[4];
+          _mm256_storeu_pd (lanes, acc);
+          sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined __SSE2__
+          const __m128d one = _mm_set1_pd (1.);
+          const __m128d c100 = _mm_set1_pd (100.);
+          const __m128d cEven = _mm_set1_pd (-400. * scale);
+          const __m128d cEvenLin = _mm_set1_pd (-2. * scale);
+          const __m128d cOdd = _mm_set1_pd (200. * scale);
+          __m128d acc = _mm_setzero_pd ();
+          for (; i + 2 <= n; i += 2)
+          {
+            __m128d lo = _mm_loadu_pd (x + 2*i);
+            __m128d hi = _mm_loadu_pd (x + 2*i + 2);
+            __m128d even = _mm_unpacklo_pd (lo, hi);
+            __m128d odd = _mm_unpackhi_pd (lo, hi);
+
+            __m128d d = _mm_sub_pd (odd, _mm_mul_pd (even, even));
+            __m128d e = _mm_sub_pd (one, even);
+            acc = _mm_add_pd
+              (acc, _mm_add_pd (_mm_mul_pd (c100, _mm_mul_pd (d, d)),
+                                _mm_mul_pd (e, e)));
+            __m128d gEven = _mm_add_pd
+              (_mm_mul_pd (cEven, _mm_mul_pd (even, d)),
+               _mm_mul_pd (cEvenLin, e));
+            __m128d gOdd = _mm_mul_pd (cOdd, d);
+
+            _mm_storeu_pd (grad + 2*i, _mm_unpacklo_pd (gEven, gOdd));
+            _mm_storeu_pd (grad + 2*i + 2, _mm_unpackhi_pd (gEven, gOdd));
+          }
+          double lanes[2];
+          _mm_storeu_pd (lanes, acc);
+          sum = lanes[0] + lanes[1];
+#endif //! __AVX__
+          return sum + valueAndGradientScalar (grad + 2*i, x + 2*i, n - i,
+                                               scale);
+        }
+      } // end of namespace kernel
+
       // Same than problem_15
       template <typename T>
-        class F : public GenericDifferentiableFunction<T>
+        class F : public GenericDifferentiableFunction<T>,
+                  public GenericFusedEvaluation<T>
       {
       public:
         ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
@@ -40,6 +307,9 @@ namespace roboptim
         void
           impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
           const;
+        void
+          impl_valueAndGradient (result_ref result, gradient_ref grad,
+                                 const_argument_ref x, size_type) const;
 
       private:
         size_type n_;
@@ -57,13 +327,8 @@ namespace roboptim
         F<T>::impl_compute (result_ref result, const_argument_ref x)
         const
         {
-          result[0] = 0.;
-          for (size_type idx = 0; idx < 2*n_; idx += 2)
-          {
-            result[0] += 100 * (x[idx+1] - x[idx] * x[idx]) * (x[idx+1] - x[idx] * x[idx])
-              + (1 - x[idx]) * (1 - x[idx]);
-          }
-          result[0] /= static_cast<value_type> (n_);
+          result[0] = kernel::value (x.data (), n_)
+            / static_cast<value_type> (n_);
         }
 
       template <>
@@ -72,14 +337,30 @@ namespace roboptim
         (gradient_ref grad, const_argument_ref x, size_type)
         const
         {
-          for (size_type idx = 0; idx < 2*n_; idx += 2)
+          value_type scale = 1. / static_cast<value_type> (n_);
+
+          if (sparseFillMode () == SPARSE_FILL_INSERT)
+          {
+            for (size_type idx = 0; idx < 2*n_; idx += 2)
+            {
+              value_type g[2];
+              kernel::gradientScalar (g, x.data () + idx, 1, scale);
+              grad.coeffRef (idx) = g[0];
+              grad.coeffRef (idx+1) = g[1];
+            }
+            return;
+          }
+
+          // The gradient is dense: once all the entries are stored, the
+          // values are in index order and can be written directly.
+          if (grad.nonZeros () != 2*n_)
           {
-            grad.coeffRef (idx) =
-              400. * x[idx] * x[idx] * x[idx]
-              - 400. * x[idx] * x[idx+1] + 2 * x[idx] - 2;
-              grad.coeffRef (idx+1) = -200 * x[idx] * x[idx] + 200 * x[idx+1];
+            grad.setZero ();
+            grad.reserve (2*n_);
+            for (size_type idx = 0; idx < 2*n_; ++idx)
+              grad.insertBack (idx) = 0.;
           }
-          grad /= static_cast<value_type> (n_);
+          kernel::gradient (grad.valuePtr (), x.data (), n_, scale);
         }
 
       template <typename T>
@@ -87,14 +368,46 @@ namespace roboptim
         F<T>::impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
         const
         {
-          for (size_type idx = 0; idx < 2*n_; idx += 2)
+          kernel::gradient (grad.data (), x.data (), n_,
+                            1. / static_cast<value_type> (n_));
+        }
+
+      template <>
+        void
+        F<EigenMatrixSparse>::impl_valueAndGradient
+        (result_ref result, gradient_ref grad, const_argument_ref x,
+         size_type functionId)
+        const
+        {
+          if (sparseFillMode () == SPARSE_FILL_INSERT)
           {
-            grad[idx] =
-              400. * x[idx] * x[idx] * x[idx]
-              - 400. * x[idx] * x[idx+1] + 2 * x[idx] - 2;
-              grad[idx+1] = -200. * x[idx] * x[idx] + 200. * x[idx+1];
+            F::impl_compute (result, x);
+            F::impl_gradient (grad, x, functionId);
+            return;
           }
-          grad /= static_cast<value_type> (n_);
+
+          // Dense gradient (see impl_gradient).
+          if (grad.nonZeros () != 2*n_)
+          {
+            grad.setZero ();
+            grad.reserve (2*n_);
+            for (size_type idx = 0; idx < 2*n_; ++idx)
+              grad.insertBack (idx) = 0.;
+          }
+          value_type scale = 1. / static_cast<value_type> (n_);
+          result[0] = scale
+            * kernel::valueAndGradient (grad.valuePtr (), x.data (), n_, scale);
+        }
+
+      template <typename T>
+        void
+        F<T>::impl_valueAndGradient
+        (result_ref result, gradient_ref grad, const_argument_ref x, size_type)
+        const
+        {
+          value_type scale = 1. / static_cast<value_type> (n_);
+          result[0] = scale
+            * kernel::valueAndGradient (grad.data (), x.data (), n_, scale);
         }
 
       template <typename T>
@@ -113,6 +426,7 @@ namespace roboptim
 
       private:
         size_type idx_;
+        int pattern_[2];
       };
 
       template <typename T>
@@ -120,7 +434,10 @@ namespace roboptim
         : GenericDifferentiableFunction<T>
           (2*n, 1, "x₁² - x₀"),
           idx_ (i)
-      {}
+      {
+        pattern_[0] = static_cast<int> (i);
+        pattern_[1] = static_cast<int> (i + 1);
+      }
 
       template <typename T>
         void
@@ -136,8 +453,9 @@ namespace roboptim
         (gradient_ref grad, const_argument_ref x, size_type)
         const
         {
-          grad.coeffRef (idx_) = -1.;
-          grad.coeffRef (idx_+1) = 2 * x[idx_+1];
+          StructuredGradient<gradient_t> g (grad, pattern_);
+          g (idx_) = -1.;
+          g (idx_+1) = 2 * x[idx_+1];
         }
 
       template <typename T>
@@ -166,6 +484,7 @@ namespace roboptim
 
       private:
         size_type idx_;
+        int pattern_[2];
       };
 
       template <typename T>
@@ -173,7 +492,10 @@ namespace roboptim
         : GenericDifferentiableFunction<T>
           (2*n, 1, "x₀² - x₁"),
           idx_ (i)
-      {}
+      {
+        pattern_[0] = static_cast<int> (i);
+        pattern_[1] = static_cast<int> (i + 1);
+      }
 
       template <typename T>
         void
@@ -189,8 +511,9 @@ namespace roboptim
         (gradient_ref grad, const_argument_ref x, size_type)
         const
         {
-          grad.coeffRef (idx_) = 2 * x[idx_];
-          grad.coeffRef (idx_+1) = -1.;
+          StructuredGradient<gradient_t> g (grad, pattern_);
+          g (idx_) = 2 * x[idx_];
+          g (idx_+1) = -1.;
         }
 
       template <typename T>
@@ -201,92 +524,978 @@ namespace roboptim
           grad[idx_] = 2 * x[idx_];
           grad[idx_+1] = -1.;
         }
+
+      /// \brief All the G and G2 constraints stacked in a single function.
+      ///
+      /// Output 2i is G at index 2i, output 2i+1 is G2 at index 2i, so the
+      /// Jacobian is block diagonal with 2x2 blocks (4n nonzeros).
+      template <typename T>
+        class GStacked : public GenericDifferentiableFunction<T>
+      {
+      public:
+        ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+          (GenericDifferentiableFunction<T>);
+
+        explicit GStacked (size_type n);
+        void
+          impl_compute (result_ref result, const_argument_ref x) const;
+        void
+          impl_gradient (gradient_ref grad, const_argument_ref x,
+                         size_type functionId) const;
+        void
+          impl_jacobian (jacobian_ref jac, const_argument_ref x) const;
+
+        /// \brief Nonzero structure of the Jacobian.
+        const SparsityPattern& pattern () const
+        {
+          return pattern_;
+        }
+
+      private:
+        size_type n_;
+        SparsityPattern pattern_;
+      };
+
+      template <typename T>
+        GStacked<T>::GStacked (size_type n)
+        : GenericDifferentiableFunction<T>
+          (2*n, 2*n, "[x₁² - x₀, x₀² - x₁]"),
+          n_ (n),
+          pattern_ ()
+      {
+        for (size_type idx = 0; idx < 2*n; idx += 2)
+        {
+          int cols[] = {static_cast<int> (idx), static_cast<int> (idx+1)};
+          pattern_.addRow (cols);
+          pattern_.addRow (cols);
+        }
+      }
+
+      template <typename T>
+        void
+        GStacked<T>::impl_compute (result_ref result, const_argument_ref x)
+        const
+        {
+          for (size_type idx = 0; idx < 2*n_; idx += 2)
+          {
+            result[idx] = x[idx+1] * x[idx+1] - x[idx];
+            result[idx+1] = x[idx] * x[idx] - x[idx+1];
+          }
+        }
+
+      template <>
+        void
+        GStacked<EigenMatrixSparse>::impl_gradient
+        (gradient_ref grad, const_argument_ref x, size_type functionId)
+        const
+        {
+          size_type idx = functionId - functionId % 2;
+          std::size_t row = static_cast<std::size_t> (functionId);
+          StructuredGradient<gradient_t> g
+            (grad, pattern_.row (row), pattern_.rowSize (row));
+          if (functionId % 2 == 0)
+          {
+            g (idx) = -1.;
+            g (idx+1) = 2 * x[idx+1];
+          }
+          else
+          {
+            g (idx) = 2 * x[idx];
+            g (idx+1) = -1.;
+          }
+        }
+
+      template <typename T>
+        void
+        GStacked<T>::impl_gradient
+        (gradient_ref grad, const_argument_ref x, size_type functionId)
+        const
+        {
+          size_type idx = functionId - functionId % 2;
+          if (functionId % 2 == 0)
+          {
+            grad[idx] = -1.;
+            grad[idx+1] = 2 * x[idx+1];
+          }
+          else
+          {
+            grad[idx] = 2 * x[idx];
+            grad[idx+1] = -1.;
+          }
+        }
+
+      template <>
+        void
+        GStacked<EigenMatrixSparse>::impl_jacobian
+        (jacobian_ref jac, const_argument_ref x)
+        const
+        {
+          StructuredJacobian<jacobian_t> j (jac, pattern_);
+          for (size_type idx = 0; idx < 2*n_; idx += 2)
+          {
+            j (idx, idx) = -1.;
+            j (idx, idx+1) = 2 * x[idx+1];
+            j (idx+1, idx) = 2 * x[idx];
+            j (idx+1, idx+1) = -1.;
+          }
+        }
+
+      template <typename T>
+        void
+        GStacked<T>::impl_jacobian (jacobian_ref jac, const_argument_ref x)
+        const
+        {
+          jac.setZero ();
+          for (size_type idx = 0; idx < 2*n_; idx += 2)
+          {
+            jac (idx, idx) = -1.;
+            jac (idx, idx+1) = 2 * x[idx+1];
+            jac (idx+1, idx) = 2 * x[idx];
+            jac (idx+1, idx+1) = -1.;
+          }
+        }
+
+      /// \brief Cost function F whose gradient is computed by
+      /// reverse-mode automatic differentiation (see tape.hh).
+      template <typename T>
+        class FTape : public GenericTapeFunction<T, FTape<T> >
+      {
+      public:
+        ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+          (GenericDifferentiableFunction<T>);
+
+        explicit FTape (size_type n)
+          : GenericTapeFunction<T, FTape<T> >
+            (2*n, 1, "100 (x₁ - x₀²)² + (1 - x₀)²"),
+            n_ (n)
+        {}
+
+        template <typename S>
+          void evaluate (S* result, const S* x) const
+          {
+            S sum = 0.;
+            for (size_type idx = 0; idx < 2*n_; idx += 2)
+            {
+              S d = x[idx+1] - x[idx] * x[idx];
+              S e = 1. - x[idx];
+              sum += 100. * d * d + e * e;
+            }
+            result[0] = sum / static_cast<value_type> (n_);
+          }
+
+      private:
+        size_type n_;
+      };
+
+      /// \brief Formulation of the constraints of the problem.
+      enum ConstraintForm
+      {
+        /// \brief 2n scalar constraints G and G2 (default).
+        SCALAR_CONSTRAINTS,
+        /// \brief A single 2n-output constraint GStacked.
+        STACKED_CONSTRAINTS,
+        /// \brief Benchmark comparing both formulations.
+        COMPARE_CONSTRAINTS
+      };
+
+      /// \brief Command line of the benchmark.
+      struct CommandLine
+      {
+        CommandLine ()
+          : form (SCALAR_CONSTRAINTS),
+            argv ()
+        {}
+
+        /// \brief Constraint formulation ("scalar", "stacked" or
+        /// "compare" argument).
+        ConstraintForm form;
+
+        /// \brief Other arguments, starting with the program name.
+        std::vector<char*> argv;
+
+        int argc () const
+        {
+          return static_cast<int> (argv.size ());
+        }
+
+        /// \brief Mode of the benchmark (first argument, if any).
+        std::string mode () const
+        {
+          return argv.size () > 1 ? std::string (argv[1]) : std::string ();
+        }
+      };
+
+      /// \brief Parse the command line.
+      ///
+      /// The first "scalar", "stacked" or "compare" argument gives the
+      /// constraint formulation, and is not kept in the other arguments.
+      /// The arguments themselves are not modified.
+      inline CommandLine parseCommandLine (int argc, char** argv)
+      {
+        CommandLine cmd;
+        bool formFound = false;
+        for (int i = 0; i < argc; ++i)
+        {
+          std::string arg (argv[i]);
+          if (i > 0 && !formFound
+              && (arg == "scalar" || arg == "stacked" || arg == "compare"))
+          {
+            formFound = true;
+            if (arg == "stacked")
+              cmd.form = STACKED_CONSTRAINTS;
+            else if (arg == "compare")
+              cmd.form = COMPARE_CONSTRAINTS;
+            continue;
+          }
+          cmd.argv.push_back (argv[i]);
+        }
+        return cmd;
+      }
+
+      /// \brief Build problem 17 with 2n variables.
+      ///
+      /// \param n size parameter of the problem.
+      /// \param x0 starting point.
+      /// \param stacked whether to use a single stacked constraint.
+      ///
+      /// \return problem.
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem (typename F<T>::size_type n,
+                    typename F<T>::argument_t& x0,
+                    bool stacked = false)
+      {
+        typedef typename Solver<T>::problem_t problem_t;
+        typedef typename F<T>::size_type size_type;
+
+        boost::shared_ptr<F<T> > f (new Instrumented<F<T> > (n));
+        boost::shared_ptr<problem_t> problem =
+          boost::make_shared<problem_t> (f);
+        x0.resize (f->inputSize ());
+
+        for (size_type i = 0; i < n; ++i)
+        {
+          problem->argumentBounds ()[static_cast<size_t> (2*i)]
+            = F<T>::makeUpperInterval (1.);
+
+          if (!stacked)
+          {
+            boost::shared_ptr<G<T> > g =
+              boost::make_shared<Instrumented<G<T> > > (n, 2*i);
+            problem->addConstraint (g, G<T>::makeLowerInterval (0.));
+            boost::shared_ptr<G2<T> > g2 =
+              boost::make_shared<Instrumented<G2<T> > > (n, 2*i);
+            problem->addConstraint (g2, G2<T>::makeLowerInterval (0.));
+          }
+
+          x0[2*i] = -2.;
+          x0[2*i+1] = 1.;
+        }
+
+        if (stacked)
+        {
+          boost::shared_ptr<GStacked<T> > g =
+            boost::make_shared<Instrumented<GStacked<T> > > (n);
+
+          typename GStacked<T>::intervals_t bounds
+            (static_cast<std::size_t> (2*n), GStacked<T>::makeLowerInterval (0.));
+          typename problem_t::scaling_t scaling
+            (static_cast<std::size_t> (2*n), 1.);
+
+          problem->addConstraint
+            (boost::static_pointer_cast<
+             GenericDifferentiableFunction<T> > (g),
+             bounds, scaling);
+        }
+
+        problem->startingPoint () = x0;
+        return problem;
+      }
+
+      /// \brief Average time needed to evaluate the Jacobian of all the
+      /// constraints of the problem (in seconds).
+      ///
+      /// \param n size parameter of the problem.
+      /// \param stacked whether to use a single stacked constraint.
+      /// \param repetitions number of evaluations.
+      template <typename T>
+      double jacobianAssemblyTime (typename F<T>::size_type n, bool stacked,
+                                   int repetitions)
+      {
+        typedef GenericDifferentiableFunction<T> function_t;
+        typedef typename function_t::size_type size_type;
+        typedef typename function_t::jacobian_t jacobian_t;
+
+        std::vector<boost::shared_ptr<function_t> > constraints;
+        if (stacked)
+          constraints.push_back (boost::make_shared<GStacked<T> > (n));
+        else
+          for (size_type i = 0; i < n; ++i)
+          {
+            constraints.push_back (boost::make_shared<G<T> > (n, 2*i));
+            constraints.push_back (boost::make_shared<G2<T> > (n, 2*i));
+          }
+
+        typename function_t::argument_t x (2*n);
+        for (size_type i = 0; i < n; ++i)
+        {
+          x[2*i] = -2.;
+          x[2*i+1] = 1.;
+        }
+
+        std::vector<jacobian_t> jacobians;
+        for (std::size_t i = 0; i < constraints.size (); ++i)
+        {
+          jacobians.push_back (jacobian_t (constraints[i]->outputSize (),
+                                           constraints[i]->inputSize ()));
+          jacobians.back ().setZero ();
+        }
+
+        std::chrono::steady_clock::time_point start
+          = std::chrono::steady_clock::now ();
+        for (int r = 0; r < repetitions; ++r)
+          for (std::size_t i = 0; i < constraints.size (); ++i)
+            constraints[i]->jacobian (jacobians[i], x);
+        std::chrono::steady_clock::time_point end
+          = std::chrono::steady_clock::now ();
+
+        return std::chrono::duration<double> (end - start).count ()
+          / repetitions;
+      }
+
+      /// \brief Descriptor of the problem for a given size.
+      ///
+      /// \param n size parameter of the problem.
+      /// \param stacked whether to use a single stacked constraint.
+      ProblemDescriptor descriptor (long n = 1, bool stacked = false)
+      {
+        ProblemDescriptor problem;
+        problem.name = "benchmark_problem17";
+        problem.category = "benchmark";
+        problem.logName = "benchmark/benchmark-17";
+        problem.dense = [n, stacked] ()
+          {
+            F<EigenMatrixDense>::argument_t x;
+            return buildProblem<EigenMatrixDense> (n, x, stacked);
+          };
+        problem.sparse = [n, stacked] ()
+          {
+            F<EigenMatrixSparse>::argument_t x;
+            return buildProblem<EigenMatrixSparse> (n, x, stacked);
+          };
+
+        // Tolerances for Boost checks.
+        problem.tolerances.f0 = 1e-4;
+        problem.tolerances.x = 1e-4;
+        problem.tolerances.f = 1e-4;
+
+        problem.expected.f0 = 909.;
+        problem.expected.x = ExpectedResult::argument_t::Zero (2*n);
+        problem.expected.fx = 1.;
+        return problem;
+      }
+
+      static ProblemRegistrar registrar (descriptor ());
     } // end of namespace problem17.
   } // end of namespace benchmark.
 } // end of namespace roboptim.
 
 BOOST_FIXTURE_TEST_SUITE (benchmark, TestSuiteConfiguration)
 
-BOOST_AUTO_TEST_CASE (benchmark_problem17)
+namespace
 {
-  int argc = boost::unit_test::framework::master_test_suite ().argc;
-  char** argv = boost::unit_test::framework::master_test_suite ().argv;
-
   using namespace roboptim;
   using namespace roboptim::benchmark::problem17;
 
-  typedef F<functionType_t>::size_type size_type;
-  typedef F<functionType_t>::argument_t argument_t;
+  /// Name of the performance records of problem 17, whatever the mode, so
+  /// that the runs of a mode can be scheduled from the ones of another.
+  const std::string recordName = "benchmark_problem17";
+
+  /// Command line of the benchmark (see parseCommandLine).
+  CommandLine commandLine ()
+  {
+    return parseCommandLine
+      (boost::unit_test::framework::master_test_suite ().argc,
+       boost::unit_test::framework::master_test_suite ().argv);
+  }
 
-  size_type n = 1;
-  if (argc == 2)
+  /// Size parameter of a single solve: benchmark_17 [N].
+  long problemSize (const CommandLine& cmd)
   {
-    n = std::atoi (argv[1]);
+    if (cmd.argc () != 2)
+      return 1;
+
+    long n = std::atol (cmd.argv[1]);
     if (n <= 0)
       exit (EXIT_FAILURE);
+    return n;
+  }
+
+  /// Solve problem 17 for a range of sizes.
+  std::vector<SweepPoint> runSweep (const SweepOptions& sweep, bool stacked)
+  {
+    std::vector<long> sizes =
+      geometricRange (sweep.minSize, sweep.maxSize, sweep.factor);
+    std::vector<SweepPoint> points;
+
+    for (std::size_t s = 0; s < sizes.size (); ++s)
+    {
+      SweepPoint point;
+      point.size = sizes[s];
+
+      for (int r = 0; r < sweep.repetitions; ++r)
+      {
+        ProblemDescriptor descriptor =
+          roboptim::benchmark::problem17::descriptor (point.size, stacked);
+        boost::shared_ptr<solver_t::problem_t> problem =
+          descriptor.build<functionType_t> ();
+
+        // Initialize solver.
+        SolverFactory<solver_t> factory (SOLVER_NAME, *problem);
+        solver_t& solver = factory ();
+
+        // Set optional log file for debugging
+        SET_LOG_FILE(solver);
+
+        // Monitor solver performance.
+        perfMonitor_t monitor (solver);
+
+        // Compute the minimum and retrieve the result.
+        solver_t::result_t res = monitor.minimum ();
+
+        const PerformanceRecord& record = monitor.finalize
+          (recordName + (stacked ? "_stacked" : ""),
+           SOLVER_NAME, BOOST_PP_STRINGIZE (FUNCTION_TYPE),
+           resultStatus (res, *problem, descriptor.expected,
+                         descriptor.tolerances));
+        std::cout << "Performance: " << record << std::endl;
+        WRITE_PERFORMANCE_RECORD (record);
+        point.runs.push_back (record);
+      }
+
+      BOOST_CHECK (point.success ());
+      points.push_back (point);
+    }
+
+    return points;
+  }
+
+  /// Solve problem 17 for a range of sizes, sequentially and on a
+  /// thread pool, and compare the total wall-clock times.
+  void runParallel (unsigned threads, const SweepOptions& sweep, bool stacked)
+  {
+    std::string prefix = recordName + (stacked ? "_stacked" : "") + "_n";
+
+    std::vector<Job> jobs;
+    std::vector<long> sizes =
+      geometricRange (sweep.minSize, sweep.maxSize, sweep.factor);
+    for (std::size_t s = 0; s < sizes.size (); ++s)
+      for (int r = 0; r < sweep.repetitions; ++r)
+      {
+        ProblemDescriptor problem =
+          roboptim::benchmark::problem17::descriptor (sizes[s], stacked);
+        problem.name = prefix + std::to_string (sizes[s]);
+        jobs.push_back (problemJob (problem));
+      }
+
+    // Long jobs first, according to the previous runs.
+    timings_t timings;
+#ifdef PERF_FILENAME
+    readHistoricalTimings (PERF_FILENAME, timings);
+#endif //! PERF_FILENAME
+    scheduleLongestFirst (jobs, timings);
+
+    std::chrono::steady_clock::time_point start
+      = std::chrono::steady_clock::now ();
+    std::vector<PerformanceRecord> sequential = runJobs (jobs, 1);
+    double tSequential = std::chrono::duration<double>
+      (std::chrono::steady_clock::now () - start).count ();
+
+    start = std::chrono::steady_clock::now ();
+    std::vector<PerformanceRecord> parallel = runJobs (jobs, threads);
+    double tParallel = std::chrono::duration<double>
+      (std::chrono::steady_clock::now () - start).count ();
+
+    std::cout << std::left << std::setw (40) << "job" << std::right
+              << std::setw (14) << "expected (s)"
+              << std::setw (16) << "sequential (s)"
+              << std::setw (14) << "parallel (s)"
+              << std::setw (9) << "status" << std::endl;
+    for (std::size_t i = 0; i < jobs.size (); ++i)
+    {
+      timings_t::const_iterator it = timings.find (jobs[i].name);
+      std::cout << std::left << std::setw (40) << jobs[i].name << std::right
+                << std::setw (14)
+                << (it == timings.end () ? std::string ("-")
+                    : std::to_string (it->second))
+                << std::setw (16) << sequential[i].wallTime
+                << std::setw (14) << parallel[i].wallTime
+                << std::setw (9) << parallel[i].status << std::endl;
+
+      BOOST_CHECK_EQUAL (sequential[i].status, "success");
+      BOOST_CHECK_EQUAL (parallel[i].status, "success");
+
+      // Sequential runs are not slowed down by the other jobs, hence
+      // are the ones kept for the next schedules.
+      WRITE_PERFORMANCE_RECORD (sequential[i]);
+    }
+
+    std::cout << jobs.size () << " jobs, " << threads << " threads: "
+              << tSequential << " s sequentially, " << tParallel
+              << " s in parallel (speedup: " << tSequential / tParallel
+              << ")" << std::endl;
+  }
+
+  /// Random chained Rosenbrock argument with n pairs.
+  Eigen::VectorXd randomPairs (long n)
+  {
+    return 2. * Eigen::VectorXd::Random (2*n);
+  }
+
+  /// Time spent per call of a kernel (in seconds).
+  template <typename K>
+  double timePerCall (K kernel, long repetitions)
+  {
+    std::chrono::steady_clock::time_point start
+      = std::chrono::steady_clock::now ();
+    for (long r = 0; r < repetitions; ++r)
+      kernel ();
+    std::chrono::steady_clock::time_point end
+      = std::chrono::steady_clock::now ();
+    return std::chrono::duration<double> (end - start).count ()
+      / static_cast<double> (repetitions);
+  }
+
+  /// Compare the throughput of the scalar and vectorized kernels.
+  void runKernelBenchmark (long maxSize)
+  {
+    namespace kernel = roboptim::benchmark::problem17::kernel;
+
+    std::cout << "Chained Rosenbrock kernels (" << kernel::instructionSet ()
+              << "):" << std::endl
+              << std::setw (10) << "n"
+              << std::setw (16) << "value (ns)"
+              << std::setw (16) << "simd value (ns)"
+              << std::setw (16) << "grad (ns)"
+              << std::setw (16) << "simd grad (ns)"
+              << std::setw (16) << "fused (ns)"
+              << std::setw (16) << "simd Mpairs/s"
+              << std::setw (16) << "fused Mpairs/s"
+              << std::setw (14) << "max rel. err" << std::endl;
+
+    std::vector<long> sizes = geometricRange (10, maxSize, 10.);
+    for (std::size_t s = 0; s < sizes.size (); ++s)
+    {
+      long n = sizes[s];
+      long reps = std::max (3L, 20000000L / n);
+      double scale = 1. / static_cast<double> (n);
+
+      Eigen::VectorXd x = randomPairs (n);
+      Eigen::VectorXd g (2*n), gSimd (2*n), gFused (2*n);
+      const double* px = x.data ();
+      volatile double sink = 0.;
+
+      double tValue = timePerCall
+        ([&] () { sink = kernel::valueScalar (px, n); }, reps);
+      double value = sink;
+      double tValueSimd = timePerCall
+        ([&] () { sink = kernel::value (px, n); }, reps);
+      double valueSimd = sink;
+      double tGrad = timePerCall
+        ([&] () { kernel::gradientScalar (g.data (), px, n, scale); }, reps);
+      double tGradSimd = timePerCall
+        ([&] () { kernel::gradient (gSimd.data (), px, n, scale); }, reps);
+      double tFused = timePerCall
+        ([&] ()
+         { sink = kernel::valueAndGradient (gFused.data (), px, n, scale); },
+         reps);
+      double valueFused = sink;
+
+      double err = std::max (std::fabs (value - valueSimd),
+                             std::fabs (value - valueFused))
+        / std::fabs (value);
+      for (long i = 0; i < 2*n; ++i)
+        err = std::max (err, std::max (std::fabs (g[i] - gSimd[i]),
+                                       std::fabs (g[i] - gFused[i]))
+                        / std::max (std::fabs (g[i]), scale));
+
+      std::cout << std::setw (10) << n
+                << std::setw (16) << 1e9 * tValue
+                << std::setw (16) << 1e9 * tValueSimd
+                << std::setw (16) << 1e9 * tGrad
+                << std::setw (16) << 1e9 * tGradSimd
+                << std::setw (16) << 1e9 * tFused
+                << std::setw (16) << 1e-6 * static_cast<double> (n)
+                                     / (tValueSimd + tGradSimd)
+                << std::setw (16) << 1e-6 * static_cast<double> (n) / tFused
+                << std::setw (14) << err << std::endl;
+    }
   }
 
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 909.;
-  expectedResult.x = ExpectedResult::argument_t::Zero (2*n);
-  expectedResult.fx = 1.;
+  /// Compare the gradient computed by reverse-mode automatic
+  /// differentiation to the hand-written one.
+  void runTapeBenchmark (long maxSize)
+  {
+    typedef F<EigenMatrixDense> f_t;
+    typedef FTape<EigenMatrixDense> fTape_t;
+
+    std::cout << "Chained Rosenbrock gradients (tape vs hand-written):"
+              << std::endl
+              << std::setw (10) << "n"
+              << std::setw (16) << "value (ns)"
+              << std::setw (16) << "grad (ns)"
+              << std::setw (16) << "record (ns)"
+              << std::setw (16) << "tape grad (ns)"
+              << std::setw (12) << "tape/value"
+              << std::setw (12) << "tape/grad"
+              << std::setw (12) << "nodes"
+              << std::setw (14) << "max abs. err" << std::endl;
+
+    std::vector<long> sizes = geometricRange (10, maxSize, 10.);
+    for (std::size_t s = 0; s < sizes.size (); ++s)
+    {
+      long n = sizes[s];
+      long reps = std::max (3L, 2000000L / n);
+
+      f_t f (n);
+      Eigen::VectorXd x = randomPairs (n);
+      f_t::result_t result (1);
+      f_t::gradient_t g (2*n), gTape (2*n);
+
+      double tValue = timePerCall ([&] () { f (result, x); }, reps);
+      double tGrad = timePerCall ([&] () { f.gradient (g, x, 0); }, reps);
+
+      // The tape is recorded at the first gradient of a new function.
+      double tRecord = timePerCall
+        ([&] () { fTape_t fTape (n); fTape.gradient (gTape, x, 0); }, 1);
+
+      fTape_t fTape (n);
+      fTape.gradient (gTape, x, 0);
+      double tTape = timePerCall
+        ([&] () { fTape.gradient (gTape, x, 0); }, reps);
+
+      double err = (g - gTape).cwiseAbs ().maxCoeff ();
+
+      std::cout << std::setw (10) << n
+                << std::setw (16) << 1e9 * tValue
+                << std::setw (16) << 1e9 * tGrad
+                << std::setw (16) << 1e9 * tRecord
+                << std::setw (16) << 1e9 * tTape
+                << std::setw (12) << tTape / tValue
+                << std::setw (12) << tTape / tGrad
+                << std::setw (12) << fTape.tapeSize ()
+                << std::setw (14) << err << std::endl;
+    }
+  }
+
+  /// Compare the number of evaluations and the time needed by the
+  /// per-column and colored finite-difference Jacobians of GStacked.
+  void runFiniteDifferenceBenchmark (long maxSize, unsigned threads)
+  {
+    typedef GStacked<EigenMatrixDense> g_t;
+    typedef GenericColoredFiniteDifferenceJacobian<EigenMatrixDense> colored_t;
+
+    std::cout << "Finite-difference Jacobian of the stacked constraints"
+              << " (" << threads << " threads):" << std::endl
+              << std::setw (8) << "n"
+              << std::setw (8) << "groups"
+              << std::setw (14) << "column evals"
+              << std::setw (14) << "colored evals"
+              << std::setw (16) << "column (ns)"
+              << std::setw (16) << "colored (ns)"
+              << std::setw (16) << "threaded (ns)"
+              << std::setw (14) << "max abs. err" << std::endl;
+
+    std::vector<long> sizes = geometricRange (1, maxSize, 10.);
+    for (std::size_t s = 0; s < sizes.size (); ++s)
+    {
+      long n = sizes[s];
+      long reps = std::max (1L, 1000L / n);
+
+      Instrumented<g_t> g (n);
+      Eigen::VectorXd x = randomPairs (n);
+      g_t::jacobian_t jac (2*n, 2*n), jacColumn (2*n, 2*n), jacColored (2*n, 2*n);
+      g.jacobian (jac, x);
+
+      GenericFiniteDifferenceGradient<EigenMatrixDense> column (g);
+      colored_t colored (g, g.pattern ());
+      g_t plain (n);
+      colored_t threaded (plain, plain.pattern (), finiteDifferenceEpsilon,
+                          threads);
+
+      unsigned long before = g.statistics ().computeCount;
+      column.jacobian (jacColumn, x);
+      unsigned long columnEvals = g.statistics ().computeCount - before;
+      before = g.statistics ().computeCount;
+      colored.jacobian (jacColored, x);
+      unsigned long coloredEvals = g.statistics ().computeCount - before;
+
+      double err = std::max ((jacColumn - jac).cwiseAbs ().maxCoeff (),
+                             (jacColored - jac).cwiseAbs ().maxCoeff ());
+
+      double tColumn = timePerCall
+        ([&] () { column.jacobian (jacColumn, x); }, reps);
+      double tColored = timePerCall
+        ([&] () { colored.jacobian (jacColored, x); }, reps);
+      double tThreaded = timePerCall
+        ([&] () { threaded.jacobian (jacColored, x); }, reps);
+
+      std::cout << std::setw (8) << n
+                << std::setw (8) << colored.groups ()
+                << std::setw (14) << columnEvals
+                << std::setw (14) << coloredEvals
+                << std::setw (16) << 1e9 * tColumn
+                << std::setw (16) << 1e9 * tColored
+                << std::setw (16) << 1e9 * tThreaded
+                << std::setw (14) << err << std::endl;
+    }
+  }
+} // end of anonymous namespace
+
+BOOST_AUTO_TEST_CASE (benchmark_problem17_kernels)
+{
+  namespace kernel = roboptim::benchmark::problem17::kernel;
+
+  // Sizes exercising the vectorized loops and their scalar remainders.
+  const long sizes[] = {1, 2, 3, 4, 5, 7, 8, 9, 33, 1000};
+  for (std::size_t s = 0; s < sizeof (sizes) / sizeof (sizes[0]); ++s)
+  {
+    long n = sizes[s];
+    double scale = 1. / static_cast<double> (n);
+    Eigen::VectorXd x = randomPairs (n);
+    Eigen::VectorXd g (2*n), gSimd (2*n), gFused (2*n);
+
+    double value = kernel::valueScalar (x.data (), n);
+    BOOST_CHECK_SMALL_OR_CLOSE (value, kernel::value (x.data (), n), 1e-10);
+    BOOST_CHECK_SMALL_OR_CLOSE
+      (value, kernel::valueAndGradient (gFused.data (), x.data (), n, scale),
+       1e-10);
+
+    kernel::gradientScalar (g.data (), x.data (), n, scale);
+    kernel::gradient (gSimd.data (), x.data (), n, scale);
+    // Entries can be close to zero after cancellation, so compare them
+    // in absolute terms (terms are at most ~1e3 before scaling).
+    for (long i = 0; i < 2*n; ++i)
+    {
+      BOOST_CHECK_SMALL (g[i] - gSimd[i], 1e-10);
+      BOOST_CHECK_SMALL (g[i] - gFused[i], 1e-10);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (benchmark_problem17_tape)
+{
+  using namespace roboptim;
+  using namespace roboptim::benchmark::problem17;
+
+  const long sizes[] = {1, 2, 3, 10, 1000};
+  for (std::size_t s = 0; s < sizeof (sizes) / sizeof (sizes[0]); ++s)
+  {
+    long n = sizes[s];
+    F<functionType_t> f (n);
+    FTape<functionType_t> fTape (n);
+    F<functionType_t>::gradient_t g (2*n), gTape (2*n);
+
+    // The second point replays the tape recorded at the first one.
+    for (int k = 0; k < 2; ++k)
+    {
+      Eigen::VectorXd x = randomPairs (n);
+
+      BOOST_CHECK_SMALL_OR_CLOSE (f (x)[0], fTape (x)[0], 1e-10);
+
+      f.gradient (g, x, 0);
+      fTape.gradient (gTape, x, 0);
+      for (long i = 0; i < 2*n; ++i)
+        BOOST_CHECK_SMALL (g.coeff (i) - gTape.coeff (i), 1e-10);
+    }
+    BOOST_CHECK (fTape.tapeSize () > 0);
+  }
+}
 
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
+BOOST_AUTO_TEST_CASE (benchmark_problem17_finite_difference)
+{
+  using namespace roboptim;
+  using namespace roboptim::benchmark::problem17;
 
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> (n));
-  solver_t::problem_t problem (f);
-  argument_t x (f->inputSize ());
+  typedef GStacked<functionType_t> g_t;
+  typedef GenericColoredFiniteDifferenceJacobian<functionType_t> colored_t;
 
-  for (size_type i = 0; i < n; ++i)
+  const long sizes[] = {1, 2, 10, 100};
+  for (std::size_t s = 0; s < sizeof (sizes) / sizeof (sizes[0]); ++s)
   {
-    problem.argumentBounds ()[static_cast<size_t> (2*i)]
-      = F<functionType_t>::makeUpperInterval (1.);
-
-    boost::shared_ptr<G<functionType_t> > g =
-      boost::make_shared<G<functionType_t> > (n, 2*i);
-    problem.addConstraint (g, G<functionType_t>::makeLowerInterval (0.));
-    boost::shared_ptr<G2<functionType_t> > g2 =
-      boost::make_shared<G2<functionType_t> > (n, 2*i);
-    problem.addConstraint (g2, G2<functionType_t>::makeLowerInterval (0.));
-
-    x[2*i] = -2.;
-    x[2*i+1] = 1.;
+    long n = sizes[s];
+    g_t g (n);
+    Eigen::VectorXd x = randomPairs (n);
+    SparsityPattern detected = detectSparsity<functionType_t> (g, x);
+    BOOST_CHECK (detected.inner == g.pattern ().inner);
+    BOOST_CHECK (detected.outer == g.pattern ().outer);
+
+    // The Jacobian is block diagonal with 2x2 blocks: 2 groups,
+    // whatever n, on one or several threads.
+    colored_t colored (g, detected);
+    colored_t threaded (g, g.pattern (), finiteDifferenceEpsilon, 4);
+    BOOST_CHECK_EQUAL (colored.groups (), 2u);
+
+    Eigen::MatrixXd jac = Eigen::MatrixXd (g.jacobian (x));
+    Eigen::MatrixXd jacColored = Eigen::MatrixXd (colored.jacobian (x));
+    Eigen::MatrixXd jacThreaded = Eigen::MatrixXd (threaded.jacobian (x));
+    BOOST_CHECK_EQUAL (colored.evaluations (), 3u);
+    BOOST_CHECK_SMALL ((jacColored - jac).cwiseAbs ().maxCoeff (), 1e-5);
+    BOOST_CHECK_SMALL ((jacThreaded - jacColored).cwiseAbs ().maxCoeff (),
+                       1e-12);
+
+    // A gradient only perturbs the groups of its row.
+    g_t::gradient_t grad (2*n);
+    colored.gradient (grad, x, 2*n - 1);
+    for (long j = 0; j < 2*n; ++j)
+      BOOST_CHECK_SMALL (grad.coeff (j) - jac (2*n - 1, j), 1e-5);
+    BOOST_CHECK_EQUAL (colored.evaluations (), 6u);
   }
+}
 
-  problem.startingPoint () = x;
+// Kernel micro-benchmark: benchmark_17 kernels [MAX_N]
+BOOST_AUTO_TEST_CASE (benchmark_problem17_kernels_timing)
+{
+  CommandLine cmd = commandLine ();
+  if (cmd.mode () != "kernels")
+    return;
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+  runKernelBenchmark (cmd.argc () > 2 ? std::atol (cmd.argv[2]) : 10000000L);
+}
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+// Finite-difference Jacobians: benchmark_17 fd [MAX_N [THREADS]]
+BOOST_AUTO_TEST_CASE (benchmark_problem17_finite_difference_timing)
+{
+  CommandLine cmd = commandLine ();
+  if (cmd.mode () != "fd")
+    return;
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "benchmark/benchmark-17");
+  runFiniteDifferenceBenchmark
+    (cmd.argc () > 2 ? std::atol (cmd.argv[2]) : 1000L,
+     (cmd.argc () > 3 && std::atoi (cmd.argv[3]) > 0)
+     ? static_cast<unsigned> (std::atoi (cmd.argv[3]))
+     : roboptim::defaultThreadCount ());
+}
+
+// Reverse-mode automatic differentiation: benchmark_17 tape [MAX_N]
+BOOST_AUTO_TEST_CASE (benchmark_problem17_tape_timing)
+{
+  CommandLine cmd = commandLine ();
+  if (cmd.mode () != "tape")
+    return;
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+  runTapeBenchmark (cmd.argc () > 2 ? std::atol (cmd.argv[2]) : 1000000L);
+}
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+// Parallel runs:
+// benchmark_17 parallel [THREADS [MIN_N [MAX_N [FACTOR [REPETITIONS]]]]]
+// [scalar|stacked]
+BOOST_AUTO_TEST_CASE (benchmark_problem17_parallel)
+{
+  using namespace roboptim;
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+  CommandLine cmd = commandLine ();
+  if (cmd.mode () != "parallel")
+    return;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+  unsigned threads = (cmd.argc () > 2 && std::atoi (cmd.argv[2]) > 0)
+    ? static_cast<unsigned> (std::atoi (cmd.argv[2]))
+    : defaultThreadCount (SOLVER_NAME);
+
+  // Remaining arguments are the ones of a sweep.
+  SweepOptions parallel;
+  parallel.minSize = 10;
+  parallel.maxSize = 160;
+  parallel.repetitions = 1;
+  std::vector<char*> args (1, cmd.argv[0]);
+  args.push_back (const_cast<char*> ("sweep"));
+  for (int i = 3; i < cmd.argc (); ++i)
+    args.push_back (cmd.argv[i]);
+  parseSweepOptions (static_cast<int> (args.size ()), args.data (),
+                     parallel);
+
+  runParallel (threads, parallel, cmd.form == STACKED_CONSTRAINTS);
+}
+
+// Sweep mode:
+// benchmark_17 sweep [MIN_N [MAX_N [FACTOR [REPETITIONS]]]] [scalar|stacked]
+BOOST_AUTO_TEST_CASE (benchmark_problem17_sweep)
+{
+  using namespace roboptim;
+
+  CommandLine cmd = commandLine ();
+  SweepOptions sweep;
+  if (cmd.form == COMPARE_CONSTRAINTS
+      || !parseSweepOptions (cmd.argc (), cmd.argv.data (), sweep))
+    return;
+
+  long baselineMemory = peakMemoryUsage ();
+  std::vector<SweepPoint> points =
+    runSweep (sweep, cmd.form == STACKED_CONSTRAINTS);
+  printSweepSummary (std::cout, points, baselineMemory);
+}
+
+// Comparison of both formulations, for a single size or a sweep:
+// benchmark_17 [N] compare
+// benchmark_17 sweep [MIN_N [MAX_N [FACTOR [REPETITIONS]]]] compare
+BOOST_AUTO_TEST_CASE (benchmark_problem17_compare)
+{
+  using namespace roboptim;
+
+  CommandLine cmd = commandLine ();
+  if (cmd.form != COMPARE_CONSTRAINTS || cmd.mode () == "parallel")
+    return;
+
+  SweepOptions sweep;
+  if (!parseSweepOptions (cmd.argc (), cmd.argv.data (), sweep))
+  {
+    sweep.minSize = sweep.maxSize = problemSize (cmd);
+    sweep.repetitions = 1;
+  }
+
+  long baselineMemory = peakMemoryUsage ();
+  std::vector<SweepPoint> scalar = runSweep (sweep, false);
+  std::vector<SweepPoint> stacked = runSweep (sweep, true);
+
+  std::cout << "Scalar constraints:" << std::endl;
+  printSweepSummary (std::cout, scalar, baselineMemory);
+  std::cout << "Stacked constraint:" << std::endl;
+  printSweepSummary (std::cout, stacked, baselineMemory);
+
+  std::cout << std::setw (10) << "size"
+            << std::setw (16) << "solve speedup"
+            << std::setw (20) << "scalar jac. (s)"
+            << std::setw (20) << "stacked jac. (s)"
+            << std::setw (16) << "jac. speedup" << std::endl;
+  for (std::size_t i = 0; i < scalar.size (); ++i)
+  {
+    long size = scalar[i].size;
+    int reps = std::max (1, static_cast<int> (1e5 / static_cast<double> (size*size)));
+    double tScalar = jacobianAssemblyTime<functionType_t> (size, false, reps);
+    double tStacked = jacobianAssemblyTime<functionType_t> (size, true, reps);
+
+    std::cout << std::setw (10) << size
+              << std::setw (16) << scalar[i].medianWallTime ()
+                                   / stacked[i].medianWallTime ()
+              << std::setw (20) << tScalar
+              << std::setw (20) << tStacked
+              << std::setw (16) << tScalar / tStacked << std::endl;
+  }
+}
+
+// Single solve: benchmark_17 [N] [scalar|stacked]
+BOOST_AUTO_TEST_CASE (benchmark_problem17)
+{
+  using namespace roboptim;
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+  CommandLine cmd = commandLine ();
+  std::string mode = cmd.mode ();
+  if (cmd.form == COMPARE_CONSTRAINTS || mode == "kernels" || mode == "fd"
+      || mode == "tape" || mode == "parallel" || mode == "sweep")
+    return;
 
-  // Process the result
-  PROCESS_RESULT();
+  solveProblem (descriptor (problemSize (cmd),
+                            cmd.form == STACKED_CONSTRAINTS));
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
@@ -0,0 +1,297 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+// Fixed-size evaluation of Schittkowski problem 71, compared to the
+// dynamically-sized hand-coded functions. This file is linked with the
+// problem it compares to (see benchmark/CMakeLists.txt).
+
+#include "common.hh"
+#include "fixed-size.hh"
+
+#include <chrono>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+namespace roboptim
+{
+  namespace benchmark
+  {
+    namespace fixedsize
+    {
+      namespace problem71
+      {
+        template <typename T>
+        struct F : public GenericFixedSizeFunction<T, F<T>, 4>
+        {
+          ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+          (GenericTwiceDifferentiableFunction<T>);
+
+          F ()
+            : GenericFixedSizeFunction<T, F<T>, 4>
+              ("x₀ x₃ (x₀ + x₁ + x₂) + x₂")
+          {}
+
+          template <typename R, typename X>
+          void evaluate (R& result, const X& x) const
+          {
+            result[0] = x[0] * x[3] * (x[0] + x[1] + x[2]) + x[2];
+          }
+
+          template <typename G, typename X>
+          void evaluateGradient (G& grad, const X& x, size_type) const
+          {
+            grad[0] = x[0] * x[3] + x[3] * (x[0] + x[1] + x[2]);
+            grad[1] = x[0] * x[3];
+            grad[2] = x[0] * x[3] + 1;
+            grad[3] = x[0] * (x[0] + x[1] + x[2]);
+          }
+
+          template <typename H, typename X>
+          void evaluateHessian (H& h, const X& x, size_type) const
+          {
+            h (0, 0) = 2 * x[3];
+            h (0, 1) = h (1, 0) = x[3];
+            h (0, 2) = h (2, 0) = x[3];
+            h (0, 3) = h (3, 0) = 2 * x[0] + x[1] + x[2];
+            h (1, 3) = h (3, 1) = x[0];
+            h (2, 3) = h (3, 2) = x[0];
+          }
+        };
+
+        template <typename T>
+        struct G0 : public GenericFixedSizeFunction<T, G0<T>, 4>
+        {
+          ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+          (GenericTwiceDifferentiableFunction<T>);
+
+          G0 ()
+            : GenericFixedSizeFunction<T, G0<T>, 4> ("x₀ x₁ x₂ x₃")
+          {}
+
+          template <typename R, typename X>
+          void evaluate (R& result, const X& x) const
+          {
+            result[0] = x[0] * x[1] * x[2] * x[3];
+          }
+
+          template <typename G, typename X>
+          void evaluateGradient (G& grad, const X& x, size_type) const
+          {
+            grad[0] = x[1] * x[2] * x[3];
+            grad[1] = x[0] * x[2] * x[3];
+            grad[2] = x[0] * x[1] * x[3];
+            grad[3] = x[0] * x[1] * x[2];
+          }
+
+          template <typename H, typename X>
+          void evaluateHessian (H& h, const X& x, size_type) const
+          {
+            h (0, 1) = h (1, 0) = x[2] * x[3];
+            h (0, 2) = h (2, 0) = x[1] * x[3];
+            h (0, 3) = h (3, 0) = x[1] * x[2];
+            h (1, 2) = h (2, 1) = x[0] * x[3];
+            h (1, 3) = h (3, 1) = x[0] * x[2];
+            h (2, 3) = h (3, 2) = x[0] * x[1];
+          }
+        };
+
+        template <typename T>
+        struct G1 : public GenericFixedSizeFunction<T, G1<T>, 4>
+        {
+          ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+          (GenericTwiceDifferentiableFunction<T>);
+
+          G1 ()
+            : GenericFixedSizeFunction<T, G1<T>, 4>
+              ("x₀² + x₁² + x₂² + x₃²")
+          {}
+
+          template <typename R, typename X>
+          void evaluate (R& result, const X& x) const
+          {
+            result[0] = x.squaredNorm ();
+          }
+
+          template <typename G, typename X>
+          void evaluateGradient (G& grad, const X& x, size_type) const
+          {
+            grad = 2 * x;
+          }
+
+          template <typename H, typename X>
+          void evaluateHessian (H& h, const X&, size_type) const
+          {
+            h.diagonal ().setConstant (2.);
+          }
+        };
+      } // end of namespace problem71
+    } // end of namespace fixedsize
+  } // end of namespace benchmark
+} // end of namespace roboptim
+
+namespace
+{
+  using namespace roboptim;
+
+  /// Time spent per call of a kernel (in seconds), repeated until the
+  /// measure is long enough to be meaningful.
+  template <typename K>
+  double timePerCall (K kernel)
+  {
+    for (long reps = 1; ; reps *= 2)
+      {
+        std::chrono::steady_clock::time_point start
+          = std::chrono::steady_clock::now ();
+        for (long r = 0; r < reps; ++r)
+          kernel ();
+        double t = std::chrono::duration<double>
+          (std::chrono::steady_clock::now () - start).count ();
+        if (t > 1e-2 || reps >= (1L << 26))
+          return t / static_cast<double> (reps);
+      }
+  }
+
+  /// Latency of the value, gradient and Hessian of a fixed-size
+  /// function. The same kernels are evaluated on:
+  ///  - dynamically-sized objects allocated at each call,
+  ///  - preallocated dynamically-sized objects,
+  ///  - fixed-size objects, through the (virtual) RobOptim interface,
+  ///  - fixed-size objects, through the *Fixed member functions.
+  template <typename D>
+  void printLatencies (std::ostream& o, const std::string& name,
+                       const D& f, const Eigen::VectorXd& x)
+  {
+    typedef typename D::fixedSize_t fixedSize_t;
+    typedef GenericTwiceDifferentiableFunction<EigenMatrixDense> function_t;
+
+    const function_t& roboptimF = f;
+    const long n = fixedSize_t::inputSize;
+    const long m = fixedSize_t::outputSize;
+
+    Eigen::VectorXd result (m), grad (n);
+    Eigen::MatrixXd hess (n, n);
+    typename fixedSize_t::argument_t xFixed = x;
+    typename fixedSize_t::result_t resultFixed;
+    typename fixedSize_t::gradient_t gradFixed;
+    typename fixedSize_t::hessian_t hessFixed;
+    volatile double sink = 0.;
+
+    double t[4][3];
+    t[0][0] = timePerCall ([&] ()
+      { Eigen::VectorXd r (m); f.evaluate (r, x); sink = r[0]; });
+    t[0][1] = timePerCall ([&] ()
+      { Eigen::VectorXd g = Eigen::VectorXd::Zero (n);
+        f.evaluateGradient (g, x, 0); sink = g[0]; });
+    t[0][2] = timePerCall ([&] ()
+      { Eigen::MatrixXd h = Eigen::MatrixXd::Zero (n, n);
+        f.evaluateHessian (h, x, 0); sink = h (0, 0); });
+    t[1][0] = timePerCall ([&] ()
+      { f.evaluate (result, x); sink = result[0]; });
+    t[1][1] = timePerCall ([&] ()
+      { grad.setZero (); f.evaluateGradient (grad, x, 0); sink = grad[0]; });
+    t[1][2] = timePerCall ([&] ()
+      { hess.setZero (); f.evaluateHessian (hess, x, 0); sink = hess (0, 0); });
+    t[2][0] = timePerCall ([&] ()
+      { roboptimF (result, x); sink = result[0]; });
+    t[2][1] = timePerCall ([&] ()
+      { roboptimF.gradient (grad, x, 0); sink = grad[0]; });
+    t[2][2] = timePerCall ([&] ()
+      { roboptimF.hessian (hess, x, 0); sink = hess (0, 0); });
+    t[3][0] = timePerCall ([&] ()
+      { f.computeFixed (resultFixed, xFixed); sink = resultFixed[0]; });
+    t[3][1] = timePerCall ([&] ()
+      { f.gradientFixed (gradFixed, xFixed); sink = gradFixed[0]; });
+    t[3][2] = timePerCall ([&] ()
+      { f.hessianFixed (hessFixed, xFixed); sink = hessFixed (0, 0); });
+
+    const char* kinds[] = {"value", "gradient", "hessian"};
+    for (int k = 0; k < 3; ++k)
+      o << std::setw (6) << name << std::setw (10) << kinds[k]
+        << std::setw (14) << 1e9 * t[0][k]
+        << std::setw (14) << 1e9 * t[1][k]
+        << std::setw (14) << 1e9 * t[2][k]
+        << std::setw (14) << 1e9 * t[3][k]
+        << std::setw (10) << t[1][k] / t[3][k] << std::endl;
+  }
+} // end of anonymous namespace
+
+BOOST_FIXTURE_TEST_SUITE (fixed_size, TestSuiteConfiguration)
+
+BOOST_AUTO_TEST_CASE (fixed_size_problem71)
+{
+  using namespace roboptim;
+  namespace fs = roboptim::benchmark::fixedsize::problem71;
+
+  typedef Solver<functionType_t>::problem_t problem_t;
+  typedef GenericTwiceDifferentiableFunction<functionType_t> twice_t;
+
+  boost::shared_ptr<problem_t> problem =
+    findProblem ("problem_71").build<functionType_t> ();
+
+  std::vector<boost::shared_ptr<twice_t> > fixed;
+  fixed.push_back (boost::make_shared<fs::F<functionType_t> > ());
+  fixed.push_back (boost::make_shared<fs::G0<functionType_t> > ());
+  fixed.push_back (boost::make_shared<fs::G1<functionType_t> > ());
+
+  // Starting point and random points of the bounds [1, 5]⁴.
+  std::vector<Eigen::VectorXd> points (1, *problem->startingPoint ());
+  for (int k = 0; k < 3; ++k)
+    points.push_back (Eigen::VectorXd::Constant (4, 3.)
+                      + 2. * Eigen::VectorXd::Random (4));
+
+  for (std::size_t c = 0; c < fixed.size (); ++c)
+    {
+      const twice_t& f = dynamic_cast<const twice_t&>
+        ((c == 0) ? problem->function () : *problem->constraints ()[c - 1]);
+      const twice_t& g = *fixed[c];
+
+      for (std::size_t p = 0; p < points.size (); ++p)
+        {
+          const Eigen::VectorXd& x = points[p];
+          BOOST_CHECK_SMALL_OR_CLOSE (f (x)[0], g (x)[0], 1e-12);
+          BOOST_CHECK_SMALL (detail::derivativeError (g.jacobian (x),
+                                                      f.jacobian (x)), 1e-12);
+          BOOST_CHECK_SMALL (detail::derivativeError (g.hessian (x, 0),
+                                                      f.hessian (x, 0)), 1e-12);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE (fixed_size_problem71_latency)
+{
+  using namespace roboptim;
+  namespace fs = roboptim::benchmark::fixedsize::problem71;
+
+  boost::shared_ptr<Solver<EigenMatrixDense>::problem_t> problem =
+    findProblem ("problem_71").build<EigenMatrixDense> ();
+  const Eigen::VectorXd& x = *problem->startingPoint ();
+
+  std::cout << "Problem 71 evaluation latency (ns):" << std::endl
+            << std::setw (16) << ""
+            << std::setw (14) << "dynamic (new)"
+            << std::setw (14) << "dynamic"
+            << std::setw (14) << "roboptim"
+            << std::setw (14) << "fixed-size"
+            << std::setw (10) << "speedup" << std::endl;
+
+  printLatencies (std::cout, "F", fs::F<EigenMatrixDense> (), x);
+  printLatencies (std::cout, "G0", fs::G0<EigenMatrixDense> (), x);
+  printLatencies (std::cout, "G1", fs::G1<EigenMatrixDense> (), x);
+}
+
+BOOST_AUTO_TEST_SUITE_END ()
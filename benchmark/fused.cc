@@ -0,0 +1,131 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+// Fused value and derivative evaluations of some Schittkowski problems,
+// compared to separate evaluations. This file is linked with the problems
+// it compares (see benchmark/CMakeLists.txt).
+
+#include "common.hh"
+#include "cache.hh"
+#include "fused.hh"
+
+#include <vector>
+
+namespace roboptim
+{
+  namespace benchmark
+  {
+    namespace fused
+    {
+      /// \brief exp (x₀ x₁), with a fused value and gradient.
+      template <typename T>
+      struct F : public GenericDifferentiableFunction<T>,
+                 public GenericFusedEvaluation<T>
+      {
+        ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+        (GenericDifferentiableFunction<T>);
+
+        F ()
+          : GenericDifferentiableFunction<T> (2, 1, "exp (x₀ x₁)")
+        {}
+
+        void impl_compute (result_ref result, const_argument_ref x) const
+        {
+          result[0] = std::exp (x[0] * x[1]);
+        }
+
+        void impl_gradient (gradient_ref grad, const_argument_ref x,
+                            size_type) const
+        {
+          grad.coeffRef (0) = x[1] * std::exp (x[0] * x[1]);
+          grad.coeffRef (1) = x[0] * std::exp (x[0] * x[1]);
+        }
+
+        void impl_valueAndGradient (result_ref result, gradient_ref grad,
+                                    const_argument_ref x, size_type) const
+        {
+          value_type e = std::exp (x[0] * x[1]);
+          result[0] = e;
+          grad.coeffRef (0) = x[1] * e;
+          grad.coeffRef (1) = x[0] * e;
+        }
+      };
+    } // end of namespace fused
+  } // end of namespace benchmark
+} // end of namespace roboptim
+
+BOOST_FIXTURE_TEST_SUITE (fused, TestSuiteConfiguration)
+
+BOOST_AUTO_TEST_CASE (fused_schittkowski)
+{
+  using namespace roboptim;
+
+  const char* problems[] =
+    {"schittkowski_problem1", "problem_71", "schittkowski_problem81"};
+  // Functions providing a fused evaluation in each problem.
+  const std::size_t fusedFunctions[] = {1, 2, 1};
+
+  std::vector<FusedComparison> comparisons;
+  for (std::size_t i = 0; i < sizeof (problems) / sizeof (problems[0]); ++i)
+    comparisons.push_back (compareFused<functionType_t> (problems[i]));
+
+  printFusedComparison (std::cout, comparisons);
+
+  for (std::size_t i = 0; i < comparisons.size (); ++i)
+    {
+      BOOST_CHECK_EQUAL (comparisons[i].fusedFunctions, fusedFunctions[i]);
+      BOOST_CHECK_MESSAGE (comparisons[i].error < 1e-9,
+                           comparisons[i].problem << ": error "
+                           << comparisons[i].error);
+    }
+}
+
+BOOST_AUTO_TEST_CASE (fused_cache)
+{
+  using namespace roboptim;
+  typedef benchmark::fused::F<functionType_t> f_t;
+
+  Cached<Instrumented<f_t> > f;
+  f_t::argument_t x (2);
+  x << 0.5, -1.;
+  f_t::gradient_t grad (2);
+
+  // A value missing from the cache is evaluated with the gradient.
+  double value = f (x)[0];
+  f.gradient (grad, x, 0);
+  BOOST_CHECK_EQUAL (f.statistics ().computeCount, 1u);
+  BOOST_CHECK_EQUAL (f.statistics ().gradientCount, 1u);
+  BOOST_CHECK_EQUAL (f.cacheStatistics ().fusedGradients, 1u);
+  BOOST_CHECK_EQUAL (f.cacheStatistics ().gradientHits, 0u);
+  BOOST_CHECK_SMALL_OR_CLOSE (value, std::exp (-0.5), 1e-12);
+  BOOST_CHECK_SMALL_OR_CLOSE (grad.coeff (0), -std::exp (-0.5), 1e-12);
+  BOOST_CHECK_SMALL_OR_CLOSE (grad.coeff (1), 0.5 * std::exp (-0.5), 1e-12);
+
+  // Fused evaluations are served from the cache too.
+  f_t::result_t result (1);
+  valueAndGradient<functionType_t> (f, result, grad, x, 0);
+  BOOST_CHECK_EQUAL (f.statistics ().computeCount, 1u);
+
+  f.setFusedEvaluation (false);
+  x[0] = 1.;
+  f (x);
+  BOOST_CHECK_EQUAL (f.statistics ().gradientCount, 1u);
+  f.gradient (grad, x, 0);
+  BOOST_CHECK_EQUAL (f.statistics ().gradientCount, 2u);
+}
+
+BOOST_AUTO_TEST_SUITE_END ()
@@ -0,0 +1,627 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_CACHE_HH
+# define ROBOPTIM_SHARED_TESTS_CACHE_HH
+# include <algorithm>
+# include <cstddef>
+# include <iomanip>
+# include <iostream>
+# include <sstream>
+# include <string>
+# include <utility>
+# include <vector>
+
+# include <boost/type_traits/integral_constant.hpp>
+
+# include <roboptim/core/twice-differentiable-function.hh>
+
+# include "fused.hh"
+# include "instrumented-function.hh"
+
+namespace roboptim
+{
+  /// \brief Hits and misses of the cache of a function.
+  struct CacheStatistics
+  {
+    CacheStatistics ()
+      : name (),
+        computeHits (0),
+        computeMisses (0),
+        gradientHits (0),
+        gradientMisses (0),
+        jacobianHits (0),
+        jacobianMisses (0),
+        hessianHits (0),
+        hessianMisses (0),
+        fusedGradients (0)
+    {}
+
+    /// \brief Name of the function.
+    std::string name;
+
+    /// \brief impl_compute calls served from the cache.
+    unsigned long computeHits;
+
+    /// \brief impl_compute calls forwarded to the function.
+    unsigned long computeMisses;
+
+    unsigned long gradientHits;
+    unsigned long gradientMisses;
+    unsigned long jacobianHits;
+    unsigned long jacobianMisses;
+    unsigned long hessianHits;
+    unsigned long hessianMisses;
+
+    /// \brief Gradient calls served from a gradient evaluated along with a
+    /// missing value (see setFusedEvaluation). They are neither hits nor
+    /// misses: the gradient was evaluated, but not by a separate call.
+    unsigned long fusedGradients;
+
+    /// \brief Total number of hits.
+    unsigned long hits () const
+    {
+      return computeHits + gradientHits + jacobianHits + hessianHits;
+    }
+
+    /// \brief Total number of misses.
+    unsigned long misses () const
+    {
+      return computeMisses + gradientMisses + jacobianMisses + hessianMisses;
+    }
+
+    /// \brief Share of the calls served from the cache (fused gradients
+    /// count as calls, not as hits).
+    double hitRate () const
+    {
+      unsigned long calls = hits () + misses () + fusedGradients;
+      return calls > 0
+        ? static_cast<double> (hits ()) / static_cast<double> (calls) : 0.;
+    }
+  };
+
+  typedef std::vector<const CacheStatistics*> cacheStatistics_t;
+
+  /// \brief Statistics of all the cached functions currently alive that
+  /// were created by the current thread (see instrumentedFunctions).
+  inline cacheStatistics_t& cachedFunctions ()
+  {
+    static thread_local cacheStatistics_t statistics;
+    return statistics;
+  }
+
+  /// \brief Print the hit rate of the caches of the cached functions
+  /// currently alive (nothing if there is none).
+  inline void printCacheStatistics (std::ostream& o)
+  {
+    const cacheStatistics_t& caches = cachedFunctions ();
+    if (caches.empty ())
+      return;
+
+    std::ostringstream ss;
+    ss << "Cache hits (hits / calls):" << std::endl
+       << std::left << std::setw (32) << "  function" << std::right
+       << std::setw (16) << "compute"
+       << std::setw (16) << "gradient"
+       << std::setw (16) << "jacobian"
+       << std::setw (16) << "hessian"
+       << std::setw (8) << "fused"
+       << std::setw (10) << "% hits" << std::endl;
+
+    for (std::size_t i = 0; i < caches.size (); ++i)
+      {
+        const CacheStatistics& s = *caches[i];
+
+        std::string name = s.name.substr (0, s.name.find ('\n'));
+        if (name.size () > 28)
+          name = name.substr (0, 25) + "...";
+
+        ss << "  " << std::left << std::setw (30) << name << std::right;
+        const unsigned long hits[] = {s.computeHits, s.gradientHits,
+                                      s.jacobianHits, s.hessianHits};
+        const unsigned long misses[] = {s.computeMisses, s.gradientMisses,
+                                        s.jacobianMisses, s.hessianMisses};
+        for (std::size_t k = 0; k < 4; ++k)
+          {
+            std::ostringstream cell;
+            cell << hits[k] << " / " << hits[k] + misses[k];
+            ss << std::setw (16) << cell.str ();
+          }
+        ss << std::setw (8) << s.fusedGradients;
+        ss << std::setw (10) << std::fixed << std::setprecision (1)
+           << 100. * s.hitRate () << std::endl;
+      }
+
+    o << ss.str () << std::flush;
+  }
+
+  namespace detail
+  {
+    /// \brief Print the cache statistics after each run (see
+    /// printStatistics). Called by the first cached function.
+    inline void registerCacheStatistics ()
+    {
+      static const bool registered =
+        (registerStatisticsPrinter (&printCacheStatistics), true);
+      (void)registered;
+    }
+
+    /// \brief Cache shared by all function kinds.
+    ///
+    /// The last K arguments are kept, each with the value and the
+    /// derivatives already computed at this argument.
+    template <typename F>
+    class CachedBase : public F
+    {
+    public:
+      typedef typename F::size_type size_type;
+      typedef typename F::argument_t argument_t;
+      typedef typename F::result_t result_t;
+      typedef typename F::gradient_t gradient_t;
+      typedef typename F::jacobian_t jacobian_t;
+      typedef typename F::result_ref result_ref;
+      typedef typename F::const_argument_ref const_argument_ref;
+      typedef typename F::gradient_ref gradient_ref;
+      typedef typename F::jacobian_ref jacobian_ref;
+
+      template <typename... Args>
+      explicit CachedBase (Args&&... args)
+        : F (std::forward<Args> (args)...),
+          stats_ (),
+          entries_ (1),
+          next_ (0),
+          fused_ (true),
+          fusedGradient_ ()
+      {
+        stats_.name = this->getName ();
+        cachedFunctions ().push_back (&stats_);
+        registerCacheStatistics ();
+      }
+
+      virtual ~CachedBase ()
+      {
+        cacheStatistics_t& s = cachedFunctions ();
+        s.erase (std::remove (s.begin (), s.end (), &stats_), s.end ());
+      }
+
+      /// \brief Hits and misses of the cache of this function.
+      const CacheStatistics& cacheStatistics () const
+      {
+        return stats_;
+      }
+
+      /// \brief Set the number of arguments kept in the cache (1 by
+      /// default: the last point). The cache is emptied.
+      void setCacheSize (std::size_t size)
+      {
+        entries_.assign (std::max<std::size_t> (1, size), Entry ());
+        next_ = 0;
+      }
+
+      /// \brief Empty the cache, e.g. if a parameter of the function
+      /// changed.
+      void clearCache ()
+      {
+        setCacheSize (entries_.size ());
+      }
+
+      /// \brief Whether a value missing from the cache is evaluated
+      /// along with the gradient, if F provides a fused evaluation (see
+      /// GenericFusedEvaluation) and has a single output (true by
+      /// default).
+      ///
+      /// Solvers usually ask for the gradient at the points whose value
+      /// they evaluated, except for rejected trial points. A gradient
+      /// evaluated this way is counted in fusedGradients, not as a hit,
+      /// when it is requested.
+      void setFusedEvaluation (bool fused)
+      {
+        fused_ = fused;
+      }
+
+    protected:
+      /// \brief State of a gradient of an entry.
+      enum GradientState
+      {
+        /// \brief Not evaluated.
+        NO_GRADIENT = 0,
+        /// \brief Evaluated by a gradient call.
+        GRADIENT = 1,
+        /// \brief Evaluated along with a missing value, not requested yet.
+        FUSED_GRADIENT = 2
+      };
+
+      /// \brief Values and derivatives at an argument.
+      struct Entry
+      {
+        Entry ()
+          : valid (false),
+            argument (),
+            result (),
+            hasResult (false),
+            gradients (),
+            hasGradient (),
+            jacobian (),
+            hasJacobian (false)
+        {}
+
+        bool valid;
+        argument_t argument;
+        result_t result;
+        bool hasResult;
+        std::vector<gradient_t> gradients;
+        /// \brief State of each gradient (see GradientState).
+        std::vector<char> hasGradient;
+        jacobian_t jacobian;
+        bool hasJacobian;
+      };
+
+      // Note: F may evaluate itself at other points (e.g. finite
+      // differences), which can replace the entry of x. Entries are only
+      // looked up again once F returns, never kept across a call to F.
+
+      void impl_compute (result_ref result, const_argument_ref x) const
+      {
+        {
+          Entry& e = entry (x);
+          if (e.hasResult)
+            {
+              ++stats_.computeHits;
+              result = e.result;
+              return;
+            }
+        }
+        ++stats_.computeMisses;
+        bool withGradient =
+          computeMissing (result, x, typename isFused<F>::type ());
+
+        Entry& e = entry (x);
+        e.result = result;
+        e.hasResult = true;
+        if (withGradient)
+          {
+            allocateGradients (e);
+            if (!e.hasGradient[0])
+              {
+                e.gradients[0] = fusedGradient_;
+                e.hasGradient[0] = FUSED_GRADIENT;
+              }
+          }
+      }
+
+      void impl_gradient (gradient_ref grad, const_argument_ref x,
+                          size_type functionId) const
+      {
+        std::size_t id = static_cast<std::size_t> (functionId);
+        {
+          Entry& e = entry (x);
+          allocateGradients (e);
+          if (countGradient (e, id))
+            {
+              grad = e.gradients[id];
+              return;
+            }
+        }
+        ++stats_.gradientMisses;
+        F::impl_gradient (grad, x, functionId);
+
+        Entry& e = entry (x);
+        allocateGradients (e);
+        e.gradients[id] = grad;
+        e.hasGradient[id] = GRADIENT;
+      }
+
+      void impl_jacobian (jacobian_ref jac, const_argument_ref x) const
+      {
+        {
+          Entry& e = entry (x);
+          if (e.hasJacobian)
+            {
+              ++stats_.jacobianHits;
+              jac = e.jacobian;
+              return;
+            }
+        }
+        ++stats_.jacobianMisses;
+        F::impl_jacobian (jac, x);
+
+        Entry& e = entry (x);
+        e.jacobian = jac;
+        e.hasJacobian = true;
+      }
+
+      /// \brief Fused value and gradient (only used if F derives from
+      /// GenericFusedEvaluation).
+      void impl_valueAndGradient (result_ref result, gradient_ref grad,
+                                  const_argument_ref x,
+                                  size_type functionId) const
+      {
+        std::size_t id = static_cast<std::size_t> (functionId);
+        {
+          Entry& e = entry (x);
+          allocateGradients (e);
+          bool hasResult = e.hasResult;
+          ++(hasResult ? stats_.computeHits : stats_.computeMisses);
+          if (!countGradient (e, id))
+            ++stats_.gradientMisses;
+          else if (hasResult)
+            {
+              result = e.result;
+              grad = e.gradients[id];
+              return;
+            }
+        }
+        F::impl_valueAndGradient (result, grad, x, functionId);
+
+        Entry& e = entry (x);
+        allocateGradients (e);
+        e.result = result;
+        e.hasResult = true;
+        e.gradients[id] = grad;
+        e.hasGradient[id] = GRADIENT;
+      }
+
+      /// \brief Count a gradient call at an entry: hit, or gradient
+      /// evaluated with the value (see setFusedEvaluation).
+      ///
+      /// \return whether the gradient is in the entry.
+      bool countGradient (Entry& e, std::size_t id) const
+      {
+        switch (e.hasGradient[id])
+          {
+          case FUSED_GRADIENT:
+            ++stats_.fusedGradients;
+            e.hasGradient[id] = GRADIENT;
+            return true;
+          case GRADIENT:
+            ++stats_.gradientHits;
+            return true;
+          default:
+            return false;
+          }
+      }
+
+      /// \brief Allocate the gradients of an entry.
+      void allocateGradients (Entry& e) const
+      {
+        if (!e.hasGradient.empty ())
+          return;
+        e.gradients.resize (static_cast<std::size_t> (this->outputSize ()));
+        e.hasGradient.assign (static_cast<std::size_t> (this->outputSize ()),
+                              0);
+      }
+
+      /// \brief Evaluate a value missing from the cache.
+      ///
+      /// \return whether the gradient was evaluated too (in
+      /// fusedGradient_).
+      bool computeMissing (result_ref result, const_argument_ref x,
+                           boost::false_type) const
+      {
+        F::impl_compute (result, x);
+        return false;
+      }
+
+      /// \brief Evaluate a value missing from the cache, and the gradient
+      /// in the same pass (see setFusedEvaluation).
+      bool computeMissing (result_ref result, const_argument_ref x,
+                           boost::true_type) const
+      {
+        if (!fused_ || this->outputSize () != 1)
+          {
+            F::impl_compute (result, x);
+            return false;
+          }
+        if (fusedGradient_.size () != this->inputSize ())
+          fusedGradient_.resize (this->inputSize ());
+        F::impl_valueAndGradient (result, fusedGradient_, x, 0);
+        return true;
+      }
+
+      /// \brief Entry of an argument, reset if it is not in the cache.
+      Entry& entry (const_argument_ref x) const
+      {
+        for (std::size_t k = 0; k < entries_.size (); ++k)
+          {
+            // Look up the most recent entries first.
+            std::size_t i = (next_ + entries_.size () - 1 - k)
+              % entries_.size ();
+            if (entries_[i].valid && entries_[i].argument == x)
+              return entries_[i];
+          }
+
+        Entry& e = entries_[next_];
+        next_ = (next_ + 1) % entries_.size ();
+        e.valid = true;
+        e.argument = x;
+        e.hasResult = false;
+        std::fill (e.hasGradient.begin (), e.hasGradient.end (), 0);
+        e.hasJacobian = false;
+        onNewEntry (e);
+        return e;
+      }
+
+      /// \brief Reset the data of derived caches of a new entry.
+      virtual void onNewEntry (Entry&) const
+      {}
+
+      mutable CacheStatistics stats_;
+      mutable std::vector<Entry> entries_;
+      /// \brief Entry replaced by the next new argument.
+      mutable std::size_t next_;
+      /// \brief Whether missing values are evaluated with the gradient.
+      bool fused_;
+      /// \brief Gradient evaluated with a missing value.
+      mutable gradient_t fusedGradient_;
+    };
+  } // end of namespace detail
+
+  /// \brief Function decorator remembering the values and derivatives of
+  /// F at its last arguments.
+  ///
+  /// Solvers often evaluate the value, then each gradient, then the
+  /// Hessian of a function at the same point. Cached<F> derives from F,
+  /// like Instrumented<F>, and only forwards a call to F the first time
+  /// it is made at a given argument (exact comparison):
+  ///
+  /// \code
+  /// boost::shared_ptr<F<functionType_t> >
+  ///   f (new Cached<Instrumented<F<functionType_t> > > ());
+  /// \endcode
+  ///
+  /// With this order, the instrumented counters only count the actual
+  /// evaluations of F. Intermediate results shared by the value and the
+  /// derivatives have to be cached by F itself, or F can provide a fused
+  /// evaluation (see GenericFusedEvaluation and setFusedEvaluation).
+  ///
+  /// Note that the returned values are copies of the cached ones, and
+  /// that the cache is not thread-safe.
+  ///
+  /// \tparam F function type.
+  template <typename F,
+            bool = detail::isTwiceDifferentiable<F>::value>
+  class Cached : public detail::CachedBase<F>
+  {
+  public:
+    template <typename... Args>
+    explicit Cached (Args&&... args)
+      : detail::CachedBase<F> (std::forward<Args> (args)...)
+    {}
+  };
+
+  template <typename F>
+  class Cached<F, true> : public detail::CachedBase<F>
+  {
+  public:
+    typedef typename F::size_type size_type;
+    typedef typename F::result_ref result_ref;
+    typedef typename F::const_argument_ref const_argument_ref;
+    typedef typename F::gradient_ref gradient_ref;
+    typedef typename F::hessian_t hessian_t;
+    typedef typename F::hessian_ref hessian_ref;
+    typedef typename detail::CachedBase<F>::Entry entry_t;
+
+    template <typename... Args>
+    explicit Cached (Args&&... args)
+      : detail::CachedBase<F> (std::forward<Args> (args)...),
+        hessians_ (this->entries_.size ())
+    {}
+
+    /// \brief Set the number of arguments kept in the cache.
+    void setCacheSize (std::size_t size)
+    {
+      detail::CachedBase<F>::setCacheSize (size);
+      hessians_.assign (this->entries_.size (), HessianEntry ());
+    }
+
+  protected:
+    void impl_hessian (hessian_ref h, const_argument_ref x,
+                       size_type functionId) const
+    {
+      std::size_t id = static_cast<std::size_t> (functionId);
+      {
+        HessianEntry& he = hessianEntry (this->entry (x));
+        if (he.hasHessian[id])
+          {
+            ++this->stats_.hessianHits;
+            h = he.hessians[id];
+            return;
+          }
+      }
+      ++this->stats_.hessianMisses;
+      F::impl_hessian (h, x, functionId);
+
+      // F may have replaced the entry of x (see CachedBase).
+      HessianEntry& he = hessianEntry (this->entry (x));
+      he.hessians[id] = h;
+      he.hasHessian[id] = 1;
+    }
+
+    /// \brief Fused value, gradient and Hessian (only used if F derives
+    /// from GenericTwiceFusedEvaluation).
+    void impl_valueGradientAndHessian (result_ref result, gradient_ref grad,
+                                       hessian_ref h, const_argument_ref x,
+                                       size_type functionId) const
+    {
+      std::size_t id = static_cast<std::size_t> (functionId);
+      CacheStatistics& s = this->stats_;
+      {
+        entry_t& e = this->entry (x);
+        HessianEntry& he = hessianEntry (e);
+        this->allocateGradients (e);
+        bool hasResult = e.hasResult;
+        bool hasHessian = he.hasHessian[id];
+        ++(hasResult ? s.computeHits : s.computeMisses);
+        ++(hasHessian ? s.hessianHits : s.hessianMisses);
+        if (!this->countGradient (e, id))
+          ++s.gradientMisses;
+        else if (hasResult && hasHessian)
+          {
+            result = e.result;
+            grad = e.gradients[id];
+            h = he.hessians[id];
+            return;
+          }
+      }
+      F::impl_valueGradientAndHessian (result, grad, h, x, functionId);
+
+      entry_t& e = this->entry (x);
+      HessianEntry& he = hessianEntry (e);
+      this->allocateGradients (e);
+      e.result = result;
+      e.hasResult = true;
+      e.gradients[id] = grad;
+      e.hasGradient[id] = this->GRADIENT;
+      he.hessians[id] = h;
+      he.hasHessian[id] = 1;
+    }
+
+    void onNewEntry (entry_t& e) const
+    {
+      HessianEntry& he = hessians_[static_cast<std::size_t>
+                                   (&e - &this->entries_[0])];
+      std::fill (he.hasHessian.begin (), he.hasHessian.end (), 0);
+    }
+
+  private:
+    /// \brief Hessians at the argument of an entry.
+    struct HessianEntry
+    {
+      std::vector<hessian_t> hessians;
+      std::vector<char> hasHessian;
+    };
+
+    /// \brief Hessians of an entry, allocated at the first use.
+    HessianEntry& hessianEntry (const entry_t& e) const
+    {
+      HessianEntry& he = hessians_[static_cast<std::size_t>
+                                   (&e - &this->entries_[0])];
+      if (he.hasHessian.empty ())
+        {
+          he.hessians.resize (static_cast<std::size_t>
+                              (this->outputSize ()));
+          he.hasHessian.assign (static_cast<std::size_t>
+                                (this->outputSize ()), 0);
+        }
+      return he;
+    }
+
+    mutable std::vector<HessianEntry> hessians_;
+  };
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_CACHE_HH
@@ -17,6 +17,12 @@
 
 #ifndef ROBOPTIM_SHARED_TESTS_COMMON_HH
 # define ROBOPTIM_SHARED_TESTS_COMMON_HH
+// When several tests are linked in a single executable, only aggregate.cc
+// provides the test runner.
+# if defined ROBOPTIM_SHARED_TESTS_AGGREGATE \
+  && !defined ROBOPTIM_SHARED_TESTS_AGGREGATE_MAIN
+#  undef BOOST_TEST_MAIN
+# endif //! ROBOPTIM_SHARED_TESTS_AGGREGATE
 # ifdef WIN32
 #  define _USE_MATH_DEFINES
 # endif //WIN32
@@ -28,6 +34,7 @@
 # include <boost/mpl/vector.hpp>
 # include <boost/mpl/push_back.hpp>
 # include <boost/make_shared.hpp>
+# include <boost/preprocessor/stringize.hpp>
 # include <boost/shared_ptr.hpp>
 # include <boost/test/test_case_template.hpp>
 # include <boost/test/unit_test.hpp>
@@ -42,6 +49,25 @@
 # include <roboptim/core/solver-factory.hh>
 
 # include "fixture.hh"
+# include "perf.hh"
+# include "registry.hh"
+
+// Optional subsystems are only included by the tests built with them.
+# if defined FAILURE_TRACE
+#  include "failure-trace.hh"
+# elif defined ASYNC_TRACE
+#  include "async-trace.hh"
+# elif defined BINARY_TRACE
+#  include "trace.hh"
+# endif //! FAILURE_TRACE
+
+# ifdef PERF_BASELINE_FILENAME
+#  include "baseline.hh"
+# endif //! PERF_BASELINE_FILENAME
+
+# ifdef SPARSE_FILL_BENCHMARK
+#  include "sparsity.hh"
+# endif //! SPARSE_FILL_BENCHMARK
 
 # ifndef SOLVER_NAME
 #  error "please define solver name"
@@ -69,23 +95,59 @@
 #  define SET_LOG_FILE(solver)
 # endif //! LOG_FILENAME
 
+# ifdef PERF_FILENAME
+#  define WRITE_PERFORMANCE_RECORD(RECORD)	\
+  writePerformanceRecord (PERF_FILENAME, RECORD)
+# else //! PERF_FILENAME
+#  define WRITE_PERFORMANCE_RECORD(RECORD)
+# endif //! PERF_FILENAME
+
+# ifdef SPARSE_FILL_BENCHMARK
+#  define BENCHMARK_SPARSE_FILL(PROBLEM)			\
+  ::roboptim::benchmarkSparseFill (std::cout, PROBLEM)
+# else //! SPARSE_FILL_BENCHMARK
+#  define BENCHMARK_SPARSE_FILL(PROBLEM)
+# endif //! SPARSE_FILL_BENCHMARK
+
+# ifdef FAILURE_TRACE
+#  define MARK_FAILURE(LOGGER)			\
+  ::roboptim::markFailure (LOGGER)
+# else //! FAILURE_TRACE
+#  define MARK_FAILURE(LOGGER) (void) 0
+# endif //! FAILURE_TRACE
+
 typedef FUNCTION_TYPE functionType_t;
 
 // Define solver type.
 typedef ::roboptim::Solver<functionType_t> solver_t;
 
+// With BINARY_TRACE, the optimization logger writes a binary iteration
+// trace instead of text files (see trace.hh), from a background thread
+// with ASYNC_TRACE (see async-trace.hh). With FAILURE_TRACE, the last
+// iterations are kept in memory and only written if the test fails (see
+// failure-trace.hh).
+# if defined FAILURE_TRACE
+typedef ::roboptim::FailureTraceLogger<solver_t> logger_t;
+# elif defined ASYNC_TRACE
+typedef ::roboptim::AsyncTraceLogger<solver_t> logger_t;
+# elif defined BINARY_TRACE
+typedef ::roboptim::BinaryTraceLogger<solver_t> logger_t;
+# else //! BINARY_TRACE
 typedef ::roboptim::OptimizationLogger<solver_t> logger_t;
+# endif //! BINARY_TRACE
+
+typedef ::roboptim::PerformanceMonitor<solver_t> perfMonitor_t;
 
 namespace roboptim
 {
-  boost::shared_ptr<logger_t> logger;
+  static boost::shared_ptr<logger_t> logger;
 } // end of namespace roboptim
 
 #define SET_OPTIMIZATION_LOGGER(SOLVER,FILENAME)	\
   logger = boost::make_shared<logger_t>			\
     (boost::ref<solver_t> (SOLVER),			\
-     "/tmp/roboptim-shared-tests/" SOLVER_NAME		\
-     "/" FILENAME);
+     std::string ("/tmp/roboptim-shared-tests/" SOLVER_NAME		\
+                  "/") + FILENAME);
 
 #define RELEASE_OPTIMIZATION_LOGGER()		\
   if (logger)					\
@@ -93,9 +155,131 @@ namespace roboptim
       logger.reset ();				\
     }
 
+// Monitor time, iterations and evaluations of the solver. This has to be
+// set after the optimization logger, since its iteration callback is
+// forwarded to the logger. If SPARSE_FILL_BENCHMARK is defined, the sparse
+// gradient fill strategies are compared first.
+#define SET_PERFORMANCE_MONITOR(SOLVER)					\
+  BENCHMARK_SPARSE_FILL (SOLVER.problem ());				\
+  perfMonitor_t monitor							\
+    (SOLVER, logger ? logger->callback () : solver_t::callback_t ());
+
+// Print and save the performance record of the monitored solver.
+#define REPORT_PERFORMANCE(STATUS)					\
+  {									\
+    const PerformanceRecord& perfRecord = monitor.finalize		\
+      (boost::unit_test::framework::current_test_case ().p_name,	\
+       SOLVER_NAME, BOOST_PP_STRINGIZE (FUNCTION_TYPE), STATUS);	\
+    std::cout << "Performance: " << perfRecord << std::endl;		\
+    printFunctionStatistics (std::cout, perfRecord);			\
+    printStatistics (std::cout);					\
+    WRITE_PERFORMANCE_RECORD (perfRecord);				\
+    performanceRecords ().push_back (perfRecord);			\
+    processPerformanceBaseline (perfRecord);				\
+  }
+
 // Note: tolerances here are in percent, since this is what
 // Boost is expecting.
 
+namespace roboptim
+{
+  /// \brief Same criterion as BOOST_CHECK_SMALL_OR_CLOSE, without the
+  /// Boost check.
+  inline bool smallOrClose (double expected, double observed, double tol)
+  {
+    if (std::fabs (expected) < tol)
+      return std::fabs (observed) <= tol;
+    return (std::fabs (expected - observed) < tol/100. * std::fabs (expected)
+            && std::fabs (expected - observed) < tol/100. * std::fabs (observed));
+  }
+
+  /// \brief Criteria of CHECK_RESULT, evaluated without Boost checks.
+  struct ResultCheck
+  {
+    ResultCheck ()
+      : fx (false),
+        bounds (false),
+        constraints (false),
+        x (false)
+    {}
+
+    /// \brief Whether the final cost is the expected one.
+    bool fx;
+
+    /// \brief Whether x satisfies the argument bounds.
+    bool bounds;
+
+    /// \brief Whether the constraint values have been copied to the result
+    /// and satisfy the constraint bounds.
+    bool constraints;
+
+    /// \brief Whether x is the expected optimum.
+    bool x;
+
+    /// \brief Success criterion of the tests: a feasible point with the
+    /// expected cost, or else the expected optimum.
+    bool success () const
+    {
+      return (fx && bounds && constraints) || x;
+    }
+  };
+
+  /// \brief Check a solver result against the expected result.
+  ///
+  /// This is the single success criterion of the tests: CHECK_RESULT
+  /// reports it, and resultStatus uses it for runs without Boost checks.
+  ///
+  /// \param result result of the solver.
+  /// \param problem solved problem.
+  /// \param expectedResult expected result.
+  /// \param x_tol tolerance on x and on the argument bounds.
+  /// \param f_tol tolerance on the cost (in percent, see smallOrClose) and
+  /// on the constraint bounds.
+  inline ResultCheck checkResult (const Result& result,
+                                  const solver_t::problem_t& problem,
+                                  const ExpectedResult& expectedResult,
+                                  double x_tol, double f_tol)
+  {
+    typedef GenericFunction<functionType_t>::size_type size_type;
+
+    ResultCheck check;
+    check.fx = smallOrClose (result.value[0], expectedResult.fx, f_tol);
+
+    check.bounds = true;
+    for (size_type i = 0; i < result.x.size (); ++i)
+      {
+        std::size_t ii = static_cast<std::size_t> (i);
+        check.bounds &=
+          result.x[i] - problem.argumentBounds ()[ii].first > -x_tol
+          && result.x[i] - problem.argumentBounds ()[ii].second < x_tol;
+      }
+
+    size_type n_cstr = 0;
+    for (std::size_t i = 0; i < problem.boundsVector ().size (); ++i)
+      n_cstr += static_cast<size_type> (problem.boundsVector ()[i].size ());
+
+    check.constraints = n_cstr == result.constraints.size ();
+    size_type cstr_i = 0;
+    for (std::size_t i = 0; check.constraints
+           && i < problem.boundsVector ().size (); ++i)
+      for (std::size_t j = 0; j < problem.boundsVector ()[i].size (); ++j)
+        {
+          check.constraints &=
+            result.constraints[cstr_i]
+            - problem.boundsVector ()[i][j].first > -f_tol
+            && result.constraints[cstr_i]
+            - problem.boundsVector ()[i][j].second < f_tol;
+          ++cstr_i;
+        }
+
+    check.x = result.x.size () == expectedResult.x.size ();
+    for (size_type i = 0; check.x && i < result.x.size (); ++i)
+      check.x = smallOrClose (result.x[i], expectedResult.x[i], x_tol);
+
+    return check;
+  }
+} // end of namespace roboptim
+
 // See: http://stackoverflow.com/a/20050381/1043187
 #define BOOST_CHECK_SMALL_OR_CLOSE(EXP, OBS, TOL)	\
   if (std::fabs (EXP) < TOL) {				\
@@ -108,12 +292,10 @@ namespace roboptim
 #define BOOST_SMALL_OR_CLOSE_RES(EXP, OBS, TOL, RES)		\
   if (std::fabs (EXP) < TOL) {					\
     BOOST_CHECK_SMALL (OBS, TOL);				\
-    RES = boost::test_tools::check_is_small (OBS, TOL);		\
   } else {							\
     BOOST_CHECK_CLOSE(EXP, OBS, TOL);				\
-    RES = (std::fabs (EXP - OBS) < TOL/100. * std::fabs (EXP) \
-        && std::fabs (EXP - OBS) < TOL/100. * std::fabs (OBS));	\
-  }
+  }								\
+  RES = ::roboptim::smallOrClose (EXP, OBS, TOL);
 
 // Run BOOST_CHECK and get result
 #define BOOST_CHECK_RES(COND, RES)		\
@@ -124,107 +306,108 @@ namespace roboptim
 #define CHECK_RESULT_UNCONSTRAINED(RESULT_TYPE)				\
   /* Get the result. */							\
   RESULT_TYPE& result = boost::get<RESULT_TYPE> (res);			\
+  /* Success criterion (see checkResult). */				\
+  ::roboptim::ResultCheck check = ::roboptim::checkResult		\
+    (result, problem, expectedResult, x_tol, f_tol);			\
   /* Check final value. */						\
-  bool correct_fx = true;						\
-  BOOST_SMALL_OR_CLOSE_RES (result.value[0], expectedResult.fx, f_tol, correct_fx); \
+  BOOST_CHECK_SMALL_OR_CLOSE (result.value[0], expectedResult.fx, f_tol); \
   /* Check final bounds on x. */					\
-  bool correct_bounds = true;						\
   for (GenericFunction<functionType_t>::size_type i = 0; i < result.x.size (); ++i) { \
-    bool res = true;							\
     std::size_t ii = static_cast<std::size_t> (i);			\
     /* Check lower bound. */						\
-    BOOST_CHECK_RES (result.x[i]					\
-                     - problem.argumentBounds ()[ii].first > -x_tol, res); \
-    correct_bounds &= res;						\
+    BOOST_CHECK (result.x[i]						\
+                 - problem.argumentBounds ()[ii].first > -x_tol);	\
     /* Check upper bound. */						\
-    BOOST_CHECK_RES (result.x[i]					\
-                     - problem.argumentBounds ()[ii].second < x_tol, res); \
-    correct_bounds &= res;						\
+    BOOST_CHECK (result.x[i]						\
+                 - problem.argumentBounds ()[ii].second < x_tol);	\
   }									\
   /* Only check x is we have not found an optimal result. */		\
-  if (!(correct_fx && correct_bounds)) {				\
+  if (!(check.fx && check.bounds)) {					\
     /* Check final x. */						\
     for (GenericFunction<functionType_t>::size_type i = 0; i < result.x.size (); ++i) \
-      BOOST_CHECK_SMALL_OR_CLOSE (result.x[i], expectedResult.x[i], x_tol); \
+      {									\
+	BOOST_CHECK_SMALL_OR_CLOSE (result.x[i], expectedResult.x[i],	\
+				    x_tol);				\
+      }									\
   }									\
+  /* Unconstrained problems: the constraints are not checked. */	\
+  bool success = (check.fx && check.bounds) || check.x;			\
+  if (logger && !success)						\
+    MARK_FAILURE (*logger);						\
   /* Display the result. */						\
   std::cout << "A solution has been found: " << std::endl		\
-  << result << std::endl;
+  << result << std::endl;						\
+  REPORT_PERFORMANCE (success ? "success" : "failure");
 
 
 // Check the result of the optimization process
 #define CHECK_RESULT(RESULT_TYPE)					\
   /* Get the result. */							\
   RESULT_TYPE& result = boost::get<RESULT_TYPE> (res);			\
+  /* Success criterion (see checkResult). */				\
+  ::roboptim::ResultCheck check = ::roboptim::checkResult		\
+    (result, problem, expectedResult, x_tol, f_tol);			\
   /* Check final value. */						\
-  bool success = false;							\
-  bool correct_fx = true;						\
-  BOOST_SMALL_OR_CLOSE_RES (result.value[0], expectedResult.fx, f_tol, correct_fx); \
+  BOOST_CHECK_SMALL_OR_CLOSE (result.value[0], expectedResult.fx, f_tol); \
   /* Check final bounds on x. */					\
-  bool correct_bounds = true;						\
-  for (F<functionType_t>::size_type i = 0; i < result.x.size (); ++i) {	\
-    bool res = true;							\
+  for (GenericFunction<functionType_t>::size_type i = 0; i < result.x.size (); ++i) { \
     std::size_t ii = static_cast<std::size_t> (i);			\
     /* Check lower bound. */						\
-    BOOST_CHECK_RES (result.x[i]					\
-                     - problem.argumentBounds ()[ii].first > -x_tol, res); \
-    correct_bounds &= res;						\
+    BOOST_CHECK (result.x[i]						\
+                 - problem.argumentBounds ()[ii].first > -x_tol);	\
     /* Check upper bound. */						\
-    BOOST_CHECK_RES (result.x[i]					\
-                     - problem.argumentBounds ()[ii].second < x_tol, res); \
-    correct_bounds &= res;						\
+    BOOST_CHECK (result.x[i]						\
+                 - problem.argumentBounds ()[ii].second < x_tol);	\
   }									\
-  /* Check final constraints. */					\
-  bool correct_g = true;						\
   /* Check that final constraint values have been copied to Result. */	\
-  F<functionType_t>::size_type n_cstr = 0;				\
+  GenericFunction<functionType_t>::size_type n_cstr = 0;		\
   for (size_t i = 0; i < problem.boundsVector ().size (); ++i) {	\
-    n_cstr += static_cast<F<functionType_t>::size_type>			\
+    n_cstr += static_cast<GenericFunction<functionType_t>::size_type>	\
       (problem.boundsVector ()[i].size ());				\
   }									\
-  BOOST_CHECK(n_cstr == static_cast<F<functionType_t>::size_type>	\
+  BOOST_CHECK(n_cstr == static_cast<GenericFunction<functionType_t>::size_type> \
               (result.constraints.size ()));				\
-  /* For each multidimensional constraint. */				\
+  /* Check final constraints. */					\
   Function::vector_t::Index cstr_i = 0;					\
-  for (size_t i = 0; i < problem.boundsVector ().size (); ++i) {	\
+  /* For each multidimensional constraint. */				\
+  for (size_t i = 0; n_cstr == result.constraints.size ()		\
+         && i < problem.boundsVector ().size (); ++i) {			\
     /* For each dimension of the constraint. */				\
     for (size_t j = 0; j < problem.boundsVector ()[i].size (); ++j) {	\
-      bool res = true;							\
       /* Check lower bound. */						\
-      BOOST_CHECK_RES (result.constraints[cstr_i]			\
-                       - problem.boundsVector ()[i][j].first > -f_tol, res); \
-      correct_g &= res;							\
+      BOOST_CHECK (result.constraints[cstr_i]				\
+                   - problem.boundsVector ()[i][j].first > -f_tol);	\
       /* Check upper bound. */						\
-      BOOST_CHECK_RES (result.constraints[cstr_i]			\
-                       - problem.boundsVector ()[i][j].second < f_tol, res); \
-      correct_g &= res;							\
+      BOOST_CHECK (result.constraints[cstr_i]				\
+                   - problem.boundsVector ()[i][j].second < f_tol);	\
       ++cstr_i;								\
     }									\
   }									\
   /* Only check x is we have not found an optimal result. */		\
-  if (!(correct_fx && correct_g && correct_bounds)) {			\
-    success = true;							\
+  if (!(check.fx && check.constraints && check.bounds)) {		\
     /* Check final x. */						\
-    for (F<functionType_t>::size_type i = 0; i < result.x.size (); ++i)	\
+    for (GenericFunction<functionType_t>::size_type i = 0; i < result.x.size (); ++i) \
       {									\
-	bool res = false;						\
-	BOOST_SMALL_OR_CLOSE_RES (result.x[i], expectedResult.x[i],	\
-				  x_tol, res);				\
-        success &= res;							\
+	BOOST_CHECK_SMALL_OR_CLOSE (result.x[i], expectedResult.x[i],	\
+				    x_tol);				\
       }									\
   }									\
-  else success = true;							\
+  bool success = check.success ();					\
   if (logger)								\
     {									\
       if (success)							\
 	(*logger) << log_result_true;					\
       else								\
-	(*logger) << log_result_false;					\
+	{								\
+	  (*logger) << log_result_false;				\
+	  MARK_FAILURE (*logger);					\
+	}								\
       (*logger) << solver;						\
     }									\
   /* Display the result. */						\
   std::cout << "A solution has been found: " << std::endl		\
-  << result << std::endl;
+  << result << std::endl;						\
+  REPORT_PERFORMANCE (success ? "success" : "failure");
 
 // Process the result for a constrained problem
 #define PROCESS_RESULT()						\
@@ -250,10 +433,12 @@ namespace roboptim
 		  << "No solution was found."				\
 		  << std::endl;						\
 	BOOST_CHECK_EQUAL (res.which (), solver_t::SOLVER_VALUE);	\
+	REPORT_PERFORMANCE ("no_solution");				\
 	if (logger)							\
 	  {								\
 	    (*logger) << log_result_false				\
 	              << solver;					\
+	    MARK_FAILURE (*logger);					\
 	    logger.reset ();						\
 	  }								\
 	return;								\
@@ -265,10 +450,12 @@ namespace roboptim
 		  << boost::get<SolverError> (res).what ()		\
 		  << std::endl;						\
 	BOOST_CHECK_EQUAL (res.which (), solver_t::SOLVER_VALUE);	\
+	REPORT_PERFORMANCE ("error");					\
 	if (logger)							\
 	  {								\
 	    (*logger) << log_result_false				\
 	              << solver;					\
+	    MARK_FAILURE (*logger);					\
 	    logger.reset ();						\
 	  }								\
 	return;								\
@@ -300,10 +487,12 @@ namespace roboptim
 		  << "No solution was found."				\
 		  << std::endl;						\
 	BOOST_CHECK_EQUAL (res.which (), solver_t::SOLVER_VALUE);	\
+	REPORT_PERFORMANCE ("no_solution");				\
 	if (logger)							\
 	  {								\
 	    (*logger) << log_result_false				\
 	              << solver;					\
+	    MARK_FAILURE (*logger);					\
 	    logger.reset ();						\
 	  }								\
 	return;								\
@@ -315,10 +504,12 @@ namespace roboptim
 		  << boost::get<SolverError> (res).what ()		\
 		  << std::endl;						\
 	BOOST_CHECK_EQUAL (res.which (), solver_t::SOLVER_VALUE);	\
+	REPORT_PERFORMANCE ("error");					\
 	if (logger)							\
 	  {								\
 	    (*logger) << log_result_false				\
 	              << solver;					\
+	    MARK_FAILURE (*logger);					\
 	    logger.reset ();						\
 	  }								\
 	return;								\
@@ -328,14 +519,124 @@ namespace roboptim
 
 namespace roboptim
 {
-  struct ExpectedResult
+  /// \brief Status of a solver result, as reported in performance records.
+  ///
+  /// Successful results are checked with checkResult, i.e. with the same
+  /// criterion as CHECK_RESULT, but without Boost checks, so that this
+  /// can be used e.g. in sweeps or parallel jobs.
+  inline std::string resultStatus (const solver_t::result_t& res,
+                                   const solver_t::problem_t& problem,
+                                   const ExpectedResult& expectedResult,
+                                   const ProblemTolerances& tolerances)
   {
-    typedef solver_t::problem_t::function_t::argument_t argument_t;
+    switch (res.which ())
+      {
+      case solver_t::SOLVER_VALUE:
+        return checkResult (boost::get<Result> (res), problem,
+                            expectedResult, tolerances.x,
+                            tolerances.f).success ()
+          ? "success" : "failure";
+      case solver_t::SOLVER_VALUE_WARNINGS:
+        return checkResult (boost::get<ResultWithWarnings> (res), problem,
+                            expectedResult, tolerances.x,
+                            tolerances.f).success ()
+          ? "success" : "failure";
+      case solver_t::SOLVER_NO_SOLUTION:
+        return "no_solution";
+      default:
+        return "error";
+      }
+  }
 
-    double f0;
-    argument_t x;
-    double fx;
-  };
+  /// \brief Compare a successful run to its performance baseline
+  /// (PERF_BASELINE_CHECK), or store it as the new baseline
+  /// (PERF_BASELINE_UPDATE).
+  inline void processPerformanceBaseline (const PerformanceRecord& record)
+  {
+# ifdef PERF_BASELINE_FILENAME
+    if (record.status != "success")
+      return;
+
+#  if defined PERF_BASELINE_UPDATE
+    writePerformanceBaseline (PERF_BASELINE_FILENAME, record);
+#  elif defined PERF_BASELINE_CHECK
+    PerformanceBaseline baseline;
+    if (!readPerformanceBaseline (PERF_BASELINE_FILENAME, record.test,
+                                  baseline))
+      {
+        std::cout << "No performance baseline for " << record.test
+                  << " in " << PERF_BASELINE_FILENAME << std::endl;
+        return;
+      }
+
+    BaselineTolerance tolerance;
+#   ifdef PERF_BASELINE_TIME_TOLERANCE
+    tolerance.time = PERF_BASELINE_TIME_TOLERANCE;
+#   endif //! PERF_BASELINE_TIME_TOLERANCE
+#   ifdef PERF_BASELINE_COUNT_TOLERANCE
+    tolerance.count = PERF_BASELINE_COUNT_TOLERANCE;
+#   endif //! PERF_BASELINE_COUNT_TOLERANCE
+
+    std::string report;
+    BOOST_CHECK_MESSAGE (checkPerformanceBaseline (baseline, record,
+                                                   tolerance, report),
+                         "Performance regression: " << report);
+#  endif //! PERF_BASELINE_UPDATE
+# endif //! PERF_BASELINE_FILENAME
+    (void)record;
+  }
+
+  /// \brief Solve a registered problem with the tested solver, and check
+  /// the result with Boost.Test.
+  ///
+  /// This is the body of the test case of a registered problem:
+  ///
+  /// \code
+  /// BOOST_AUTO_TEST_CASE (schittkowski_problem1)
+  /// {
+  ///   solveProblem (roboptim::schittkowski::problem1::descriptor ());
+  /// }
+  /// \endcode
+  inline void solveProblem (const ProblemDescriptor& descriptor)
+  {
+    // Tolerances for Boost checks.
+    double f0_tol = descriptor.tolerances.f0;
+    double x_tol = descriptor.tolerances.x;
+    double f_tol = descriptor.tolerances.f;
+
+    const ExpectedResult& expectedResult = descriptor.expected;
+
+    // Build problem.
+    boost::shared_ptr<solver_t::problem_t> pb =
+      descriptor.build<functionType_t> ();
+    solver_t::problem_t& problem = *pb;
+
+    BOOST_CHECK_SMALL_OR_CLOSE
+      (problem.function () (*problem.startingPoint ())[0],
+       expectedResult.f0, f0_tol);
+
+    // Initialize solver.
+    SolverFactory<solver_t> factory (SOLVER_NAME, problem);
+    solver_t& solver = factory ();
+
+    // Set optimization logger
+    SET_OPTIMIZATION_LOGGER (solver, descriptor.logName);
+
+    // Set optional log file for debugging
+    SET_LOG_FILE (solver);
+
+    // Monitor solver performance.
+    SET_PERFORMANCE_MONITOR (solver);
+
+    // Compute the minimum and retrieve the result.
+    solver_t::result_t res = monitor.minimum ();
+
+    // Display solver information.
+    std::cout << solver << std::endl;
+
+    // Process the result
+    PROCESS_RESULT ();
+  }
 } // end of namespace roboptim
 
 #endif //! ROBOPTIM_SHARED_TESTS_COMMON_HH
@@ -0,0 +1,144 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "common.hh"
+#include "baseline.hh"
+
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+namespace
+{
+  /// \brief Record of a run with the given counts and normalized time.
+  roboptim::PerformanceRecord record (long iterations,
+                                      unsigned long computeCount,
+                                      unsigned long gradientCount,
+                                      double normalizedTime)
+  {
+    roboptim::PerformanceRecord r;
+    r.test = "problem.fixture";
+    r.solver = "fixture";
+    r.iterations = iterations;
+    r.wallTime = normalizedTime * roboptim::referenceTime ();
+
+    // Counts are summed over the functions.
+    roboptim::FunctionStatistics cost;
+    cost.computeCount = computeCount / 2;
+    cost.gradientCount = gradientCount;
+    roboptim::FunctionStatistics constraint;
+    constraint.computeCount = computeCount - cost.computeCount;
+    r.functions.push_back (cost);
+    r.functions.push_back (constraint);
+    return r;
+  }
+} // end of unnamed namespace
+
+BOOST_FIXTURE_TEST_SUITE (common, TestSuiteConfiguration)
+
+BOOST_AUTO_TEST_CASE (baseline_read)
+{
+  using namespace roboptim;
+
+  // Test names may contain dots.
+  PerformanceBaseline baseline;
+  BOOST_REQUIRE (readPerformanceBaseline (BASELINE_FIXTURE, "problem.fixture",
+                                          baseline));
+  BOOST_CHECK_EQUAL (baseline.iterations, 100);
+  BOOST_CHECK_EQUAL (baseline.computeCount, 100u);
+  BOOST_CHECK_EQUAL (baseline.gradientCount, 50u);
+  BOOST_CHECK_EQUAL (baseline.jacobianCount, 0u);
+  BOOST_CHECK_EQUAL (baseline.hessianCount, 0u);
+  BOOST_CHECK_EQUAL (baseline.wallTime, 0.5);
+  BOOST_CHECK_EQUAL (baseline.normalizedTime, 10.);
+
+  BOOST_CHECK (!readPerformanceBaseline (BASELINE_FIXTURE, "problem",
+                                         baseline));
+  BOOST_CHECK (!readPerformanceBaseline (BASELINE_FIXTURE, "missing",
+                                         baseline));
+
+  // Written baselines are read back, the other tests of the file are kept.
+  boost::filesystem::path path =
+    boost::filesystem::path ("/tmp/roboptim-shared-tests/" SOLVER_NAME)
+    / "common/baseline/baseline.json";
+  boost::filesystem::remove (path);
+  PerformanceRecord r = record (12, 30, 7, 2.);
+  writePerformanceBaseline (path, r);
+  r.test = "other";
+  writePerformanceBaseline (path, r);
+  BOOST_REQUIRE (readPerformanceBaseline (path, "problem.fixture", baseline));
+  BOOST_CHECK_EQUAL (baseline.iterations, 12);
+  BOOST_CHECK_EQUAL (baseline.computeCount, 30u);
+  BOOST_CHECK_EQUAL (baseline.gradientCount, 7u);
+  BOOST_CHECK_CLOSE (baseline.normalizedTime, 2., 1e-6);
+  BOOST_CHECK (readPerformanceBaseline (path, "other", baseline));
+}
+
+BOOST_AUTO_TEST_CASE (baseline_check)
+{
+  using namespace roboptim;
+
+  PerformanceBaseline baseline;
+  BOOST_REQUIRE (readPerformanceBaseline (BASELINE_FIXTURE, "problem.fixture",
+                                          baseline));
+
+  // The reference time is measured once per process.
+  BOOST_CHECK_GT (referenceTime (), 0.);
+  BOOST_CHECK_EQUAL (referenceTime (), referenceTime ());
+
+  BaselineTolerance tolerance;
+  tolerance.time = 0.5;
+  tolerance.count = 0.2;
+  tolerance.minTime = 0.;
+  std::string report;
+
+  // Counts: up to +20%, plus one.
+  BOOST_CHECK (checkPerformanceBaseline
+               (baseline, record (100, 100, 50, 10.), tolerance, report));
+  BOOST_CHECK (report.empty ());
+  BOOST_CHECK (checkPerformanceBaseline
+               (baseline, record (121, 121, 61, 10.), tolerance, report));
+  BOOST_CHECK (!checkPerformanceBaseline
+               (baseline, record (100, 122, 50, 10.), tolerance, report));
+  BOOST_CHECK_NE (report.find ("compute: 122"), std::string::npos);
+  BOOST_CHECK_EQUAL (report.find ("gradient"), std::string::npos);
+  BOOST_CHECK (!checkPerformanceBaseline
+               (baseline, record (122, 100, 62, 10.), tolerance, report));
+  BOOST_CHECK_NE (report.find ("iterations"), std::string::npos);
+  BOOST_CHECK_NE (report.find ("gradient"), std::string::npos);
+
+  // Fewer evaluations, and unknown iteration counts, are not regressions.
+  BOOST_CHECK (checkPerformanceBaseline
+               (baseline, record (-1, 10, 5, 10.), tolerance, report));
+
+  // Times are compared once normalized by the reference time of this
+  // machine: up to +50%.
+  BOOST_CHECK (checkPerformanceBaseline
+               (baseline, record (100, 100, 50, 14.9), tolerance, report));
+  BOOST_CHECK (!checkPerformanceBaseline
+               (baseline, record (100, 100, 50, 15.1), tolerance, report));
+  BOOST_CHECK_NE (report.find ("normalized time"), std::string::npos);
+
+  // Differences below minTime are timer noise.
+  tolerance.minTime = 6. * referenceTime ();
+  BOOST_CHECK (checkPerformanceBaseline
+               (baseline, record (100, 100, 50, 15.1), tolerance, report));
+  BOOST_CHECK (!checkPerformanceBaseline
+               (baseline, record (100, 100, 50, 16.1), tolerance, report));
+}
+
+BOOST_AUTO_TEST_SUITE_END ()
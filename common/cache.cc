@@ -0,0 +1,154 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "common.hh"
+#include "cache.hh"
+#include "fused.hh"
+
+#include <cmath>
+
+#include <roboptim/core/finite-difference-gradient.hh>
+
+namespace roboptim
+{
+  namespace cache
+  {
+    /// x₀² + 3 x₁, with a finite-difference gradient, as problem 54b: the
+    /// gradient evaluates the function at other points.
+    template <typename T>
+    struct F : public GenericDifferentiableFunction<T>
+    {
+      ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+      (GenericDifferentiableFunction<T>);
+
+      F () : GenericDifferentiableFunction<T> (2, 1, "x₀² + 3 x₁")
+      {}
+
+      void impl_compute (result_ref result, const_argument_ref x) const
+      {
+        result[0] = x[0] * x[0] + 3. * x[1];
+      }
+
+      void impl_gradient (gradient_ref grad, const_argument_ref x,
+                          size_type functionId) const
+      {
+        GenericFiniteDifferenceGradient<T> fd (*this);
+        fd.gradient (grad, x, functionId);
+      }
+    };
+
+    /// x₀ x₁, with a fused value and gradient.
+    template <typename T>
+    struct G : public GenericDifferentiableFunction<T>,
+               public GenericFusedEvaluation<T>
+    {
+      ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+      (GenericDifferentiableFunction<T>);
+
+      G () : GenericDifferentiableFunction<T> (2, 1, "x₀ x₁")
+      {}
+
+      void impl_compute (result_ref result, const_argument_ref x) const
+      {
+        result[0] = x[0] * x[1];
+      }
+
+      void impl_gradient (gradient_ref grad, const_argument_ref x,
+                          size_type) const
+      {
+        grad.coeffRef (0) = x[1];
+        grad.coeffRef (1) = x[0];
+      }
+
+      void impl_valueAndGradient (result_ref result, gradient_ref grad,
+                                  const_argument_ref x, size_type) const
+      {
+        result[0] = x[0] * x[1];
+        grad.coeffRef (0) = x[1];
+        grad.coeffRef (1) = x[0];
+      }
+    };
+  } // end of namespace cache
+} // end of namespace roboptim
+
+BOOST_FIXTURE_TEST_SUITE (common, TestSuiteConfiguration)
+
+// A derivative evaluating the function at other points must not store
+// its result under one of these points.
+BOOST_AUTO_TEST_CASE (cache_reentrant)
+{
+  using namespace roboptim;
+  typedef cache::F<functionType_t> f_t;
+
+  Cached<Instrumented<f_t> > f;
+  f.setCacheSize (1);
+
+  f_t::argument_t x (2);
+  x << 1., 2.;
+  f_t::gradient_t grad (2);
+  f_t::gradient_t cached (2);
+
+  f (x);
+  f.gradient (grad, x, 0);
+  BOOST_CHECK_CLOSE (grad.coeff (0), 2., 1e-4);
+  BOOST_CHECK_CLOSE (grad.coeff (1), 3., 1e-4);
+  BOOST_CHECK_EQUAL (f.cacheStatistics ().gradientMisses, 1u);
+
+  // The gradient at x is served from the cache.
+  f.gradient (cached, x, 0);
+  BOOST_CHECK_EQUAL (f.cacheStatistics ().gradientHits, 1u);
+  BOOST_CHECK (f_t::gradient_t (cached - grad).norm () == 0.);
+
+  // The last point evaluated by the finite differences has no cached
+  // gradient.
+  f_t::argument_t xp = x;
+  xp[1] += finiteDifferenceEpsilon;
+  f.gradient (grad, xp, 0);
+  BOOST_CHECK_EQUAL (f.cacheStatistics ().gradientHits, 1u);
+  BOOST_CHECK_EQUAL (f.cacheStatistics ().gradientMisses, 2u);
+  BOOST_CHECK_EQUAL (f.statistics ().gradientCount, 2u);
+}
+
+// Gradients evaluated along with a missing value are not hits.
+BOOST_AUTO_TEST_CASE (cache_fused_gradient)
+{
+  using namespace roboptim;
+  typedef cache::G<functionType_t> g_t;
+
+  Cached<Instrumented<g_t> > g;
+  g_t::argument_t x (2);
+  x << 2., 3.;
+  g_t::gradient_t grad (2);
+
+  // The gradient is evaluated once, with the value.
+  g (x);
+  g.gradient (grad, x, 0);
+  BOOST_CHECK_EQUAL (g.statistics ().computeCount, 1u);
+  BOOST_CHECK_EQUAL (g.statistics ().gradientCount, 1u);
+  BOOST_CHECK_EQUAL (g.cacheStatistics ().fusedGradients, 1u);
+  BOOST_CHECK_EQUAL (g.cacheStatistics ().gradientHits, 0u);
+  BOOST_CHECK_EQUAL (grad.coeff (0), 3.);
+  BOOST_CHECK_EQUAL (grad.coeff (1), 2.);
+
+  // Later calls are hits.
+  g.gradient (grad, x, 0);
+  BOOST_CHECK_EQUAL (g.cacheStatistics ().fusedGradients, 1u);
+  BOOST_CHECK_EQUAL (g.cacheStatistics ().gradientHits, 1u);
+  BOOST_CHECK_CLOSE (g.cacheStatistics ().hitRate (), 1. / 3., 1e-9);
+}
+
+BOOST_AUTO_TEST_SUITE_END ()
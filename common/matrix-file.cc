@@ -0,0 +1,344 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "common.hh"
+#include "matrix-file.hh"
+
+#include <chrono>
+#include <fstream>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+
+#include "serialize.hh"
+#include "util.hh"
+
+namespace
+{
+  boost::filesystem::path matrixPath (const std::string& name)
+  {
+    boost::filesystem::path path =
+      boost::filesystem::path ("/tmp/roboptim-shared-tests/" SOLVER_NAME)
+      / "common/matrix-file";
+    boost::filesystem::create_directories (path);
+    return path / name;
+  }
+
+  /// \brief Path of a test file relative to the tests data directory, as
+  /// expected by the functions of util.hh.
+  path_t dataPath (const std::string& name)
+  {
+    return boost::filesystem::relative (matrixPath (name), TESTS_DATA_DIR);
+  }
+
+  /// \brief Overwrite a field of a file.
+  template <typename T>
+  void patch (const boost::filesystem::path& file, std::streamoff offset,
+              T value)
+  {
+    std::fstream f (file.c_str (),
+                    std::ios::in | std::ios::out | std::ios::binary);
+    f.seekp (offset);
+    f.write (reinterpret_cast<const char*> (&value), sizeof (T));
+  }
+
+  template <typename M>
+  Eigen::SparseMatrix<double, M::Options>
+  randomSparse (typename M::Index rows, typename M::Index cols,
+                typename M::Index perColumn)
+  {
+    typedef typename M::Index index_t;
+    typedef Eigen::Triplet<double> triplet_t;
+    std::vector<triplet_t> triplets;
+    triplets.reserve (static_cast<std::size_t> (cols * perColumn));
+    for (index_t j = 0; j < cols; ++j)
+      for (index_t k = 0; k < perColumn; ++k)
+        triplets.push_back (triplet_t ((j * 7 + k * 13) % rows, j,
+                                       static_cast<double> (j - k)));
+
+    Eigen::SparseMatrix<double, M::Options> m (rows, cols);
+    m.setFromTriplets (triplets.begin (), triplets.end ());
+    return m;
+  }
+} // end of unnamed namespace
+
+BOOST_FIXTURE_TEST_SUITE (common, TestSuiteConfiguration)
+
+BOOST_AUTO_TEST_CASE (matrix_file)
+{
+  using namespace roboptim;
+
+  // Dense matrices, in both storage orders.
+  Eigen::MatrixXd a = Eigen::MatrixXd::Random (7, 5);
+  writeBinaryMatrix (matrixPath ("dense.bin"), a);
+  {
+    MatrixFile file (matrixPath ("dense.bin"));
+    BOOST_CHECK_EQUAL (file.header ().rows, 7u);
+    BOOST_CHECK_EQUAL (file.header ().cols, 5u);
+    BOOST_CHECK (file.dense<Eigen::MatrixXd> () == a);
+    BOOST_CHECK_THROW (file.dense<Eigen::MatrixXf> (), std::runtime_error);
+    BOOST_CHECK_THROW ((file.dense<Eigen::Matrix<double, Eigen::Dynamic,
+                        Eigen::Dynamic, Eigen::RowMajor> > ()),
+                       std::runtime_error);
+    BOOST_CHECK_THROW ((file.dense<Eigen::Matrix<double, 5, 7> > ()),
+                       std::runtime_error);
+#if EIGEN_VERSION_AT_LEAST(3, 2, 90)
+    BOOST_CHECK_THROW (file.sparse<Eigen::SparseMatrix<double> > (),
+                       std::runtime_error);
+#endif //! EIGEN_VERSION_AT_LEAST(3, 2, 90)
+  }
+
+  Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> b =
+    a.cast<float> ();
+  writeBinaryMatrix (matrixPath ("dense-row-major.bin"), b);
+  {
+    MatrixFile file (matrixPath ("dense-row-major.bin"));
+    BOOST_CHECK ((file.dense<Eigen::Matrix<float, Eigen::Dynamic,
+                  Eigen::Dynamic, Eigen::RowMajor> > () == b));
+  }
+
+#if EIGEN_VERSION_AT_LEAST(3, 2, 90)
+  // Sparse matrices, compressed or not.
+  Eigen::SparseMatrix<double> s =
+    randomSparse<Eigen::SparseMatrix<double> > (50, 40, 3);
+  writeBinaryMatrix (matrixPath ("sparse.bin"), s);
+  {
+    MatrixFile file (matrixPath ("sparse.bin"));
+    BOOST_CHECK_EQUAL (file.header ().nonZeros,
+                       static_cast<boost::uint64_t> (s.nonZeros ()));
+    Eigen::SparseMatrix<double> loaded =
+      file.sparse<Eigen::SparseMatrix<double> > ();
+    BOOST_CHECK_EQUAL ((loaded - s).norm (), 0.);
+    BOOST_CHECK_THROW (file.dense<Eigen::MatrixXd> (), std::runtime_error);
+  }
+
+  Eigen::SparseMatrix<double, Eigen::RowMajor> r = s;
+  r.insert (0, 39) = 1.;
+  BOOST_REQUIRE (!r.isCompressed ());
+  writeBinaryMatrix (matrixPath ("sparse-row-major.bin"), r);
+  {
+    MatrixFile file (matrixPath ("sparse-row-major.bin"));
+    Eigen::SparseMatrix<double, Eigen::RowMajor> loaded =
+      file.sparse<Eigen::SparseMatrix<double, Eigen::RowMajor> > ();
+    BOOST_CHECK_EQUAL ((loaded - r).norm (), 0.);
+  }
+#endif //! EIGEN_VERSION_AT_LEAST(3, 2, 90)
+
+  // Files that are not matrix files, or truncated.
+  {
+    std::ofstream out (matrixPath ("text.txt").c_str ());
+    out << "not a matrix file, but long enough for a matrix file header."
+        << std::endl;
+  }
+  BOOST_CHECK (!MatrixFile::isMatrixFile (matrixPath ("text.txt")));
+  BOOST_CHECK (MatrixFile::isMatrixFile (matrixPath ("dense.bin")));
+  BOOST_CHECK_THROW (MatrixFile (matrixPath ("text.txt")),
+                     std::runtime_error);
+
+  boost::filesystem::copy_file
+    (matrixPath ("dense.bin"), matrixPath ("truncated.bin"),
+     boost::filesystem::copy_option::overwrite_if_exists);
+  boost::filesystem::resize_file (matrixPath ("truncated.bin"), 100);
+  BOOST_CHECK_THROW (MatrixFile (matrixPath ("truncated.bin")),
+                     std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE (matrix_file_util)
+{
+  using namespace roboptim;
+
+  // Binary and text files, written and read through util.hh.
+  Eigen::MatrixXd a = Eigen::MatrixXd::Random (7, 5);
+  writeMatrix (dataPath ("util-dense.bin"), a);
+  writeMatrix (dataPath ("util-dense.txt"), a);
+  BOOST_CHECK (MatrixFile::isMatrixFile (matrixPath ("util-dense.bin")));
+  BOOST_CHECK (!MatrixFile::isMatrixFile (matrixPath ("util-dense.txt")));
+  BOOST_CHECK (readMatrix<Eigen::MatrixXd> (dataPath ("util-dense.bin")) == a);
+  BOOST_CHECK (readMatrix<Eigen::MatrixXd> (dataPath ("util-dense.txt")) == a);
+  BOOST_CHECK (mapMatrix (dataPath ("util-dense.bin"))
+               ->dense<Eigen::MatrixXd> () == a);
+
+  Eigen::SparseMatrix<double> s =
+    randomSparse<Eigen::SparseMatrix<double> > (50, 40, 3);
+  writeMatrix (dataPath ("util-sparse.txt"), s);
+  BOOST_CHECK_EQUAL ((readMatrix<Eigen::SparseMatrix<double> >
+                      (dataPath ("util-sparse.txt")) - s).norm (), 0.);
+
+  writeMatrix (dataPath ("util-sparse.bin"), s);
+#if EIGEN_VERSION_AT_LEAST(3, 2, 90)
+  BOOST_CHECK_EQUAL ((readMatrix<Eigen::SparseMatrix<double> >
+                      (dataPath ("util-sparse.bin")) - s).norm (), 0.);
+  BOOST_CHECK_EQUAL ((Eigen::SparseMatrix<double>
+                      (mapMatrix (dataPath ("util-sparse.bin"))
+                       ->sparse<Eigen::SparseMatrix<double> > ())
+                      - s).norm (), 0.);
+#else
+  BOOST_CHECK_THROW (readMatrix<Eigen::SparseMatrix<double> >
+                     (dataPath ("util-sparse.bin")), std::runtime_error);
+#endif //! EIGEN_VERSION_AT_LEAST(3, 2, 90)
+}
+
+BOOST_AUTO_TEST_CASE (matrix_file_corrupt)
+{
+  using namespace roboptim;
+
+  // Header offsets (see matrix-file.hh).
+  const std::streamoff rows = 32;
+  const std::streamoff cols = 40;
+  const std::streamoff nonZeros = 48;
+  // First array of the file.
+  const std::streamoff data = 64;
+
+  Eigen::MatrixXd a = Eigen::MatrixXd::Random (7, 5);
+  writeMatrix (dataPath ("util-dense.bin"), a);
+
+  // rows * cols overflows.
+  boost::filesystem::copy_file
+    (matrixPath ("util-dense.bin"), matrixPath ("corrupt.bin"),
+     boost::filesystem::copy_option::overwrite_if_exists);
+  patch (matrixPath ("corrupt.bin"), rows, boost::uint64_t (1) << 33);
+  patch (matrixPath ("corrupt.bin"), cols, boost::uint64_t (1) << 33);
+  BOOST_CHECK_THROW (readMatrix<Eigen::MatrixXd> (dataPath ("corrupt.bin")),
+                     std::runtime_error);
+
+  // rows * cols * sizeof (double) overflows.
+  patch (matrixPath ("corrupt.bin"), rows, boost::uint64_t (1) << 31);
+  patch (matrixPath ("corrupt.bin"), cols, boost::uint64_t (1) << 31);
+  BOOST_CHECK_THROW (mapMatrix (dataPath ("corrupt.bin")),
+                     std::runtime_error);
+
+  // Sizes that do not fit in Eigen indices.
+  patch (matrixPath ("corrupt.bin"), rows, boost::uint64_t (1) << 63);
+  patch (matrixPath ("corrupt.bin"), cols, boost::uint64_t (0));
+  BOOST_CHECK_THROW (mapMatrix (dataPath ("corrupt.bin")),
+                     std::runtime_error);
+
+  Eigen::SparseMatrix<double> s =
+    randomSparse<Eigen::SparseMatrix<double> > (50, 40, 3);
+  writeMatrix (dataPath ("util-sparse.bin"), s);
+  const std::streamoff inner =
+    data + static_cast<std::streamoff>
+    (matrixFile::padded ((static_cast<std::size_t> (s.outerSize ()) + 1)
+                         * sizeof (int)));
+
+  // The size of the arrays of nonZeros elements overflows.
+  boost::filesystem::copy_file
+    (matrixPath ("util-sparse.bin"), matrixPath ("corrupt.bin"),
+     boost::filesystem::copy_option::overwrite_if_exists);
+  patch (matrixPath ("corrupt.bin"), nonZeros, boost::uint64_t (1) << 62);
+  BOOST_CHECK_THROW (mapMatrix (dataPath ("corrupt.bin")),
+                     std::runtime_error);
+
+#if EIGEN_VERSION_AT_LEAST(3, 2, 90)
+  typedef Eigen::SparseMatrix<double> sparse_t;
+
+  // Outer index array not starting at 0.
+  boost::filesystem::copy_file
+    (matrixPath ("util-sparse.bin"), matrixPath ("corrupt.bin"),
+     boost::filesystem::copy_option::overwrite_if_exists);
+  patch (matrixPath ("corrupt.bin"), data, int (1));
+  BOOST_CHECK_THROW (readMatrix<sparse_t> (dataPath ("corrupt.bin")),
+                     std::runtime_error);
+
+  // Decreasing outer index array.
+  boost::filesystem::copy_file
+    (matrixPath ("util-sparse.bin"), matrixPath ("corrupt.bin"),
+     boost::filesystem::copy_option::overwrite_if_exists);
+  patch (matrixPath ("corrupt.bin"), data + 2 * sizeof (int),
+         int (s.outerIndexPtr ()[1] - 1));
+  BOOST_CHECK_THROW (readMatrix<sparse_t> (dataPath ("corrupt.bin")),
+                     std::runtime_error);
+
+  // Outer index array not ending at the number of nonzeros.
+  boost::filesystem::copy_file
+    (matrixPath ("util-sparse.bin"), matrixPath ("corrupt.bin"),
+     boost::filesystem::copy_option::overwrite_if_exists);
+  patch (matrixPath ("corrupt.bin"),
+         data + static_cast<std::streamoff> (s.outerSize () * sizeof (int)),
+         int (s.nonZeros () + 1));
+  BOOST_CHECK_THROW (readMatrix<sparse_t> (dataPath ("corrupt.bin")),
+                     std::runtime_error);
+
+  // Inner index out of range.
+  boost::filesystem::copy_file
+    (matrixPath ("util-sparse.bin"), matrixPath ("corrupt.bin"),
+     boost::filesystem::copy_option::overwrite_if_exists);
+  patch (matrixPath ("corrupt.bin"), inner, int (s.innerSize ()));
+  BOOST_CHECK_THROW (readMatrix<sparse_t> (dataPath ("corrupt.bin")),
+                     std::runtime_error);
+  BOOST_CHECK_THROW (mapMatrix (dataPath ("corrupt.bin"))->sparse<sparse_t> (),
+                     std::runtime_error);
+
+  // The original file is still valid.
+  BOOST_CHECK_EQUAL ((readMatrix<sparse_t> (dataPath ("util-sparse.bin"))
+                      - s).norm (), 0.);
+#endif //! EIGEN_VERSION_AT_LEAST(3, 2, 90)
+}
+
+BOOST_AUTO_TEST_CASE (matrix_file_load)
+{
+  using namespace roboptim;
+
+  // Reference Jacobian of 10⁶ nonzeros.
+  Eigen::SparseMatrix<double> s =
+    randomSparse<Eigen::SparseMatrix<double> > (10000, 100000, 10);
+
+  writeBinaryMatrix (matrixPath ("large.bin"), s);
+  {
+    std::ofstream ofs (matrixPath ("large.txt").c_str ());
+    boost::archive::text_oarchive oa (ofs);
+    oa << s;
+  }
+
+  std::chrono::steady_clock::time_point start
+    = std::chrono::steady_clock::now ();
+  Eigen::SparseMatrix<double> text;
+  {
+    std::ifstream ifs (matrixPath ("large.txt").c_str ());
+    boost::archive::text_iarchive ia (ifs);
+    ia >> text;
+  }
+  double textTime = std::chrono::duration<double>
+    (std::chrono::steady_clock::now () - start).count ();
+  std::cout << "Loading " << s.nonZeros () << " nonzeros: "
+            << textTime << "s (text archive)";
+
+#if EIGEN_VERSION_AT_LEAST(3, 2, 90)
+  // The mapped matrix is summed, so that its pages are actually read.
+  start = std::chrono::steady_clock::now ();
+  double sum = 0.;
+  {
+    MatrixFile file (matrixPath ("large.bin"));
+    Eigen::Map<const Eigen::SparseMatrix<double> > mapped =
+      file.sparse<Eigen::SparseMatrix<double> > ();
+    sum = mapped.sum ();
+  }
+  double mappedTime = std::chrono::duration<double>
+    (std::chrono::steady_clock::now () - start).count ();
+
+  std::cout << ", " << mappedTime << "s (mapped file)";
+
+  BOOST_CHECK_EQUAL (sum, s.sum ());
+#endif //! EIGEN_VERSION_AT_LEAST(3, 2, 90)
+  std::cout << std::endl;
+  BOOST_CHECK_EQUAL ((text - s).norm (), 0.);
+}
+
+BOOST_AUTO_TEST_SUITE_END ()
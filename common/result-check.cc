@@ -0,0 +1,131 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "common.hh"
+
+#include <boost/make_shared.hpp>
+
+namespace roboptim
+{
+  namespace resultCheck
+  {
+    /// f(x) = x₀
+    template <typename T>
+    struct Identity : public GenericLinearFunction<T>
+    {
+      ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+      (GenericLinearFunction<T>);
+
+      Identity () : GenericLinearFunction<T> (1, 1, "x₀")
+      {}
+
+      void impl_compute (result_ref result, const_argument_ref x) const
+      {
+        result[0] = x[0];
+      }
+
+      void impl_gradient (gradient_ref grad, const_argument_ref,
+                          size_type functionId = 0) const;
+    };
+
+    template <>
+    void
+    Identity<EigenMatrixSparse>::impl_gradient
+    (gradient_ref grad, const_argument_ref, size_type) const
+    {
+      grad.coeffRef (0) = 1.;
+    }
+
+    template <typename T>
+    void
+    Identity<T>::impl_gradient
+    (gradient_ref grad, const_argument_ref, size_type) const
+    {
+      grad[0] = 1.;
+    }
+  } // end of namespace resultCheck
+} // end of namespace roboptim
+
+BOOST_FIXTURE_TEST_SUITE (common, TestSuiteConfiguration)
+
+// The status of runs without Boost checks (sweeps, parallel jobs,
+// profiles) uses the criterion of CHECK_RESULT.
+BOOST_AUTO_TEST_CASE (result_check)
+{
+  using namespace roboptim;
+  using namespace roboptim::resultCheck;
+
+  typedef Identity<functionType_t> identity_t;
+
+  // min x₀ s.t. x₀ ∈ [0.5, 1], x₀ ∈ [-1, 1]
+  solver_t::problem_t problem (boost::make_shared<identity_t> ());
+  problem.argumentBounds ()[0] = Function::makeInterval (-1., 1.);
+  problem.addConstraint (boost::make_shared<identity_t> (),
+                         Function::makeInterval (0.5, 1.));
+
+  ExpectedResult expectedResult;
+  expectedResult.f0 = 0.;
+  expectedResult.x = (ExpectedResult::argument_t (1) << 0.5).finished ();
+  expectedResult.fx = 0.5;
+
+  ProblemTolerances tolerances;
+
+  // Optimum.
+  Result result (1, 1);
+  result.x[0] = 0.5;
+  result.value[0] = 0.5;
+  result.constraints.resize (1);
+  result.constraints[0] = 0.5;
+  ResultCheck check = checkResult (result, problem, expectedResult,
+                                   tolerances.x, tolerances.f);
+  BOOST_CHECK (check.fx && check.bounds && check.constraints && check.x);
+  BOOST_CHECK_EQUAL (resultStatus (solver_t::result_t (result), problem,
+                                   expectedResult, tolerances), "success");
+
+  // Infeasible point with the expected cost.
+  result.x[0] = -0.5;
+  result.constraints[0] = -0.5;
+  check = checkResult (result, problem, expectedResult,
+                       tolerances.x, tolerances.f);
+  BOOST_CHECK (check.fx && check.bounds);
+  BOOST_CHECK (!check.constraints);
+  BOOST_CHECK (!check.success ());
+  BOOST_CHECK_EQUAL (resultStatus (solver_t::result_t (result), problem,
+                                   expectedResult, tolerances), "failure");
+
+  // Point outside of the argument bounds.
+  result.x[0] = 2.;
+  result.constraints[0] = 0.5;
+  check = checkResult (result, problem, expectedResult,
+                       tolerances.x, tolerances.f);
+  BOOST_CHECK (!check.bounds);
+  BOOST_CHECK (!check.success ());
+
+  // Constraint values not copied to the result: only x is trusted.
+  result.x[0] = 0.5;
+  result.constraints.resize (0);
+  check = checkResult (result, problem, expectedResult,
+                       tolerances.x, tolerances.f);
+  BOOST_CHECK (!check.constraints);
+  BOOST_CHECK (check.success ());
+
+  BOOST_CHECK_EQUAL (resultStatus (solver_t::result_t (SolverError ("error")),
+                                   problem, expectedResult, tolerances),
+                     "error");
+}
+
+BOOST_AUTO_TEST_SUITE_END ()
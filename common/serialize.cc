@@ -0,0 +1,197 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "common.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+
+#include "serialize.hh"
+
+namespace
+{
+  /// \brief Sparse matrix with the same number of nonzeros in each outer
+  /// vector, built in compressed storage.
+  template <typename M>
+  M bandedSparse (typename M::Index rows, typename M::Index cols,
+                  typename M::Index perOuter)
+  {
+    M m (rows, cols);
+    m.reserve (m.outerSize () * perOuter);
+    for (typename M::Index j = 0; j < m.outerSize (); ++j)
+      {
+        m.startVec (j);
+        typename M::Index first = j % (m.innerSize () - perOuter + 1);
+        for (typename M::Index k = 0; k < perOuter; ++k)
+          m.insertBackByOuterInner (j, first + k) =
+            static_cast<typename M::Scalar> (j - k);
+      }
+    m.finalize ();
+    return m;
+  }
+
+  template <typename M>
+  bool sameStorage (const M& a, const M& b)
+  {
+    return a.rows () == b.rows () && a.cols () == b.cols ()
+      && a.nonZeros () == b.nonZeros () && b.isCompressed ()
+      && std::equal (a.outerIndexPtr (),
+                     a.outerIndexPtr () + a.outerSize () + 1,
+                     b.outerIndexPtr ())
+      && std::equal (a.innerIndexPtr (), a.innerIndexPtr () + a.nonZeros (),
+                     b.innerIndexPtr ())
+      && std::equal (a.valuePtr (), a.valuePtr () + a.nonZeros (),
+                     b.valuePtr ());
+  }
+
+  template <typename M>
+  M textRoundTrip (const M& m)
+  {
+    std::stringstream ss;
+    {
+      boost::archive::text_oarchive oa (ss);
+      oa << m;
+    }
+    M loaded;
+    boost::archive::text_iarchive ia (ss);
+    ia >> loaded;
+    return loaded;
+  }
+
+  template <typename M>
+  M binaryRoundTrip (const M& m)
+  {
+    std::stringstream ss;
+    {
+      boost::archive::binary_oarchive oa (ss);
+      oa << m;
+    }
+    M loaded;
+    boost::archive::binary_iarchive ia (ss);
+    ia >> loaded;
+    return loaded;
+  }
+} // end of unnamed namespace
+
+BOOST_FIXTURE_TEST_SUITE (common, TestSuiteConfiguration)
+
+BOOST_AUTO_TEST_CASE (serialize_sparse)
+{
+  typedef Eigen::SparseMatrix<double> colMajor_t;
+  typedef Eigen::SparseMatrix<double, Eigen::RowMajor> rowMajor_t;
+
+  colMajor_t a = bandedSparse<colMajor_t> (30, 20, 3);
+  BOOST_CHECK (sameStorage (a, textRoundTrip (a)));
+
+  rowMajor_t b = bandedSparse<rowMajor_t> (30, 20, 4);
+  BOOST_CHECK (sameStorage (b, textRoundTrip (b)));
+
+  // Binary archives, as used for large matrices.
+  colMajor_t large = bandedSparse<colMajor_t> (1000, 10000, 10);
+  BOOST_CHECK (sameStorage (large, binaryRoundTrip (large)));
+  BOOST_CHECK (sameStorage (b, binaryRoundTrip (b)));
+
+  // Uncompressed matrices are saved compressed.
+  colMajor_t c = a;
+  c.insert (29, 0) = 1.;
+  BOOST_REQUIRE (!c.isCompressed ());
+  colMajor_t loaded = textRoundTrip (c);
+  BOOST_CHECK (loaded.isCompressed ());
+  BOOST_CHECK_EQUAL ((loaded - c).norm (), 0.);
+
+  // Empty matrices, and loading into a non-empty matrix.
+  colMajor_t empty (5, 0);
+  BOOST_CHECK (sameStorage (empty, textRoundTrip (empty)));
+  {
+    std::stringstream ss;
+    {
+      boost::archive::text_oarchive oa (ss);
+      oa << a;
+    }
+    boost::archive::text_iarchive ia (ss);
+    ia >> c;
+    BOOST_CHECK (sameStorage (a, c));
+  }
+}
+
+// Measure the time needed to save and load a sparse matrix of 10⁷
+// nonzeros (about 120 MiB) in a binary archive:
+// serialize --run_test=common/serialize_sparse_throughput -- throughput
+BOOST_AUTO_TEST_CASE (serialize_sparse_throughput)
+{
+  typedef Eigen::SparseMatrix<double> matrix_t;
+
+  int argc = boost::unit_test::framework::master_test_suite ().argc;
+  char** argv = boost::unit_test::framework::master_test_suite ().argv;
+  if (argc < 2 || std::string (argv[1]) != "throughput")
+    return;
+
+  // 10⁷ nonzeros.
+  matrix_t m = bandedSparse<matrix_t> (100000, 1000000, 10);
+
+  boost::filesystem::path path =
+    boost::filesystem::path ("/tmp/roboptim-shared-tests/" SOLVER_NAME)
+    / "common/serialize";
+  boost::filesystem::create_directories (path);
+  path /= "sparse.bin";
+
+  std::chrono::steady_clock::time_point start
+    = std::chrono::steady_clock::now ();
+  {
+    std::ofstream ofs (path.c_str (), std::ios::binary);
+    boost::archive::binary_oarchive oa (ofs);
+    oa << m;
+  }
+  double saveTime = std::chrono::duration<double>
+    (std::chrono::steady_clock::now () - start).count ();
+
+  start = std::chrono::steady_clock::now ();
+  matrix_t loaded;
+  {
+    std::ifstream ifs (path.c_str (), std::ios::binary);
+    boost::archive::binary_iarchive ia (ifs);
+    ia >> loaded;
+  }
+  double loadTime = std::chrono::duration<double>
+    (std::chrono::steady_clock::now () - start).count ();
+
+  double size = static_cast<double> (boost::filesystem::file_size (path));
+  std::cout << "Serializing " << m.nonZeros () << " nonzeros ("
+            << size / (1 << 20) << " MiB): "
+            << saveTime << "s (save), " << loadTime << "s (load)"
+            << std::endl;
+
+  BOOST_CHECK (sameStorage (m, loaded));
+
+  // Compressed storage: a value and an inner index per nonzero.
+  BOOST_CHECK_LT (size, static_cast<double> (m.nonZeros ())
+                  * (sizeof (double) + sizeof (int)) * 1.1);
+
+  boost::filesystem::remove (path);
+}
+
+BOOST_AUTO_TEST_SUITE_END ()
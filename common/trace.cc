@@ -0,0 +1,282 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "common.hh"
+#include "async-trace.hh"
+#include "failure-trace.hh"
+#include "trace.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+#include <boost/make_shared.hpp>
+
+#include <roboptim/core/numeric-quadratic-function.hh>
+
+namespace roboptim
+{
+  namespace common
+  {
+    namespace trace
+    {
+      /// (x₀ - 1)² + (x₁ - 2)² - 5
+      template <typename T>
+      struct F : public GenericNumericQuadraticFunction<T>
+      {
+        ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+        (GenericNumericQuadraticFunction<T>);
+
+        explicit F () : GenericNumericQuadraticFunction<T>
+                        (matrix_t (2, 2),
+                         (vector_t (2) << -2., -4.).finished (),
+                         vector_t::Zero (1))
+        {
+          initialize ();
+        }
+
+        void initialize ();
+      };
+
+      template <>
+      void F<EigenMatrixSparse>::initialize ()
+      {
+        Eigen::MatrixXd denseA = Eigen::MatrixXd::Identity (2, 2);
+        this->A () = denseA.sparseView ();
+      }
+
+      template <typename T>
+      void F<T>::initialize ()
+      {
+        this->A () = Eigen::MatrixXd::Identity (2, 2);
+      }
+    } // end of namespace trace
+  } // end of namespace common
+} // end of namespace roboptim
+
+BOOST_FIXTURE_TEST_SUITE (common, TestSuiteConfiguration)
+
+BOOST_AUTO_TEST_CASE (binary_trace)
+{
+  using namespace roboptim;
+  typedef roboptim::common::trace::F<functionType_t> f_t;
+
+  boost::shared_ptr<f_t> f = boost::make_shared<f_t> ();
+  solver_t::problem_t problem (f);
+  problem.startingPoint () = (f_t::argument_t (2) << 0., 0.).finished ();
+  problem.argumentBounds ()[0] = Function::makeInterval (-5., 5.);
+  problem.argumentBounds ()[1] = Function::makeInterval (-5., 5.);
+
+  boost::filesystem::path path =
+    boost::filesystem::path ("/tmp/roboptim-shared-tests/" SOLVER_NAME)
+    / "common/trace";
+
+  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
+  solver_t& solver = factory ();
+  {
+    BinaryTraceLogger<solver_t> logger (solver, path);
+    solver_t::result_t res = solver.minimum ();
+    logger << "Optimal solution found: true" << solver;
+  }
+
+  // Read the trace back.
+  TraceReader reader (path / "trace.bin");
+  BOOST_CHECK_EQUAL (reader.header ().inputSize, 2u);
+  BOOST_CHECK_EQUAL (reader.header ().constraintsSize, 0u);
+
+  TraceRecord record;
+  boost::uint64_t iterations = 0;
+  std::vector<std::string> texts;
+  while (reader.next (record))
+    if (record.type == roboptim::trace::ITERATION)
+      {
+        BOOST_CHECK_EQUAL (record.iteration, iterations++);
+        BOOST_CHECK_EQUAL (record.x.size (), 2);
+      }
+    else
+      texts.push_back (record.text);
+
+  BOOST_REQUIRE_EQUAL (texts.size (), 2u);
+  BOOST_CHECK_EQUAL (texts[0], "Optimal solution found: true");
+
+  std::ostringstream csv;
+  writeTraceCsv (csv, path / "trace.bin");
+  BOOST_CHECK_EQUAL (csv.str ().substr (0, csv.str ().find ('\n')),
+                     "iteration,cost,violation,x_0,x_1");
+
+  // A truncated last record is ignored.
+  boost::uintmax_t size = boost::filesystem::file_size (path / "trace.bin");
+  boost::filesystem::resize_file (path / "trace.bin", size - 1);
+  TraceReader truncated (path / "trace.bin");
+  std::size_t records = 0;
+  while (truncated.next (record))
+    ++records;
+  BOOST_CHECK_EQUAL (records, iterations + 1);
+}
+
+BOOST_AUTO_TEST_CASE (async_trace)
+{
+  using namespace roboptim;
+  typedef roboptim::common::trace::F<functionType_t> f_t;
+
+  boost::shared_ptr<f_t> f = boost::make_shared<f_t> ();
+  solver_t::problem_t problem (f);
+  problem.startingPoint () = (f_t::argument_t (2) << 0., 0.).finished ();
+
+  boost::filesystem::path path =
+    boost::filesystem::path ("/tmp/roboptim-shared-tests/" SOLVER_NAME)
+    / "common/async-trace";
+
+  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
+  solver_t& solver = factory ();
+  long iterations = 0;
+  unsigned long dropped = 0;
+  {
+    // Buffer of 2 iterations, without waiting: iterations may be dropped.
+    AsyncTraceLogger<solver_t> logger (solver, path, false, 2,
+                                       std::chrono::microseconds (0));
+    BOOST_CHECK_EQUAL (logger.capacity (), 2u);
+
+    perfMonitor_t monitor (solver, logger.callback ());
+    monitor.minimum ();
+    iterations = monitor.record ().iterations;
+    dropped = logger.dropped ();
+    logger << "Optimal solution found: true";
+  }
+
+  // The records are written in order, and all the iterations are either
+  // written or dropped.
+  TraceReader reader (path / "trace.bin");
+  TraceRecord record;
+  long written = 0;
+  long last = -1;
+  std::vector<std::string> texts;
+  while (reader.next (record))
+    if (record.type == roboptim::trace::ITERATION)
+      {
+        BOOST_CHECK (static_cast<long> (record.iteration) > last);
+        last = static_cast<long> (record.iteration);
+        ++written;
+      }
+    else
+      texts.push_back (record.text);
+
+  if (iterations >= 0)
+    BOOST_CHECK_EQUAL (written + static_cast<long> (dropped), iterations);
+  BOOST_REQUIRE (!texts.empty ());
+  BOOST_CHECK_EQUAL (texts[0], "Optimal solution found: true");
+  BOOST_CHECK_EQUAL (texts.size (), dropped ? 2u : 1u);
+}
+
+BOOST_AUTO_TEST_CASE (async_trace_error)
+{
+  using namespace roboptim;
+  typedef roboptim::common::trace::F<functionType_t> f_t;
+
+  // Writes to /dev/full fail with ENOSPC (Linux).
+  if (!boost::filesystem::exists ("/dev/full"))
+    return;
+
+  boost::shared_ptr<f_t> f = boost::make_shared<f_t> ();
+  solver_t::problem_t problem (f);
+  problem.startingPoint () = (f_t::argument_t (2) << 0., 0.).finished ();
+
+  boost::filesystem::path path =
+    boost::filesystem::path ("/tmp/roboptim-shared-tests/" SOLVER_NAME)
+    / "common/async-trace-error";
+  boost::filesystem::remove_all (path);
+  boost::filesystem::create_directories (path);
+  boost::filesystem::create_symlink ("/dev/full", path / "trace.bin");
+
+  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
+  solver_t& solver = factory ();
+  {
+    AsyncTraceLogger<solver_t> logger (solver, path, false, 2);
+    logger << "Optimal solution found: true";
+
+    std::chrono::steady_clock::time_point deadline
+      = std::chrono::steady_clock::now () + std::chrono::seconds (10);
+    while (logger.error ().empty ()
+           && std::chrono::steady_clock::now () < deadline)
+      std::this_thread::sleep_for (std::chrono::milliseconds (1));
+    BOOST_CHECK (!logger.error ().empty ());
+
+    // The records are still consumed after the error.
+    for (int i = 0; i < 10; ++i)
+      logger << "Discarded record";
+  }
+
+  boost::filesystem::remove_all (path);
+}
+
+BOOST_AUTO_TEST_CASE (failure_trace)
+{
+  using namespace roboptim;
+  typedef roboptim::common::trace::F<functionType_t> f_t;
+
+  boost::shared_ptr<f_t> f = boost::make_shared<f_t> ();
+  solver_t::problem_t problem (f);
+  problem.startingPoint () = (f_t::argument_t (2) << 0., 0.).finished ();
+
+  boost::filesystem::path path =
+    boost::filesystem::path ("/tmp/roboptim-shared-tests/" SOLVER_NAME)
+    / "common/failure-trace";
+  boost::filesystem::remove_all (path);
+
+  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
+  solver_t& solver = factory ();
+
+  // Successful runs are not written.
+  {
+    FailureTraceLogger<solver_t> logger (solver, path, true, 3);
+    solver.minimum ();
+    logger << "Optimal solution found: true";
+  }
+  BOOST_CHECK (!boost::filesystem::exists (path / "trace.bin"));
+
+  // Failed runs write the last iterations.
+  boost::uint64_t iterations = 0;
+  {
+    FailureTraceLogger<solver_t> logger (solver, path, true, 3);
+    solver.minimum ();
+    logger << "Optimal solution found: false";
+    markFailure (logger);
+    iterations = logger.iterations ();
+  }
+  BOOST_REQUIRE (boost::filesystem::exists (path / "trace.bin"));
+
+  TraceReader reader (path / "trace.bin");
+  TraceRecord record;
+  std::vector<boost::uint64_t> written;
+  std::vector<std::string> texts;
+  while (reader.next (record))
+    if (record.type == roboptim::trace::ITERATION)
+      written.push_back (record.iteration);
+    else
+      texts.push_back (record.text);
+
+  BOOST_CHECK_EQUAL (written.size (), std::min<boost::uint64_t> (iterations, 3));
+  for (std::size_t i = 0; i < written.size (); ++i)
+    BOOST_CHECK_EQUAL (written[i], iterations - written.size () + i);
+  BOOST_REQUIRE_EQUAL (texts.size (), 1u);
+  BOOST_CHECK_EQUAL (texts[0], "Optimal solution found: false");
+}
+
+BOOST_AUTO_TEST_SUITE_END ()
@@ -0,0 +1,202 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_COMPARISON_HH
+# define ROBOPTIM_SHARED_TESTS_COMPARISON_HH
+# include <algorithm>
+# include <fstream>
+# include <iomanip>
+# include <iostream>
+# include <map>
+# include <sstream>
+# include <string>
+# include <utility>
+# include <vector>
+
+# include <boost/filesystem.hpp>
+
+# include "perf.hh"
+
+namespace roboptim
+{
+  /// \brief Results of several solvers on the same problems (solver ×
+  /// problem matrix).
+  ///
+  /// Problems and solvers are kept in the order in which they were first
+  /// added.
+  class ComparisonMatrix
+  {
+  public:
+    typedef std::pair<std::string, std::string> key_t;
+
+    /// \brief Add the record of a run (indexed by record.test and
+    /// record.solver). A previous record of the same run is replaced.
+    void add (const PerformanceRecord& record)
+    {
+      if (std::find (problems_.begin (), problems_.end (), record.test)
+          == problems_.end ())
+        problems_.push_back (record.test);
+      if (std::find (solvers_.begin (), solvers_.end (), record.solver)
+          == solvers_.end ())
+        solvers_.push_back (record.solver);
+      records_[key_t (record.test, record.solver)] = record;
+    }
+
+    /// \brief Add several records.
+    void add (const std::vector<PerformanceRecord>& records)
+    {
+      for (std::size_t i = 0; i < records.size (); ++i)
+        add (records[i]);
+    }
+
+    /// \brief Record of a solver on a problem, null if it was not run.
+    const PerformanceRecord* find (const std::string& problem,
+                                   const std::string& solver) const
+    {
+      std::map<key_t, PerformanceRecord>::const_iterator
+        it = records_.find (key_t (problem, solver));
+      return (it == records_.end ()) ? 0 : &it->second;
+    }
+
+    const std::vector<std::string>& problems () const
+    {
+      return problems_;
+    }
+
+    const std::vector<std::string>& solvers () const
+    {
+      return solvers_;
+    }
+
+  private:
+    std::vector<std::string> problems_;
+    std::vector<std::string> solvers_;
+    std::map<key_t, PerformanceRecord> records_;
+  };
+
+  /// \brief Print the matrix: one row per problem, and for each solver
+  /// the status, solve time and number of iterations.
+  ///
+  /// The last rows give, for each solver, the number of solved problems,
+  /// the total time on these problems, and the number of problems on
+  /// which the solver is the fastest among the successful ones.
+  inline void printComparisonMatrix (std::ostream& o,
+                                     const ComparisonMatrix& matrix)
+  {
+    const std::vector<std::string>& problems = matrix.problems ();
+    const std::vector<std::string>& solvers = matrix.solvers ();
+
+    std::ostringstream ss;
+    ss << "Solver comparison (status / wall time in ms / iterations):"
+       << std::endl << std::left << std::setw (32) << "problem" << std::right;
+    for (std::size_t s = 0; s < solvers.size (); ++s)
+      ss << std::setw (32) << solvers[s];
+    ss << std::endl;
+
+    std::vector<std::size_t> solved (solvers.size (), 0);
+    std::vector<std::size_t> fastest (solvers.size (), 0);
+    std::vector<double> time (solvers.size (), 0.);
+    for (std::size_t p = 0; p < problems.size (); ++p)
+      {
+        ss << std::left << std::setw (32) << problems[p] << std::right;
+
+        std::size_t best = solvers.size ();
+        for (std::size_t s = 0; s < solvers.size (); ++s)
+          {
+            const PerformanceRecord* r = matrix.find (problems[p], solvers[s]);
+            if (!r)
+              {
+                ss << std::setw (32) << "-";
+                continue;
+              }
+
+            std::ostringstream cell;
+            cell << r->status << " / " << std::fixed << std::setprecision (3)
+                 << 1e3 * r->wallTime << " / " << r->iterations;
+            ss << std::setw (32) << cell.str ();
+
+            if (r->status != "success")
+              continue;
+            ++solved[s];
+            time[s] += r->wallTime;
+            if (best == solvers.size ()
+                || r->wallTime
+                < matrix.find (problems[p], solvers[best])->wallTime)
+              best = s;
+          }
+        if (best < solvers.size ())
+          ++fastest[best];
+        ss << std::endl;
+      }
+
+    ss << std::left << std::setw (32) << "solved" << std::right;
+    for (std::size_t s = 0; s < solvers.size (); ++s)
+      {
+        std::ostringstream cell;
+        cell << solved[s] << "/" << problems.size ();
+        ss << std::setw (32) << cell.str ();
+      }
+    ss << std::endl << std::left << std::setw (32) << "time on solved (ms)"
+       << std::right << std::fixed << std::setprecision (3);
+    for (std::size_t s = 0; s < solvers.size (); ++s)
+      ss << std::setw (32) << 1e3 * time[s];
+    ss << std::endl << std::left << std::setw (32) << "fastest" << std::right;
+    for (std::size_t s = 0; s < solvers.size (); ++s)
+      ss << std::setw (32) << fastest[s];
+    ss << std::endl;
+
+    o << ss.str ();
+  }
+
+  /// \brief Write the matrix as CSV, one line per (problem, solver) run:
+  /// problem, solver, status, wall time (s), iterations and evaluations
+  /// (summed over all the instrumented functions).
+  ///
+  /// \param file output file.
+  /// \param matrix results.
+  inline void writeComparisonMatrix (const boost::filesystem::path& file,
+                                     const ComparisonMatrix& matrix)
+  {
+    if (file.has_parent_path ())
+      boost::filesystem::create_directories (file.parent_path ());
+
+    std::ostringstream ss;
+    ss.precision (9);
+    ss << "problem,solver,status,wall_time,iterations,evaluations\n";
+    for (std::size_t p = 0; p < matrix.problems ().size (); ++p)
+      for (std::size_t s = 0; s < matrix.solvers ().size (); ++s)
+        {
+          const PerformanceRecord* r = matrix.find (matrix.problems ()[p],
+                                                    matrix.solvers ()[s]);
+          if (!r)
+            continue;
+
+          unsigned long evaluations = 0;
+          for (std::size_t i = 0; i < r->functions.size (); ++i)
+            evaluations += r->functions[i].totalCount ();
+
+          ss << r->test << "," << r->solver << "," << r->status << ","
+             << r->wallTime << "," << r->iterations << "," << evaluations
+             << "\n";
+        }
+
+    std::ofstream ofs (file.c_str ());
+    ofs << ss.str ();
+  }
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_COMPARISON_HH
@@ -0,0 +1,210 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_FAILURE_TRACE_HH
+# define ROBOPTIM_SHARED_TESTS_FAILURE_TRACE_HH
+# include <algorithm>
+# include <cstddef>
+# include <iostream>
+# include <sstream>
+# include <stdexcept>
+# include <string>
+# include <vector>
+
+# include <boost/filesystem.hpp>
+
+# include "trace.hh"
+
+// Default number of iterations kept by FailureTraceLogger.
+# ifndef FAILURE_TRACE_SIZE
+#  define FAILURE_TRACE_SIZE 100
+# endif //! FAILURE_TRACE_SIZE
+
+namespace roboptim
+{
+  /// \brief Optimization logger keeping the last iterations in memory, and
+  /// writing them only if the run fails.
+  ///
+  /// The iteration callback copies the solver state into a bounded ring
+  /// buffer, overwriting the oldest iteration. The data streamed into the
+  /// logger (result, solver) is kept as well. Nothing is written unless
+  /// markFailure () is called: the last iterations and the text records
+  /// are then written to `<path>/trace.bin' (see trace.hh) when the
+  /// logger is destroyed.
+  ///
+  /// \tparam S solver type.
+  template <typename S>
+  class FailureTraceLogger
+  {
+  public:
+    typedef S solver_t;
+    typedef typename solver_t::problem_t problem_t;
+    typedef typename solver_t::solverState_t solverState_t;
+    typedef typename solver_t::callback_t callback_t;
+
+    /// \brief Create an in-memory trace for a solver.
+    ///
+    /// \param solver solver to trace.
+    /// \param path directory of the trace, written on failure only.
+    /// \param selfRegister whether to register the iteration callback.
+    /// \param size number of iterations kept.
+    FailureTraceLogger (solver_t& solver, const boost::filesystem::path& path,
+                        bool selfRegister = true,
+                        std::size_t size = FAILURE_TRACE_SIZE)
+      : path_ (path),
+        header_ (detail::traceHeader (solver.problem (), path)),
+        iterations_ (std::max<std::size_t> (size, 1), initialRecord ()),
+        iteration_ (0),
+        texts_ (),
+        failed_ (false)
+    {
+      if (!selfRegister)
+        return;
+
+      // Not all solvers support per-iteration callbacks.
+      try
+        {
+          solver.setIterationCallback (callback ());
+        }
+      catch (std::runtime_error&)
+        {
+        }
+    }
+
+    /// \brief Write the trace if the run failed.
+    ~FailureTraceLogger ()
+    {
+      if (!failed_)
+        return;
+
+      try
+        {
+          write ();
+        }
+      catch (const std::exception& e)
+        {
+          std::cerr << "cannot write the failure trace: " << e.what ()
+                    << std::endl;
+        }
+    }
+
+    /// \brief Iteration callback copying the solver state.
+    callback_t callback ()
+    {
+      IterationBuffer buffer = {this};
+      return buffer;
+    }
+
+    /// \brief Keep data (result, solver...) as a TEXT record.
+    template <typename U>
+    FailureTraceLogger& operator<< (const U& data)
+    {
+      std::ostringstream ss;
+      ss << data;
+      texts_.push_back (ss.str ());
+      return *this;
+    }
+
+    /// \brief Write the trace when the logger is destroyed.
+    void markFailure ()
+    {
+      failed_ = true;
+    }
+
+    bool failed () const
+    {
+      return failed_;
+    }
+
+    /// \brief Number of iterations seen.
+    boost::uint64_t iterations () const
+    {
+      return iteration_;
+    }
+
+  private:
+    /// \brief Iteration callback forwarding to perIterationCallback.
+    struct IterationBuffer
+    {
+      FailureTraceLogger* logger;
+
+      void operator () (const problem_t& pb, solverState_t& state)
+      {
+        logger->perIterationCallback (pb, state);
+      }
+    };
+
+    /// \brief Slot with x and the multipliers allocated, so that the
+    /// callback does not allocate.
+    TraceRecord initialRecord () const
+    {
+      TraceRecord record;
+      record.x.resize (static_cast<TraceRecord::index_t> (header_.inputSize));
+      record.multipliers.resize
+        (static_cast<TraceRecord::index_t> (header_.constraintsSize));
+      return record;
+    }
+
+    void perIterationCallback (const problem_t&, solverState_t& state)
+    {
+      std::size_t slot =
+        static_cast<std::size_t> (iteration_ % iterations_.size ());
+      detail::traceRecord (iterations_[slot], iteration_++, state);
+    }
+
+    /// \brief Write the kept iterations, oldest first, then the texts.
+    void write () const
+    {
+      TraceWriter writer (path_ / "trace.bin", header_);
+
+      boost::uint64_t size = iterations_.size ();
+      boost::uint64_t first = iteration_ > size ? iteration_ - size : 0;
+      for (boost::uint64_t i = first; i < iteration_; ++i)
+        writer.write (iterations_[static_cast<std::size_t> (i % size)]);
+
+      for (std::size_t i = 0; i < texts_.size (); ++i)
+        writer.write (texts_[i]);
+    }
+
+    boost::filesystem::path path_;
+    TraceHeader header_;
+
+    /// \brief Last iterations (ring buffer).
+    std::vector<TraceRecord> iterations_;
+
+    /// \brief Iterations seen by the callback.
+    boost::uint64_t iteration_;
+
+    std::vector<std::string> texts_;
+    bool failed_;
+  };
+
+  /// \brief Report a failed run to an optimization logger. Only
+  /// FailureTraceLogger uses it: other loggers always write their logs.
+  template <typename L>
+  void markFailure (L&)
+  {
+  }
+
+  template <typename S>
+  void markFailure (FailureTraceLogger<S>& logger)
+  {
+    logger.markFailure ();
+  }
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_FAILURE_TRACE_HH
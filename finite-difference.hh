@@ -0,0 +1,396 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_FINITE_DIFFERENCE_HH
+# define ROBOPTIM_SHARED_TESTS_FINITE_DIFFERENCE_HH
+# include <algorithm>
+# include <atomic>
+# include <cmath>
+# include <cstddef>
+# include <stdexcept>
+# include <thread>
+# include <utility>
+# include <vector>
+
+# include <roboptim/core/differentiable-function.hh>
+# include <roboptim/core/finite-difference-gradient.hh>
+
+# include "sparsity.hh"
+
+namespace roboptim
+{
+  /// \brief Group the columns of a Jacobian so that the columns of a
+  /// group have no nonzero in the same row (Curtis-Powell-Reid).
+  ///
+  /// Columns are assigned, in order, to the first group in which they do
+  /// not conflict. The columns of a group can then be perturbed together:
+  /// each row of the difference only depends on one of them.
+  ///
+  /// \param pattern nonzero structure of the Jacobian.
+  /// \param columns number of columns.
+  ///
+  /// \return group of each column.
+  inline std::vector<int> columnGroups (const SparsityPattern& pattern,
+                                        std::size_t columns)
+  {
+    std::size_t rows = pattern.outer.size () - 1;
+
+    // Rows of each column (transposed pattern).
+    std::vector<std::vector<int> > columnRows (columns);
+    for (std::size_t i = 0; i < rows; ++i)
+      for (std::size_t k = 0; k < pattern.rowSize (i); ++k)
+        columnRows[static_cast<std::size_t> (pattern.row (i)[k])]
+          .push_back (static_cast<int> (i));
+
+    std::vector<int> group (columns, -1);
+    // forbidden[g] == j if group g conflicts with column j.
+    std::vector<std::size_t> forbidden;
+    for (std::size_t j = 0; j < columns; ++j)
+      {
+        for (std::size_t r = 0; r < columnRows[j].size (); ++r)
+          {
+            std::size_t i = static_cast<std::size_t> (columnRows[j][r]);
+            for (std::size_t k = 0; k < pattern.rowSize (i); ++k)
+              {
+                int g = group[static_cast<std::size_t> (pattern.row (i)[k])];
+                if (g >= 0)
+                  forbidden[static_cast<std::size_t> (g)] = j;
+              }
+          }
+
+        std::size_t g = 0;
+        while (g < forbidden.size () && forbidden[g] == j)
+          ++g;
+        if (g == forbidden.size ())
+          forbidden.push_back (columns);
+        group[j] = static_cast<int> (g);
+      }
+    return group;
+  }
+
+  /// \brief Detect the nonzero structure of the Jacobian of a function.
+  ///
+  /// Each variable is perturbed in turn, at x and at points close to x,
+  /// and the outputs that change are recorded. Using several points
+  /// avoids missing entries that happen to vanish at x. This costs
+  /// points × (n + 1) evaluations, once.
+  ///
+  /// \param f function.
+  /// \param x point around which the structure is detected.
+  /// \param points number of points.
+  template <typename T>
+  SparsityPattern
+  detectSparsity (const GenericFunction<T>& f,
+                  typename GenericFunction<T>::const_argument_ref x,
+                  int points = 3)
+  {
+    typedef typename GenericFunction<T>::size_type size_type;
+    typedef typename GenericFunction<T>::argument_t argument_t;
+    typedef typename GenericFunction<T>::result_t result_t;
+
+    const size_type n = f.inputSize ();
+    const size_type m = f.outputSize ();
+
+    std::vector<std::vector<char> > nonZero
+      (static_cast<std::size_t> (m),
+       std::vector<char> (static_cast<std::size_t> (n), 0));
+
+    argument_t point (n);
+    argument_t xp (n);
+    result_t f0 (m);
+    result_t fp (m);
+    for (int p = 0; p < points; ++p)
+      {
+        point = x;
+        if (p > 0)
+          point += 1e-3 * (argument_t::Ones (n) + x.cwiseAbs ())
+            .cwiseProduct (argument_t::Random (n));
+        f (f0, point);
+
+        for (size_type j = 0; j < n; ++j)
+          {
+            xp = point;
+            xp[j] += 1e-4 * (1. + std::fabs (point[j]));
+            f (fp, xp);
+            for (size_type i = 0; i < m; ++i)
+              if (fp[i] != f0[i])
+                nonZero[static_cast<std::size_t> (i)]
+                  [static_cast<std::size_t> (j)] = 1;
+          }
+      }
+
+    SparsityPattern pattern;
+    std::vector<int> cols;
+    for (std::size_t i = 0; i < nonZero.size (); ++i)
+      {
+        cols.clear ();
+        for (std::size_t j = 0; j < nonZero[i].size (); ++j)
+          if (nonZero[i][j])
+            cols.push_back (static_cast<int> (j));
+        pattern.addRow (cols.data (), cols.size ());
+      }
+    return pattern;
+  }
+
+  namespace detail
+  {
+    /// \brief Write the values of a Jacobian, given in the order of its
+    /// pattern.
+    template <typename T>
+    struct FiniteDifferenceWriter
+    {
+      template <typename J>
+      static void jacobian (J& jac, const SparsityPattern& pattern,
+                            const std::vector<double>& values)
+      {
+        jac.setZero ();
+        for (std::size_t i = 0; i + 1 < pattern.outer.size (); ++i)
+          for (int k = pattern.outer[i]; k < pattern.outer[i + 1]; ++k)
+            jac (static_cast<std::ptrdiff_t> (i),
+                 pattern.inner[static_cast<std::size_t> (k)])
+              = values[static_cast<std::size_t> (k)];
+      }
+
+      template <typename G>
+      static void gradient (G& grad, const SparsityPattern& pattern,
+                            std::size_t row, const std::vector<double>& values)
+      {
+        grad.setZero ();
+        for (int k = pattern.outer[row]; k < pattern.outer[row + 1]; ++k)
+          grad[pattern.inner[static_cast<std::size_t> (k)]]
+            = values[static_cast<std::size_t> (k)];
+      }
+    };
+
+    /// \brief Sparse Jacobians and gradients keep the declared structure.
+    template <>
+    struct FiniteDifferenceWriter<EigenMatrixSparse>
+    {
+      template <typename J>
+      static void jacobian (J& jac, const SparsityPattern& pattern,
+                            const std::vector<double>& values)
+      {
+        StructuredJacobian<J> w (jac, pattern);
+        for (std::size_t i = 0; i + 1 < pattern.outer.size (); ++i)
+          for (int k = pattern.outer[i]; k < pattern.outer[i + 1]; ++k)
+            w (static_cast<std::ptrdiff_t> (i),
+               pattern.inner[static_cast<std::size_t> (k)])
+              = values[static_cast<std::size_t> (k)];
+      }
+
+      template <typename G>
+      static void gradient (G& grad, const SparsityPattern& pattern,
+                            std::size_t row, const std::vector<double>& values)
+      {
+        StructuredGradient<G> g (grad, pattern.row (row),
+                                 pattern.rowSize (row));
+        for (int k = pattern.outer[row]; k < pattern.outer[row + 1]; ++k)
+          g (pattern.inner[static_cast<std::size_t> (k)])
+            = values[static_cast<std::size_t> (k)];
+      }
+    };
+  } // end of namespace detail
+
+  /// \brief Sparse finite-difference Jacobian of a function.
+  ///
+  /// The columns of the Jacobian are grouped so that no two columns of a
+  /// group share a nonzero row (see columnGroups), and all the variables
+  /// of a group are perturbed at once: a Jacobian costs one evaluation
+  /// per group plus one, instead of one per variable plus one. A
+  /// gradient only perturbs the groups of the nonzeros of its row.
+  ///
+  /// Forward differences with the same step as
+  /// GenericFiniteDifferenceGradient are used, so that both give the
+  /// same derivatives with a dense pattern.
+  ///
+  /// The groups can be evaluated on several threads. The function is
+  /// then evaluated concurrently, which is only valid if its
+  /// impl_compute is thread-safe (e.g. not for Instrumented functions).
+  ///
+  /// \tparam T matrix type.
+  template <typename T>
+  class GenericColoredFiniteDifferenceJacobian
+    : public GenericDifferentiableFunction<T>
+  {
+  public:
+    ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+    (GenericDifferentiableFunction<T>);
+
+    typedef typename GenericDifferentiableFunction<T>::result_t result_t;
+
+    /// \param f differentiated function.
+    /// \param pattern nonzero structure of its Jacobian (declared, or
+    /// see detectSparsity).
+    /// \param epsilon finite-difference step.
+    /// \param threads number of threads evaluating the groups.
+    GenericColoredFiniteDifferenceJacobian
+    (const GenericFunction<T>& f, const SparsityPattern& pattern,
+     value_type epsilon = finiteDifferenceEpsilon, unsigned threads = 1)
+      : GenericDifferentiableFunction<T>
+        (f.inputSize (), f.outputSize (), f.getName ()),
+        adaptee_ (f),
+        pattern_ (pattern),
+        epsilon_ (epsilon),
+        threads_ (std::max (1u, threads)),
+        groups_ (),
+        entries_ (static_cast<std::size_t> (f.inputSize ())),
+        columnGroup_ (),
+        values_ (pattern.nonZeros ()),
+        result_ (f.outputSize ()),
+        arguments_ (threads_, argument_t (f.inputSize ())),
+        results_ (threads_, result_t (f.outputSize ())),
+        selected_ (),
+        evaluations_ (0)
+    {
+      if (pattern_.outer.size ()
+          != static_cast<std::size_t> (f.outputSize ()) + 1)
+        throw std::runtime_error ("invalid sparsity pattern for "
+                                  + f.getName ());
+
+      columnGroup_ = columnGroups
+        (pattern_, static_cast<std::size_t> (f.inputSize ()));
+      for (std::size_t j = 0; j < columnGroup_.size (); ++j)
+        {
+          std::size_t g = static_cast<std::size_t> (columnGroup_[j]);
+          if (g >= groups_.size ())
+            groups_.resize (g + 1);
+          groups_[g].push_back (static_cast<int> (j));
+        }
+
+      for (std::size_t i = 0; i + 1 < pattern_.outer.size (); ++i)
+        for (int k = pattern_.outer[i]; k < pattern_.outer[i + 1]; ++k)
+          entries_[static_cast<std::size_t>
+                   (pattern_.inner[static_cast<std::size_t> (k)])]
+            .push_back (std::make_pair (static_cast<int> (i), k));
+    }
+
+    /// \brief Number of column groups, i.e. evaluations per Jacobian
+    /// (plus one at the point itself).
+    std::size_t groups () const
+    {
+      return groups_.size ();
+    }
+
+    /// \brief Number of evaluations of the function made so far.
+    unsigned long evaluations () const
+    {
+      return evaluations_;
+    }
+
+  protected:
+    void impl_compute (result_ref result, const_argument_ref x) const
+    {
+      adaptee_ (result, x);
+    }
+
+    void impl_gradient (gradient_ref grad, const_argument_ref x,
+                        size_type functionId) const
+    {
+      std::size_t row = static_cast<std::size_t> (functionId);
+      selected_.clear ();
+      for (std::size_t k = 0; k < pattern_.rowSize (row); ++k)
+        selected_.push_back
+          (columnGroup_[static_cast<std::size_t> (pattern_.row (row)[k])]);
+
+      differentiate (x);
+      detail::FiniteDifferenceWriter<T>::gradient
+        (grad, pattern_, row, values_);
+    }
+
+    void impl_jacobian (jacobian_ref jac, const_argument_ref x) const
+    {
+      selected_.clear ();
+      for (std::size_t g = 0; g < groups_.size (); ++g)
+        selected_.push_back (static_cast<int> (g));
+
+      differentiate (x);
+      detail::FiniteDifferenceWriter<T>::jacobian (jac, pattern_, values_);
+    }
+
+  private:
+    /// \brief Compute the values of the columns of the selected groups.
+    void differentiate (const_argument_ref x) const
+    {
+      adaptee_ (result_, x);
+      evaluations_ += 1 + selected_.size ();
+
+      std::atomic<std::size_t> next (0);
+      auto worker = [&] (std::size_t t)
+        {
+          for (std::size_t s = next++; s < selected_.size (); s = next++)
+            perturb (x, groups_[static_cast<std::size_t> (selected_[s])],
+                     arguments_[t], results_[t]);
+        };
+
+      std::size_t threads = std::min<std::size_t>
+        (threads_, selected_.size ());
+      std::vector<std::thread> pool;
+      for (std::size_t t = 1; t < threads; ++t)
+        pool.push_back (std::thread (worker, t));
+      worker (0);
+      for (std::size_t t = 0; t < pool.size (); ++t)
+        pool[t].join ();
+    }
+
+    /// \brief Perturb the variables of a group together.
+    void perturb (const_argument_ref x, const std::vector<int>& group,
+                  argument_t& xp, result_t& fp) const
+    {
+      xp = x;
+      for (std::size_t c = 0; c < group.size (); ++c)
+        xp[group[c]] += epsilon_;
+      adaptee_ (fp, xp);
+
+      for (std::size_t c = 0; c < group.size (); ++c)
+        {
+          const std::vector<std::pair<int, int> >& column =
+            entries_[static_cast<std::size_t> (group[c])];
+          for (std::size_t e = 0; e < column.size (); ++e)
+            values_[static_cast<std::size_t> (column[e].second)] =
+              (fp[column[e].first] - result_[column[e].first]) / epsilon_;
+        }
+    }
+
+    /// \brief Differentiated function.
+    const GenericFunction<T>& adaptee_;
+    /// \brief Nonzero structure of the Jacobian.
+    SparsityPattern pattern_;
+    value_type epsilon_;
+    std::size_t threads_;
+
+    /// \brief Columns of each group.
+    std::vector<std::vector<int> > groups_;
+    /// \brief (row, position in the pattern) of the nonzeros of each
+    /// column.
+    std::vector<std::vector<std::pair<int, int> > > entries_;
+    /// \brief Group of each column.
+    std::vector<int> columnGroup_;
+
+    /// \brief Values of the nonzeros, in the order of the pattern.
+    mutable std::vector<double> values_;
+    /// \brief Value of the function at the point.
+    mutable result_t result_;
+    /// \brief Perturbed arguments and values, one per thread.
+    mutable std::vector<argument_t> arguments_;
+    mutable std::vector<result_t> results_;
+    /// \brief Groups perturbed by the current evaluation.
+    mutable std::vector<int> selected_;
+    mutable unsigned long evaluations_;
+  };
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_FINITE_DIFFERENCE_HH
@@ -0,0 +1,179 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_FIXED_SIZE_HH
+# define ROBOPTIM_SHARED_TESTS_FIXED_SIZE_HH
+# include <string>
+
+# include <Eigen/Core>
+
+# include <roboptim/core/twice-differentiable-function.hh>
+
+# include "autodiff.hh"
+
+namespace roboptim
+{
+  /// \brief Fixed-size Eigen types of a function with N variables and M
+  /// outputs. They live on the stack, and Eigen unrolls (and vectorizes)
+  /// the operations on them.
+  template <int N, int M = 1>
+  struct FixedSize
+  {
+    typedef double value_type;
+
+    static const int inputSize = N;
+    static const int outputSize = M;
+
+    typedef Eigen::Matrix<value_type, N, 1> argument_t;
+    typedef Eigen::Matrix<value_type, M, 1> result_t;
+    typedef Eigen::Matrix<value_type, N, 1> gradient_t;
+    // Row vectors have to be row-major, column vectors column-major.
+    typedef Eigen::Matrix<value_type, M, N,
+                          (N == 1) ? Eigen::ColMajor : Eigen::RowMajor>
+    jacobian_t;
+    typedef Eigen::Matrix<value_type, N, N> hessian_t;
+  };
+
+  /// \brief Twice-differentiable function whose dimensions are known at
+  /// compile time.
+  ///
+  /// The derived class provides its value and derivatives as member
+  /// templates, which are instantiated both for the dynamic RobOptim
+  /// interface and for fixed-size Eigen objects (CRTP):
+  ///
+  /// \code
+  /// template <typename T>
+  /// struct F : public GenericFixedSizeFunction<T, F<T>, 2>
+  /// {
+  ///   ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+  ///   (GenericTwiceDifferentiableFunction<T>);
+  ///
+  ///   F () : GenericFixedSizeFunction<T, F<T>, 2> ("x₀² x₁") {}
+  ///
+  ///   template <typename R, typename X>
+  ///   void evaluate (R& result, const X& x) const
+  ///   {
+  ///     result[0] = x[0] * x[0] * x[1];
+  ///   }
+  ///
+  ///   template <typename G, typename X>
+  ///   void evaluateGradient (G& grad, const X& x, size_type) const
+  ///   {
+  ///     grad[0] = 2 * x[0] * x[1];
+  ///     grad[1] = x[0] * x[0];
+  ///   }
+  ///
+  ///   template <typename H, typename X>
+  ///   void evaluateHessian (H& h, const X& x, size_type) const
+  ///   {
+  ///     h (0, 0) = 2 * x[1];
+  ///     h (0, 1) = h (1, 0) = 2 * x[0];
+  ///   }
+  /// };
+  /// \endcode
+  ///
+  /// Gradients and Hessians are zeroed before evaluateGradient and
+  /// evaluateHessian, which only write the nonzero entries.
+  ///
+  /// The *Fixed member functions evaluate the function on fixed-size
+  /// objects, without virtual call nor heap allocation. The RobOptim
+  /// interface (impl_compute, impl_gradient, impl_hessian) maps its
+  /// arguments to fixed-size vectors and evaluates the derivatives in
+  /// fixed-size buffers on the stack, which are then copied (dense) or
+  /// inserted (sparse, nonzero entries only) in the output.
+  ///
+  /// \tparam T matrix type.
+  /// \tparam D derived class.
+  /// \tparam N number of variables.
+  /// \tparam M number of outputs.
+  template <typename T, typename D, int N, int M = 1>
+  class GenericFixedSizeFunction : public GenericTwiceDifferentiableFunction<T>
+  {
+  public:
+    ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+    (GenericTwiceDifferentiableFunction<T>);
+
+    typedef FixedSize<N, M> fixedSize_t;
+
+    explicit GenericFixedSizeFunction (const std::string& name)
+      : GenericTwiceDifferentiableFunction<T> (N, M, name)
+    {}
+
+    /// \brief Evaluate the function on fixed-size objects.
+    void computeFixed (typename fixedSize_t::result_t& result,
+                       const typename fixedSize_t::argument_t& x) const
+    {
+      derived ().evaluate (result, x);
+    }
+
+    /// \brief Evaluate a gradient on fixed-size objects.
+    void gradientFixed (typename fixedSize_t::gradient_t& grad,
+                        const typename fixedSize_t::argument_t& x,
+                        size_type functionId = 0) const
+    {
+      grad.setZero ();
+      derived ().evaluateGradient (grad, x, functionId);
+    }
+
+    /// \brief Evaluate a Hessian on fixed-size objects.
+    void hessianFixed (typename fixedSize_t::hessian_t& h,
+                       const typename fixedSize_t::argument_t& x,
+                       size_type functionId = 0) const
+    {
+      h.setZero ();
+      derived ().evaluateHessian (h, x, functionId);
+    }
+
+  protected:
+    void impl_compute (result_ref result, const_argument_ref x) const
+    {
+      Eigen::Map<typename fixedSize_t::result_t> r (result.data ());
+      derived ().evaluate (r, fixedArgument (x));
+    }
+
+    void impl_gradient (gradient_ref grad, const_argument_ref x,
+                        size_type functionId) const
+    {
+      typename fixedSize_t::gradient_t g;
+      gradientFixed (g, fixedArgument (x), functionId);
+      detail::AutoDiffWriter<T>::gradient (grad, g);
+    }
+
+    void impl_hessian (hessian_ref h, const_argument_ref x,
+                       size_type functionId) const
+    {
+      typename fixedSize_t::hessian_t hessian;
+      hessianFixed (hessian, fixedArgument (x), functionId);
+      detail::AutoDiffWriter<T>::matrix (h, hessian);
+    }
+
+  private:
+    const D& derived () const
+    {
+      return static_cast<const D&> (*this);
+    }
+
+    /// \brief View of a (contiguous) argument as a fixed-size vector.
+    static Eigen::Map<const typename fixedSize_t::argument_t>
+    fixedArgument (const_argument_ref x)
+    {
+      return Eigen::Map<const typename fixedSize_t::argument_t> (x.data ());
+    }
+  };
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_FIXED_SIZE_HH
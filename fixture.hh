@@ -36,26 +36,47 @@
 # include <roboptim/core/solver.hh>
 # include <roboptim/core/solver-factory.hh>
 
+/// \brief Configure log4cxx and the plug-in search path.
+inline void setUpTestEnvironment ()
+{
+  std::string log4cxxConfigurationFile = TESTS_DATA_DIR;
+  log4cxxConfigurationFile += "/log4cxx.xml";
+  log4cxx::xml::DOMConfigurator::configure (log4cxxConfigurationFile);
+
+  lt_dlinit();
+  BOOST_REQUIRE_EQUAL (lt_dlsetsearchpath (PLUGIN_PATH), 0);
+}
+
+/// \brief Release the resources acquired by setUpTestEnvironment.
+inline void tearDownTestEnvironment ()
+{
+  if (lt_dlexit ())
+    std::cerr << "lt_dlexit failed" << std::endl;
+}
+
+/// \brief Per-test configuration.
+///
+/// When all the tests are linked in a single executable
+/// (ROBOPTIM_SHARED_TESTS_AGGREGATE), the environment is set up once
+/// by a global fixture instead (see aggregate.cc).
 struct TestSuiteConfiguration
 {
   TestSuiteConfiguration ()
   {
-    std::string log4cxxConfigurationFile = TESTS_DATA_DIR;
-    log4cxxConfigurationFile += "/log4cxx.xml";
-    log4cxx::xml::DOMConfigurator::configure (log4cxxConfigurationFile);
-
-    lt_dlinit();
-    BOOST_REQUIRE_EQUAL (lt_dlsetsearchpath (PLUGIN_PATH), 0);
+# ifndef ROBOPTIM_SHARED_TESTS_AGGREGATE
+    setUpTestEnvironment ();
+# endif //! ROBOPTIM_SHARED_TESTS_AGGREGATE
   }
 
   ~TestSuiteConfiguration ()
   {
-    if (lt_dlexit ())
-      std::cerr << "lt_dlexit failed" << std::endl;
+# ifndef ROBOPTIM_SHARED_TESTS_AGGREGATE
+    tearDownTestEnvironment ();
+# endif //! ROBOPTIM_SHARED_TESTS_AGGREGATE
   }
 };
 
-boost::shared_ptr<boost::test_tools::output_test_stream>
+inline boost::shared_ptr<boost::test_tools::output_test_stream>
 retrievePattern (const std::string& testName)
 {
   std::string patternFilename = TESTS_DATA_DIR;
@@ -0,0 +1,425 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_FUSED_HH
+# define ROBOPTIM_SHARED_TESTS_FUSED_HH
+# include <algorithm>
+# include <chrono>
+# include <cstddef>
+# include <iomanip>
+# include <iostream>
+# include <sstream>
+# include <string>
+# include <vector>
+
+# include <boost/type_traits/is_base_of.hpp>
+
+# include <roboptim/core/twice-differentiable-function.hh>
+
+# include "instrumented-function.hh"
+# include "registry.hh"
+# include "sparsity.hh"
+
+namespace roboptim
+{
+  /// \brief Evaluation of the value and of a gradient in a single pass.
+  ///
+  /// Functions whose value and derivatives share subexpressions derive
+  /// from this interface in addition to their function type, and compute
+  /// them once:
+  ///
+  /// \code
+  /// template <typename T>
+  /// struct F : public GenericDifferentiableFunction<T>,
+  ///            public GenericFusedEvaluation<T>
+  /// {
+  ///   ...
+  ///   void impl_valueAndGradient (result_ref result, gradient_ref grad,
+  ///                               const_argument_ref x, size_type) const
+  ///   {
+  ///     value_type e = std::exp (x[0] * x[1]);
+  ///     result[0] = e;
+  ///     grad[0] = x[1] * e;
+  ///     grad[1] = x[0] * e;
+  ///   }
+  /// };
+  /// \endcode
+  ///
+  /// The separate impl_compute and impl_gradient are still required:
+  /// solvers that do not know about this interface keep using them.
+  /// Callers holding a plain function use the valueAndGradient free
+  /// function, which falls back to separate evaluations.
+  ///
+  /// \tparam T matrix type.
+  template <typename T>
+  class GenericFusedEvaluation
+  {
+  public:
+    typedef GenericDifferentiableFunction<T> differentiableFunction_t;
+    typedef typename differentiableFunction_t::size_type size_type;
+    typedef typename differentiableFunction_t::result_ref result_ref;
+    typedef typename differentiableFunction_t::const_argument_ref
+    const_argument_ref;
+    typedef typename differentiableFunction_t::gradient_ref gradient_ref;
+
+    virtual ~GenericFusedEvaluation ()
+    {}
+
+    /// \brief Evaluate the (whole) result and the gradient of the
+    /// functionId-th output at x.
+    void valueAndGradient (result_ref result, gradient_ref grad,
+                           const_argument_ref x,
+                           size_type functionId = 0) const
+    {
+      impl_valueAndGradient (result, grad, x, functionId);
+    }
+
+  protected:
+    virtual void impl_valueAndGradient (result_ref result, gradient_ref grad,
+                                        const_argument_ref x,
+                                        size_type functionId) const = 0;
+  };
+
+  /// \brief Evaluation of the value, a gradient and a Hessian in a single
+  /// pass (see GenericFusedEvaluation).
+  ///
+  /// \tparam T matrix type.
+  template <typename T>
+  class GenericTwiceFusedEvaluation : public GenericFusedEvaluation<T>
+  {
+  public:
+    typedef GenericTwiceDifferentiableFunction<T> twiceDifferentiableFunction_t;
+    typedef typename GenericFusedEvaluation<T>::size_type size_type;
+    typedef typename GenericFusedEvaluation<T>::result_ref result_ref;
+    typedef typename GenericFusedEvaluation<T>::const_argument_ref
+    const_argument_ref;
+    typedef typename GenericFusedEvaluation<T>::gradient_ref gradient_ref;
+    typedef typename twiceDifferentiableFunction_t::hessian_ref hessian_ref;
+
+    /// \brief Evaluate the (whole) result, and the gradient and Hessian
+    /// of the functionId-th output at x.
+    void valueGradientAndHessian (result_ref result, gradient_ref grad,
+                                  hessian_ref h, const_argument_ref x,
+                                  size_type functionId = 0) const
+    {
+      impl_valueGradientAndHessian (result, grad, h, x, functionId);
+    }
+
+  protected:
+    virtual void impl_valueGradientAndHessian
+    (result_ref result, gradient_ref grad, hessian_ref h,
+     const_argument_ref x, size_type functionId) const = 0;
+  };
+
+  namespace detail
+  {
+    /// \brief Check whether F provides a fused value and gradient.
+    template <typename F>
+    struct isFused
+      : boost::is_base_of<GenericFusedEvaluation<typename F::traits_t>, F>
+    {};
+  } // end of namespace detail
+
+  /// \brief Evaluate the result and the functionId-th gradient of f at x,
+  /// in a single pass if f provides one.
+  ///
+  /// The interface of f is looked up (dynamic_cast) at each call, which
+  /// costs as much as evaluating a small function: frequent callers
+  /// should look it up once.
+  template <typename T>
+  void valueAndGradient
+  (const GenericDifferentiableFunction<T>& f,
+   typename GenericDifferentiableFunction<T>::result_ref result,
+   typename GenericDifferentiableFunction<T>::gradient_ref grad,
+   typename GenericDifferentiableFunction<T>::const_argument_ref x,
+   typename GenericDifferentiableFunction<T>::size_type functionId = 0)
+  {
+    const GenericFusedEvaluation<T>* fused =
+      dynamic_cast<const GenericFusedEvaluation<T>*> (&f);
+    if (fused)
+      {
+        fused->valueAndGradient (result, grad, x, functionId);
+        return;
+      }
+    f (result, x);
+    f.gradient (grad, x, functionId);
+  }
+
+  /// \brief Evaluate the result, and the functionId-th gradient and
+  /// Hessian of f at x, in as few passes as f allows.
+  template <typename T>
+  void valueGradientAndHessian
+  (const GenericTwiceDifferentiableFunction<T>& f,
+   typename GenericTwiceDifferentiableFunction<T>::result_ref result,
+   typename GenericTwiceDifferentiableFunction<T>::gradient_ref grad,
+   typename GenericTwiceDifferentiableFunction<T>::hessian_ref h,
+   typename GenericTwiceDifferentiableFunction<T>::const_argument_ref x,
+   typename GenericTwiceDifferentiableFunction<T>::size_type functionId = 0)
+  {
+    const GenericTwiceFusedEvaluation<T>* fused =
+      dynamic_cast<const GenericTwiceFusedEvaluation<T>*> (&f);
+    if (fused)
+      {
+        fused->valueGradientAndHessian (result, grad, h, x, functionId);
+        return;
+      }
+    valueAndGradient<T> (f, result, grad, x, functionId);
+    f.hessian (h, x, functionId);
+  }
+
+  /// \brief Separate and fused evaluation times of the functions of a
+  /// problem, for one solver iteration.
+  struct FusedComparison
+  {
+    FusedComparison ()
+      : problem (),
+        fusedFunctions (0),
+        functions (0),
+        separateTime (0.),
+        fusedTime (0.),
+        separateHessianTime (0.),
+        fusedHessianTime (0.),
+        error (0.)
+    {}
+
+    /// \brief Name of the problem.
+    std::string problem;
+
+    /// \brief Number of functions providing a fused evaluation.
+    std::size_t fusedFunctions;
+
+    /// \brief Number of functions (cost and constraints).
+    std::size_t functions;
+
+    /// \brief Time needed to evaluate the values and all the gradients
+    /// of all the functions separately (in seconds).
+    double separateTime;
+
+    /// \brief Same, through valueAndGradient (in seconds).
+    double fusedTime;
+
+    /// \brief Time needed to also evaluate all the Hessians separately
+    /// (in seconds, 0 if some function is not twice differentiable).
+    double separateHessianTime;
+
+    /// \brief Same, through valueGradientAndHessian (in seconds).
+    double fusedHessianTime;
+
+    /// \brief Largest difference between the separate and fused results,
+    /// relative to 1 + |separate value|.
+    double error;
+  };
+
+  namespace detail
+  {
+    /// \brief Time per call of a kernel (in seconds), repeated until the
+    /// measure is long enough to be meaningful.
+    template <typename K>
+    double fusedTimePerCall (K kernel)
+    {
+      for (long reps = 1; ; reps *= 2)
+        {
+          std::chrono::steady_clock::time_point start
+            = std::chrono::steady_clock::now ();
+          for (long r = 0; r < reps; ++r)
+            kernel ();
+          double t = std::chrono::duration<double>
+            (std::chrono::steady_clock::now () - start).count ();
+          if (t > 1e-2 || reps >= (1L << 24))
+            return t / static_cast<double> (reps);
+        }
+    }
+  } // end of namespace detail
+
+  /// \brief Compare the separate and fused evaluations of the functions
+  /// of a registered problem, at its starting point.
+  ///
+  /// One iteration is modeled as the evaluation of the value and of all
+  /// the gradients (and Hessians) of every function at the same point.
+  /// The fused evaluation replaces the value and the first gradient.
+  /// Evaluations are not timed by the instrumented functions during the
+  /// comparison (see timeEvaluations).
+  ///
+  /// \param name registered problem (see findProblem).
+  template <typename T>
+  FusedComparison compareFused (const std::string& name)
+  {
+    typedef typename Solver<T>::problem_t problem_t;
+    typedef typename problem_t::function_t function_t;
+    typedef GenericTwiceDifferentiableFunction<T> twiceDifferentiable_t;
+    typedef typename function_t::size_type size_type;
+    typedef typename function_t::result_t result_t;
+    typedef typename function_t::gradient_t gradient_t;
+    typedef typename twiceDifferentiable_t::hessian_t hessian_t;
+
+    boost::shared_ptr<problem_t> problem = findProblem (name).build<T> ();
+    const typename problem_t::argument_t& x = *problem->startingPoint ();
+
+    bool timed = timeEvaluations ();
+    timeEvaluations () = false;
+
+    FusedComparison comparison;
+    comparison.problem = name;
+    comparison.functions = problem->constraints ().size () + 1;
+    bool twiceDifferentiable = true;
+    for (std::size_t c = 0; c < comparison.functions; ++c)
+      {
+        const function_t& f = (c == 0)
+          ? problem->function () : *problem->constraints ()[c - 1];
+        const twiceDifferentiable_t* ft =
+          dynamic_cast<const twiceDifferentiable_t*> (&f);
+        // Resolved once, like a solver would when the problem is set.
+        const GenericFusedEvaluation<T>* fused =
+          dynamic_cast<const GenericFusedEvaluation<T>*> (&f);
+        const GenericTwiceFusedEvaluation<T>* twiceFused =
+          dynamic_cast<const GenericTwiceFusedEvaluation<T>*> (&f);
+        if (fused)
+          ++comparison.fusedFunctions;
+
+        size_type n = f.inputSize ();
+        result_t result (f.outputSize ()), fusedResult (f.outputSize ());
+        gradient_t grad (n), fusedGrad (n);
+        hessian_t h (n, n), fusedH (n, n);
+
+        for (size_type i = 0; i < f.outputSize (); ++i)
+          {
+            f (result, x);
+            f.gradient (grad, x, i);
+            valueAndGradient<T> (f, fusedResult, fusedGrad, x, i);
+            comparison.error =
+              std::max (comparison.error,
+                        std::max (detail::derivativeError (fusedResult, result),
+                                  detail::derivativeError (fusedGrad, grad)));
+            if (!ft)
+              continue;
+            ft->hessian (h, x, i);
+            valueGradientAndHessian<T> (*ft, fusedResult, fusedGrad, fusedH,
+                                        x, i);
+            comparison.error =
+              std::max (comparison.error, detail::derivativeError (fusedH, h));
+          }
+
+        comparison.separateTime += detail::fusedTimePerCall ([&] ()
+          {
+            f (result, x);
+            for (size_type i = 0; i < f.outputSize (); ++i)
+              f.gradient (grad, x, i);
+          });
+        // The result is complete after the first fused evaluation.
+        comparison.fusedTime += detail::fusedTimePerCall ([&] ()
+          {
+            if (fused)
+              fused->valueAndGradient (fusedResult, fusedGrad, x, 0);
+            else
+              {
+                f (fusedResult, x);
+                f.gradient (fusedGrad, x, 0);
+              }
+            for (size_type i = 1; i < f.outputSize (); ++i)
+              f.gradient (fusedGrad, x, i);
+          });
+
+        if (!ft)
+          {
+            twiceDifferentiable = false;
+            continue;
+          }
+        comparison.separateHessianTime += detail::fusedTimePerCall ([&] ()
+          {
+            (*ft) (result, x);
+            for (size_type i = 0; i < f.outputSize (); ++i)
+              {
+                ft->gradient (grad, x, i);
+                ft->hessian (h, x, i);
+              }
+          });
+        comparison.fusedHessianTime += detail::fusedTimePerCall ([&] ()
+          {
+            if (twiceFused)
+              twiceFused->valueGradientAndHessian (fusedResult, fusedGrad,
+                                                   fusedH, x, 0);
+            else
+              {
+                if (fused)
+                  fused->valueAndGradient (fusedResult, fusedGrad, x, 0);
+                else
+                  {
+                    (*ft) (fusedResult, x);
+                    ft->gradient (fusedGrad, x, 0);
+                  }
+                ft->hessian (fusedH, x, 0);
+              }
+            for (size_type i = 1; i < f.outputSize (); ++i)
+              {
+                ft->gradient (fusedGrad, x, i);
+                ft->hessian (fusedH, x, i);
+              }
+          });
+      }
+    if (!twiceDifferentiable)
+      comparison.separateHessianTime = comparison.fusedHessianTime = 0.;
+
+    timeEvaluations () = timed;
+    return comparison;
+  }
+
+  /// \brief Print the comparisons: time of one iteration with separate
+  /// and fused evaluations, and the relative saving.
+  inline void printFusedComparison
+  (std::ostream& o, const std::vector<FusedComparison>& comparisons)
+  {
+    std::ostringstream ss;
+    ss << "Fused evaluations (ns per iteration):" << std::endl
+       << std::left << std::setw (24) << "problem" << std::right
+       << std::setw (8) << "fused"
+       << std::setw (12) << "separate" << std::setw (12) << "fused"
+       << std::setw (9) << "saving"
+       << std::setw (12) << "+hessian" << std::setw (12) << "fused"
+       << std::setw (9) << "saving"
+       << std::setw (12) << "error" << std::endl;
+
+    for (std::size_t i = 0; i < comparisons.size (); ++i)
+      {
+        const FusedComparison& c = comparisons[i];
+        std::ostringstream count;
+        count << c.fusedFunctions << "/" << c.functions;
+        ss << std::left << std::setw (24) << c.problem << std::right
+           << std::setw (8) << count.str ()
+           << std::fixed << std::setprecision (1)
+           << std::setw (12) << 1e9 * c.separateTime
+           << std::setw (12) << 1e9 * c.fusedTime
+           << std::setw (8) << 100. * (1. - c.fusedTime / c.separateTime)
+           << "%";
+        if (c.separateHessianTime > 0.)
+          ss << std::setw (12) << 1e9 * c.separateHessianTime
+             << std::setw (12) << 1e9 * c.fusedHessianTime
+             << std::setw (8)
+             << 100. * (1. - c.fusedHessianTime / c.separateHessianTime)
+             << "%";
+        else
+          ss << std::setw (12) << "-" << std::setw (12) << "-"
+             << std::setw (9) << "-";
+        ss << std::scientific << std::setprecision (1)
+           << std::setw (12) << c.error << std::endl;
+        ss.unsetf (std::ios_base::floatfield);
+      }
+
+    o << ss.str ();
+  }
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_FUSED_HH
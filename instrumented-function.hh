@@ -0,0 +1,331 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_INSTRUMENTED_FUNCTION_HH
+# define ROBOPTIM_SHARED_TESTS_INSTRUMENTED_FUNCTION_HH
+# include <algorithm>
+# include <chrono>
+# include <cstddef>
+# include <iosfwd>
+# include <string>
+# include <utility>
+# include <vector>
+
+# include <boost/type_traits/is_base_of.hpp>
+
+# include <roboptim/core/twice-differentiable-function.hh>
+
+namespace roboptim
+{
+  /// \brief Evaluation counters and timers of an instrumented function.
+  struct FunctionStatistics
+  {
+    FunctionStatistics ()
+      : name (),
+        computeCount (0),
+        gradientCount (0),
+        jacobianCount (0),
+        hessianCount (0),
+        computeTime (0.),
+        gradientTime (0.),
+        jacobianTime (0.),
+        hessianTime (0.)
+    {}
+
+    /// \brief Name of the function.
+    std::string name;
+
+    /// \brief Number of impl_compute calls.
+    unsigned long computeCount;
+
+    /// \brief Number of impl_gradient calls.
+    ///
+    /// Note that this includes the calls made by the default
+    /// impl_jacobian implementation.
+    unsigned long gradientCount;
+
+    /// \brief Number of impl_jacobian calls.
+    unsigned long jacobianCount;
+
+    /// \brief Number of impl_hessian calls.
+    unsigned long hessianCount;
+
+    /// \brief Time spent in impl_compute (in seconds).
+    ///
+    /// Like for the other timers, the time of nested calls (e.g. calls to
+    /// impl_gradient made by impl_jacobian) is only accounted for in the
+    /// outermost call.
+    double computeTime;
+
+    /// \brief Time spent in impl_gradient (in seconds).
+    double gradientTime;
+
+    /// \brief Time spent in impl_jacobian (in seconds).
+    double jacobianTime;
+
+    /// \brief Time spent in impl_hessian (in seconds).
+    double hessianTime;
+
+    /// \brief Total number of calls.
+    unsigned long totalCount () const
+    {
+      return computeCount + gradientCount + jacobianCount + hessianCount;
+    }
+
+    /// \brief Total time spent in the function (in seconds).
+    double totalTime () const
+    {
+      return computeTime + gradientTime + jacobianTime + hessianTime;
+    }
+  };
+
+  typedef std::vector<const FunctionStatistics*> functionStatistics_t;
+
+  /// \brief Statistics of all the instrumented functions currently alive
+  /// that were created by the current thread.
+  ///
+  /// The registry is per thread so that problems built and solved by
+  /// different threads (see runJobs) are monitored separately.
+  inline functionStatistics_t& instrumentedFunctions ()
+  {
+    static thread_local functionStatistics_t statistics;
+    return statistics;
+  }
+
+  /// \brief Whether the instrumented functions of the current thread time
+  /// their evaluations (true by default).
+  ///
+  /// Reading the clock costs about as much as evaluating a small function:
+  /// latency benchmarks disable the timers, and only keep the counters.
+  inline bool& timeEvaluations ()
+  {
+    static thread_local bool enabled = true;
+    return enabled;
+  }
+
+  typedef void (*statisticsPrinter_t) (std::ostream&);
+
+  /// \brief Printers of the statistics of optional subsystems (e.g. the
+  /// caches of cache.hh), called by printStatistics after each run.
+  ///
+  /// Subsystems register their printer when they are first used, so that
+  /// the tests that do not include them do not depend on them.
+  inline std::vector<statisticsPrinter_t>& statisticsPrinters ()
+  {
+    static std::vector<statisticsPrinter_t> printers;
+    return printers;
+  }
+
+  /// \brief Register a statistics printer, once.
+  inline void registerStatisticsPrinter (statisticsPrinter_t printer)
+  {
+    std::vector<statisticsPrinter_t>& printers = statisticsPrinters ();
+    if (std::find (printers.begin (), printers.end (), printer)
+        == printers.end ())
+      printers.push_back (printer);
+  }
+
+  /// \brief Print the statistics of the registered subsystems.
+  inline void printStatistics (std::ostream& o)
+  {
+    const std::vector<statisticsPrinter_t>& printers = statisticsPrinters ();
+    for (std::size_t i = 0; i < printers.size (); ++i)
+      printers[i] (o);
+  }
+
+  namespace detail
+  {
+    /// \brief Count and time a call of an instrumented function.
+    ///
+    /// Only the outermost call of a function is timed, so that nested
+    /// calls are not accounted for twice.
+    class CallScope
+    {
+    public:
+      CallScope (unsigned long& count, double& time, int& depth)
+        : time_ (time),
+          depth_ (depth),
+          timed_ (false),
+          start_ ()
+      {
+        ++count;
+        if (depth_++ == 0 && timeEvaluations ())
+          {
+            timed_ = true;
+            start_ = std::chrono::steady_clock::now ();
+          }
+      }
+
+      ~CallScope ()
+      {
+        if (--depth_ == 0 && timed_)
+          time_ += std::chrono::duration<double>
+            (std::chrono::steady_clock::now () - start_).count ();
+      }
+
+    private:
+      double& time_;
+      int& depth_;
+      bool timed_;
+      std::chrono::steady_clock::time_point start_;
+    };
+
+    /// \brief Check whether F provides a Hessian.
+    template <typename F>
+    struct isTwiceDifferentiable
+      : boost::is_base_of<GenericTwiceDifferentiableFunction
+                          <typename F::traits_t>, F>
+    {};
+
+    /// \brief Instrumentation shared by all function kinds.
+    template <typename F>
+    class InstrumentedBase : public F
+    {
+    public:
+      typedef typename F::size_type size_type;
+      typedef typename F::result_ref result_ref;
+      typedef typename F::const_argument_ref const_argument_ref;
+      typedef typename F::gradient_ref gradient_ref;
+      typedef typename F::jacobian_ref jacobian_ref;
+
+      template <typename... Args>
+      explicit InstrumentedBase (Args&&... args)
+        : F (std::forward<Args> (args)...),
+          stats_ (),
+          depth_ (0)
+      {
+        stats_.name = this->getName ();
+        instrumentedFunctions ().push_back (&stats_);
+      }
+
+      virtual ~InstrumentedBase ()
+      {
+        functionStatistics_t& s = instrumentedFunctions ();
+        s.erase (std::remove (s.begin (), s.end (), &stats_), s.end ());
+      }
+
+      /// \brief Evaluation counters and timers of this function.
+      const FunctionStatistics& statistics () const
+      {
+        return stats_;
+      }
+
+    protected:
+      void impl_compute (result_ref result, const_argument_ref x) const
+      {
+        CallScope scope (stats_.computeCount, stats_.computeTime, depth_);
+        F::impl_compute (result, x);
+      }
+
+      void impl_gradient (gradient_ref grad, const_argument_ref x,
+                          size_type functionId) const
+      {
+        CallScope scope (stats_.gradientCount, stats_.gradientTime, depth_);
+        F::impl_gradient (grad, x, functionId);
+      }
+
+      void impl_jacobian (jacobian_ref jac, const_argument_ref x) const
+      {
+        CallScope scope (stats_.jacobianCount, stats_.jacobianTime, depth_);
+        F::impl_jacobian (jac, x);
+      }
+
+      /// \brief Fused value and gradient (only used if F derives from
+      /// GenericFusedEvaluation), counted as one call of each.
+      void impl_valueAndGradient (result_ref result, gradient_ref grad,
+                                  const_argument_ref x,
+                                  size_type functionId) const
+      {
+        ++stats_.gradientCount;
+        CallScope scope (stats_.computeCount, stats_.computeTime, depth_);
+        F::impl_valueAndGradient (result, grad, x, functionId);
+      }
+
+      mutable FunctionStatistics stats_;
+
+      /// \brief Depth of the current call (see CallScope).
+      mutable int depth_;
+    };
+  } // end of namespace detail
+
+  /// \brief Function decorator counting and timing the evaluations of F.
+  ///
+  /// Instrumented<F> derives from F, so it can replace F wherever the
+  /// problem is built (and keeps its linear/twice-differentiable
+  /// nature), e.g.:
+  ///
+  /// \code
+  /// boost::shared_ptr<F<functionType_t> >
+  ///   f (new Instrumented<F<functionType_t> > ());
+  /// \endcode
+  ///
+  /// Fused evaluations (see GenericFusedEvaluation) are counted as one
+  /// call of each evaluation they replace, and timed as value or Hessian
+  /// evaluations.
+  ///
+  /// \tparam F function type.
+  template <typename F,
+            bool = detail::isTwiceDifferentiable<F>::value>
+  class Instrumented : public detail::InstrumentedBase<F>
+  {
+  public:
+    template <typename... Args>
+    explicit Instrumented (Args&&... args)
+      : detail::InstrumentedBase<F> (std::forward<Args> (args)...)
+    {}
+  };
+
+  template <typename F>
+  class Instrumented<F, true> : public detail::InstrumentedBase<F>
+  {
+  public:
+    typedef typename F::size_type size_type;
+    typedef typename F::result_ref result_ref;
+    typedef typename F::const_argument_ref const_argument_ref;
+    typedef typename F::gradient_ref gradient_ref;
+    typedef typename F::hessian_ref hessian_ref;
+
+    template <typename... Args>
+    explicit Instrumented (Args&&... args)
+      : detail::InstrumentedBase<F> (std::forward<Args> (args)...)
+    {}
+
+  protected:
+    void impl_hessian (hessian_ref h, const_argument_ref x,
+                       size_type functionId) const
+    {
+      detail::CallScope scope (this->stats_.hessianCount,
+                               this->stats_.hessianTime, this->depth_);
+      F::impl_hessian (h, x, functionId);
+    }
+
+    /// \brief Fused value, gradient and Hessian (only used if F derives
+    /// from GenericTwiceFusedEvaluation), counted as one call of each.
+    void impl_valueGradientAndHessian (result_ref result, gradient_ref grad,
+                                       hessian_ref h, const_argument_ref x,
+                                       size_type functionId) const
+    {
+      ++this->stats_.computeCount;
+      ++this->stats_.gradientCount;
+      detail::CallScope scope (this->stats_.hessianCount,
+                               this->stats_.hessianTime, this->depth_);
+      F::impl_valueGradientAndHessian (result, grad, h, x, functionId);
+    }
+  };
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_INSTRUMENTED_FUNCTION_HH
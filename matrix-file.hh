@@ -0,0 +1,648 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_MATRIX_FILE_HH
+# define ROBOPTIM_SHARED_TESTS_MATRIX_FILE_HH
+# include <cstddef>
+# include <cstring>
+# include <fstream>
+# include <limits>
+# include <stdexcept>
+# include <string>
+# include <vector>
+
+# ifdef __unix__
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+# endif //! __unix__
+
+# include <boost/cstdint.hpp>
+# include <boost/filesystem.hpp>
+# include <boost/noncopyable.hpp>
+
+# include <Eigen/Dense>
+# include <Eigen/Sparse>
+
+namespace roboptim
+{
+  /// \brief Binary matrix file format, for large reference matrices.
+  ///
+  /// A matrix file starts with a 64-byte header:
+  ///
+  /// | field       | type    | content                                 |
+  /// |-------------|---------|-----------------------------------------|
+  /// | magic       | char[8] | "RBOMATRX"                              |
+  /// | version     | uint32  | 1                                       |
+  /// | byte order  | uint32  | 0x01020304 (writer's order)             |
+  /// | scalar      | uint32  | scalar type (see matrixFile::Scalar)    |
+  /// | kind        | uint32  | DENSE or SPARSE (see matrixFile::Kind)  |
+  /// | row major   | uint32  | 1 for row-major storage, else 0         |
+  /// | index size  | uint32  | size of sparse indices in bytes         |
+  /// | rows        | uint64  | number of rows                          |
+  /// | cols        | uint64  | number of columns                       |
+  /// | nonzeros    | uint64  | number of stored values                 |
+  /// | reserved    | uint64  | 0                                       |
+  ///
+  /// followed by the data, as stored in memory by Eigen:
+  ///
+  /// - DENSE: rows * cols values.
+  /// - SPARSE: the compressed storage, i.e. the outer index array (outer
+  ///   size + 1 indices), the inner index array (nonzeros indices) and the
+  ///   values (nonzeros values).
+  ///
+  /// Each array starts at a multiple of 64 bytes, so that the file can be
+  /// mapped in memory and used in place (see MatrixFile), and read back
+  /// with readBinaryMatrix.
+  namespace matrixFile
+  {
+    static const char magic[8] = {'R', 'B', 'O', 'M', 'A', 'T', 'R', 'X'};
+    static const boost::uint32_t version = 1;
+    static const boost::uint32_t byteOrder = 0x01020304;
+    static const std::size_t alignment = 64;
+
+    enum Kind
+    {
+      DENSE = 1,
+      SPARSE = 2
+    };
+
+    /// \brief Scalar type code of T.
+    template <typename T>
+    struct Scalar;
+
+    template <>
+    struct Scalar<float>
+    {
+      static const boost::uint32_t value = 1;
+    };
+
+    template <>
+    struct Scalar<double>
+    {
+      static const boost::uint32_t value = 2;
+    };
+
+    template <>
+    struct Scalar<boost::int32_t>
+    {
+      static const boost::uint32_t value = 3;
+    };
+
+    template <>
+    struct Scalar<boost::int64_t>
+    {
+      static const boost::uint32_t value = 4;
+    };
+
+    /// \brief Size of an array padded to the alignment of the format.
+    inline std::size_t padded (std::size_t size)
+    {
+      return (size + alignment - 1) / alignment * alignment;
+    }
+  } // end of namespace matrixFile
+
+  /// \brief Header of a matrix file.
+  struct MatrixHeader
+  {
+    MatrixHeader ()
+      : scalar (0),
+        kind (0),
+        rowMajor (0),
+        indexSize (0),
+        rows (0),
+        cols (0),
+        nonZeros (0)
+    {}
+
+    /// \brief Scalar type (see matrixFile::Scalar).
+    boost::uint32_t scalar;
+
+    /// \brief Dense or sparse matrix (see matrixFile::Kind).
+    boost::uint32_t kind;
+
+    /// \brief Whether the matrix is stored in row-major order.
+    boost::uint32_t rowMajor;
+
+    /// \brief Size of the indices of sparse matrices, in bytes.
+    boost::uint32_t indexSize;
+
+    boost::uint64_t rows;
+    boost::uint64_t cols;
+
+    /// \brief Number of stored values.
+    boost::uint64_t nonZeros;
+
+    /// \brief Size of the outer dimension.
+    boost::uint64_t outerSize () const
+    {
+      return rowMajor ? rows : cols;
+    }
+  };
+
+  namespace detail
+  {
+    /// \brief Write an array followed by the padding of the format.
+    inline void writeMatrixArray (std::ofstream& out, const void* data,
+                                  std::size_t size)
+    {
+      static const char zeros[matrixFile::alignment] = {};
+      out.write (static_cast<const char*> (data),
+                 static_cast<std::streamsize> (size));
+      out.write (zeros, static_cast<std::streamsize>
+                 (matrixFile::padded (size) - size));
+    }
+
+    /// \brief Create a matrix file and write its header.
+    inline void writeMatrixHeader (std::ofstream& out,
+                                   const boost::filesystem::path& file,
+                                   const MatrixHeader& header)
+    {
+      out.open (file.c_str (), std::ios::out | std::ios::binary
+                | std::ios::trunc);
+      if (!out)
+        throw std::runtime_error ("cannot open matrix file " + file.string ());
+
+      boost::uint64_t reserved = 0;
+      out.write (matrixFile::magic, sizeof (matrixFile::magic));
+      out.write (reinterpret_cast<const char*> (&matrixFile::version),
+                 sizeof (boost::uint32_t));
+      out.write (reinterpret_cast<const char*> (&matrixFile::byteOrder),
+                 sizeof (boost::uint32_t));
+      out.write (reinterpret_cast<const char*> (&header.scalar),
+                 sizeof (boost::uint32_t));
+      out.write (reinterpret_cast<const char*> (&header.kind),
+                 sizeof (boost::uint32_t));
+      out.write (reinterpret_cast<const char*> (&header.rowMajor),
+                 sizeof (boost::uint32_t));
+      out.write (reinterpret_cast<const char*> (&header.indexSize),
+                 sizeof (boost::uint32_t));
+      out.write (reinterpret_cast<const char*> (&header.rows),
+                 sizeof (boost::uint64_t));
+      out.write (reinterpret_cast<const char*> (&header.cols),
+                 sizeof (boost::uint64_t));
+      out.write (reinterpret_cast<const char*> (&header.nonZeros),
+                 sizeof (boost::uint64_t));
+      out.write (reinterpret_cast<const char*> (&reserved),
+                 sizeof (boost::uint64_t));
+    }
+  } // end of namespace detail
+
+  /// \brief Write a dense matrix to a binary matrix file.
+  template <typename S, int R, int C, int O, int MR, int MC>
+  void writeBinaryMatrix (const boost::filesystem::path& file,
+                          const Eigen::Matrix<S, R, C, O, MR, MC>& m)
+  {
+    MatrixHeader header;
+    header.scalar = matrixFile::Scalar<S>::value;
+    header.kind = matrixFile::DENSE;
+    header.rowMajor = (O & Eigen::RowMajor) ? 1 : 0;
+    header.rows = static_cast<boost::uint64_t> (m.rows ());
+    header.cols = static_cast<boost::uint64_t> (m.cols ());
+    header.nonZeros = static_cast<boost::uint64_t> (m.size ());
+
+    std::ofstream out;
+    detail::writeMatrixHeader (out, file, header);
+    detail::writeMatrixArray (out, m.data (),
+                              static_cast<std::size_t> (m.size ())
+                              * sizeof (S));
+    if (!out)
+      throw std::runtime_error ("cannot write matrix file " + file.string ());
+  }
+
+  /// \brief Write a sparse matrix to a binary matrix file, in compressed
+  /// storage.
+  template <typename S, int O, typename I>
+  void writeBinaryMatrix (const boost::filesystem::path& file,
+                          const Eigen::SparseMatrix<S, O, I>& matrix)
+  {
+    typedef Eigen::SparseMatrix<S, O, I> matrix_t;
+
+    // Uncompressed matrices are compressed in a copy.
+    matrix_t compressed;
+    const matrix_t* m = &matrix;
+    if (!matrix.isCompressed ())
+      {
+        compressed = matrix;
+        compressed.makeCompressed ();
+        m = &compressed;
+      }
+
+    MatrixHeader header;
+    header.scalar = matrixFile::Scalar<S>::value;
+    header.kind = matrixFile::SPARSE;
+    header.rowMajor = (O & Eigen::RowMajor) ? 1 : 0;
+    header.indexSize = sizeof (I);
+    header.rows = static_cast<boost::uint64_t> (m->rows ());
+    header.cols = static_cast<boost::uint64_t> (m->cols ());
+    header.nonZeros = static_cast<boost::uint64_t> (m->nonZeros ());
+
+    std::size_t nnz = static_cast<std::size_t> (m->nonZeros ());
+    std::ofstream out;
+    detail::writeMatrixHeader (out, file, header);
+    detail::writeMatrixArray (out, m->outerIndexPtr (),
+                              static_cast<std::size_t> (m->outerSize () + 1)
+                              * sizeof (I));
+    detail::writeMatrixArray (out, m->innerIndexPtr (), nnz * sizeof (I));
+    detail::writeMatrixArray (out, m->valuePtr (), nnz * sizeof (S));
+    if (!out)
+      throw std::runtime_error ("cannot write matrix file " + file.string ());
+  }
+
+  /// \brief Binary matrix file mapped in memory.
+  ///
+  /// The file is mapped read-only, and the matrices returned by dense ()
+  /// and sparse () point to the mapped data: loading a matrix does not
+  /// copy it, pages are loaded by the system when accessed. The matrices
+  /// are valid as long as the MatrixFile exists. On systems without mmap,
+  /// the file is read in memory instead.
+  ///
+  /// The sizes of the header are checked against the size of the file,
+  /// and sparse () checks the index arrays (hence reads them), so that a
+  /// corrupt file throws instead of giving an invalid matrix.
+  class MatrixFile : boost::noncopyable
+  {
+  public:
+    /// \brief Map a matrix file.
+    ///
+    /// \param file binary matrix file (see writeBinaryMatrix).
+    explicit MatrixFile (const boost::filesystem::path& file)
+      : file_ (file),
+        header_ (),
+        data_ (0),
+        size_ (0),
+        buffer_ ()
+    {
+# ifdef __unix__
+      int fd = ::open (file.c_str (), O_RDONLY);
+      if (fd < 0)
+        throw std::runtime_error ("cannot open matrix file " + file.string ());
+
+      struct stat st;
+      if (::fstat (fd, &st) != 0 || st.st_size < 64)
+        {
+          ::close (fd);
+          throw std::runtime_error (file.string () + " is not a matrix file");
+        }
+
+      size_ = static_cast<std::size_t> (st.st_size);
+      void* data = ::mmap (0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      ::close (fd);
+      if (data == MAP_FAILED)
+        throw std::runtime_error ("cannot map matrix file " + file.string ());
+      data_ = static_cast<const char*> (data);
+# else
+      std::ifstream in (file.c_str (), std::ios::in | std::ios::binary);
+      if (!in)
+        throw std::runtime_error ("cannot open matrix file " + file.string ());
+
+      in.seekg (0, std::ios::end);
+      std::streamoff size = in.tellg ();
+      if (size < 64)
+        throw std::runtime_error (file.string () + " is not a matrix file");
+
+      buffer_.resize (static_cast<std::size_t> (size));
+      in.seekg (0, std::ios::beg);
+      in.read (&buffer_[0], static_cast<std::streamsize> (size));
+      if (!in)
+        throw std::runtime_error ("cannot read matrix file " + file.string ());
+      data_ = &buffer_[0];
+      size_ = buffer_.size ();
+# endif //! __unix__
+
+      try
+        {
+          readHeader ();
+        }
+      catch (...)
+        {
+          release ();
+          throw;
+        }
+    }
+
+    ~MatrixFile ()
+    {
+      release ();
+    }
+
+    /// \brief Whether a file is a binary matrix file.
+    static bool isMatrixFile (const boost::filesystem::path& file)
+    {
+      char magic[sizeof (matrixFile::magic)] = {};
+      std::ifstream in (file.c_str (), std::ios::in | std::ios::binary);
+      in.read (magic, sizeof (magic));
+      return in && std::memcmp (magic, matrixFile::magic, sizeof (magic)) == 0;
+    }
+
+    const MatrixHeader& header () const
+    {
+      return header_;
+    }
+
+    const boost::filesystem::path& path () const
+    {
+      return file_;
+    }
+
+    /// \brief Dense matrix stored in the file.
+    ///
+    /// \tparam M Eigen matrix type, with the scalar type and storage order
+    /// of the file.
+    template <typename M>
+    Eigen::Map<const M> dense () const
+    {
+      typedef typename M::Scalar scalar_t;
+      check<scalar_t> (matrixFile::DENSE, M::IsRowMajor);
+
+      if ((M::RowsAtCompileTime != Eigen::Dynamic
+           && static_cast<boost::uint64_t> (M::RowsAtCompileTime)
+           != header_.rows)
+          || (M::ColsAtCompileTime != Eigen::Dynamic
+              && static_cast<boost::uint64_t> (M::ColsAtCompileTime)
+              != header_.cols))
+        throw std::runtime_error (file_.string ()
+                                  + ": matrix size mismatch");
+
+      return Eigen::Map<const M>
+        (reinterpret_cast<const scalar_t*> (data_ + 64),
+         static_cast<typename M::Index> (header_.rows),
+         static_cast<typename M::Index> (header_.cols));
+    }
+
+# if EIGEN_VERSION_AT_LEAST(3, 2, 90)
+    /// \brief Sparse matrix stored in the file.
+    ///
+    /// \tparam M Eigen sparse matrix type, with the scalar type, storage
+    /// order and index type of the file.
+    template <typename M>
+    Eigen::Map<const M> sparse () const
+    {
+      typedef typename M::Scalar scalar_t;
+      typedef typename M::StorageIndex index_t;
+      check<scalar_t> (matrixFile::SPARSE, M::IsRowMajor);
+
+      if (header_.indexSize != sizeof (index_t))
+        throw std::runtime_error (file_.string ()
+                                  + ": sparse index type mismatch");
+
+      const boost::uint64_t maxIndex =
+        static_cast<boost::uint64_t> (std::numeric_limits<index_t>::max ());
+      if (header_.rows > maxIndex || header_.cols > maxIndex
+          || header_.nonZeros > maxIndex)
+        throw std::runtime_error (file_.string ()
+                                  + ": matrix too large for its index type");
+
+      const char* outer = data_ + 64;
+      const char* inner = outer + outerBytes ();
+      const char* values = inner + innerBytes ();
+      checkSparseIndices (reinterpret_cast<const index_t*> (outer),
+                          reinterpret_cast<const index_t*> (inner));
+
+      return Eigen::Map<const M>
+        (static_cast<typename M::Index> (header_.rows),
+         static_cast<typename M::Index> (header_.cols),
+         static_cast<typename M::Index> (header_.nonZeros),
+         reinterpret_cast<const index_t*> (outer),
+         reinterpret_cast<const index_t*> (inner),
+         reinterpret_cast<const scalar_t*> (values));
+    }
+# endif //! EIGEN_VERSION_AT_LEAST(3, 2, 90)
+
+  private:
+    /// \brief Unmap the file.
+    void release ()
+    {
+# ifdef __unix__
+      ::munmap (const_cast<char*> (data_), size_);
+# endif //! __unix__
+    }
+
+    template <typename T>
+    static T field (const char* data)
+    {
+      T value;
+      std::memcpy (&value, data, sizeof (T));
+      return value;
+    }
+
+    void readHeader ()
+    {
+      if (std::memcmp (data_, matrixFile::magic,
+                       sizeof (matrixFile::magic)) != 0)
+        throw std::runtime_error (file_.string () + " is not a matrix file");
+      if (field<boost::uint32_t> (data_ + 12) != matrixFile::byteOrder)
+        throw std::runtime_error (file_.string ()
+                                  + ": unsupported byte order");
+      if (field<boost::uint32_t> (data_ + 8) != matrixFile::version)
+        throw std::runtime_error (file_.string ()
+                                  + ": unsupported matrix file version");
+
+      header_.scalar = field<boost::uint32_t> (data_ + 16);
+      header_.kind = field<boost::uint32_t> (data_ + 20);
+      header_.rowMajor = field<boost::uint32_t> (data_ + 24);
+      header_.indexSize = field<boost::uint32_t> (data_ + 28);
+      header_.rows = field<boost::uint64_t> (data_ + 32);
+      header_.cols = field<boost::uint64_t> (data_ + 40);
+      header_.nonZeros = field<boost::uint64_t> (data_ + 48);
+
+      // Sizes are converted to Eigen indices.
+      const boost::uint64_t maxIndex = static_cast<boost::uint64_t>
+        (std::numeric_limits<std::ptrdiff_t>::max ());
+      if (header_.rows > maxIndex || header_.cols > maxIndex
+          || header_.nonZeros > maxIndex)
+        throw std::runtime_error (file_.string ()
+                                  + ": invalid matrix size");
+
+      // Each array must fit in what remains of the file.
+      std::size_t offset = 64;
+      if (header_.kind == matrixFile::DENSE)
+        {
+          if (header_.cols != 0
+              && header_.rows > std::numeric_limits<boost::uint64_t>::max ()
+              / header_.cols)
+            throw std::runtime_error (file_.string ()
+                                      + ": invalid matrix size");
+          skip (offset, arrayBytes (header_.rows * header_.cols,
+                                    scalarSize ()));
+        }
+      else if (header_.kind == matrixFile::SPARSE)
+        {
+          if (header_.indexSize != 4 && header_.indexSize != 8)
+            throw std::runtime_error (file_.string ()
+                                      + ": invalid sparse index size");
+          skip (offset, outerBytes ());
+          skip (offset, innerBytes ());
+          skip (offset, arrayBytes (header_.nonZeros, scalarSize ()));
+        }
+      else
+        throw std::runtime_error (file_.string ()
+                                  + ": unknown matrix kind");
+    }
+
+    /// \brief Size of an array of count elements, padded.
+    ///
+    /// \throw std::runtime_error if the size does not fit in memory.
+    std::size_t arrayBytes (boost::uint64_t count,
+                            std::size_t elementSize) const
+    {
+      if (count > static_cast<boost::uint64_t>
+          ((std::numeric_limits<std::size_t>::max ()
+            - matrixFile::alignment) / elementSize))
+        throw std::runtime_error (file_.string ()
+                                  + ": invalid matrix size");
+      return matrixFile::padded (static_cast<std::size_t> (count)
+                                 * elementSize);
+    }
+
+    /// \brief Move past an array of the file.
+    ///
+    /// \throw std::runtime_error if the file is too short.
+    void skip (std::size_t& offset, std::size_t bytes) const
+    {
+      if (bytes > size_ - offset)
+        throw std::runtime_error (file_.string ()
+                                  + ": truncated matrix file");
+      offset += bytes;
+    }
+
+    /// \brief Check the compressed storage of a sparse matrix: the outer
+    /// index array starts at 0, is nondecreasing and ends at the number of
+    /// nonzeros, and the inner indices of each outer vector are sorted and
+    /// within the inner size.
+    template <typename I>
+    void checkSparseIndices (const I* outer, const I* inner) const
+    {
+      const boost::uint64_t outerSize = header_.outerSize ();
+      const I innerSize = static_cast<I>
+        (header_.rowMajor ? header_.cols : header_.rows);
+      const I nonZeros = static_cast<I> (header_.nonZeros);
+
+      if (outer[0] != 0 || outer[outerSize] != nonZeros)
+        throw std::runtime_error (file_.string ()
+                                  + ": corrupt sparse outer index");
+
+      for (boost::uint64_t j = 0; j < outerSize; ++j)
+        {
+          if (outer[j + 1] < outer[j] || outer[j + 1] > nonZeros)
+            throw std::runtime_error (file_.string ()
+                                      + ": corrupt sparse outer index");
+          for (I k = outer[j]; k < outer[j + 1]; ++k)
+            if (inner[k] < 0 || inner[k] >= innerSize
+                || (k > outer[j] && inner[k] <= inner[k - 1]))
+              throw std::runtime_error (file_.string ()
+                                        + ": corrupt sparse inner index");
+        }
+    }
+
+    std::size_t scalarSize () const
+    {
+      switch (header_.scalar)
+        {
+        case matrixFile::Scalar<float>::value:
+        case matrixFile::Scalar<boost::int32_t>::value:
+          return 4;
+        case matrixFile::Scalar<double>::value:
+        case matrixFile::Scalar<boost::int64_t>::value:
+          return 8;
+        default:
+          throw std::runtime_error (file_.string ()
+                                    + ": unknown scalar type");
+        }
+    }
+
+    /// \brief Size of the outer index array of sparse matrices, padded.
+    std::size_t outerBytes () const
+    {
+      return arrayBytes (header_.outerSize () + 1, header_.indexSize);
+    }
+
+    /// \brief Size of the inner index array of sparse matrices, padded.
+    std::size_t innerBytes () const
+    {
+      return arrayBytes (header_.nonZeros, header_.indexSize);
+    }
+
+    /// \brief Check the type of the stored matrix.
+    template <typename T>
+    void check (matrixFile::Kind kind, bool rowMajor) const
+    {
+      if (header_.kind != static_cast<boost::uint32_t> (kind))
+        throw std::runtime_error
+          (file_.string () + ": not a "
+           + (kind == matrixFile::DENSE ? "dense" : "sparse") + " matrix");
+      if (header_.scalar != matrixFile::Scalar<T>::value)
+        throw std::runtime_error (file_.string ()
+                                  + ": scalar type mismatch");
+      if ((header_.rowMajor != 0) != rowMajor)
+        throw std::runtime_error (file_.string ()
+                                  + ": storage order mismatch");
+    }
+
+    boost::filesystem::path file_;
+    MatrixHeader header_;
+
+    /// \brief Mapped file (or buffer_).
+    const char* data_;
+    std::size_t size_;
+
+    /// \brief Content of the file, on systems without mmap.
+    std::vector<char> buffer_;
+  };
+
+  /// \brief Copy the dense matrix of a matrix file.
+  template <typename S, int R, int C, int O, int MR, int MC>
+  void readBinaryMatrix (const MatrixFile& file,
+                         Eigen::Matrix<S, R, C, O, MR, MC>& m)
+  {
+    m = file.dense<Eigen::Matrix<S, R, C, O, MR, MC> > ();
+  }
+
+# if EIGEN_VERSION_AT_LEAST(3, 2, 90)
+  /// \brief Copy the sparse matrix of a matrix file.
+  template <typename S, int O, typename I>
+  void readBinaryMatrix (const MatrixFile& file,
+                         Eigen::SparseMatrix<S, O, I>& m)
+  {
+    m = file.sparse<Eigen::SparseMatrix<S, O, I> > ();
+  }
+# else
+  /// \brief Sparse matrices cannot be mapped before Eigen 3.3.
+  template <typename S, int O, typename I>
+  void readBinaryMatrix (const MatrixFile& file,
+                         Eigen::SparseMatrix<S, O, I>&)
+  {
+    throw std::runtime_error
+      (file.path ().string ()
+       + ": sparse matrix files require Eigen 3.3 or later");
+  }
+# endif //! EIGEN_VERSION_AT_LEAST(3, 2, 90)
+
+  /// \brief Read a matrix from a binary matrix file.
+  ///
+  /// \param file binary matrix file (see writeBinaryMatrix).
+  /// \param m matrix receiving a copy of the stored matrix.
+  template <typename M>
+  void readBinaryMatrix (const boost::filesystem::path& file, M& m)
+  {
+    MatrixFile mapped (file);
+    readBinaryMatrix (mapped, m);
+  }
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_MATRIX_FILE_HH
@@ -0,0 +1,466 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_PERF_HH
+# define ROBOPTIM_SHARED_TESTS_PERF_HH
+# include <algorithm>
+# include <chrono>
+# include <ctime>
+# include <fstream>
+# include <iomanip>
+# include <iostream>
+# include <map>
+# include <sstream>
+# include <stdexcept>
+# include <string>
+# include <vector>
+
+# include <boost/filesystem.hpp>
+
+# ifdef __unix__
+#  include <sys/resource.h>
+# endif //! __unix__
+
+# include "instrumented-function.hh"
+
+namespace roboptim
+{
+  /// \brief Performance data of a single solver run.
+  struct PerformanceRecord
+  {
+    PerformanceRecord ()
+      : test (),
+        solver (),
+        functionType (),
+        status (),
+        inputSize (0),
+        constraintsSize (0),
+        wallTime (0.),
+        cpuTime (0.),
+        iterations (-1),
+        peakMemory (-1),
+        functions ()
+    {}
+
+    /// \brief Name of the test case.
+    std::string test;
+
+    /// \brief Name of the solver plugin.
+    std::string solver;
+
+    /// \brief Matrix type used by the functions.
+    std::string functionType;
+
+    /// \brief Outcome of the run (success, failure, no_solution, error).
+    std::string status;
+
+    /// \brief Number of optimization variables.
+    long inputSize;
+
+    /// \brief Total number of constraint outputs.
+    long constraintsSize;
+
+    /// \brief Wall-clock time spent in solver.minimum () (in seconds).
+    double wallTime;
+
+    /// \brief CPU time spent in solver.minimum () (in seconds).
+    ///
+    /// This is the CPU time of the whole process: it includes the other
+    /// threads, e.g. the concurrent jobs of runJobs.
+    double cpuTime;
+
+    /// \brief Number of solver iterations (-1 if unknown).
+    long iterations;
+
+    /// \brief Peak resident memory during the solve (in bytes, -1 if
+    /// unknown).
+    ///
+    /// This is the peak of the whole process: it includes the other
+    /// threads, e.g. the concurrent jobs of runJobs.
+    long peakMemory;
+
+    /// \brief Evaluations of the instrumented functions during the solve.
+    std::vector<FunctionStatistics> functions;
+  };
+
+  namespace detail
+  {
+    inline std::string jsonEscape (const std::string& s)
+    {
+      std::string res;
+      res.reserve (s.size ());
+      for (std::string::const_iterator it = s.begin (); it != s.end (); ++it)
+        {
+          switch (*it)
+            {
+            case '"':  res += "\\\""; break;
+            case '\\': res += "\\\\"; break;
+            case '\n': res += "\\n";  break;
+            case '\t': res += "\\t";  break;
+            default:   res += *it;
+            }
+        }
+      return res;
+    }
+  } // end of namespace detail
+
+  /// \brief Reset the peak resident memory of the process.
+  ///
+  /// This is only supported on Linux (>= 4.0). Elsewhere, the peak
+  /// memory is the peak since the start of the process.
+  inline void resetPeakMemoryUsage ()
+  {
+# ifdef __linux__
+    std::ofstream ofs ("/proc/self/clear_refs");
+    if (ofs)
+      ofs << "5" << std::flush;
+# endif //! __linux__
+  }
+
+  /// \brief Peak resident memory of the process (in bytes, -1 if unknown).
+  inline long peakMemoryUsage ()
+  {
+# ifdef __linux__
+    std::ifstream ifs ("/proc/self/status");
+    std::string line;
+    while (std::getline (ifs, line))
+      {
+        if (line.compare (0, 6, "VmHWM:") == 0)
+          {
+            std::istringstream iss (line.substr (6));
+            long kb = -1;
+            if (iss >> kb)
+              return 1024 * kb;
+          }
+      }
+# endif //! __linux__
+# ifdef __unix__
+    struct rusage usage;
+    if (getrusage (RUSAGE_SELF, &usage) == 0)
+      return 1024 * static_cast<long> (usage.ru_maxrss);
+# endif //! __unix__
+    return -1;
+  }
+
+  /// \brief Write a performance record as a single-line JSON object.
+  inline std::ostream& operator<< (std::ostream& o, const PerformanceRecord& r)
+  {
+    using detail::jsonEscape;
+
+    std::ostringstream ss;
+    ss.precision (9);
+    ss << "{\"test\": \"" << jsonEscape (r.test) << "\""
+       << ", \"solver\": \"" << jsonEscape (r.solver) << "\""
+       << ", \"function_type\": \"" << jsonEscape (r.functionType) << "\""
+       << ", \"status\": \"" << jsonEscape (r.status) << "\""
+       << ", \"n\": " << r.inputSize
+       << ", \"m\": " << r.constraintsSize
+       << ", \"wall_time\": " << r.wallTime
+       << ", \"cpu_time\": " << r.cpuTime
+       << ", \"iterations\": " << r.iterations
+       << ", \"peak_memory\": " << r.peakMemory
+       << ", \"functions\": [";
+    for (std::size_t i = 0; i < r.functions.size (); ++i)
+      {
+        const FunctionStatistics& s = r.functions[i];
+        ss << (i > 0 ? ", " : "")
+           << "{\"name\": \"" << jsonEscape (s.name) << "\""
+           << ", \"compute\": " << s.computeCount
+           << ", \"gradient\": " << s.gradientCount
+           << ", \"jacobian\": " << s.jacobianCount
+           << ", \"hessian\": " << s.hessianCount
+           << ", \"compute_time\": " << s.computeTime
+           << ", \"gradient_time\": " << s.gradientTime
+           << ", \"jacobian_time\": " << s.jacobianTime
+           << ", \"hessian_time\": " << s.hessianTime << "}";
+      }
+    ss << "]}";
+
+    return o << ss.str ();
+  }
+
+  /// \brief Print the evaluations of the instrumented functions of a run.
+  ///
+  /// For each function, print the number of calls and the time spent in
+  /// impl_compute, impl_gradient, impl_jacobian and impl_hessian, and the
+  /// share of the solver time spent in the function. The remaining time is
+  /// spent inside the solver.
+  inline void printFunctionStatistics (std::ostream& o,
+                                       const PerformanceRecord& r)
+  {
+    std::ostringstream ss;
+    ss << "Function evaluations (calls / time in ms):" << std::endl
+       << std::left << std::setw (32) << "  function" << std::right
+       << std::setw (20) << "compute"
+       << std::setw (20) << "gradient"
+       << std::setw (20) << "jacobian"
+       << std::setw (20) << "hessian"
+       << std::setw (10) << "% solve" << std::endl;
+
+    double total = 0.;
+    for (std::size_t i = 0; i < r.functions.size (); ++i)
+      {
+        const FunctionStatistics& s = r.functions[i];
+        if (s.totalCount () == 0)
+          continue;
+
+        std::string name = s.name.substr (0, s.name.find ('\n'));
+        if (name.size () > 28)
+          name = name.substr (0, 25) + "...";
+
+        ss << "  " << std::left << std::setw (30) << name << std::right
+           << std::fixed << std::setprecision (3);
+        const unsigned long counts[] = {s.computeCount, s.gradientCount,
+                                        s.jacobianCount, s.hessianCount};
+        const double times[] = {s.computeTime, s.gradientTime,
+                                s.jacobianTime, s.hessianTime};
+        for (std::size_t k = 0; k < 4; ++k)
+          {
+            std::ostringstream cell;
+            cell << counts[k] << " / " << std::fixed << std::setprecision (3)
+                 << 1e3 * times[k];
+            ss << std::setw (20) << cell.str ();
+          }
+        ss << std::setw (10) << std::setprecision (1)
+           << (r.wallTime > 0. ? 100. * s.totalTime () / r.wallTime : 0.)
+           << std::endl;
+        total += s.totalTime ();
+      }
+
+    ss << std::fixed << std::setprecision (3)
+       << "  time in functions: " << 1e3 * total << " ms, in solver: "
+       << 1e3 * std::max (0., r.wallTime - total) << " ms" << std::endl;
+
+    o << ss.str ();
+  }
+
+  /// \brief Measure the time, memory, iterations and evaluations of a
+  /// solver run.
+  ///
+  /// The monitor registers an iteration callback on the solver (forwarding
+  /// to an optional callback, e.g. the optimization logger's), times
+  /// solver.minimum () and collects the evaluation counters of the
+  /// instrumented functions (see Instrumented).
+  ///
+  /// \tparam S solver type.
+  template <typename S>
+  class PerformanceMonitor
+  {
+  public:
+    typedef S solver_t;
+    typedef typename solver_t::result_t result_t;
+    typedef typename solver_t::callback_t callback_t;
+
+    /// \brief Create a monitor for a given solver.
+    ///
+    /// \param solver solver to monitor.
+    /// \param callback callback to chain after the iteration counter.
+    explicit PerformanceMonitor (solver_t& solver,
+                                 const callback_t& callback = callback_t ())
+      : solver_ (solver),
+        record_ (),
+        start_ ()
+    {
+      record_.inputSize = solver.problem ().function ().inputSize ();
+      for (std::size_t i = 0; i < solver.problem ().boundsVector ().size (); ++i)
+        record_.constraintsSize += static_cast<long>
+          (solver.problem ().boundsVector ()[i].size ());
+
+      // Not all solvers support per-iteration callbacks.
+      try
+        {
+          IterationCounter counter = {&record_.iterations, callback};
+          solver_.setIterationCallback (counter);
+          record_.iterations = 0;
+        }
+      catch (std::runtime_error&)
+        {
+          record_.iterations = -1;
+        }
+    }
+
+    /// \brief Compute the minimum, measuring wall and CPU time.
+    result_t minimum ()
+    {
+      const functionStatistics_t& functions = instrumentedFunctions ();
+      for (std::size_t i = 0; i < functions.size (); ++i)
+        start_[functions[i]] = *functions[i];
+
+      resetPeakMemoryUsage ();
+
+      std::chrono::steady_clock::time_point wallStart
+        = std::chrono::steady_clock::now ();
+      std::clock_t cpuStart = std::clock ();
+
+      result_t res = solver_.minimum ();
+
+      std::clock_t cpuEnd = std::clock ();
+      std::chrono::steady_clock::time_point wallEnd
+        = std::chrono::steady_clock::now ();
+
+      record_.wallTime = std::chrono::duration<double>
+        (wallEnd - wallStart).count ();
+      record_.cpuTime = static_cast<double> (cpuEnd - cpuStart)
+        / CLOCKS_PER_SEC;
+      record_.peakMemory = peakMemoryUsage ();
+
+      return res;
+    }
+
+    /// \brief Finalize the record of the run.
+    ///
+    /// \param test name of the test case.
+    /// \param solver name of the solver plugin.
+    /// \param functionType matrix type of the functions.
+    /// \param status outcome of the run.
+    const PerformanceRecord& finalize (const std::string& test,
+                                       const std::string& solver,
+                                       const std::string& functionType,
+                                       const std::string& status)
+    {
+      record_.test = test;
+      record_.solver = solver;
+      record_.functionType = functionType;
+      record_.status = status;
+
+      record_.functions.clear ();
+      const functionStatistics_t& functions = instrumentedFunctions ();
+      for (std::size_t i = 0; i < functions.size (); ++i)
+        {
+          FunctionStatistics s = *functions[i];
+          typename start_t::const_iterator it = start_.find (functions[i]);
+          if (it != start_.end ())
+            {
+              s.computeCount -= it->second.computeCount;
+              s.gradientCount -= it->second.gradientCount;
+              s.jacobianCount -= it->second.jacobianCount;
+              s.hessianCount -= it->second.hessianCount;
+              s.computeTime -= it->second.computeTime;
+              s.gradientTime -= it->second.gradientTime;
+              s.jacobianTime -= it->second.jacobianTime;
+              s.hessianTime -= it->second.hessianTime;
+            }
+          record_.functions.push_back (s);
+        }
+
+      return record_;
+    }
+
+    /// \brief Performance record of the run.
+    const PerformanceRecord& record () const
+    {
+      return record_;
+    }
+
+  private:
+    /// \brief Iteration callback counting the solver iterations.
+    struct IterationCounter
+    {
+      long* iterations;
+      callback_t next;
+
+      template <typename P, typename State>
+      void operator () (const P& pb, State& state)
+      {
+        ++(*iterations);
+        if (next)
+          next (pb, state);
+      }
+    };
+
+    typedef std::map<const FunctionStatistics*, FunctionStatistics> start_t;
+
+    solver_t& solver_;
+    PerformanceRecord record_;
+    start_t start_;
+  };
+
+  /// \brief Append a performance record to a JSON Lines file.
+  ///
+  /// The file is truncated by the first record written by the process,
+  /// so that each test executable only keeps the records of its last run.
+  ///
+  /// \param file output file.
+  /// \param record record to write.
+  inline void writePerformanceRecord (const boost::filesystem::path& file,
+                                      const PerformanceRecord& record)
+  {
+    static bool first = true;
+
+    if (file.has_parent_path ())
+      boost::filesystem::create_directories (file.parent_path ());
+
+    std::ofstream ofs (file.c_str (), first ? std::ios::trunc : std::ios::app);
+    first = false;
+
+    std::ostringstream ss;
+    ss << record << "\n";
+    ofs << ss.str () << std::flush;
+  }
+
+  /// \brief Performance records of all the tests run by this process.
+  inline std::vector<PerformanceRecord>& performanceRecords ()
+  {
+    static std::vector<PerformanceRecord> records;
+    return records;
+  }
+
+  /// \brief Print one line per record and the total solve time.
+  ///
+  /// \param o output stream.
+  /// \param records performance records.
+  /// \param startupTime time spent setting up the process (in seconds),
+  /// not included in the solve times.
+  inline void printPerformanceSummary
+  (std::ostream& o, const std::vector<PerformanceRecord>& records,
+   double startupTime)
+  {
+    std::ostringstream ss;
+    ss << std::left << std::setw (32) << "test" << std::right
+       << std::setw (12) << "status"
+       << std::setw (12) << "iterations"
+       << std::setw (14) << "wall (ms)"
+       << std::setw (14) << "cpu (ms)" << std::endl;
+
+    double wall = 0.;
+    double cpu = 0.;
+    std::size_t success = 0;
+    for (std::size_t i = 0; i < records.size (); ++i)
+      {
+        const PerformanceRecord& r = records[i];
+        ss << std::left << std::setw (32) << r.test << std::right
+           << std::setw (12) << r.status
+           << std::setw (12) << r.iterations
+           << std::fixed << std::setprecision (3)
+           << std::setw (14) << 1e3 * r.wallTime
+           << std::setw (14) << 1e3 * r.cpuTime << std::endl;
+        wall += r.wallTime;
+        cpu += r.cpuTime;
+        if (r.status == "success")
+          ++success;
+      }
+
+    ss << std::fixed << std::setprecision (3)
+       << success << "/" << records.size () << " successful, solve time: "
+       << 1e3 * wall << " ms (cpu: " << 1e3 * cpu << " ms), startup: "
+       << 1e3 * startupTime << " ms" << std::endl;
+
+    o << ss.str ();
+  }
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_PERF_HH
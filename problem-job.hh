@@ -0,0 +1,66 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_PROBLEM_JOB_HH
+# define ROBOPTIM_SHARED_TESTS_PROBLEM_JOB_HH
+# include <mutex>
+# include <string>
+
+# include <boost/preprocessor/stringize.hpp>
+# include <boost/shared_ptr.hpp>
+
+# include "common.hh"
+# include "runner.hh"
+
+namespace roboptim
+{
+  /// \brief Job solving a registered problem without Boost checks (see
+  /// runJobs). The status of the record is given by resultStatus.
+  ///
+  /// \param descriptor problem to solve.
+  /// \param plugin solver plug-in (default: the tested solver).
+  inline Job problemJob (const ProblemDescriptor& descriptor,
+                         const std::string& plugin = SOLVER_NAME)
+  {
+    Job job;
+    job.name = descriptor.name;
+    job.run = [descriptor, plugin] ()
+      {
+        boost::shared_ptr<solver_t::problem_t> problem =
+          descriptor.build<functionType_t> ();
+
+        // Each job has its own solver instance.
+        ThreadSafeSolverFactory<solver_t> factory (plugin, *problem);
+        solver_t& solver = factory ();
+
+        // Solvers that are not thread-safe run one at a time.
+        perfMonitor_t monitor (solver);
+        std::unique_lock<std::mutex> lock = factory.lock ();
+        solver_t::result_t res = monitor.minimum ();
+        if (lock.owns_lock ())
+          lock.unlock ();
+
+        return monitor.finalize
+          (descriptor.name, plugin, BOOST_PP_STRINGIZE (FUNCTION_TYPE),
+           resultStatus (res, *problem, descriptor.expected,
+                         descriptor.tolerances));
+      };
+    return job;
+  }
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_PROBLEM_JOB_HH
@@ -0,0 +1,432 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_PROFILE_HH
+# define ROBOPTIM_SHARED_TESTS_PROFILE_HH
+# include <algorithm>
+# include <fstream>
+# include <iomanip>
+# include <iostream>
+# include <limits>
+# include <sstream>
+# include <string>
+# include <vector>
+
+# include <boost/filesystem.hpp>
+# include <boost/property_tree/json_parser.hpp>
+# include <boost/property_tree/ptree.hpp>
+
+# include "comparison.hh"
+# include "perf.hh"
+
+namespace roboptim
+{
+  /// \brief Read the performance records of a file written by
+  /// writePerformanceRecord. Malformed lines are skipped.
+  ///
+  /// \param file performance record file (JSON Lines).
+  /// \param records records to complete.
+  inline void readPerformanceRecords (const boost::filesystem::path& file,
+                                      std::vector<PerformanceRecord>& records)
+  {
+    typedef boost::property_tree::ptree ptree_t;
+
+    std::ifstream ifs (file.c_str ());
+    std::string line;
+    while (std::getline (ifs, line))
+      {
+        if (line.empty ())
+          continue;
+
+        ptree_t node;
+        std::istringstream ss (line);
+        try
+          {
+            boost::property_tree::read_json (ss, node);
+          }
+        catch (const boost::property_tree::json_parser_error&)
+          {
+            continue;
+          }
+
+        PerformanceRecord r;
+        r.test = node.get<std::string> ("test", "");
+        r.solver = node.get<std::string> ("solver", "");
+        r.functionType = node.get<std::string> ("function_type", "");
+        r.status = node.get<std::string> ("status", "");
+        r.inputSize = node.get<long> ("n", 0);
+        r.constraintsSize = node.get<long> ("m", 0);
+        r.wallTime = node.get<double> ("wall_time", 0.);
+        r.cpuTime = node.get<double> ("cpu_time", 0.);
+        r.iterations = node.get<long> ("iterations", -1);
+        r.peakMemory = node.get<long> ("peak_memory", -1);
+
+        boost::optional<ptree_t&> functions = node.get_child_optional
+          ("functions");
+        if (functions)
+          for (ptree_t::const_iterator it = functions->begin ();
+               it != functions->end (); ++it)
+            {
+              FunctionStatistics f;
+              f.name = it->second.get<std::string> ("name", "");
+              f.computeCount = it->second.get<unsigned long> ("compute", 0);
+              f.gradientCount = it->second.get<unsigned long> ("gradient", 0);
+              f.jacobianCount = it->second.get<unsigned long> ("jacobian", 0);
+              f.hessianCount = it->second.get<unsigned long> ("hessian", 0);
+              f.computeTime = it->second.get<double> ("compute_time", 0.);
+              f.gradientTime = it->second.get<double> ("gradient_time", 0.);
+              f.jacobianTime = it->second.get<double> ("jacobian_time", 0.);
+              f.hessianTime = it->second.get<double> ("hessian_time", 0.);
+              r.functions.push_back (f);
+            }
+
+        records.push_back (r);
+      }
+  }
+
+  /// \brief Cost measure used to compare the solvers.
+  enum ProfileMeasure
+  {
+    /// \brief Wall-clock solve time.
+    PROFILE_WALL_TIME,
+    /// \brief Evaluations of the instrumented functions (compute,
+    /// gradient, Jacobian and Hessian calls).
+    PROFILE_EVALUATIONS,
+    /// \brief Solver iterations.
+    PROFILE_ITERATIONS
+  };
+
+  /// \brief Name of a measure, as used in file names.
+  inline const char* profileMeasureName (ProfileMeasure measure)
+  {
+    switch (measure)
+      {
+      case PROFILE_WALL_TIME:
+        return "time";
+      case PROFILE_EVALUATIONS:
+        return "evaluations";
+      case PROFILE_ITERATIONS:
+        return "iterations";
+      }
+    return "unknown";
+  }
+
+  /// \brief Cost of a run for a given measure.
+  ///
+  /// Runs that did not succeed (i.e. whose result does not pass the
+  /// checks of the test, see resultStatus) or whose measure
+  /// is unknown have an infinite cost. Costs are bounded below so that
+  /// ratios are defined (timer resolution, one evaluation/iteration).
+  inline double profileCost (const PerformanceRecord& r,
+                             ProfileMeasure measure)
+  {
+    const double inf = std::numeric_limits<double>::infinity ();
+    if (r.status != "success")
+      return inf;
+
+    switch (measure)
+      {
+      case PROFILE_WALL_TIME:
+        return std::max (r.wallTime, 1e-9);
+      case PROFILE_EVALUATIONS:
+        {
+          unsigned long evaluations = 0;
+          for (std::size_t i = 0; i < r.functions.size (); ++i)
+            evaluations += r.functions[i].totalCount ();
+          return std::max (static_cast<double> (evaluations), 1.);
+        }
+      case PROFILE_ITERATIONS:
+        return (r.iterations < 0)
+          ? inf : std::max (static_cast<double> (r.iterations), 1.);
+      }
+    return inf;
+  }
+
+  /// \brief Cumulative distribution of the solvers over a set of
+  /// problems: fraction[s][k] is the fraction of the problems solved by
+  /// solver s within abscissa[k].
+  ///
+  /// The distributions are step functions, and the abscissae are all the
+  /// points where one of them changes.
+  struct SolverProfile
+  {
+    /// \brief Name of the profile (e.g. "performance-time").
+    std::string name;
+
+    /// \brief Label of the abscissa.
+    std::string label;
+
+    /// \brief Compared solvers.
+    std::vector<std::string> solvers;
+
+    /// \brief Number of problems.
+    std::size_t problems;
+
+    /// \brief Sorted abscissae.
+    std::vector<double> abscissa;
+
+    /// \brief Fraction of solved problems, by solver and abscissa.
+    std::vector<std::vector<double> > fraction;
+  };
+
+  namespace detail
+  {
+    /// \brief Profile of the solvers from their scaled costs
+    /// (cost[s][p], infinite if not solved).
+    inline void fillProfile (SolverProfile& profile,
+                             const std::vector<std::vector<double> >& cost)
+    {
+      for (std::size_t s = 0; s < cost.size (); ++s)
+        for (std::size_t p = 0; p < cost[s].size (); ++p)
+          if (cost[s][p] < std::numeric_limits<double>::infinity ())
+            profile.abscissa.push_back (cost[s][p]);
+      std::sort (profile.abscissa.begin (), profile.abscissa.end ());
+      profile.abscissa.erase (std::unique (profile.abscissa.begin (),
+                                           profile.abscissa.end ()),
+                              profile.abscissa.end ());
+
+      profile.fraction.assign (cost.size (), std::vector<double>
+                               (profile.abscissa.size (), 0.));
+      if (profile.problems == 0)
+        return;
+
+      for (std::size_t s = 0; s < cost.size (); ++s)
+        {
+          std::vector<double> sorted (cost[s]);
+          std::sort (sorted.begin (), sorted.end ());
+
+          for (std::size_t k = 0; k < profile.abscissa.size (); ++k)
+            {
+              std::size_t solved = static_cast<std::size_t>
+                (std::upper_bound (sorted.begin (), sorted.end (),
+                                   profile.abscissa[k]) - sorted.begin ());
+              profile.fraction[s][k] = static_cast<double> (solved)
+                / static_cast<double> (profile.problems);
+            }
+        }
+    }
+
+    /// \brief Cost of every solver on every problem of the matrix
+    /// (infinite if the run is missing or failed).
+    inline std::vector<std::vector<double> >
+    matrixCosts (const ComparisonMatrix& matrix, ProfileMeasure measure)
+    {
+      const std::vector<std::string>& problems = matrix.problems ();
+      const std::vector<std::string>& solvers = matrix.solvers ();
+
+      std::vector<std::vector<double> > cost
+        (solvers.size (), std::vector<double>
+         (problems.size (), std::numeric_limits<double>::infinity ()));
+      for (std::size_t s = 0; s < solvers.size (); ++s)
+        for (std::size_t p = 0; p < problems.size (); ++p)
+          {
+            const PerformanceRecord* r = matrix.find (problems[p], solvers[s]);
+            if (r)
+              cost[s][p] = profileCost (*r, measure);
+          }
+      return cost;
+    }
+  } // end of namespace detail
+
+  /// \brief Performance profile (Dolan and Moré, 2002).
+  ///
+  /// For each problem p and solver s, the performance ratio
+  /// r(p, s) = cost(p, s) / min_s' cost(p, s') compares the solver to the
+  /// best one on this problem. The profile of s is the fraction of the
+  /// problems with r(p, s) <= tau: its value at tau = 1 is the share of
+  /// problems on which s is the fastest, and its limit is the share of
+  /// problems it solves.
+  ///
+  /// \param matrix results of the solvers.
+  /// \param measure cost measure.
+  inline SolverProfile performanceProfile (const ComparisonMatrix& matrix,
+                                           ProfileMeasure measure)
+  {
+    SolverProfile profile;
+    profile.name = std::string ("performance-") + profileMeasureName (measure);
+    profile.label = std::string ("performance ratio (")
+      + profileMeasureName (measure) + ")";
+    profile.solvers = matrix.solvers ();
+    profile.problems = matrix.problems ().size ();
+
+    std::vector<std::vector<double> > cost =
+      detail::matrixCosts (matrix, measure);
+    for (std::size_t p = 0; p < profile.problems; ++p)
+      {
+        double best = std::numeric_limits<double>::infinity ();
+        for (std::size_t s = 0; s < cost.size (); ++s)
+          best = std::min (best, cost[s][p]);
+        // Problems that no solver solved keep infinite ratios.
+        if (best < std::numeric_limits<double>::infinity ())
+          for (std::size_t s = 0; s < cost.size (); ++s)
+            cost[s][p] /= best;
+      }
+
+    detail::fillProfile (profile, cost);
+    return profile;
+  }
+
+  /// \brief Data profile (Moré and Wild, 2009).
+  ///
+  /// The profile of a solver is the fraction of the problems it solves
+  /// within a budget of alpha simplex gradients, i.e. with
+  /// cost(p, s) / (n_p + 1) <= alpha where n_p is the number of variables
+  /// of problem p. Unlike performance profiles, data profiles do not
+  /// depend on the other solvers.
+  ///
+  /// \param matrix results of the solvers.
+  /// \param measure cost measure (usually PROFILE_EVALUATIONS).
+  inline SolverProfile dataProfile (const ComparisonMatrix& matrix,
+                                    ProfileMeasure measure)
+  {
+    SolverProfile profile;
+    profile.name = std::string ("data-") + profileMeasureName (measure);
+    profile.label = std::string (profileMeasureName (measure))
+      + " / (n + 1)";
+    profile.solvers = matrix.solvers ();
+    profile.problems = matrix.problems ().size ();
+
+    std::vector<std::vector<double> > cost =
+      detail::matrixCosts (matrix, measure);
+    for (std::size_t s = 0; s < cost.size (); ++s)
+      for (std::size_t p = 0; p < profile.problems; ++p)
+        {
+          const PerformanceRecord* r =
+            matrix.find (matrix.problems ()[p], profile.solvers[s]);
+          if (r)
+            cost[s][p] /= static_cast<double> (std::max (r->inputSize, 0L) + 1);
+        }
+
+    detail::fillProfile (profile, cost);
+    return profile;
+  }
+
+  /// \brief Write a profile as CSV, one line per abscissa:
+  /// `x,solver1,solver2,...'.
+  inline void writeSolverProfile (const boost::filesystem::path& file,
+                                  const SolverProfile& profile)
+  {
+    if (file.has_parent_path ())
+      boost::filesystem::create_directories (file.parent_path ());
+
+    std::ostringstream ss;
+    ss.precision (9);
+    ss << "x";
+    for (std::size_t s = 0; s < profile.solvers.size (); ++s)
+      ss << "," << profile.solvers[s];
+    ss << "\n";
+    for (std::size_t k = 0; k < profile.abscissa.size (); ++k)
+      {
+        ss << profile.abscissa[k];
+        for (std::size_t s = 0; s < profile.solvers.size (); ++s)
+          ss << "," << profile.fraction[s][k];
+        ss << "\n";
+      }
+
+    std::ofstream ofs (file.c_str ());
+    ofs << ss.str ();
+  }
+
+  /// \brief Write a gnuplot script plotting a profile written by
+  /// writeSolverProfile (step functions, logarithmic abscissa).
+  ///
+  /// \param file output script.
+  /// \param data CSV file of the profile, relative to the script.
+  /// \param profile plotted profile.
+  inline void writeSolverProfilePlot (const boost::filesystem::path& file,
+                                      const boost::filesystem::path& data,
+                                      const SolverProfile& profile)
+  {
+    if (file.has_parent_path ())
+      boost::filesystem::create_directories (file.parent_path ());
+
+    std::ostringstream ss;
+    ss << "set datafile separator ','\n"
+       << "set terminal pdfcairo\n"
+       << "set output '"
+       << boost::filesystem::path (data).replace_extension (".pdf").string ()
+       << "'\n"
+       << "set title '" << profile.name << " profile ("
+       << profile.problems << " problems)'\n"
+       << "set xlabel '" << profile.label << "'\n"
+       << "set ylabel 'fraction of problems solved'\n"
+       << "set logscale x 2\n"
+       << "set yrange [0:1.05]\n"
+       << "set key bottom right\n"
+       << "plot";
+    for (std::size_t s = 0; s < profile.solvers.size (); ++s)
+      ss << (s > 0 ? ", \\\n    " : " ") << "'" << data.string ()
+         << "' using 1:" << s + 2 << " with steps title '"
+         << profile.solvers[s] << "'";
+    ss << "\n";
+
+    std::ofstream ofs (file.c_str ());
+    ofs << ss.str ();
+  }
+
+  /// \brief Print, for each solver, the value of a profile at its first
+  /// abscissa (e.g. share of wins of a performance profile) and its
+  /// final value (share of solved problems).
+  inline void printSolverProfile (std::ostream& o,
+                                  const SolverProfile& profile)
+  {
+    std::ostringstream ss;
+    ss << profile.name << " profile (" << profile.problems << " problems):"
+       << std::endl << std::left << std::setw (32) << "  solver"
+       << std::right << std::setw (12) << "first"
+       << std::setw (12) << "final" << std::endl
+       << std::fixed << std::setprecision (3);
+    for (std::size_t s = 0; s < profile.solvers.size (); ++s)
+      {
+        const std::vector<double>& f = profile.fraction[s];
+        ss << "  " << std::left << std::setw (30) << profile.solvers[s]
+           << std::right << std::setw (12) << (f.empty () ? 0. : f.front ())
+           << std::setw (12) << (f.empty () ? 0. : f.back ()) << std::endl;
+      }
+    o << ss.str ();
+  }
+
+  /// \brief Write the performance profiles (time, evaluations) and the
+  /// data profile (evaluations) of a matrix, as CSV files and gnuplot
+  /// scripts named `${prefix}.${profile}.csv' and `${prefix}.${profile}.gp',
+  /// and print their summary.
+  ///
+  /// \param o output stream of the summary.
+  /// \param prefix prefix of the output files.
+  /// \param matrix results of the solvers.
+  inline void writeSolverProfiles (std::ostream& o,
+                                   const boost::filesystem::path& prefix,
+                                   const ComparisonMatrix& matrix)
+  {
+    std::vector<SolverProfile> profiles;
+    profiles.push_back (performanceProfile (matrix, PROFILE_WALL_TIME));
+    profiles.push_back (performanceProfile (matrix, PROFILE_EVALUATIONS));
+    profiles.push_back (dataProfile (matrix, PROFILE_EVALUATIONS));
+
+    for (std::size_t i = 0; i < profiles.size (); ++i)
+      {
+        boost::filesystem::path csv = prefix.string () + "."
+          + profiles[i].name + ".csv";
+        writeSolverProfile (csv, profiles[i]);
+        writeSolverProfilePlot (prefix.string () + "." + profiles[i].name
+                                + ".gp", csv.filename (), profiles[i]);
+        printSolverProfile (o, profiles[i]);
+      }
+  }
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_PROFILE_HH
@@ -80,59 +80,59 @@ namespace roboptim
         // Fill c.
         this->c () << 5.;
       }
-    } // end of namespace unconstrained
-  } // end of namespace qp
-} // end of namespace roboptim
-
-
-BOOST_FIXTURE_TEST_SUITE (qp_unconstrained, TestSuiteConfiguration)
-
-BOOST_AUTO_TEST_CASE (qp_unconstrained)
-{
-  using namespace roboptim;
-  using namespace roboptim::qp::unconstrained;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-6;
-  double x_tol = 1e-5;
-  double f_tol = 1e-4;
-
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 5.;
-  expectedResult.x = (ExpectedResult::argument_t (3) << 3., 5., 7.).finished ();
-  expectedResult.fx = -244.;
 
-  // Build cost function.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+        typedef typename Solver<T>::problem_t problem_t;
 
-  // Build problem.
-  solver_t::problem_t problem (f);
+        // Build cost function.
+        boost::shared_ptr<F<T> > f (new Instrumented<F<T> > ());
 
-  // Load starting point
-  F<functionType_t>::argument_t x (3);
-  x << 0., 0., 0.;
-  problem.startingPoint () = x;
+        // Build problem.
+        boost::shared_ptr<problem_t> pb = boost::make_shared<problem_t> (f);
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+        // Load starting point
+        typename F<T>::argument_t x (3);
+        x << 0., 0., 0.;
+        pb->startingPoint () = x;
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
+        return pb;
+      }
 
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "qp/unconstrained");
+      ProblemDescriptor descriptor ()
+      {
+        ProblemDescriptor problem;
+        problem.name = "qp_unconstrained";
+        problem.category = "qp";
+        problem.logName = "qp/unconstrained";
+        problem.dense = &buildProblem<EigenMatrixDense>;
+        problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+        // Tolerances for Boost checks.
+        problem.tolerances.f0 = 1e-6;
+        problem.tolerances.x = 1e-5;
+        problem.tolerances.f = 1e-4;
+
+        problem.expected.f0 = 5.;
+        problem.expected.x =
+          (ExpectedResult::argument_t (3) << 3., 5., 7.).finished ();
+        problem.expected.fx = -244.;
+        return problem;
+      }
 
-  // Set optional log file for debugging
-  SET_LOG_FILE (solver);
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace unconstrained
+  } // end of namespace qp
+} // end of namespace roboptim
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (qp_unconstrained, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT_UNCONSTRAINED();
+BOOST_AUTO_TEST_CASE (qp_unconstrained)
+{
+  roboptim::solveProblem (roboptim::qp::unconstrained::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
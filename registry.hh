@@ -0,0 +1,219 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_REGISTRY_HH
+# define ROBOPTIM_SHARED_TESTS_REGISTRY_HH
+# include <cmath>
+# include <stdexcept>
+# include <string>
+# include <vector>
+
+# include <boost/function.hpp>
+# include <boost/shared_ptr.hpp>
+
+# include <roboptim/core/linear-function.hh>
+# include <roboptim/core/solver.hh>
+
+namespace roboptim
+{
+  /// \brief Expected result of a problem.
+  struct ExpectedResult
+  {
+    typedef GenericFunction<EigenMatrixDense>::argument_t argument_t;
+
+    /// \brief Cost at the starting point.
+    double f0;
+
+    /// \brief Optimal argument.
+    argument_t x;
+
+    /// \brief Optimal cost.
+    double fx;
+  };
+
+  /// \brief Tolerances used to check the result of a problem.
+  struct ProblemTolerances
+  {
+    ProblemTolerances ()
+      : f0 (1e-6),
+        x (1e-5),
+        f (1e-5)
+    {}
+
+    /// \brief Tolerance on the cost at the starting point.
+    double f0;
+
+    /// \brief Tolerance on the optimal argument.
+    double x;
+
+    /// \brief Tolerance on the optimal cost and on the constraints.
+    double f;
+  };
+
+  /// \brief Kinds of constraints of a problem (bit flags).
+  enum ConstraintKind
+  {
+    /// \brief Finite bounds on the arguments.
+    BOUND_CONSTRAINTS = 1 << 0,
+    /// \brief Linear constraints.
+    LINEAR_CONSTRAINTS = 1 << 1,
+    /// \brief Nonlinear constraints.
+    NONLINEAR_CONSTRAINTS = 1 << 2,
+    /// \brief Equality constraints (lower bound = upper bound).
+    EQUALITY_CONSTRAINTS = 1 << 3
+  };
+
+  /// \brief Size and structure of a problem.
+  struct ProblemMetadata
+  {
+    ProblemMetadata ()
+      : inputSize (0),
+        constraintsSize (0),
+        constraintKinds (0)
+    {}
+
+    /// \brief Number of variables (n).
+    long inputSize;
+
+    /// \brief Number of scalar constraints (m).
+    long constraintsSize;
+
+    /// \brief Combination of ConstraintKind flags.
+    int constraintKinds;
+  };
+
+  /// \brief Description of a test problem: how to build it and what its
+  /// solution is.
+  ///
+  /// Descriptors are registered by the problem files (see
+  /// ProblemRegistrar), so that drivers can enumerate the problems.
+  struct ProblemDescriptor
+  {
+    typedef Solver<EigenMatrixDense>::problem_t denseProblem_t;
+    typedef Solver<EigenMatrixSparse>::problem_t sparseProblem_t;
+
+    /// \brief Name of the problem, also used as test case name.
+    std::string name;
+
+    /// \brief Family of the problem (schittkowski, qp, roboptim,
+    /// benchmark).
+    std::string category;
+
+    /// \brief Name of the optimization logger output.
+    std::string logName;
+
+    /// \brief Factory of the dense problem, starting point included.
+    boost::function<boost::shared_ptr<denseProblem_t> ()> dense;
+
+    /// \brief Factory of the sparse problem, starting point included.
+    boost::function<boost::shared_ptr<sparseProblem_t> ()> sparse;
+
+    /// \brief Expected result.
+    ExpectedResult expected;
+
+    /// \brief Tolerances of the checks.
+    ProblemTolerances tolerances;
+
+    /// \brief Build the problem with a given matrix type.
+    template <typename T>
+    boost::shared_ptr<typename Solver<T>::problem_t> build () const;
+  };
+
+  template <>
+  inline boost::shared_ptr<ProblemDescriptor::denseProblem_t>
+  ProblemDescriptor::build<EigenMatrixDense> () const
+  {
+    return dense ();
+  }
+
+  template <>
+  inline boost::shared_ptr<ProblemDescriptor::sparseProblem_t>
+  ProblemDescriptor::build<EigenMatrixSparse> () const
+  {
+    return sparse ();
+  }
+
+  typedef std::vector<ProblemDescriptor> problemRegistry_t;
+
+  /// \brief All the problems registered in this executable.
+  inline problemRegistry_t& problemRegistry ()
+  {
+    static problemRegistry_t registry;
+    return registry;
+  }
+
+  /// \brief Registered problem with a given name.
+  inline const ProblemDescriptor& findProblem (const std::string& name)
+  {
+    const problemRegistry_t& registry = problemRegistry ();
+    for (std::size_t i = 0; i < registry.size (); ++i)
+      if (registry[i].name == name)
+        return registry[i];
+    throw std::runtime_error ("unknown problem: " + name);
+  }
+
+  /// \brief Register a problem at static initialization time:
+  ///
+  /// \code
+  /// static ProblemRegistrar registrar (descriptor ());
+  /// \endcode
+  struct ProblemRegistrar
+  {
+    explicit ProblemRegistrar (const ProblemDescriptor& descriptor)
+    {
+      problemRegistry ().push_back (descriptor);
+    }
+  };
+
+  /// \brief Size and structure of a registered problem.
+  ///
+  /// The problem is built to be inspected.
+  template <typename T>
+  ProblemMetadata problemMetadata (const ProblemDescriptor& descriptor)
+  {
+    typedef typename Solver<T>::problem_t problem_t;
+    typedef typename problem_t::function_t function_t;
+
+    boost::shared_ptr<problem_t> problem = descriptor.build<T> ();
+
+    ProblemMetadata metadata;
+    metadata.inputSize = problem->function ().inputSize ();
+
+    for (std::size_t i = 0; i < problem->argumentBounds ().size (); ++i)
+      if (!std::isinf (problem->argumentBounds ()[i].first)
+          || !std::isinf (problem->argumentBounds ()[i].second))
+        metadata.constraintKinds |= BOUND_CONSTRAINTS;
+
+    for (std::size_t i = 0; i < problem->constraints ().size (); ++i)
+      {
+        const function_t& g = *problem->constraints ()[i];
+        metadata.constraintsSize += g.outputSize ();
+        metadata.constraintKinds |=
+          dynamic_cast<const GenericLinearFunction<T>*> (&g)
+          ? LINEAR_CONSTRAINTS : NONLINEAR_CONSTRAINTS;
+
+        for (std::size_t j = 0; j < problem->boundsVector ()[i].size (); ++j)
+          if (problem->boundsVector ()[i][j].first
+              == problem->boundsVector ()[i][j].second)
+            metadata.constraintKinds |= EQUALITY_CONSTRAINTS;
+      }
+
+    return metadata;
+  }
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_REGISTRY_HH
@@ -17,6 +17,10 @@
 
 
 #include "common.hh"
+#include "cache.hh"
+#include "sparsity.hh"
+
+#include <limits>
 
 #include <roboptim/core/sum-of-c1-squares.hh>
 
@@ -34,8 +38,10 @@ namespace roboptim
       explicit F (const ExpectedResult& target) : GenericDifferentiableFunction<T>
 		      (2, 3,
 		       "vector between unit sphere and point (x,y,z)"),
-		      point_ (3)
+		      point_ (3),
+		      trigonometry_ ()
       {
+	trigonometry_.theta = std::numeric_limits<double>::quiet_NaN ();
 	sphericalCoordinates (point_, target.x[0], target.x[1]);
 	point_ *= 2.;
       }
@@ -54,18 +60,46 @@ namespace roboptim
         res (1) = sin(theta) * cos(phi);
         res (2) = sin(phi);
       }
+
+      /// Sines and cosines of the angles of an argument.
+      struct Trigonometry
+      {
+        double theta;
+        double phi;
+        double cosTheta;
+        double sinTheta;
+        double cosPhi;
+        double sinPhi;
+      };
+
+      /// Sines and cosines of the angles of x, shared by impl_compute and
+      /// impl_gradient: they are only recomputed when x changes.
+      const Trigonometry& trigonometry (const_argument_ref x) const
+      {
+        if (x[0] != trigonometry_.theta || x[1] != trigonometry_.phi)
+          {
+            trigonometry_.theta = x[0];
+            trigonometry_.phi = x[1];
+            trigonometry_.cosTheta = cos (x[0]);
+            trigonometry_.sinTheta = sin (x[0]);
+            trigonometry_.cosPhi = cos (x[1]);
+            trigonometry_.sinPhi = sin (x[1]);
+          }
+        return trigonometry_;
+      }
+
       result_t point_;
+      mutable Trigonometry trigonometry_;
     };
 
     template <typename T>
     void
     F<T>::impl_compute (result_ref result, const_argument_ref x) const
     {
-      result.setZero ();
-      double theta = x[0];
-      double phi = x[1];
-      sphericalCoordinates (result, theta, phi);
-      result -= point_;
+      const Trigonometry& t = trigonometry (x);
+      result[0] = t.cosTheta * t.cosPhi - point_[0];
+      result[1] = t.sinTheta * t.cosPhi - point_[1];
+      result[2] = t.sinPhi - point_[2];
     }
 
     template <>
@@ -74,24 +108,32 @@ namespace roboptim
     (gradient_ref grad, const_argument_ref x, size_type functionId)
       const
     {
-      grad.setZero ();
+      const Trigonometry& t = trigonometry (x);
 
-      double theta = x[0];
-      double phi = x[1];
+      static const int pattern[] = {0, 1};
+      static const int pattern2[] = {1};
 
       switch (functionId)
         {
         case 0:
-          grad.coeffRef (0) = -sin(theta) * cos(phi);
-          grad.coeffRef (1) = -cos(theta) * sin(phi);
+          {
+            StructuredGradient<gradient_t> g (grad, pattern);
+            g (0) = -t.sinTheta * t.cosPhi;
+            g (1) = -t.cosTheta * t.sinPhi;
+          }
           break;
         case 1:
-          grad.coeffRef (0) = cos(theta) * cos(phi);
-          grad.coeffRef (1) = -sin(theta) * sin(phi);
+          {
+            StructuredGradient<gradient_t> g (grad, pattern);
+            g (0) = t.cosTheta * t.cosPhi;
+            g (1) = -t.sinTheta * t.sinPhi;
+          }
           break;
         case 2:
-          grad.coeffRef (0) = 0.;
-          grad.coeffRef (1) = cos(phi);
+          {
+            StructuredGradient<gradient_t> g (grad, pattern2);
+            g (1) = t.cosPhi;
+          }
           break;
         default:
           abort();
@@ -106,28 +148,94 @@ namespace roboptim
     {
       grad.setZero ();
 
-      double theta = x[0];
-      double phi = x[1];
+      const Trigonometry& t = trigonometry (x);
 
       switch (functionId)
         {
         case 0:
-          grad[0] = -sin(theta) * cos(phi);
-          grad[1] = -cos(theta) * sin(phi);
+          grad[0] = -t.sinTheta * t.cosPhi;
+          grad[1] = -t.cosTheta * t.sinPhi;
           break;
         case 1:
-          grad[0] = cos(theta) * cos(phi);
-          grad[1] = -sin(theta) * sin(phi);
+          grad[0] = t.cosTheta * t.cosPhi;
+          grad[1] = -t.sinTheta * t.sinPhi;
           break;
         case 2:
           grad[0] = 0.;
-          grad[1] = cos(phi);
+          grad[1] = t.cosPhi;
           break;
         default:
           abort();
         }
     }
 
+    /// Expected result: the target point is built from it.
+    ExpectedResult expectedResult ()
+    {
+      ExpectedResult expected;
+      expected.f0 = 4.8974713057829096;
+      expected.x = (ExpectedResult::argument_t (2) << -1.5, -1.2).finished ();
+      expected.fx = 1.0;
+      return expected;
+    }
+
+    template <typename T>
+    boost::shared_ptr<typename Solver<T>::problem_t>
+    buildProblem ()
+    {
+      typedef typename Solver<T>::problem_t problem_t;
+
+      // The sum of squares evaluates F and its Jacobian at the same
+      // points: the cache only forwards the first call at each point to
+      // the (instrumented) function.
+      boost::shared_ptr<F<T> >
+        f (new Cached<Instrumented<F<T> > > (expectedResult ()));
+      boost::shared_ptr<GenericSumOfC1Squares<T> >
+        soq (new Instrumented<GenericSumOfC1Squares<T> > (f, ""));
+
+      boost::shared_ptr<problem_t> pb = boost::make_shared<problem_t> (soq);
+      problem_t& problem = *pb;
+
+      // Load starting point
+      typename F<T>::argument_t x (2);
+      x << 0., 0.;
+      problem.startingPoint () = x;
+
+      // Set arguments names (optional).
+      typename F<T>::names_t
+        names (static_cast<std::size_t> (f->inputSize ()));
+      names[0] = "θ";
+      names[1] = "φ";
+      problem.argumentNames () = names;
+
+      // Bounds on theta \in [-Pi/2, Pi/2]
+      problem.argumentBounds ()[0] = Function::makeInterval (-M_PI_2, M_PI_2);
+
+      // Bounds on phi \in [-Pi, Pi]
+      problem.argumentBounds ()[1] = Function::makeInterval (-M_PI, M_PI);
+
+      return pb;
+    }
+
+    ProblemDescriptor descriptor ()
+    {
+      ProblemDescriptor problem;
+      problem.name = "distanceToSphere_problem1";
+      problem.category = "roboptim";
+      problem.logName = "roboptim/distance-to-sphere";
+      problem.dense = &buildProblem<EigenMatrixDense>;
+      problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+      // Tolerances for Boost checks.
+      problem.tolerances.f0 = 1e-6;
+      problem.tolerances.x = 1e-5;
+      problem.tolerances.f = 1e-4;
+
+      problem.expected = expectedResult ();
+      return problem;
+    }
+
+    static ProblemRegistrar registrar (descriptor ());
   } // namespace distanceToSphere
 } // namespace roboptim
 
@@ -136,64 +244,33 @@ BOOST_FIXTURE_TEST_SUITE (distanceToSphere, TestSuiteConfiguration)
 
 BOOST_AUTO_TEST_CASE (distanceToSphere_problem1)
 {
-  using namespace roboptim;
-  using namespace roboptim::distanceToSphere;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-6;
-  double x_tol = 1e-5;
-  double f_tol = 1e-4;
-
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 4.8974713057829096;
-  expectedResult.x = (ExpectedResult::argument_t (2) << -1.5, -1.2).finished ();
-  expectedResult.fx = 1.0;
-
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> (expectedResult));
-  boost::shared_ptr<GenericSumOfC1Squares<functionType_t> >
-    soq (new GenericSumOfC1Squares<functionType_t> (f, ""));
-
-  solver_t::problem_t problem (soq);
-
-  // Load starting point
-  F<functionType_t>::argument_t x (2);
-  x << 0., 0.;
-  problem.startingPoint () = x;
-
-  // Set arguments names (optional).
-  F<functionType_t>::names_t
-    names (static_cast<std::size_t> (f->inputSize ()));
-  names[0] = "θ";
-  names[1] = "φ";
-  problem.argumentNames () = names;
-
-  // Bounds on theta \in [-Pi/2, Pi/2]
-  problem.argumentBounds ()[0] = Function::makeInterval (-M_PI_2, M_PI_2);
-
-  // Bounds on phi \in [-Pi, Pi]
-  problem.argumentBounds ()[1] = Function::makeInterval (-M_PI, M_PI);
-
-  BOOST_CHECK_SMALL_OR_CLOSE ((*soq) (x)[0], expectedResult.f0, f0_tol);
-
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "roboptim/distance-to-sphere");
-
-  // Set optional log file for debugging
-  SET_LOG_FILE (solver);
-
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
-
-  // Display solver information.
-  std::cout << solver << std::endl;
+  roboptim::solveProblem (roboptim::distanceToSphere::descriptor ());
+}
 
-  // Process the result
-  PROCESS_RESULT_UNCONSTRAINED();
+BOOST_AUTO_TEST_CASE (distanceToSphere_cache)
+{
+  using namespace roboptim;
+  typedef distanceToSphere::F<functionType_t> f_t;
+
+  Cached<Instrumented<f_t> > f (distanceToSphere::expectedResult ());
+  f_t::argument_t x (2);
+  x << 0.5, -0.25;
+
+  // Value, then Jacobian (one gradient per output), twice at x.
+  f_t::result_t value = f (x);
+  f_t::jacobian_t jac = f.jacobian (x);
+  BOOST_CHECK (f (x) == value);
+  BOOST_CHECK (f.jacobian (x).isApprox (jac));
+  BOOST_CHECK_EQUAL (f.statistics ().computeCount, 1u);
+  BOOST_CHECK_EQUAL (f.statistics ().gradientCount, 3u);
+  BOOST_CHECK_EQUAL (f.cacheStatistics ().computeHits, 1u);
+  BOOST_CHECK_EQUAL (f.cacheStatistics ().jacobianHits, 1u);
+
+  // A new point is forwarded to the function.
+  x[0] = 0.75;
+  f (x);
+  BOOST_CHECK_EQUAL (f.statistics ().computeCount, 2u);
+  BOOST_CHECK_EQUAL (f.cacheStatistics ().computeMisses, 2u);
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
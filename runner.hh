@@ -0,0 +1,282 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_RUNNER_HH
+# define ROBOPTIM_SHARED_TESTS_RUNNER_HH
+# include <algorithm>
+# include <atomic>
+# include <exception>
+# include <fstream>
+# include <iostream>
+# include <map>
+# include <memory>
+# include <mutex>
+# include <sstream>
+# include <string>
+# include <thread>
+# include <vector>
+
+# include <boost/filesystem.hpp>
+# include <boost/function.hpp>
+# include <boost/property_tree/json_parser.hpp>
+# include <boost/property_tree/ptree.hpp>
+
+# include <roboptim/core/solver-factory.hh>
+
+# include "perf.hh"
+
+namespace roboptim
+{
+  /// \brief Independent solver run.
+  ///
+  /// A job builds its own problem and solver, and returns the
+  /// performance record of the run. Jobs may be run concurrently: they
+  /// must not use Boost.Test assertions or the global optimization logger.
+  struct Job
+  {
+    /// \brief Name of the job, also used as test name in the records.
+    std::string name;
+
+    /// \brief Build, solve and evaluate the problem.
+    boost::function<PerformanceRecord ()> run;
+  };
+
+  /// \brief Wall-clock solve time of previous runs, by test name.
+  typedef std::map<std::string, double> timings_t;
+
+  /// \brief Read the solve times of a performance record file (see
+  /// writePerformanceRecord). The last record of a test is kept.
+  ///
+  /// \param file performance record file (JSON Lines).
+  /// \param timings timings to update.
+  inline void readHistoricalTimings (const boost::filesystem::path& file,
+                                     timings_t& timings)
+  {
+    std::ifstream ifs (file.c_str ());
+    std::string line;
+    while (std::getline (ifs, line))
+      {
+        if (line.empty ())
+          continue;
+
+        boost::property_tree::ptree record;
+        std::istringstream ss (line);
+        try
+          {
+            boost::property_tree::read_json (ss, record);
+          }
+        catch (const boost::property_tree::json_parser_error&)
+          {
+            continue;
+          }
+        timings[record.get<std::string> ("test", "")] =
+          record.get<double> ("wall_time", 0.);
+      }
+  }
+
+  /// \brief Sort jobs by decreasing expected solve time, so that long jobs
+  /// do not end up alone at the end of a parallel run.
+  ///
+  /// Jobs without historical timing are scheduled first, since nothing
+  /// is known about them.
+  inline void scheduleLongestFirst (std::vector<Job>& jobs,
+                                    const timings_t& timings)
+  {
+    struct
+    {
+      const timings_t* timings;
+
+      double expected (const Job& job) const
+      {
+        timings_t::const_iterator it = timings->find (job.name);
+        return (it == timings->end ()) ? -1. : it->second;
+      }
+
+      bool operator () (const Job& a, const Job& b) const
+      {
+        double ta = expected (a);
+        double tb = expected (b);
+        if (ta < 0. || tb < 0.)
+          return ta < 0. && tb >= 0.;
+        return ta > tb;
+      }
+    } longerFirst = {&timings};
+
+    std::stable_sort (jobs.begin (), jobs.end (), longerFirst);
+  }
+
+  /// \brief Default number of worker threads (number of cores).
+  inline unsigned defaultThreadCount ()
+  {
+    return std::max (1u, std::thread::hardware_concurrency ());
+  }
+
+  /// \brief Whether the solvers of a plug-in can solve problems
+  /// concurrently.
+  ///
+  /// Most plug-ins are not re-entrant (e.g. Ipopt with MUMPS), so only
+  /// the plug-ins listed in THREAD_SAFE_PLUGINS (comma-separated, set by
+  /// the THREAD_SAFE_PLUGINS CMake variable) are.
+  inline bool isThreadSafePlugin (const std::string& plugin)
+  {
+# ifdef THREAD_SAFE_PLUGINS
+    const std::string plugins = "," THREAD_SAFE_PLUGINS ",";
+    return plugins.find ("," + plugin + ",") != std::string::npos;
+# else
+    (void)plugin;
+    return false;
+# endif //! THREAD_SAFE_PLUGINS
+  }
+
+  /// \brief Default number of worker threads for the jobs of a plug-in:
+  /// the number of cores if the plug-in is thread-safe, else 1.
+  inline unsigned defaultThreadCount (const std::string& plugin)
+  {
+    return isThreadSafePlugin (plugin) ? defaultThreadCount () : 1u;
+  }
+
+  /// \brief Run jobs on a pool of worker threads.
+  ///
+  /// Jobs are started in order, each worker taking the next job as soon
+  /// as it is idle. An exception thrown by a job, of any type, is
+  /// reported as an "error" record.
+  ///
+  /// Note that the CPU time and the peak memory of the records are
+  /// measured for the whole process (see perf.hh): when several threads
+  /// are used, they include the concurrent jobs, and are only meaningful
+  /// for sequential runs (threads = 1).
+  ///
+  /// Also note that the solves of plug-ins that are not thread-safe (see
+  /// isThreadSafePlugin) are serialized by ThreadSafeSolverFactory: with
+  /// these plug-ins, only the building and the checks of the problems run
+  /// concurrently.
+  ///
+  /// \param jobs jobs to run.
+  /// \param threads number of worker threads.
+  ///
+  /// \return performance records, in the order of the jobs.
+  inline std::vector<PerformanceRecord>
+  runJobs (const std::vector<Job>& jobs, unsigned threads)
+  {
+    std::vector<PerformanceRecord> records (jobs.size ());
+    std::atomic<std::size_t> next (0);
+
+    auto worker = [&] ()
+      {
+        for (std::size_t i = next++; i < jobs.size (); i = next++)
+          {
+            try
+              {
+                records[i] = jobs[i].run ();
+              }
+            catch (const std::exception& e)
+              {
+                records[i].status = "error";
+                std::cerr << jobs[i].name << ": " << e.what () << std::endl;
+              }
+            catch (...)
+              {
+                records[i].status = "error";
+                std::cerr << jobs[i].name << ": unknown exception"
+                          << std::endl;
+              }
+            if (records[i].test.empty ())
+              records[i].test = jobs[i].name;
+          }
+      };
+
+    threads = std::max (1u, std::min (threads, static_cast<unsigned>
+                                      (jobs.size ())));
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t)
+      pool.push_back (std::thread (worker));
+    worker ();
+    for (std::size_t t = 0; t < pool.size (); ++t)
+      pool[t].join ();
+
+    return records;
+  }
+
+  /// \brief Mutex serializing the loading and unloading of solver
+  /// plug-ins (libltdl is not thread-safe).
+  inline std::mutex& pluginMutex ()
+  {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  /// \brief Mutex serializing the solves of the plug-ins that are not
+  /// thread-safe (see isThreadSafePlugin).
+  inline std::mutex& solverMutex ()
+  {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  /// \brief Solver factory that can be used from worker threads.
+  ///
+  /// Each worker creates its own solver instance. The plug-in loading and
+  /// unloading are serialized, and so are the solves of the plug-ins that
+  /// are not thread-safe: hold the lock returned by lock () while the
+  /// solver runs.
+  ///
+  /// \tparam S solver type.
+  template <typename S>
+  class ThreadSafeSolverFactory
+  {
+  public:
+    typedef S solver_t;
+    typedef typename solver_t::problem_t problem_t;
+
+    ThreadSafeSolverFactory (const std::string& plugin,
+                             const problem_t& problem)
+      : factory_ (),
+        threadSafe_ (isThreadSafePlugin (plugin))
+    {
+      std::lock_guard<std::mutex> lock (pluginMutex ());
+      factory_.reset (new SolverFactory<solver_t> (plugin, problem));
+    }
+
+    ~ThreadSafeSolverFactory ()
+    {
+      std::lock_guard<std::mutex> lock (pluginMutex ());
+      factory_.reset ();
+    }
+
+    solver_t& operator () ()
+    {
+      return (*factory_) ();
+    }
+
+    /// \brief Lock to hold while the solver runs: it owns solverMutex ()
+    /// unless the plug-in is thread-safe.
+    std::unique_lock<std::mutex> lock () const
+    {
+      if (threadSafe_)
+        return std::unique_lock<std::mutex> ();
+      return std::unique_lock<std::mutex> (solverMutex ());
+    }
+
+  private:
+    std::unique_ptr<SolverFactory<solver_t> > factory_;
+
+    /// \brief Whether solvers of the plug-in may run concurrently.
+    bool threadSafe_;
+  };
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_RUNNER_HH
@@ -0,0 +1,145 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+// Fused value and derivative evaluations (see fused.hh) of the
+// Schittkowski problems providing them, compared to separate evaluations
+// at a few points. This file is linked with these problems in the fused
+// benchmark (see benchmark/CMakeLists.txt).
+
+#include "common.hh"
+#include "fused.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace roboptim
+{
+  namespace fusedCheck
+  {
+    /// \brief Tolerance on the difference between the fused and separate
+    /// evaluations, relative to 1 + |separate value|.
+    const double tolerance = 1e-9;
+
+    /// \brief Points at which the evaluations are compared: the starting
+    /// point, and points around it.
+    template <typename A>
+    std::vector<A> points (const A& x0)
+    {
+      std::vector<A> x (1, x0);
+      for (int k = 1; k <= 2; ++k)
+        {
+          A xk (x0);
+          for (typename A::Index j = 0; j < xk.size (); ++j)
+            xk[j] += ((j % 2) ? -0.1 : 0.1) * k
+              * std::max (1., std::fabs (x0[j]));
+          x.push_back (xk);
+        }
+      return x;
+    }
+
+    /// \brief Compare the fused and separate evaluations of the functions
+    /// of a registered problem.
+    ///
+    /// \return number of functions providing a fused evaluation.
+    template <typename T>
+    std::size_t checkFused (const std::string& name)
+    {
+      typedef typename Solver<T>::problem_t problem_t;
+      typedef typename problem_t::function_t function_t;
+      typedef GenericTwiceDifferentiableFunction<T> twiceDifferentiable_t;
+      typedef typename function_t::size_type size_type;
+      typedef typename function_t::result_t result_t;
+      typedef typename function_t::gradient_t gradient_t;
+      typedef typename twiceDifferentiable_t::hessian_t hessian_t;
+
+      boost::shared_ptr<problem_t> problem = findProblem (name).build<T> ();
+      std::vector<typename problem_t::argument_t> x =
+        points (*problem->startingPoint ());
+
+      std::size_t fusedFunctions = 0;
+      std::size_t functions = problem->constraints ().size () + 1;
+      for (std::size_t c = 0; c < functions; ++c)
+        {
+          const function_t& f = (c == 0)
+            ? problem->function () : *problem->constraints ()[c - 1];
+          const twiceDifferentiable_t* ft =
+            dynamic_cast<const twiceDifferentiable_t*> (&f);
+          if (dynamic_cast<const GenericFusedEvaluation<T>*> (&f))
+            ++fusedFunctions;
+
+          size_type n = f.inputSize ();
+          result_t result (f.outputSize ()), fusedResult (f.outputSize ());
+          gradient_t grad (n), fusedGrad (n);
+          hessian_t h (n, n), fusedH (n, n);
+
+          for (std::size_t p = 0; p < x.size (); ++p)
+            for (size_type i = 0; i < f.outputSize (); ++i)
+              {
+                f (result, x[p]);
+                f.gradient (grad, x[p], i);
+                valueAndGradient<T> (f, fusedResult, fusedGrad, x[p], i);
+                double error =
+                  std::max (detail::derivativeError (fusedResult, result),
+                            detail::derivativeError (fusedGrad, grad));
+
+                if (ft)
+                  {
+                    ft->hessian (h, x[p], i);
+                    valueGradientAndHessian<T> (*ft, fusedResult, fusedGrad,
+                                                fusedH, x[p], i);
+                    error = std::max
+                      (error, detail::derivativeError (fusedResult, result));
+                    error = std::max
+                      (error, detail::derivativeError (fusedGrad, grad));
+                    error = std::max
+                      (error, detail::derivativeError (fusedH, h));
+                  }
+
+                BOOST_CHECK_MESSAGE (error < tolerance,
+                                     name << ": " << f.getName ()
+                                     << ", point " << p << ", output " << i
+                                     << ": error " << error);
+              }
+        }
+      return fusedFunctions;
+    }
+  } // end of namespace fusedCheck
+} // end of namespace roboptim
+
+BOOST_FIXTURE_TEST_SUITE (fused, TestSuiteConfiguration)
+
+BOOST_AUTO_TEST_CASE (fused_evaluations)
+{
+  using namespace roboptim;
+
+  const char* problems[] =
+    {"schittkowski_problem1", "problem_71", "schittkowski_problem81"};
+  // Functions providing a fused evaluation in each problem.
+  const std::size_t fusedFunctions[] = {1, 2, 1};
+
+  for (std::size_t i = 0; i < sizeof (problems) / sizeof (problems[0]); ++i)
+    {
+      BOOST_CHECK_EQUAL (fusedCheck::checkFused<EigenMatrixDense>
+                         (problems[i]), fusedFunctions[i]);
+      BOOST_CHECK_EQUAL (fusedCheck::checkFused<EigenMatrixSparse>
+                         (problems[i]), fusedFunctions[i]);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END ()
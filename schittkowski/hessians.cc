@@ -0,0 +1,139 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+// Analytic Hessians of the registered problems, compared to central
+// differences of their gradients at the starting point. This file is
+// linked with the Schittkowski problems (see schittkowski/CMakeLists.txt).
+
+#include "common.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace roboptim
+{
+  namespace hessianCheck
+  {
+    /// \brief Largest relative step of the central differences.
+    const double step = 1e-4;
+
+    /// \brief Tolerance on the difference to the finite-difference
+    /// Hessian, relative to 1 + |reference value|.
+    ///
+    /// Some problems compute their gradients by finite differences, hence
+    /// the loose tolerance: wrong analytic terms give much larger errors.
+    const double tolerance = 1e-3;
+
+    /// \brief Gradient of f, as a dense column vector.
+    template <typename T>
+    Eigen::VectorXd denseGradient
+    (const GenericDifferentiableFunction<T>& f,
+     const typename GenericFunction<T>::argument_t& x,
+     typename GenericFunction<T>::size_type i)
+    {
+      typename GenericDifferentiableFunction<T>::gradient_t grad (f.inputSize ());
+      grad.setZero ();
+      f.gradient (grad, x, i);
+      Eigen::MatrixXd g (grad);
+      return Eigen::Map<const Eigen::VectorXd> (g.data (), g.size ());
+    }
+
+    /// \brief Hessian of the output i of f, by central differences of the
+    /// gradients.
+    template <typename T>
+    Eigen::MatrixXd finiteDifferenceHessian
+    (const GenericDifferentiableFunction<T>& f,
+     const typename GenericFunction<T>::argument_t& x,
+     typename GenericFunction<T>::size_type i)
+    {
+      typedef typename GenericFunction<T>::argument_t argument_t;
+      typedef typename GenericFunction<T>::size_type size_type;
+
+      Eigen::MatrixXd h (f.inputSize (), f.inputSize ());
+      argument_t xh (x);
+      for (size_type j = 0; j < f.inputSize (); ++j)
+        {
+          double hj = step * std::max (1., std::fabs (x[j]));
+          xh[j] = x[j] + hj;
+          Eigen::VectorXd up = denseGradient (f, xh, i);
+          xh[j] = x[j] - hj;
+          Eigen::VectorXd down = denseGradient (f, xh, i);
+          xh[j] = x[j];
+          h.col (j) = (up - down) / (2. * hj);
+        }
+      return h;
+    }
+
+    /// \brief Check the Hessians of the cost and of the constraints of a
+    /// registered problem built with the matrix type T.
+    template <typename T>
+    void checkHessians (const ProblemDescriptor& descriptor,
+                        const std::string& type)
+    {
+      typedef typename Solver<T>::problem_t problem_t;
+      typedef typename problem_t::function_t function_t;
+      typedef GenericTwiceDifferentiableFunction<T> twiceDifferentiable_t;
+      typedef typename function_t::size_type size_type;
+
+      boost::shared_ptr<problem_t> problem = descriptor.build<T> ();
+      const typename problem_t::argument_t& x = *problem->startingPoint ();
+
+      std::size_t functions = problem->constraints ().size () + 1;
+      for (std::size_t c = 0; c < functions; ++c)
+        {
+          const function_t& f = (c == 0)
+            ? problem->function () : *problem->constraints ()[c - 1];
+          const twiceDifferentiable_t* ft =
+            dynamic_cast<const twiceDifferentiable_t*> (&f);
+          BOOST_CHECK_MESSAGE (ft, descriptor.name << " (" << type
+                               << "): " << f.getName ()
+                               << " is not twice differentiable");
+          if (!ft)
+            continue;
+
+          for (size_type i = 0; i < f.outputSize (); ++i)
+            {
+              double error =
+                detail::derivativeError (ft->hessian (x, i),
+                                         finiteDifferenceHessian (*ft, x, i));
+              BOOST_CHECK_MESSAGE (error < tolerance,
+                                   descriptor.name << " (" << type << "): "
+                                   << f.getName () << ", output " << i
+                                   << ": error " << error);
+            }
+        }
+    }
+  } // end of namespace hessianCheck
+} // end of namespace roboptim
+
+BOOST_FIXTURE_TEST_SUITE (hessians, TestSuiteConfiguration)
+
+BOOST_AUTO_TEST_CASE (hessians_finite_differences)
+{
+  using namespace roboptim;
+
+  const problemRegistry_t& registry = problemRegistry ();
+  BOOST_REQUIRE (!registry.empty ());
+  for (std::size_t i = 0; i < registry.size (); ++i)
+    {
+      hessianCheck::checkHessians<EigenMatrixDense> (registry[i], "dense");
+      hessianCheck::checkHessians<EigenMatrixSparse> (registry[i], "sparse");
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END ()
@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,11 +25,11 @@ namespace roboptim
     namespace problem10
     {
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -36,11 +37,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (2, 1, "x₀ - x₁")
       {}
 
@@ -58,8 +62,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref, size_type)
 	const
       {
-	grad.coeffRef (0) = 1.;
-	grad.coeffRef (1) = -1.;
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = 1.;
+	g (1) = -1.;
       }
 
       template <typename T>
@@ -72,11 +78,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G : public GenericDifferentiableFunction<T>
+      class G : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G ();
 	void
@@ -84,11 +90,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G<T>::G ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (2, 1, "-3x₀² + 2x₀x₁ - x₁² + 1")
       {}
 
@@ -106,8 +115,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = -6 * x[0] + 2 * x[1];
-	grad.coeffRef (1) = 2 * x[0] - 2 * x[1];
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = -6 * x[0] + 2 * x[1];
+	g (1) = 2 * x[0] - 2 * x[1];
       }
 
       template <typename T>
@@ -118,67 +129,93 @@ namespace roboptim
 	grad[0] = -6 * x[0] + 2 * x[1];
 	grad[1] = 2 * x[0] - 2 * x[1];
       }
-    } // end of namespace problem10.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
-
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
-
-BOOST_AUTO_TEST_CASE (schittkowski_problem10)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem10;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
 
-  ExpectedResult expectedResult;
-  expectedResult.f0 = -20;
-  expectedResult.x = (ExpectedResult::argument_t (2) << 0, 1).finished ();
-  expectedResult.fx = -1;
-
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+      }
 
-  boost::shared_ptr<G<functionType_t> > g =
-    boost::make_shared<G<functionType_t> > ();
-  problem.addConstraint (g, G<functionType_t>::makeInterval (0., 0.));
+      template <>
+      void
+      G<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = -6.;
+	h (0, 1) = 2.;
+	h (1, 0) = 2.;
+	h (1, 1) = -2.;
+      }
 
-  F<functionType_t>::argument_t x (2);
-  x << -10, 10;
-  problem.startingPoint () = x;
+      template <typename T>
+      void
+      G<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = -6.;
+	h (0, 1) = 2.;
+	h (1, 0) = 2.;
+	h (1, 1) = -2.;
+      }
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-10");
+	boost::shared_ptr<G<T> > g =
+	  boost::make_shared<Instrumented<G<T> > > ();
+	problem.addConstraint (g, G<T>::makeInterval (0., 0.));
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+	typename F<T>::argument_t x (2);
+	x << -10, 10;
+	problem.startingPoint () = x;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	return pb;
+      }
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem10";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-10";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = -20;
+	problem.expected.x = (ExpectedResult::argument_t (2) << 0, 1).finished ();
+	problem.expected.fx = -1;
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem10.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem10)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem10::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
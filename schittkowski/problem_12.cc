@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,11 +25,11 @@ namespace roboptim
     namespace problem12
     {
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -36,11 +37,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (2, 1, ".5 * x₀² + x₁² - x₀x₁ - 7x₀ - 7x₁")
       {}
 
@@ -63,8 +67,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = x[0] - x[1] - 7;
-	grad.coeffRef (1) = -x[0] + 2 * x[1] - 7;
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = x[0] - x[1] - 7;
+	g (1) = -x[0] + 2 * x[1] - 7;
       }
 
       template <typename T>
@@ -77,11 +83,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G : public GenericDifferentiableFunction<T>
+      class G : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G ();
 	void
@@ -89,11 +95,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G<T>::G ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (2, 1, "25 - 4x₀² - x₁²")
       {}
 
@@ -111,8 +120,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = -8. * x[0];
-	grad.coeffRef (1) = -2. * x[1];
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = -8. * x[0];
+	g (1) = -2. * x[1];
       }
 
       template <typename T>
@@ -123,67 +134,106 @@ namespace roboptim
 	grad[0] = -8. * x[0];
 	grad[1] = -2. * x[1];
       }
-    } // end of namespace problem12.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
-
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-BOOST_AUTO_TEST_CASE (schittkowski_problem12)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem12;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
-
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 0;
-  expectedResult.x = (ExpectedResult::argument_t (2) << 2, 3).finished ();
-  expectedResult.fx = -30;
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = 1.;
+	h (0, 1) = -1.;
+	h (1, 0) = -1.;
+	h (1, 1) = 2.;
+      }
 
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = 1.;
+	h (0, 1) = -1.;
+	h (1, 0) = -1.;
+	h (1, 1) = 2.;
+      }
 
-  boost::shared_ptr<G<functionType_t> > g =
-    boost::make_shared<G<functionType_t> > ();
-  problem.addConstraint (g, G<functionType_t>::makeLowerInterval (0.));
+      template <>
+      void
+      G<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {1, 1}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = -8.;
+	h (1, 1) = -2.;
+      }
 
-  F<functionType_t>::argument_t x (2);
-  x << 0, 0;
-  problem.startingPoint () = x;
+      template <typename T>
+      void
+      G<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = -8.;
+	h (1, 1) = -2.;
+      }
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-12");
+	boost::shared_ptr<G<T> > g =
+	  boost::make_shared<Instrumented<G<T> > > ();
+	problem.addConstraint (g, G<T>::makeLowerInterval (0.));
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+	typename F<T>::argument_t x (2);
+	x << 0, 0;
+	problem.startingPoint () = x;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	return pb;
+      }
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem12";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-12";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = 0;
+	problem.expected.x = (ExpectedResult::argument_t (2) << 2, 3).finished ();
+	problem.expected.fx = -30;
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem12.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem12)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem12::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,11 +25,11 @@ namespace roboptim
     namespace problem14
     {
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -36,11 +37,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (2, 1, "(x₀ - 2)² + (x₁ - 1)²")
       {}
 
@@ -58,8 +62,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = 2 * x[0] - 4;
-	grad.coeffRef (1) = 2 * x[1] - 2;
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = 2 * x[0] - 4;
+	g (1) = 2 * x[1] - 2;
       }
 
       template <typename T>
@@ -72,11 +78,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G : public GenericDifferentiableFunction<T>
+      class G : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G ();
 	void
@@ -84,11 +90,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G<T>::G ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (2, 1, "-.25 * x₀² - x₁² + 1")
       {}
 
@@ -106,8 +115,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = -.25 * 2. * x[0];
-	grad.coeffRef (1) = -2 * x[1];
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = -.25 * 2. * x[0];
+	g (1) = -2 * x[1];
       }
 
       template <typename T>
@@ -120,11 +131,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G2 : public GenericDifferentiableFunction<T>
+      class G2 : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G2 ();
 	void
@@ -132,11 +143,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G2<T>::G2 ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (2, 1, "x₀ - 2 * x₁ + 1")
       {}
 
@@ -154,8 +168,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref, size_type)
 	const
       {
-	grad.coeffRef (0) = 1.;
-	grad.coeffRef (1) = -2.;
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = 1.;
+	g (1) = -2.;
       }
 
       template <typename T>
@@ -167,72 +183,114 @@ namespace roboptim
 	grad[1] = -2.;
       }
 
-    } // end of namespace problem14.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
-
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
-
-BOOST_AUTO_TEST_CASE (schittkowski_problem14)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem14;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
-
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 1.;
-  expectedResult.x = (ExpectedResult::argument_t (2)
-                      << 5. * (std::sqrt (7) - 1.),
-                      .25 * (std::sqrt (7) + 1)).finished ();
-  expectedResult.fx = 9. - 2.875 * std::sqrt (7);
-
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
-
-  boost::shared_ptr<G<functionType_t> > g =
-    boost::make_shared<G<functionType_t> > ();
-  problem.addConstraint (g, G<functionType_t>::makeLowerInterval (0.));
-  boost::shared_ptr<G2<functionType_t> > g2 =
-    boost::make_shared<G2<functionType_t> > ();
-  problem.addConstraint (g2, G2<functionType_t>::makeInterval (0., 0.));
-
-  F<functionType_t>::argument_t x (2);
-  x << 2, 2;
-  problem.startingPoint () = x;
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {1, 1}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = 2.;
+	h (1, 1) = 2.;
+      }
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = 2.;
+	h (1, 1) = 2.;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      template <>
+      void
+      G<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {1, 1}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = -0.5;
+	h (1, 1) = -2.;
+      }
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-14");
+      template <typename T>
+      void
+      G<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = -0.5;
+	h (1, 1) = -2.;
+      }
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+      template <typename T>
+      void
+      G2<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
+
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
+
+	boost::shared_ptr<G<T> > g =
+	  boost::make_shared<Instrumented<G<T> > > ();
+	problem.addConstraint (g, G<T>::makeLowerInterval (0.));
+	boost::shared_ptr<G2<T> > g2 =
+	  boost::make_shared<Instrumented<G2<T> > > ();
+	problem.addConstraint (g2, G2<T>::makeInterval (0., 0.));
+
+	typename F<T>::argument_t x (2);
+	x << 2, 2;
+	problem.startingPoint () = x;
+
+	return pb;
+      }
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem14";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-14";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = 1.;
+	problem.expected.x = (ExpectedResult::argument_t (2)
+			      << 5. * (std::sqrt (7) - 1.),
+			      .25 * (std::sqrt (7) + 1)).finished ();
+	problem.expected.fx = 9. - 2.875 * std::sqrt (7);
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem14.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem14)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem14::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
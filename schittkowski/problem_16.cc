@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -25,11 +26,11 @@ namespace roboptim
     {
       // Same than problem_15
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -37,11 +38,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (2, 1, "100 (x₁ - x₀²)² + (1 - x₀)²")
       {}
 
@@ -60,10 +64,12 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) =
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) =
 	  400. * x[0] * x[0] * x[0]
 	  - 400. * x[0] * x[1] + 2 * x[0] - 2;
-	grad.coeffRef (1) = -200 * x[0] * x[0] + 200 * x[1];
+	g (1) = -200 * x[0] * x[0] + 200 * x[1];
       }
 
       template <typename T>
@@ -78,11 +84,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G : public GenericDifferentiableFunction<T>
+      class G : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G ();
 	void
@@ -90,11 +96,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G<T>::G ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (2, 1, "x₀ + x₁²")
       {}
 
@@ -112,8 +121,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = 1.;
-	grad.coeffRef (1) = 2 * x[1];
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = 1.;
+	g (1) = 2 * x[1];
       }
 
       template <typename T>
@@ -127,11 +138,11 @@ namespace roboptim
 
 
       template <typename T>
-      class G2 : public GenericDifferentiableFunction<T>
+      class G2 : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G2 ();
 	void
@@ -139,11 +150,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G2<T>::G2 ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (2, 1, "x₀² + x₁")
       {}
 
@@ -161,8 +175,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = 2 * x[0];
-	grad.coeffRef (1) = 1.;
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = 2 * x[0];
+	g (1) = 1.;
       }
 
       template <typename T>
@@ -173,73 +189,129 @@ namespace roboptim
 	grad[0] = 2 * x[0];
 	grad[1] = 1.;
       }
-    } // end of namespace problem16.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
-
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-BOOST_AUTO_TEST_CASE (schittkowski_problem16)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem16;
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref x, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = 1200 * x[0] * x[0] - 400 * x[1] + 2;
+	h (0, 1) = -400 * x[0];
+	h (1, 0) = -400 * x[0];
+	h (1, 1) = 200.;
+      }
 
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = 1200 * x[0] * x[0] - 400 * x[1] + 2;
+	h (0, 1) = -400 * x[0];
+	h (1, 0) = -400 * x[0];
+	h (1, 1) = 200.;
+      }
 
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 909.;
-  expectedResult.x = (ExpectedResult::argument_t (2) << 0.5, 0.25).finished ();
-  expectedResult.fx = .25;
+      template <>
+      void
+      G<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{1, 1}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (1, 1) = 2.;
+      }
 
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
+      template <typename T>
+      void
+      G<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (1, 1) = 2.;
+      }
 
-  problem.argumentBounds ()[0] = F<functionType_t>::makeInterval (-2., 0.5);
-  problem.argumentBounds ()[1] = F<functionType_t>::makeUpperInterval (1.);
+      template <>
+      void
+      G2<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = 2.;
+      }
 
-  boost::shared_ptr<G<functionType_t> > g =
-    boost::make_shared<G<functionType_t> > ();
-  problem.addConstraint (g, G<functionType_t>::makeLowerInterval (0.));
-  boost::shared_ptr<G2<functionType_t> > g2 =
-    boost::make_shared<G2<functionType_t> > ();
-  problem.addConstraint (g2, G2<functionType_t>::makeLowerInterval (0.));
+      template <typename T>
+      void
+      G2<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = 2.;
+      }
 
-  F<functionType_t>::argument_t x (2);
-  x << -2, 1;
-  problem.startingPoint () = x;
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	problem.argumentBounds ()[0] = F<T>::makeInterval (-2., 0.5);
+	problem.argumentBounds ()[1] = F<T>::makeUpperInterval (1.);
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-16");
+	boost::shared_ptr<G<T> > g =
+	  boost::make_shared<Instrumented<G<T> > > ();
+	problem.addConstraint (g, G<T>::makeLowerInterval (0.));
+	boost::shared_ptr<G2<T> > g2 =
+	  boost::make_shared<Instrumented<G2<T> > > ();
+	problem.addConstraint (g2, G2<T>::makeLowerInterval (0.));
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+	typename F<T>::argument_t x (2);
+	x << -2, 1;
+	problem.startingPoint () = x;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	return pb;
+      }
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem16";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-16";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = 909.;
+	problem.expected.x = (ExpectedResult::argument_t (2) << 0.5, 0.25).finished ();
+	problem.expected.fx = .25;
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem16.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem16)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem16::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,11 +25,11 @@ namespace roboptim
     namespace problem2
     {
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -36,11 +37,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (2, 1, "100 (x₁ - x₀²)² + (1 - x₀)²")
       {}
 
@@ -59,9 +63,11 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) =
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) =
 	  -400 * x[0] * (x[1] - std::pow (x[0], 2)) - 2 * (1 - x[0]);
-	grad.coeffRef (1) = 200 * (x[1] - std::pow (x[0], 2));
+	g (1) = 200 * (x[1] - std::pow (x[0], 2));
       }
 
       template <typename T>
@@ -72,70 +78,88 @@ namespace roboptim
 	grad[0] = -400 * x[0] * (x[1] - std::pow (x[0], 2)) - 2 * (1 - x[0]);
 	grad[1] = 200 * (x[1] - std::pow (x[0], 2));
       }
-    } // end of namespace problem2.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
 
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
-
-BOOST_AUTO_TEST_CASE (schittkowski_problem2)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem2;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-6;
-  double x_tol = 1e-5;
-  double f_tol = 1e-4;
-
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 909.;
-  // a = (598/1200)^{1/2}
-  // b = 400 * a^3
-  // x[] = (2 * a * cos (1/3 * arccos(1/b)), 1.5)
-  expectedResult.x = (ExpectedResult::argument_t (2)
-                      << 1.224370748736354, 1.5).finished ();
-  expectedResult.fx = 0.0504261879;
-
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
-
-  // In problem2, this bound changes.
-  problem.argumentBounds ()[1] = F<functionType_t>::makeLowerInterval (1.5);
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref x, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = 1200 * x[0] * x[0] - 400 * x[1] + 2;
+	h (0, 1) = -400 * x[0];
+	h (1, 0) = -400 * x[0];
+	h (1, 1) = 200.;
+      }
 
-  F<functionType_t>::argument_t x (2);
-  x << -2., 1.;
-  problem.startingPoint () = x;
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = 1200 * x[0] * x[0] - 400 * x[1] + 2;
+	h (0, 1) = -400 * x[0];
+	h (1, 0) = -400 * x[0];
+	h (1, 1) = 200.;
+      }
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-2");
+	// In problem2, this bound changes.
+	problem.argumentBounds ()[1] = F<T>::makeLowerInterval (1.5);
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+	typename F<T>::argument_t x (2);
+	x << -2., 1.;
+	problem.startingPoint () = x;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	return pb;
+      }
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem2";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-2";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-6;
+	problem.tolerances.x = 1e-5;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = 909.;
+	// a = (598/1200)^{1/2}
+	// b = 400 * a^3
+	// x[] = (2 * a * cos (1/3 * arccos(1/b)), 1.5)
+	problem.expected.x = (ExpectedResult::argument_t (2)
+			      << 1.224370748736354, 1.5).finished ();
+	problem.expected.fx = 0.0504261879;
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem2.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem2)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem2::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
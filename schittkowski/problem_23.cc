@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,11 +25,11 @@ namespace roboptim
     namespace problem23
     {
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -36,11 +37,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (2, 1, "x₀² + x₁²")
       {}
 
@@ -58,8 +62,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = 2. * x[0];
-	grad.coeffRef (1) = 2. * x[1];
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = 2. * x[0];
+	g (1) = 2. * x[1];
       }
 
       template <typename T>
@@ -72,11 +78,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G : public GenericDifferentiableFunction<T>
+      class G : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G ();
 	void
@@ -84,11 +90,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G<T>::G ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (2, 1, "x₀ + x₁ - 1")
       {}
 
@@ -106,8 +115,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref, size_type)
 	const
       {
-	grad.coeffRef (0) = 1;
-	grad.coeffRef (1) = 1;
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = 1;
+	g (1) = 1;
       }
 
       template <typename T>
@@ -121,11 +132,11 @@ namespace roboptim
 
 
       template <typename T>
-      class G2 : public GenericDifferentiableFunction<T>
+      class G2 : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G2 ();
 	void
@@ -133,11 +144,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G2<T>::G2 ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (2, 1, "x₀² + x₁² - 1")
       {}
 
@@ -155,8 +169,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = 2. * x[0];
-	grad.coeffRef (1) = 2. * x[1];
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = 2. * x[0];
+	g (1) = 2. * x[1];
       }
 
       template <typename T>
@@ -170,11 +186,11 @@ namespace roboptim
 
 
       template <typename T>
-      class G3 : public GenericDifferentiableFunction<T>
+      class G3 : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G3 ();
 	void
@@ -182,11 +198,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G3<T>::G3 ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (2, 1, "9x₀² + x₁² - 9")
       {}
 
@@ -204,8 +223,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = 9. * 2. * x[0];
-	grad.coeffRef (1) = 2. * x[1];
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = 9. * 2. * x[0];
+	g (1) = 2. * x[1];
       }
 
       template <typename T>
@@ -218,11 +239,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G4 : public GenericDifferentiableFunction<T>
+      class G4 : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G4 ();
 	void
@@ -230,11 +251,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G4<T>::G4 ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (2, 1, "x₀² - x₁")
       {}
 
@@ -252,8 +276,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = 2. * x[0];
-	grad.coeffRef (1) = -1.;
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = 2. * x[0];
+	g (1) = -1.;
       }
 
       template <typename T>
@@ -266,11 +292,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G5 : public GenericDifferentiableFunction<T>
+      class G5 : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G5 ();
 	void
@@ -278,11 +304,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G5<T>::G5 ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (2, 1, "x₁² - x₀")
       {}
 
@@ -300,8 +329,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = -1.;
-	grad.coeffRef (1) = 2. * x[1];
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = -1.;
+	g (1) = 2. * x[1];
       }
 
       template <typename T>
@@ -313,6 +344,174 @@ namespace roboptim
 	grad[1] = 2. * x[1];
       }
 
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {1, 1}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = 2.;
+	h (1, 1) = 2.;
+      }
+
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = 2.;
+	h (1, 1) = 2.;
+      }
+
+      template <typename T>
+      void
+      G<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+      }
+
+      template <>
+      void
+      G2<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {1, 1}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = 2.;
+	h (1, 1) = 2.;
+      }
+
+      template <typename T>
+      void
+      G2<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = 2.;
+	h (1, 1) = 2.;
+      }
+
+      template <>
+      void
+      G3<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {1, 1}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = 18.;
+	h (1, 1) = 2.;
+      }
+
+      template <typename T>
+      void
+      G3<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = 18.;
+	h (1, 1) = 2.;
+      }
+
+      template <>
+      void
+      G4<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = 2.;
+      }
+
+      template <typename T>
+      void
+      G4<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = 2.;
+      }
+
+      template <>
+      void
+      G5<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{1, 1}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (1, 1) = 2.;
+      }
+
+      template <typename T>
+      void
+      G5<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (1, 1) = 2.;
+      }
+
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
+
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
+
+	problem.argumentBounds ()[0] = F<T>::makeInterval (-50., 50.);
+	problem.argumentBounds ()[1] = F<T>::makeInterval (-50., 50.);
+
+	boost::shared_ptr<G<T> > g =
+	  boost::make_shared<Instrumented<G<T> > > ();
+	problem.addConstraint (g, G<T>::makeLowerInterval (0.));
+	boost::shared_ptr<G2<T> > g2 =
+	  boost::make_shared<Instrumented<G2<T> > > ();
+	problem.addConstraint (g2, G2<T>::makeLowerInterval (0.));
+	boost::shared_ptr<G3<T> > g3 =
+	  boost::make_shared<Instrumented<G3<T> > > ();
+	problem.addConstraint (g3, G3<T>::makeLowerInterval (0.));
+	boost::shared_ptr<G4<T> > g4 =
+	  boost::make_shared<Instrumented<G4<T> > > ();
+	problem.addConstraint (g4, G<T>::makeLowerInterval (0.));
+	boost::shared_ptr<G5<T> > g5 =
+	  boost::make_shared<Instrumented<G5<T> > > ();
+	problem.addConstraint (g5, G5<T>::makeLowerInterval (0.));
+
+	typename F<T>::argument_t x (2);
+	x << 3, 1;
+	problem.startingPoint () = x;
+
+	return pb;
+      }
+
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem23";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-23";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = 10.;
+	problem.expected.x = (ExpectedResult::argument_t (2) << 1., 1.).finished ();
+	problem.expected.fx = 2.;
+	return problem;
+      }
+
+      static ProblemRegistrar registrar (descriptor ());
     } // end of namespace problem23.
   } // end of namespace schittkowski.
 } // end of namespace roboptim.
@@ -321,74 +520,7 @@ BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
 BOOST_AUTO_TEST_CASE (schittkowski_problem23)
 {
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem23;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
-
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 10.;
-  expectedResult.x = (ExpectedResult::argument_t (2) << 1., 1.).finished ();
-  expectedResult.fx = 2.;
-
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
-
-  problem.argumentBounds ()[0] = F<functionType_t>::makeInterval (-50., 50.);
-  problem.argumentBounds ()[1] = F<functionType_t>::makeInterval (-50., 50.);
-
-  boost::shared_ptr<G<functionType_t> > g =
-    boost::make_shared<G<functionType_t> > ();
-  problem.addConstraint (g, G<functionType_t>::makeLowerInterval (0.));
-  boost::shared_ptr<G2<functionType_t> > g2 =
-    boost::make_shared<G2<functionType_t> > ();
-  problem.addConstraint (g2, G2<functionType_t>::makeLowerInterval (0.));
-  boost::shared_ptr<G3<functionType_t> > g3 =
-    boost::make_shared<G3<functionType_t> > ();
-  problem.addConstraint (g3, G3<functionType_t>::makeLowerInterval (0.));
-  boost::shared_ptr<G4<functionType_t> > g4 =
-    boost::make_shared<G4<functionType_t> > ();
-  problem.addConstraint (g4, G<functionType_t>::makeLowerInterval (0.));
-  boost::shared_ptr<G5<functionType_t> > g5 =
-    boost::make_shared<G5<functionType_t> > ();
-  problem.addConstraint (g5, G5<functionType_t>::makeLowerInterval (0.));
-
-  F<functionType_t>::argument_t x (2);
-  x << 3, 1;
-  problem.startingPoint () = x;
-
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
-
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
-
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-23");
-
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
-
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
-
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
-
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
-
-  // Display solver information.
-  std::cout << solver << std::endl;
-
-  // Process the result
-  PROCESS_RESULT();
+  roboptim::solveProblem (roboptim::schittkowski::problem23::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,11 +25,11 @@ namespace roboptim
     namespace problem25
     {
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -36,11 +37,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (3, 1, "Σ f_i(x)²")
       {}
 
@@ -59,39 +63,74 @@ namespace roboptim
 	  }
       }
 
+      typedef Eigen::Matrix<double, 3, 1> vector3_t;
+      typedef Eigen::Matrix<double, 3, 3> matrix3_t;
+
+      /// \brief i-th residual f = e - 0.01 i of the cost, with e = exp (q)
+      /// and q = -(u - x₁)^x₂ / x₀, and the derivatives of q.
+      template <typename A>
+      double residual (const A& x, int i, double& e,
+		       vector3_t& dq, matrix3_t& d2q)
+      {
+	double u = 25 + std::pow (-50. * std::log (0.01 * i), 2. / 3.);
+	double a = u - x[1];
+	double l = std::log (a);
+	double p = std::pow (a, x[2]);
+
+	e = std::exp (-p / x[0]);
+
+	dq[0] = p / (x[0] * x[0]);
+	dq[1] = x[2] * p / (x[0] * a);
+	dq[2] = -p * l / x[0];
+
+	d2q (0, 0) = -2 * p / (x[0] * x[0] * x[0]);
+	d2q (0, 1) = -x[2] * p / (x[0] * x[0] * a);
+	d2q (0, 2) = p * l / (x[0] * x[0]);
+	d2q (1, 1) = x[2] * (1 - x[2]) * p / (x[0] * a * a);
+	d2q (1, 2) = p * (1 + x[2] * l) / (x[0] * a);
+	d2q (2, 2) = -p * l * l / x[0];
+	d2q (1, 0) = d2q (0, 1);
+	d2q (2, 0) = d2q (0, 2);
+	d2q (2, 1) = d2q (1, 2);
+
+	return e - 0.01 * i;
+      }
+
+      /// \brief Gradient and Hessian of the cost Σ f_i².
+      template <typename A>
+      void costDerivatives (const A& x, vector3_t& grad, matrix3_t* hess)
+      {
+	vector3_t dq;
+	matrix3_t d2q;
+	double e;
+
+	grad.setZero ();
+	if (hess)
+	  hess->setZero ();
+
+	for (int i = 1; i < 100; ++i)
+	  {
+	    double f = residual (x, i, e, dq, d2q);
+	    grad += 2 * f * e * dq;
+	    if (hess)
+	      *hess += 2 * e * ((e + f) * dq * dq.transpose () + f * d2q);
+	  }
+      }
+
       template <>
       void
       F<EigenMatrixSparse>::impl_gradient
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	value_type dx0 = 0.;
-	value_type dx1 = 0.;
-	value_type dx2 = 0.;
-	for (int i = 1; i < 100; ++i)
-	  {
-	    value_type u = 25 + std::pow (-50. * std::log (0.01 * i), 2. / 3.);
-	    dx0 +=
-	      1. / (x[0] * x[0])
-	      * std::pow (u - x[1], x[2])
-	      * std::exp (-1. / x[0] * std::pow (u - x[1], x[2]));
-
-
-	    dx1 +=
-	      1. / (x[0] * (u - x[1]))
-	      * x[2] * std::pow (u - x[1], x[2])
-	      * std::exp (-1. / x[0] * std::pow (u - x[1], x[2]));
-	    dx2 +=
-	      -1. / x[0]
-	      * std::pow (u - x[1], x[2])
-	      * std::exp (-1. / x[0] * std::pow (u - x[1], x[2]))
-	      * std::log (u - x[1]);
-	  }
-
-
-	grad.coeffRef (0) = dx0;
-	grad.coeffRef (1) = dx1;
-	grad.coeffRef (2) = dx2;
+	vector3_t d;
+	costDerivatives (x, d, 0);
+
+	static const int pattern[] = {0, 1, 2};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = d[0];
+	g (1) = d[1];
+	g (2) = d[2];
       }
 
       template <typename T>
@@ -99,93 +138,92 @@ namespace roboptim
       F<T>::impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	value_type dx0 = 0.;
-	value_type dx1 = 0.;
-	value_type dx2 = 0.;
-	for (int i = 1; i < 100; ++i)
-	  {
-	    value_type u = 25 + std::pow (-50. * std::log (0.01 * i), 2. / 3.);
-	    dx0 +=
-	      1. / (x[0] * x[0])
-	      * std::pow (u - x[1], x[2])
-	      * std::exp (-1. / x[0] * std::pow (u - x[1], x[2]));
-
-
-	    dx1 +=
-	      1. / (x[0] * (u - x[1]))
-	      * x[2] * std::pow (u - x[1], x[2])
-	      * std::exp (-1. / x[0] * std::pow (u - x[1], x[2]));
-	    dx2 +=
-	      -1. / x[0]
-	      * std::pow (u - x[1], x[2])
-	      * std::exp (-1. / x[0] * std::pow (u - x[1], x[2]))
-	      * std::log (u - x[1]);
-	  }
-	grad[0] = dx0;
-	grad[1] = dx1;
-  	grad[2] = dx2;
+	vector3_t d;
+	costDerivatives (x, d, 0);
+	grad = d;
       }
-    } // end of namespace problem25.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
 
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
-
-BOOST_AUTO_TEST_CASE (schittkowski_problem25)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem25;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
-
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 32.835;
-  expectedResult.x = (ExpectedResult::argument_t (3) << 50., 25., 1.5).finished ();
-  expectedResult.fx = 0.;
-
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
-
-  problem.argumentBounds ()[0] = F<functionType_t>::makeInterval (0.1, 100.);
-  problem.argumentBounds ()[1] = F<functionType_t>::makeInterval (0., 25.6);
-  problem.argumentBounds ()[2] = F<functionType_t>::makeInterval (0., 5.);
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref x, size_type) const
+      {
+	vector3_t d;
+	matrix3_t d2;
+	costDerivatives (x, d, &d2);
+
+	static const int pattern[][2] = {{0, 0}, {0, 1}, {0, 2}, {1, 0},
+	  {1, 1}, {1, 2}, {2, 0}, {2, 1}, {2, 2}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	for (int i = 0; i < 3; ++i)
+	  for (int j = 0; j < 3; ++j)
+	    h (i, j) = d2 (i, j);
+      }
 
-  F<functionType_t>::argument_t x (3);
-  x << 100, 12.5, 3;
-  problem.startingPoint () = x;
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	const
+      {
+	vector3_t d;
+	matrix3_t d2;
+	costDerivatives (x, d, &d2);
+	h = d2;
+      }
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-25");
+	problem.argumentBounds ()[0] = F<T>::makeInterval (0.1, 100.);
+	problem.argumentBounds ()[1] = F<T>::makeInterval (0., 25.6);
+	problem.argumentBounds ()[2] = F<T>::makeInterval (0., 5.);
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+	typename F<T>::argument_t x (3);
+	x << 100, 12.5, 3;
+	problem.startingPoint () = x;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	return pb;
+      }
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem25";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-25";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = 32.835;
+	problem.expected.x = (ExpectedResult::argument_t (3) << 50., 25., 1.5).finished ();
+	problem.expected.fx = 0.;
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem25.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem25)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem25::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
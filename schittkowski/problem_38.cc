@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,11 +25,11 @@ namespace roboptim
     namespace problem38
     {
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -36,11 +37,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (4, 1,
 	   "100 (x₁ - x₀²)² + (1 - x₀)² + 90 (x₃ - x₂²)² + (1 - x₂)²"
 	   " + 10.1 ((x₁ - 1)² + (x₃ - 1)²) + 19.8 (x₁ - 1) (x₃ - 1)")
@@ -66,13 +70,15 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) =
+	static const int pattern[] = {0, 1, 2, 3};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) =
 	  400. * std::pow (x[0], 3) - 400. * x[0] * x[1] + 2. * x[0] - 2.;
-	grad.coeffRef (1) =
+	g (1) =
 	  -200. * std::pow (x[0], 2)  + 220.2 * x[1] + 19.8 * x[3] - 40.;
-	grad.coeffRef (2) =
+	g (2) =
 	  360. * std::pow (x[2], 3)  - 360. * x[2] * x[3] + 2. * x[2] - 2.;
-	grad.coeffRef (3) =
+	g (3) =
 	  19.8 * x[1] - 180. * std::pow (x[2], 2)  + 200.2 * x[3] - 40.;
       }
 
@@ -90,66 +96,97 @@ namespace roboptim
 	grad[3] =
 	  19.8 * x[1] - 180. * std::pow (x[2], 2)  + 200.2 * x[3] - 40.;
       }
-    } // end of namespace problem38.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
 
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
-
-BOOST_AUTO_TEST_CASE (schittkowski_problem38)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem38;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
-
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 19192;
-  expectedResult.x = (ExpectedResult::argument_t (4) << 1., 1., 1., 1.).finished ();
-  expectedResult.fx = 0.;
-
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
-
-  for (std::size_t i = 0; i < 4; ++i)
-    problem.argumentBounds ()[i] = F<functionType_t>::makeInterval (-10., 10.);
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref x, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {0, 1}, {1, 0}, {1, 1},
+	  {1, 3}, {2, 2}, {2, 3}, {3, 1}, {3, 2}, {3, 3}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = 1200 * x[0] * x[0] - 400 * x[1] + 2;
+	h (0, 1) = -400 * x[0];
+	h (1, 0) = -400 * x[0];
+	h (1, 1) = 220.2;
+	h (1, 3) = 19.8;
+	h (2, 2) = 1080 * x[2] * x[2] - 360 * x[3] + 2;
+	h (2, 3) = -360 * x[2];
+	h (3, 1) = 19.8;
+	h (3, 2) = -360 * x[2];
+	h (3, 3) = 200.2;
+      }
 
-  F<functionType_t>::argument_t x (4);
-  x << -3., -1., -3., -1.;
-  problem.startingPoint () = x;
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = 1200 * x[0] * x[0] - 400 * x[1] + 2;
+	h (0, 1) = -400 * x[0];
+	h (1, 0) = -400 * x[0];
+	h (1, 1) = 220.2;
+	h (1, 3) = 19.8;
+	h (2, 2) = 1080 * x[2] * x[2] - 360 * x[3] + 2;
+	h (2, 3) = -360 * x[2];
+	h (3, 1) = 19.8;
+	h (3, 2) = -360 * x[2];
+	h (3, 3) = 200.2;
+      }
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-38");
+	for (std::size_t i = 0; i < 4; ++i)
+	  problem.argumentBounds ()[i] = F<T>::makeInterval (-10., 10.);
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+	typename F<T>::argument_t x (4);
+	x << -3., -1., -3., -1.;
+	problem.startingPoint () = x;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	return pb;
+      }
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem38";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-38";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = 19192;
+	problem.expected.x = (ExpectedResult::argument_t (4) << 1., 1., 1., 1.).finished ();
+	problem.expected.fx = 0.;
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem38.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem38)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem38::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
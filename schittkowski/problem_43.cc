@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,11 +25,11 @@ namespace roboptim
     namespace problem43
     {
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -36,11 +37,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (4, 1,
 	   "x₀² + x₁² + 2x₂² + x₃² - 5x₀ - 5x₁ - 21x₂ + 7x₃")
       {}
@@ -67,10 +71,12 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = 2. * x[0] - 5.;
-	grad.coeffRef (1) = 2. * x[1] - 5.;
-	grad.coeffRef (2) = 4. * x[2] - 21.;
-	grad.coeffRef (3) = 2. * x[3] + 7.;
+	static const int pattern[] = {0, 1, 2, 3};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = 2. * x[0] - 5.;
+	g (1) = 2. * x[1] - 5.;
+	g (2) = 4. * x[2] - 21.;
+	g (3) = 2. * x[3] + 7.;
       }
 
       template <typename T>
@@ -85,11 +91,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G : public GenericDifferentiableFunction<T>
+      class G : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G ();
 	void
@@ -97,11 +103,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G<T>::G ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (4, 1,
 	   "8 - x₀² - x₁² - x₂² - x₃² - x₀ + x₁ - x₂ + x₃")
       {}
@@ -129,10 +138,12 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = -2. * x[0] - 1.;
-	grad.coeffRef (1) = -2. * x[1] + 1.;
-	grad.coeffRef (2) = -2. * x[2] - 1.;
-	grad.coeffRef (3) = -2. * x[3] + 1.;
+	static const int pattern[] = {0, 1, 2, 3};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = -2. * x[0] - 1.;
+	g (1) = -2. * x[1] + 1.;
+	g (2) = -2. * x[2] - 1.;
+	g (3) = -2. * x[3] + 1.;
       }
 
       template <typename T>
@@ -147,11 +158,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G2 : public GenericDifferentiableFunction<T>
+      class G2 : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G2 ();
 	void
@@ -159,11 +170,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G2<T>::G2 ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (4, 1,
 	   "10 - x₀² - 2x₁² - x₂² - 2x₃² + x₀ + x₃")
       {}
@@ -189,10 +203,12 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = -2. * x[0] + 1.;
-	grad.coeffRef (1) = -2. * 2. * x[1];
-	grad.coeffRef (2) = -2. * x[2];
-	grad.coeffRef (3) = -2. * 2. * x[3] + 1.;
+	static const int pattern[] = {0, 1, 2, 3};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = -2. * x[0] + 1.;
+	g (1) = -2. * 2. * x[1];
+	g (2) = -2. * x[2];
+	g (3) = -2. * 2. * x[3] + 1.;
       }
 
       template <typename T>
@@ -207,11 +223,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G3 : public GenericDifferentiableFunction<T>
+      class G3 : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G3 ();
 	void
@@ -219,11 +235,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G3<T>::G3 ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (4, 1,
 	   "5 - 2x₀² - x₁² - x₂² - 2x₀ + x₁ + x₃")
       {}
@@ -249,10 +268,12 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = -4. * x[0] - 2.;
-	grad.coeffRef (1) = -2. * x[1] + 1.;
-	grad.coeffRef (2) = -2. * x[2];
-	grad.coeffRef (3) = 1.;
+	static const int pattern[] = {0, 1, 2, 3};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = -4. * x[0] - 2.;
+	g (1) = -2. * x[1] + 1.;
+	g (2) = -2. * x[2];
+	g (3) = 1.;
       }
 
       template <typename T>
@@ -266,74 +287,164 @@ namespace roboptim
 	grad[3] = 1.;
       }
 
-    } // end of namespace problem43.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
-
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
-
-BOOST_AUTO_TEST_CASE (schittkowski_problem43)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem43;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
-
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 0.;
-  expectedResult.x = (ExpectedResult::argument_t (4) << 0., 1., 2., -1.).finished ();
-  expectedResult.fx = -44.;
-
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {1, 1}, {2, 2}, {3, 3}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = 2.;
+	h (1, 1) = 2.;
+	h (2, 2) = 4.;
+	h (3, 3) = 2.;
+      }
 
-  boost::shared_ptr<G<functionType_t> > g =
-    boost::make_shared<G<functionType_t> > ();
-  problem.addConstraint (g, G<functionType_t>::makeLowerInterval (0.));
-  boost::shared_ptr<G2<functionType_t> > g2 =
-    boost::make_shared<G2<functionType_t> > ();
-  problem.addConstraint (g2, G2<functionType_t>::makeLowerInterval (0.));
-  boost::shared_ptr<G3<functionType_t> > g3 =
-    boost::make_shared<G3<functionType_t> > ();
-  problem.addConstraint (g3, G3<functionType_t>::makeLowerInterval (0.));
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = 2.;
+	h (1, 1) = 2.;
+	h (2, 2) = 4.;
+	h (3, 3) = 2.;
+      }
 
+      template <>
+      void
+      G<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {1, 1}, {2, 2}, {3, 3}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = -2.;
+	h (1, 1) = -2.;
+	h (2, 2) = -2.;
+	h (3, 3) = -2.;
+      }
 
-  F<functionType_t>::argument_t x (4);
-  x << 0., 0., 0., 0.;
-  problem.startingPoint () = x;
+      template <typename T>
+      void
+      G<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = -2.;
+	h (1, 1) = -2.;
+	h (2, 2) = -2.;
+	h (3, 3) = -2.;
+      }
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+      template <>
+      void
+      G2<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {1, 1}, {2, 2}, {3, 3}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = -2.;
+	h (1, 1) = -4.;
+	h (2, 2) = -2.;
+	h (3, 3) = -4.;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      template <typename T>
+      void
+      G2<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = -2.;
+	h (1, 1) = -4.;
+	h (2, 2) = -2.;
+	h (3, 3) = -4.;
+      }
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-43");
+      template <>
+      void
+      G3<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {1, 1}, {2, 2}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = -4.;
+	h (1, 1) = -2.;
+	h (2, 2) = -2.;
+      }
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+      template <typename T>
+      void
+      G3<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = -4.;
+	h (1, 1) = -2.;
+	h (2, 2) = -2.;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
+
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
+
+	boost::shared_ptr<G<T> > g =
+	  boost::make_shared<Instrumented<G<T> > > ();
+	problem.addConstraint (g, G<T>::makeLowerInterval (0.));
+	boost::shared_ptr<G2<T> > g2 =
+	  boost::make_shared<Instrumented<G2<T> > > ();
+	problem.addConstraint (g2, G2<T>::makeLowerInterval (0.));
+	boost::shared_ptr<G3<T> > g3 =
+	  boost::make_shared<Instrumented<G3<T> > > ();
+	problem.addConstraint (g3, G3<T>::makeLowerInterval (0.));
+
+
+	typename F<T>::argument_t x (4);
+	x << 0., 0., 0., 0.;
+	problem.startingPoint () = x;
+
+	return pb;
+      }
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem43";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-43";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = 0.;
+	problem.expected.x = (ExpectedResult::argument_t (4) << 0., 1., 2., -1.).finished ();
+	problem.expected.fx = -44.;
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem43.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem43)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem43::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,11 +25,11 @@ namespace roboptim
     namespace problem44
     {
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -36,11 +37,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (4, 1,
 	   "x₀ - x₁ - x₂ - x₀x₂ + x₀x₃ + x₁x₂ - x₁x₃")
       {}
@@ -64,10 +68,12 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = -x[2] + x[3] + 1.;
-	grad.coeffRef (1) = x[2] - x[3] - 1.;
-	grad.coeffRef (2) = -x[0] + x[1] - 1.;
-	grad.coeffRef (3) = x[0] - x[1];
+	static const int pattern[] = {0, 1, 2, 3};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = -x[2] + x[3] + 1.;
+	g (1) = x[2] - x[3] - 1.;
+	g (2) = -x[0] + x[1] - 1.;
+	g (3) = x[0] - x[1];
       }
 
       template <typename T>
@@ -82,11 +88,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G : public GenericDifferentiableFunction<T>
+      class G : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G ();
 	void
@@ -94,11 +100,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G<T>::G ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (4, 1, "8 - x₀ - 2x₁")
       {}
 
@@ -116,10 +125,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref, size_type)
 	const
       {
-	grad.coeffRef (0) = -1.;
-	grad.coeffRef (1) = -2.;
-	grad.coeffRef (2) = 0.;
-	grad.coeffRef (3) = 0.;
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = -1.;
+	g (1) = -2.;
       }
 
       template <typename T>
@@ -134,11 +143,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G2 : public GenericDifferentiableFunction<T>
+      class G2 : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G2 ();
 	void
@@ -146,11 +155,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G2<T>::G2 ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (4, 1, "12 - 4x₀ - x₁")
       {}
 
@@ -168,10 +180,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref, size_type)
 	const
       {
-	grad.coeffRef (0) = -4.;
-	grad.coeffRef (1) = -1.;
-	grad.coeffRef (2) = 0.;
-	grad.coeffRef (3) = 0.;
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = -4.;
+	g (1) = -1.;
       }
 
       template <typename T>
@@ -186,11 +198,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G3 : public GenericDifferentiableFunction<T>
+      class G3 : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G3 ();
 	void
@@ -198,11 +210,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G3<T>::G3 ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (4, 1, "12 - 3x₀ - 4x₁")
       {}
 
@@ -220,10 +235,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref, size_type)
 	const
       {
-	grad.coeffRef (0) = -3.;
-	grad.coeffRef (1) = -4.;
-	grad.coeffRef (2) = 0.;
-	grad.coeffRef (3) = 0.;
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = -3.;
+	g (1) = -4.;
       }
 
       template <typename T>
@@ -238,11 +253,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G4 : public GenericDifferentiableFunction<T>
+      class G4 : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G4 ();
 	void
@@ -250,11 +265,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G4<T>::G4 ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (4, 1, "8 - 2x₂ - x₃")
       {}
 
@@ -272,10 +290,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref, size_type)
 	const
       {
-	grad.coeffRef (0) = 0.;
-	grad.coeffRef (1) = 0.;
-	grad.coeffRef (2) = -2.;
-	grad.coeffRef (3) = -1.;
+	static const int pattern[] = {2, 3};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (2) = -2.;
+	g (3) = -1.;
       }
 
       template <typename T>
@@ -290,11 +308,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G5 : public GenericDifferentiableFunction<T>
+      class G5 : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G5 ();
 	void
@@ -302,11 +320,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G5<T>::G5 ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (4, 1, "8 - x₂ - 2x₃")
       {}
 
@@ -324,10 +345,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref, size_type)
 	const
       {
-	grad.coeffRef (0) = 0.;
-	grad.coeffRef (1) = 0.;
-	grad.coeffRef (2) = -1.;
-	grad.coeffRef (3) = -2.;
+	static const int pattern[] = {2, 3};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (2) = -1.;
+	g (3) = -2.;
       }
 
       template <typename T>
@@ -342,11 +363,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G6 : public GenericDifferentiableFunction<T>
+      class G6 : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G6 ();
 	void
@@ -354,11 +375,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G6<T>::G6 ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (4, 1, "5 - x₂ - x₃")
       {}
 
@@ -376,10 +400,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref, size_type)
 	const
       {
-	grad.coeffRef (0) = 0.;
-	grad.coeffRef (1) = 0.;
-	grad.coeffRef (2) = -1.;
-	grad.coeffRef (3) = -1.;
+	static const int pattern[] = {2, 3};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (2) = -1.;
+	g (3) = -1.;
       }
 
       template <typename T>
@@ -393,6 +417,147 @@ namespace roboptim
 	grad[3] = -1.;
       }
 
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{0, 2}, {0, 3}, {1, 2}, {1, 3},
+	  {2, 0}, {2, 1}, {3, 0}, {3, 1}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 2) = -1.;
+	h (0, 3) = 1.;
+	h (1, 2) = 1.;
+	h (1, 3) = -1.;
+	h (2, 0) = -1.;
+	h (2, 1) = 1.;
+	h (3, 0) = 1.;
+	h (3, 1) = -1.;
+      }
+
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 2) = -1.;
+	h (0, 3) = 1.;
+	h (1, 2) = 1.;
+	h (1, 3) = -1.;
+	h (2, 0) = -1.;
+	h (2, 1) = 1.;
+	h (3, 0) = 1.;
+	h (3, 1) = -1.;
+      }
+
+      template <typename T>
+      void
+      G<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+      }
+
+      template <typename T>
+      void
+      G2<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+      }
+
+      template <typename T>
+      void
+      G3<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+      }
+
+      template <typename T>
+      void
+      G4<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+      }
+
+      template <typename T>
+      void
+      G5<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+      }
+
+      template <typename T>
+      void
+      G6<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+      }
+
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
+
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
+
+	for (std::size_t i = 0; i < 4; ++i)
+	  problem.argumentBounds ()[i] = F<T>::makeLowerInterval (0.);
+
+	boost::shared_ptr<G<T> > g =
+	  boost::make_shared<Instrumented<G<T> > > ();
+	problem.addConstraint (g, G<T>::makeLowerInterval (0.));
+	boost::shared_ptr<G2<T> > g2 =
+	  boost::make_shared<Instrumented<G2<T> > > ();
+	problem.addConstraint (g2, G2<T>::makeLowerInterval (0.));
+	boost::shared_ptr<G3<T> > g3 =
+	  boost::make_shared<Instrumented<G3<T> > > ();
+	problem.addConstraint (g3, G3<T>::makeLowerInterval (0.));
+	boost::shared_ptr<G4<T> > g4 =
+	  boost::make_shared<Instrumented<G4<T> > > ();
+	problem.addConstraint (g4, G4<T>::makeLowerInterval (0.));
+	boost::shared_ptr<G5<T> > g5 =
+	  boost::make_shared<Instrumented<G5<T> > > ();
+	problem.addConstraint (g5, G5<T>::makeLowerInterval (0.));
+
+	typename F<T>::argument_t x (4);
+	x << 0., 0., 0., 0.;
+	problem.startingPoint () = x;
+
+	return pb;
+      }
+
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem44";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-44";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = 0.;
+	problem.expected.x = (ExpectedResult::argument_t (4) << 0., 3., 0., 4.).finished ();
+	problem.expected.fx = -15.;
+	return problem;
+      }
+
+      static ProblemRegistrar registrar (descriptor ());
     } // end of namespace problem44.
   } // end of namespace schittkowski.
 } // end of namespace roboptim.
@@ -401,74 +566,7 @@ BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
 BOOST_AUTO_TEST_CASE (schittkowski_problem44)
 {
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem44;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
-
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 0.;
-  expectedResult.x = (ExpectedResult::argument_t (4) << 0., 3., 0., 4.).finished ();
-  expectedResult.fx = -15.;
-
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
-
-  for (std::size_t i = 0; i < 4; ++i)
-    problem.argumentBounds ()[i] = F<functionType_t>::makeLowerInterval (0.);
-
-  boost::shared_ptr<G<functionType_t> > g =
-    boost::make_shared<G<functionType_t> > ();
-  problem.addConstraint (g, G<functionType_t>::makeLowerInterval (0.));
-  boost::shared_ptr<G2<functionType_t> > g2 =
-    boost::make_shared<G2<functionType_t> > ();
-  problem.addConstraint (g2, G2<functionType_t>::makeLowerInterval (0.));
-  boost::shared_ptr<G3<functionType_t> > g3 =
-    boost::make_shared<G3<functionType_t> > ();
-  problem.addConstraint (g3, G3<functionType_t>::makeLowerInterval (0.));
-  boost::shared_ptr<G4<functionType_t> > g4 =
-    boost::make_shared<G4<functionType_t> > ();
-  problem.addConstraint (g4, G4<functionType_t>::makeLowerInterval (0.));
-  boost::shared_ptr<G5<functionType_t> > g5 =
-    boost::make_shared<G5<functionType_t> > ();
-  problem.addConstraint (g5, G5<functionType_t>::makeLowerInterval (0.));
-
-  F<functionType_t>::argument_t x (4);
-  x << 0., 0., 0., 0.;
-  problem.startingPoint () = x;
-
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
-
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
-
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-44");
-
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
-
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
-
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
-
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
-
-  // Display solver information.
-  std::cout << solver << std::endl;
-
-  // Process the result
-  PROCESS_RESULT();
+  roboptim::solveProblem (roboptim::schittkowski::problem44::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,11 +25,11 @@ namespace roboptim
     namespace problem45
     {
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -36,11 +37,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (5, 1, "2 - (1/120)x₀x₁x₂x₃x₄")
       {}
 
@@ -58,11 +62,13 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = -(1./120.)*x[1]*x[2]*x[3]*x[4];
-	grad.coeffRef (1) = -(1./120.)*x[0]*x[2]*x[3]*x[4];
-	grad.coeffRef (2) = -(1./120.)*x[0]*x[1]*x[3]*x[4];
-	grad.coeffRef (3) = -(1./120.)*x[0]*x[1]*x[2]*x[4];
-	grad.coeffRef (4) = -(1./120.)*x[0]*x[1]*x[2]*x[3];
+	static const int pattern[] = {0, 1, 2, 3, 4};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = -(1./120.)*x[1]*x[2]*x[3]*x[4];
+	g (1) = -(1./120.)*x[0]*x[2]*x[3]*x[4];
+	g (2) = -(1./120.)*x[0]*x[1]*x[3]*x[4];
+	g (3) = -(1./120.)*x[0]*x[1]*x[2]*x[4];
+	g (4) = -(1./120.)*x[0]*x[1]*x[2]*x[3];
       }
 
       template <typename T>
@@ -76,68 +82,120 @@ namespace roboptim
 	grad[3] = -(1./120.)*x[0]*x[1]*x[2]*x[4];
 	grad[4] = -(1./120.)*x[0]*x[1]*x[2]*x[3];
       }
-    } // end of namespace problem45.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
 
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
-
-BOOST_AUTO_TEST_CASE (schittkowski_problem45)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem45;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
-
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 26./15.;
-  expectedResult.x = (ExpectedResult::argument_t (5)
-                      << 1., 2., 3., 4., 5.).finished ();
-  expectedResult.fx = 1.;
-
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
-
-  for (F<functionType_t>::size_type i = 0; i < f->inputSize (); ++i)
-    problem.argumentBounds ()[static_cast<std::size_t> (i)]
-      = F<functionType_t>::makeInterval (0., 1. + static_cast<double> (i));
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref x, size_type) const
+      {
+	static const int pattern[][2] = {{0, 1}, {0, 2}, {0, 3}, {0, 4},
+	  {1, 0}, {1, 2}, {1, 3}, {1, 4}, {2, 0}, {2, 1}, {2, 3}, {2, 4},
+	  {3, 0}, {3, 1}, {3, 2}, {3, 4}, {4, 0}, {4, 1}, {4, 2}, {4, 3}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 1) = -x[2] * x[3] * x[4] / 120.;
+	h (0, 2) = -x[1] * x[3] * x[4] / 120.;
+	h (0, 3) = -x[1] * x[2] * x[4] / 120.;
+	h (0, 4) = -x[1] * x[2] * x[3] / 120.;
+	h (1, 0) = -x[2] * x[3] * x[4] / 120.;
+	h (1, 2) = -x[0] * x[3] * x[4] / 120.;
+	h (1, 3) = -x[0] * x[2] * x[4] / 120.;
+	h (1, 4) = -x[0] * x[2] * x[3] / 120.;
+	h (2, 0) = -x[1] * x[3] * x[4] / 120.;
+	h (2, 1) = -x[0] * x[3] * x[4] / 120.;
+	h (2, 3) = -x[0] * x[1] * x[4] / 120.;
+	h (2, 4) = -x[0] * x[1] * x[3] / 120.;
+	h (3, 0) = -x[1] * x[2] * x[4] / 120.;
+	h (3, 1) = -x[0] * x[2] * x[4] / 120.;
+	h (3, 2) = -x[0] * x[1] * x[4] / 120.;
+	h (3, 4) = -x[0] * x[1] * x[2] / 120.;
+	h (4, 0) = -x[1] * x[2] * x[3] / 120.;
+	h (4, 1) = -x[0] * x[2] * x[3] / 120.;
+	h (4, 2) = -x[0] * x[1] * x[3] / 120.;
+	h (4, 3) = -x[0] * x[1] * x[2] / 120.;
+      }
 
-  F<functionType_t>::argument_t x (5);
-  x << 2, 2, 2, 2, 2;
-  problem.startingPoint () = x;
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 1) = -x[2] * x[3] * x[4] / 120.;
+	h (0, 2) = -x[1] * x[3] * x[4] / 120.;
+	h (0, 3) = -x[1] * x[2] * x[4] / 120.;
+	h (0, 4) = -x[1] * x[2] * x[3] / 120.;
+	h (1, 0) = -x[2] * x[3] * x[4] / 120.;
+	h (1, 2) = -x[0] * x[3] * x[4] / 120.;
+	h (1, 3) = -x[0] * x[2] * x[4] / 120.;
+	h (1, 4) = -x[0] * x[2] * x[3] / 120.;
+	h (2, 0) = -x[1] * x[3] * x[4] / 120.;
+	h (2, 1) = -x[0] * x[3] * x[4] / 120.;
+	h (2, 3) = -x[0] * x[1] * x[4] / 120.;
+	h (2, 4) = -x[0] * x[1] * x[3] / 120.;
+	h (3, 0) = -x[1] * x[2] * x[4] / 120.;
+	h (3, 1) = -x[0] * x[2] * x[4] / 120.;
+	h (3, 2) = -x[0] * x[1] * x[4] / 120.;
+	h (3, 4) = -x[0] * x[1] * x[2] / 120.;
+	h (4, 0) = -x[1] * x[2] * x[3] / 120.;
+	h (4, 1) = -x[0] * x[2] * x[3] / 120.;
+	h (4, 2) = -x[0] * x[1] * x[3] / 120.;
+	h (4, 3) = -x[0] * x[1] * x[2] / 120.;
+      }
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-45");
+	for (typename F<T>::size_type i = 0; i < f->inputSize (); ++i)
+	  problem.argumentBounds ()[static_cast<std::size_t> (i)]
+	    = F<T>::makeInterval (0., 1. + static_cast<double> (i));
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+	typename F<T>::argument_t x (5);
+	x << 2, 2, 2, 2, 2;
+	problem.startingPoint () = x;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	return pb;
+      }
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem45";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-45";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = 26./15.;
+	problem.expected.x = (ExpectedResult::argument_t (5)
+			      << 1., 2., 3., 4., 5.).finished ();
+	problem.expected.fx = 1.;
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem45.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem45)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem45::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
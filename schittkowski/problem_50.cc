@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,11 +25,11 @@ namespace roboptim
     namespace problem50
     {
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -36,11 +37,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (5, 1, "(x₀ - x₁)² + (x₁ - x₂)² + (x₂ - x₃)² + (x₃ - x₄)²")
       {}
 
@@ -61,11 +65,13 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = 2. * (x[0] - x[1]);
-	grad.coeffRef (1) = 2. * (-x[0] + 2. * x[1] - x[2]);
-	grad.coeffRef (2) = 2. * (-x[1] + 2. * x[2] - x[3]);
-	grad.coeffRef (3) = 2. * (-x[2] + 2. * x[3] - x[4]);
-	grad.coeffRef (4) = 2. * (-x[3] + x[4]);
+	static const int pattern[] = {0, 1, 2, 3, 4};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = 2. * (x[0] - x[1]);
+	g (1) = 2. * (-x[0] + 2. * x[1] - x[2]);
+	g (2) = 2. * (-x[1] + 2. * x[2] - x[3]);
+	g (3) = 2. * (-x[2] + 2. * x[3] - x[4]);
+	g (4) = 2. * (-x[3] + x[4]);
       }
 
       template <typename T>
@@ -81,11 +87,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G : public GenericDifferentiableFunction<T>
+      class G : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G ();
 	void
@@ -93,11 +99,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref, const_argument_ref, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G<T>::G ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (5, 3, "x₀ + 2x₁ + 3x₂, x₁ + 2x₂ + 3x₃, x₂ + 2x₃ + 3x₄")
       {}
 
@@ -119,21 +128,33 @@ namespace roboptim
         switch (functionId)
           {
 	  case 0:
-	    grad.coeffRef (0) = 1;
-	    grad.coeffRef (1) = 2;
-	    grad.coeffRef (2) = 3;
+	    {
+	      static const int pattern[] = {0, 1, 2};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (0) = 1;
+	      g (1) = 2;
+	      g (2) = 3;
+	    }
 	    break;
 
 	  case 1:
-	    grad.coeffRef (1) = 1;
-	    grad.coeffRef (2) = 2;
-	    grad.coeffRef (3) = 3;
+	    {
+	      static const int pattern[] = {1, 2, 3};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (1) = 1;
+	      g (2) = 2;
+	      g (3) = 3;
+	    }
 	    break;
 
 	  case 2:
-	    grad.coeffRef (2) = 1;
-	    grad.coeffRef (3) = 2;
-	    grad.coeffRef (4) = 3;
+	    {
+	      static const int pattern[] = {2, 3, 4};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (2) = 1;
+	      g (3) = 2;
+	      g (4) = 3;
+	    }
 	    break;
 	  }
       }
@@ -166,75 +187,121 @@ namespace roboptim
 	    break;
 	  }
       }
-    } // end of namespace problem50.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
-
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
-
-BOOST_AUTO_TEST_CASE (schittkowski_problem50)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem50;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
 
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 6256;
-  expectedResult.x = (ExpectedResult::argument_t (5) << 1, 1, 1, 1, 1).finished ();
-  expectedResult.fx = 0;
-
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {0, 1}, {1, 0}, {1, 1},
+	  {1, 2}, {2, 1}, {2, 2}, {2, 3}, {3, 2}, {3, 3}, {3, 4}, {4, 3},
+	  {4, 4}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = 2.;
+	h (0, 1) = -2.;
+	h (1, 0) = -2.;
+	h (1, 1) = 4.;
+	h (1, 2) = -2.;
+	h (2, 1) = -2.;
+	h (2, 2) = 4.;
+	h (2, 3) = -2.;
+	h (3, 2) = -2.;
+	h (3, 3) = 4.;
+	h (3, 4) = -2.;
+	h (4, 3) = -2.;
+	h (4, 4) = 2.;
+      }
 
-  boost::shared_ptr<G<functionType_t> > g =
-    boost::make_shared<G<functionType_t> > ();
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = 2.;
+	h (0, 1) = -2.;
+	h (1, 0) = -2.;
+	h (1, 1) = 4.;
+	h (1, 2) = -2.;
+	h (2, 1) = -2.;
+	h (2, 2) = 4.;
+	h (2, 3) = -2.;
+	h (3, 2) = -2.;
+	h (3, 3) = 4.;
+	h (3, 4) = -2.;
+	h (4, 3) = -2.;
+	h (4, 4) = 2.;
+      }
 
-  solver_t::problem_t::intervals_t intervals;
-  intervals.push_back (G<functionType_t>::makeInterval (6., 6.));
-  intervals.push_back (G<functionType_t>::makeInterval (6., 6.));
-  intervals.push_back (G<functionType_t>::makeInterval (6., 6.));
-  solver_t::problem_t::scaling_t scaling
-    (static_cast<std::size_t> (g->outputSize ()), 1.);
+      template <typename T>
+      void
+      G<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+      }
 
-  problem.addConstraint (g, intervals, scaling);
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
 
-  F<functionType_t>::argument_t x (5);
-  x << 35, -31, 11, 5, -5;
-  problem.startingPoint () = x;
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+	boost::shared_ptr<G<T> > g =
+	  boost::make_shared<Instrumented<G<T> > > ();
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	typename problem_t::intervals_t intervals;
+	intervals.push_back (G<T>::makeInterval (6., 6.));
+	intervals.push_back (G<T>::makeInterval (6., 6.));
+	intervals.push_back (G<T>::makeInterval (6., 6.));
+	typename problem_t::scaling_t scaling
+	  (static_cast<std::size_t> (g->outputSize ()), 1.);
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-50");
+	problem.addConstraint (g, intervals, scaling);
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+	typename F<T>::argument_t x (5);
+	x << 35, -31, 11, 5, -5;
+	problem.startingPoint () = x;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	return pb;
+      }
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem50";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-50";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = 6256;
+	problem.expected.x = (ExpectedResult::argument_t (5) << 1, 1, 1, 1, 1).finished ();
+	problem.expected.fx = 0;
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem50.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem50)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem50::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 #include <roboptim/core/finite-difference-gradient.hh>
 
@@ -25,12 +26,55 @@ namespace roboptim
   {
     namespace problem54
     {
+      typedef Eigen::Matrix<double, 6, 1> vector6_t;
+      typedef Eigen::Matrix<double, 6, 6> matrix6_t;
+
+      /// \brief Quadratic form h of the cost -exp (-h/2).
+      template <typename A>
+      double quadraticForm (const A& x)
+      {
+	return
+	  (std::pow (x[0] - 1.E4, 2.) / 6.4E7
+	   + (x[0] - 1E4) * (x[1] - 1.) / 2.E4
+	   + std::pow (x[1] - 1, 2.)) / 0.96
+	  + std::pow (x[2] - 2.E6, 2.) / 4.9E13
+	  + std::pow (x[3] - 10., 2.) / 2.5E3
+	  + std::pow (x[4] - 1.E-3, 2) / 2.5E-3
+	  + std::pow (x[5] - 1.E8, 2) / 2.5E17;
+      }
+
+      /// \brief Hessian of the cost: with e = exp (-h/2),
+      /// ∇²f = e (∇²h / 2 - ∇h ∇hᵀ / 4).
+      template <typename A>
+      void costHessian (const A& x, matrix6_t& hess)
+      {
+	vector6_t dh;
+	dh[0] = (2 * (x[0] - 1.E4) / 6.4E7 + (x[1] - 1.) / 2.E4) / 0.96;
+	dh[1] = ((x[0] - 1.E4) / 2.E4 + 2 * (x[1] - 1.)) / 0.96;
+	dh[2] = 2 * (x[2] - 2.E6) / 4.9E13;
+	dh[3] = 2 * (x[3] - 10.) / 2.5E3;
+	dh[4] = 2 * (x[4] - 1.E-3) / 2.5E-3;
+	dh[5] = 2 * (x[5] - 1.E8) / 2.5E17;
+
+	matrix6_t d2h = matrix6_t::Zero ();
+	d2h (0, 0) = 2. / (6.4E7 * 0.96);
+	d2h (0, 1) = d2h (1, 0) = 1. / (2.E4 * 0.96);
+	d2h (1, 1) = 2. / 0.96;
+	d2h (2, 2) = 2. / 4.9E13;
+	d2h (3, 3) = 2. / 2.5E3;
+	d2h (4, 4) = 2. / 2.5E-3;
+	d2h (5, 5) = 2. / 2.5E17;
+
+	double e = std::exp (-quadraticForm (x) / 2.);
+	hess = e * (d2h / 2. - dh * dh.transpose () / 4.);
+      }
+
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -38,11 +82,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (6, 1, "-exp(-h(x)/2)")
       {}
 
@@ -51,15 +98,7 @@ namespace roboptim
       F<T>::impl_compute (result_ref result, const_argument_ref x)
 	const
       {
-	value_type h =
-	  (std::pow (x[0] - 1.E4, 2.) / 6.4E7
-	   + (x[0] - 1E4) * (x[1] - 1.) / 2.E4
-	   + std::pow (x[1] - 1, 2.)) / 0.96
-	  + std::pow (x[2] - 2.E6, 2.) / 4.9E13
-	  + std::pow (x[3] - 10., 2.) / 2.5E3
-	  + std::pow (x[4] - 1.E-3, 2) / 2.5E-3
-	  + std::pow (x[5] - 1.E8, 2) / 2.5E17;
-	result[0] = -std::exp (-h/2.);
+	result[0] = -std::exp (-quadraticForm (x) / 2.);
       }
 
       template <typename T>
@@ -72,12 +111,41 @@ namespace roboptim
 	fd.gradient (grad, x, i);
       }
 
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref x, size_type) const
+      {
+	matrix6_t d2;
+	costHessian (x, d2);
+
+	static const int pattern[][2] = {{0, 0}, {0, 1}, {0, 2}, {0, 3},
+	  {0, 4}, {0, 5}, {1, 0}, {1, 1}, {1, 2}, {1, 3}, {1, 4}, {1, 5},
+	  {2, 0}, {2, 1}, {2, 2}, {2, 3}, {2, 4}, {2, 5}, {3, 0}, {3, 1},
+	  {3, 2}, {3, 3}, {3, 4}, {3, 5}, {4, 0}, {4, 1}, {4, 2}, {4, 3},
+	  {4, 4}, {4, 5}, {5, 0}, {5, 1}, {5, 2}, {5, 3}, {5, 4}, {5, 5}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	for (int i = 0; i < 6; ++i)
+	  for (int j = 0; j < 6; ++j)
+	    h (i, j) = d2 (i, j);
+      }
+
       template <typename T>
-      class G : public GenericDifferentiableFunction<T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	const
+      {
+	matrix6_t d2;
+	costHessian (x, d2);
+	h = d2;
+      }
+
+      template <typename T>
+      class G : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G ();
 	void
@@ -85,11 +153,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G<T>::G ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (6, 1, "x₀ + 4.E3 x₁ - 1.76E4")
       {}
 
@@ -107,8 +178,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref, size_type)
 	const
       {
-	grad.coeffRef (0) = 1.;
-	grad.coeffRef (1) = 4.E3;
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = 1.;
+	g (1) = 4.E3;
       }
 
       template <typename T>
@@ -123,76 +196,77 @@ namespace roboptim
 	grad[4] = 0.;
 	grad[5] = 0.;
       }
-    } // end of namespace problem54.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
-
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
-
-BOOST_AUTO_TEST_CASE (schittkowski_problem54)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem54;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
-
-  ExpectedResult expectedResult;
-  expectedResult.f0 = -0.7651;
-  expectedResult.x = (ExpectedResult::argument_t (6)
-                      << 91600. / 7., 79. / 70., 2E6, 10., 1E-3, 1E8
-                     ).finished ();
-  expectedResult.fx = -std::exp (-27./280.);
 
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
+      template <typename T>
+      void
+      G<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+      }
 
-  problem.argumentBounds ()[0] = F<functionType_t>::makeInterval (0., 2.E4);
-  problem.argumentBounds ()[1] = F<functionType_t>::makeInterval (-10., 10.);
-  problem.argumentBounds ()[2] = F<functionType_t>::makeInterval (0., 1.E7);
-  problem.argumentBounds ()[3] = F<functionType_t>::makeInterval (0., 20.);
-  problem.argumentBounds ()[4] = F<functionType_t>::makeInterval (-1., 1.);
-  problem.argumentBounds ()[5] = F<functionType_t>::makeInterval (0., 2.E8);
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
 
-  boost::shared_ptr<G<functionType_t> > g =
-    boost::make_shared<G<functionType_t> > ();
-  problem.addConstraint (g, G<functionType_t>::makeInterval (0., 0.));
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
 
-  F<functionType_t>::argument_t x (6);
-  x << 6.E3, 1.5, 4E6, 2., 3E-3, 5E7;
-  problem.startingPoint () = x;
+	problem.argumentBounds ()[0] = F<T>::makeInterval (0., 2.E4);
+	problem.argumentBounds ()[1] = F<T>::makeInterval (-10., 10.);
+	problem.argumentBounds ()[2] = F<T>::makeInterval (0., 1.E7);
+	problem.argumentBounds ()[3] = F<T>::makeInterval (0., 20.);
+	problem.argumentBounds ()[4] = F<T>::makeInterval (-1., 1.);
+	problem.argumentBounds ()[5] = F<T>::makeInterval (0., 2.E8);
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+	boost::shared_ptr<G<T> > g =
+	  boost::make_shared<Instrumented<G<T> > > ();
+	problem.addConstraint (g, G<T>::makeInterval (0., 0.));
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	typename F<T>::argument_t x (6);
+	x << 6.E3, 1.5, 4E6, 2., 3E-3, 5E7;
+	problem.startingPoint () = x;
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-54");
+	return pb;
+      }
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem54";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-54";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+	problem.expected.f0 = -0.7651;
+	problem.expected.x = (ExpectedResult::argument_t (6)
+			      << 91600. / 7., 79. / 70., 2E6, 10., 1E-3, 1E8
+			     ).finished ();
+	problem.expected.fx = -std::exp (-27./280.);
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem54.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem54)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem54::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 #include <roboptim/core/finite-difference-gradient.hh>
 
@@ -41,12 +42,59 @@ namespace roboptim
       const double s4 = 0.05;
       const double s5 = 5e8;
 
+      typedef Eigen::Matrix<double, 6, 1> vector6_t;
+      typedef Eigen::Matrix<double, 6, 6> matrix6_t;
+
+      /// \brief Quadratic form h of the cost -exp (-h/2).
+      template <typename A>
+      double quadraticForm (const A& x)
+      {
+	return 1./(1. - r * r) *
+	  (std::pow ((x[0] - m0)/s0, 2)
+	   + 2 * r * (x[0] - m0) * (x[1] - m1) / (s0 * s1)
+	   + std::pow ((x[1] - m1)/s1, 2))
+	  + std::pow ((x[2] - m2)/s2, 2)
+	  + std::pow ((x[3] - m3)/s3, 2)
+	  + std::pow ((x[4] - m4)/s4, 2)
+	  + std::pow ((x[5] - m5)/s5, 2);
+      }
+
+      /// \brief Hessian of the cost: with e = exp (-h/2),
+      /// ∇²f = e (∇²h / 2 - ∇h ∇hᵀ / 4).
+      template <typename A>
+      void costHessian (const A& x, matrix6_t& hess)
+      {
+	const double c = 1. / (1. - r * r);
+	double z0 = (x[0] - m0) / s0;
+	double z1 = (x[1] - m1) / s1;
+
+	vector6_t dh;
+	dh[0] = 2 * c * (z0 + r * z1) / s0;
+	dh[1] = 2 * c * (z1 + r * z0) / s1;
+	dh[2] = 2 * (x[2] - m2) / (s2 * s2);
+	dh[3] = 2 * (x[3] - m3) / (s3 * s3);
+	dh[4] = 2 * (x[4] - m4) / (s4 * s4);
+	dh[5] = 2 * (x[5] - m5) / (s5 * s5);
+
+	matrix6_t d2h = matrix6_t::Zero ();
+	d2h (0, 0) = 2 * c / (s0 * s0);
+	d2h (0, 1) = d2h (1, 0) = 2 * c * r / (s0 * s1);
+	d2h (1, 1) = 2 * c / (s1 * s1);
+	d2h (2, 2) = 2. / (s2 * s2);
+	d2h (3, 3) = 2. / (s3 * s3);
+	d2h (4, 4) = 2. / (s4 * s4);
+	d2h (5, 5) = 2. / (s5 * s5);
+
+	double e = std::exp (-quadraticForm (x) / 2.);
+	hess = e * (d2h / 2. - dh * dh.transpose () / 4.);
+      }
+
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -54,11 +102,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (6, 1, "-exp(-h(x)/2)")
       {}
 
@@ -67,16 +118,7 @@ namespace roboptim
       F<T>::impl_compute (result_ref result, const_argument_ref x)
 	const
       {
-	value_type h = 1./(1. - r * r) *
-	  (std::pow ((x[0] - m0)/s0, 2)
-	   + 2 * r * (x[0] - m0) * (x[1] - m1) / (s0 * s1)
-	   + std::pow ((x[1] - m1)/s1, 2))
-	  + std::pow ((x[2] - m2)/s2, 2)
-	  + std::pow ((x[3] - m3)/s3, 2)
-	  + std::pow ((x[4] - m4)/s4, 2)
-	  + std::pow ((x[5] - m5)/s5, 2);
-
-	result[0] = -std::exp (-h/2.);
+	result[0] = -std::exp (-quadraticForm (x) / 2.);
       }
 
       template <typename T>
@@ -84,17 +126,45 @@ namespace roboptim
       F<T>::impl_gradient (gradient_ref grad, const_argument_ref x, size_type i)
 	const
       {
-	//FIXME:
 	GenericFiniteDifferenceGradient<T> fd (*this);
 	fd.gradient (grad, x, i);
       }
 
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref x, size_type) const
+      {
+	matrix6_t d2;
+	costHessian (x, d2);
+
+	static const int pattern[][2] = {{0, 0}, {0, 1}, {0, 2}, {0, 3},
+	  {0, 4}, {0, 5}, {1, 0}, {1, 1}, {1, 2}, {1, 3}, {1, 4}, {1, 5},
+	  {2, 0}, {2, 1}, {2, 2}, {2, 3}, {2, 4}, {2, 5}, {3, 0}, {3, 1},
+	  {3, 2}, {3, 3}, {3, 4}, {3, 5}, {4, 0}, {4, 1}, {4, 2}, {4, 3},
+	  {4, 4}, {4, 5}, {5, 0}, {5, 1}, {5, 2}, {5, 3}, {5, 4}, {5, 5}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	for (int i = 0; i < 6; ++i)
+	  for (int j = 0; j < 6; ++j)
+	    h (i, j) = d2 (i, j);
+      }
+
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	const
+      {
+	matrix6_t d2;
+	costHessian (x, d2);
+	h = d2;
+      }
+
       template <typename T>
-      class G : public GenericDifferentiableFunction<T>
+      class G : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G ();
 	void
@@ -102,11 +172,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G<T>::G ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (6, 1, "((x₀ - µ₀) - 0.2σ₀ + 4000(x₁ - µ₁) - 2000σ₁")
       {}
 
@@ -124,8 +197,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref, size_type)
 	const
       {
-	grad.coeffRef (0) = 1.;
-	grad.coeffRef (1) = 4e3;
+	static const int pattern[] = {0, 1};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = 1.;
+	g (1) = 4e3;
       }
 
       template <typename T>
@@ -140,6 +215,68 @@ namespace roboptim
 	grad[4] = 0.;
 	grad[5] = 0.;
       }
+
+      template <typename T>
+      void
+      G<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+      }
+
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
+
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
+
+	problem.argumentBounds ()[0] = F<T>::makeInterval (0., 2.e4);
+	problem.argumentBounds ()[1] = F<T>::makeInterval (-10., 10.);
+	problem.argumentBounds ()[2] = F<T>::makeInterval (0., 1.e7);
+	problem.argumentBounds ()[3] = F<T>::makeInterval (0., 20.);
+	problem.argumentBounds ()[4] = F<T>::makeInterval (-1., 1.);
+	problem.argumentBounds ()[5] = F<T>::makeInterval (0., 2.e8);
+
+	boost::shared_ptr<G<T> > g =
+	  boost::make_shared<Instrumented<G<T> > > ();
+	problem.addConstraint (g, G<T>::makeInterval (0., 0.));
+
+	typename F<T>::argument_t x (f->inputSize ());
+	x << 6.e3, 1.5, 4e6, 2., 3e-3, 5e7;
+	problem.startingPoint () = x;
+
+	return pb;
+      }
+
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem54b";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-54b";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = -0.7651;
+	problem.expected.x = (ExpectedResult::argument_t (6)
+			      << 1.2670e4, 1.2322, 1.9999e6, 10., 1e-3, 1e8
+			     ).finished ();
+	problem.expected.fx = -0.93676;
+	return problem;
+      }
+
+      static ProblemRegistrar registrar (descriptor ());
     } // end of namespace problem54b.
   } // end of namespace schittkowski.
 } // end of namespace roboptim.
@@ -148,67 +285,7 @@ BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
 BOOST_AUTO_TEST_CASE (schittkowski_problem54b)
 {
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem54b;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
-
-  expectedResult.f0 = -0.7651;
-  expectedResult.x = (ExpectedResult::argument_t (6)
-                      << 1.2670e4, 1.2322, 1.9999e6, 10., 1e-3, 1e8
-                     ).finished ();
-  expectedResult.fx = -0.93676;
-
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
-
-  problem.argumentBounds ()[0] = F<functionType_t>::makeInterval (0., 2.e4);
-  problem.argumentBounds ()[1] = F<functionType_t>::makeInterval (-10., 10.);
-  problem.argumentBounds ()[2] = F<functionType_t>::makeInterval (0., 1.e7);
-  problem.argumentBounds ()[3] = F<functionType_t>::makeInterval (0., 20.);
-  problem.argumentBounds ()[4] = F<functionType_t>::makeInterval (-1., 1.);
-  problem.argumentBounds ()[5] = F<functionType_t>::makeInterval (0., 2.e8);
-
-  boost::shared_ptr<G<functionType_t> > g =
-    boost::make_shared<G<functionType_t> > ();
-  problem.addConstraint (g, G<functionType_t>::makeInterval (0., 0.));
-
-  F<functionType_t>::argument_t x (f->inputSize ());
-  x << 6.e3, 1.5, 4e6, 2., 3e-3, 5e7;
-  problem.startingPoint () = x;
-
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
-
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
-
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-54b");
-
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
-
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
-
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
-
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
-
-  // Display solver information.
-  std::cout << solver << std::endl;
-
-  // Process the result
-  PROCESS_RESULT();
+  roboptim::solveProblem (roboptim::schittkowski::problem54b::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
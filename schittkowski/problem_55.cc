@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,11 +25,11 @@ namespace roboptim
     namespace problem55
     {
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -36,11 +37,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (6, 1, "x₀ + 2x₁ + 4x₄ + exp(x₀x₃)")
       {}
 
@@ -58,10 +62,12 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = 1 + x[3] * std::exp (x[0] * x[3]);
-	grad.coeffRef (1) = 2;
-	grad.coeffRef (3) = x[0] * std::exp (x[0] * x[3]);
-	grad.coeffRef (4) = 4;
+	static const int pattern[] = {0, 1, 3, 4};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = 1 + x[3] * std::exp (x[0] * x[3]);
+	g (1) = 2;
+	g (3) = x[0] * std::exp (x[0] * x[3]);
+	g (4) = 4;
       }
 
       template <typename T>
@@ -77,11 +83,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G : public GenericDifferentiableFunction<T>
+      class G : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G ();
 	void
@@ -89,11 +95,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref, const_argument_ref, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G<T>::G ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (6, 6, "x₀ + 2x₁ + 5x₄ - 6, x₀ + x₁ + x₂ - 3, x₃ + x₄ + x₅ - 2, "
 	   "x₀ + x₃ - 1, x₁ + x₄ - 2, x₂ + x₅ - 2")
       {}
@@ -119,36 +128,60 @@ namespace roboptim
         switch (functionId)
           {
 	  case 0:
-	    grad.coeffRef (0) = 1;
-	    grad.coeffRef (1) = 2;
-	    grad.coeffRef (4) = 5;
+	    {
+	      static const int pattern[] = {0, 1, 4};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (0) = 1;
+	      g (1) = 2;
+	      g (4) = 5;
+	    }
 	    break;
 
 	  case 1:
-	    grad.coeffRef (0) = 1;
-	    grad.coeffRef (1) = 1;
-	    grad.coeffRef (2) = 1;
+	    {
+	      static const int pattern[] = {0, 1, 2};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (0) = 1;
+	      g (1) = 1;
+	      g (2) = 1;
+	    }
 	    break;
 
 	  case 2:
-	    grad.coeffRef (3) = 1;
-	    grad.coeffRef (4) = 1;
-	    grad.coeffRef (5) = 1;
+	    {
+	      static const int pattern[] = {3, 4, 5};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (3) = 1;
+	      g (4) = 1;
+	      g (5) = 1;
+	    }
 	    break;
 
 	  case 3:
-	    grad.coeffRef (0) = 1;
-	    grad.coeffRef (3) = 1;
+	    {
+	      static const int pattern[] = {0, 3};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (0) = 1;
+	      g (3) = 1;
+	    }
 	    break;
 
 	  case 4:
-	    grad.coeffRef (1) = 1;
-	    grad.coeffRef (4) = 1;
+	    {
+	      static const int pattern[] = {1, 4};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (1) = 1;
+	      g (4) = 1;
+	    }
 	    break;
 
 	  case 5:
-	    grad.coeffRef (2) = 1;
-	    grad.coeffRef (5) = 1;
+	    {
+	      static const int pattern[] = {2, 5};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (2) = 1;
+	      g (5) = 1;
+	    }
 	    break;
 	  }
       }
@@ -196,81 +229,109 @@ namespace roboptim
 	    break;
 	  }
       }
-    } // end of namespace problem55.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
-
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
-
-BOOST_AUTO_TEST_CASE (schittkowski_problem55)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem55;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
 
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 6.;
-  expectedResult.x = (ExpectedResult::argument_t (6) << 0., 4./3., 5./3., 1., 2./3., 1./3.).finished ();
-  expectedResult.fx = 19./3.;
-
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref x, size_type) const
+      {
+	value_type e = std::exp (x[0] * x[3]);
+	static const int pattern[][2] = {{0, 0}, {0, 3}, {3, 0}, {3, 3}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = e * x[3] * x[3];
+	h (0, 3) = e * x[0] * x[3] + e;
+	h (3, 0) = e * x[0] * x[3] + e;
+	h (3, 3) = e * x[0] * x[0];
+      }
 
-  problem.argumentBounds ()[0] = F<functionType_t>::makeInterval (0., 1.);
-  problem.argumentBounds ()[1] = F<functionType_t>::makeLowerInterval (0.);
-  problem.argumentBounds ()[2] = F<functionType_t>::makeLowerInterval (0.);
-  problem.argumentBounds ()[3] = F<functionType_t>::makeInterval (0., 1.);
-  problem.argumentBounds ()[4] = F<functionType_t>::makeLowerInterval (0.);
-  problem.argumentBounds ()[5] = F<functionType_t>::makeLowerInterval (0.);
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	const
+      {
+	h.setZero ();
+	value_type e = std::exp (x[0] * x[3]);
+	h (0, 0) = e * x[3] * x[3];
+	h (0, 3) = e * x[0] * x[3] + e;
+	h (3, 0) = e * x[0] * x[3] + e;
+	h (3, 3) = e * x[0] * x[0];
+      }
 
-  boost::shared_ptr<G<functionType_t> > g =
-    boost::make_shared<G<functionType_t> > ();
+      template <typename T>
+      void
+      G<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+      }
 
-  solver_t::problem_t::intervals_t intervals;
-  for (F<functionType_t>::size_type i = 0; i < g->outputSize (); ++i)
-    intervals.push_back (G<functionType_t>::makeInterval (0., 0.));
-  solver_t::problem_t::scaling_t scaling
-    (static_cast<std::size_t> (g->outputSize ()), 1.);
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
 
-  problem.addConstraint (g, intervals, scaling);
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
 
-  F<functionType_t>::argument_t x (f->inputSize ());
-  x << 1, 2, 0, 0, 0, 2;
-  problem.startingPoint () = x;
+	problem.argumentBounds ()[0] = F<T>::makeInterval (0., 1.);
+	problem.argumentBounds ()[1] = F<T>::makeLowerInterval (0.);
+	problem.argumentBounds ()[2] = F<T>::makeLowerInterval (0.);
+	problem.argumentBounds ()[3] = F<T>::makeInterval (0., 1.);
+	problem.argumentBounds ()[4] = F<T>::makeLowerInterval (0.);
+	problem.argumentBounds ()[5] = F<T>::makeLowerInterval (0.);
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+	boost::shared_ptr<G<T> > g =
+	  boost::make_shared<Instrumented<G<T> > > ();
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	typename problem_t::intervals_t intervals;
+	for (typename F<T>::size_type i = 0; i < g->outputSize (); ++i)
+	  intervals.push_back (G<T>::makeInterval (0., 0.));
+	typename problem_t::scaling_t scaling
+	  (static_cast<std::size_t> (g->outputSize ()), 1.);
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-55");
+	problem.addConstraint (g, intervals, scaling);
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+	typename F<T>::argument_t x (f->inputSize ());
+	x << 1, 2, 0, 0, 0, 2;
+	problem.startingPoint () = x;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	return pb;
+      }
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem55";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-55";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = 6.;
+	problem.expected.x = (ExpectedResult::argument_t (6) << 0., 4./3., 5./3., 1., 2./3., 1./3.).finished ();
+	problem.expected.fx = 19./3.;
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem55.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem55)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem55::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -29,11 +30,11 @@ namespace roboptim
       const double d = std::asin (std::sqrt (2./7.));
 
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -41,11 +42,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (7, 1, "-x₀x₁x₂")
       {}
 
@@ -63,9 +67,11 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = -x[1] * x[2];
-	grad.coeffRef (1) = -x[0] * x[2];
-	grad.coeffRef (3) = -x[0] * x[1];
+	static const int pattern[] = {0, 1, 3};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = -x[1] * x[2];
+	g (1) = -x[0] * x[2];
+	g (3) = -x[0] * x[1];
       }
 
       template <typename T>
@@ -81,11 +87,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G : public GenericDifferentiableFunction<T>
+      class G : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G ();
 	void
@@ -93,11 +99,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref, const_argument_ref, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	  const;
       };
 
       template <typename T>
       G<T>::G ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (7, 4, "x₀ - 4.2sin²x₃, x₁ - 4.2sin²x₄, x₂ - 4.2sin²x₅, "
 	   "x₀ + 2x₁ + 2x₂ - 7.2sin²x₆")
       {}
@@ -124,25 +133,41 @@ namespace roboptim
         switch (functionId)
           {
 	  case 0:
-	    grad.coeffRef (0) = 1;
-	    grad.coeffRef (3) = -8.4 * std::sin (x[3]) * std::cos (x[3]);
+	    {
+	      static const int pattern[] = {0, 3};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (0) = 1;
+	      g (3) = -8.4 * std::sin (x[3]) * std::cos (x[3]);
+	    }
 	    break;
 
 	  case 1:
-	    grad.coeffRef (1) = 1;
-	    grad.coeffRef (4) = -8.4 * std::sin (x[4]) * std::cos (x[4]);
+	    {
+	      static const int pattern[] = {1, 4};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (1) = 1;
+	      g (4) = -8.4 * std::sin (x[4]) * std::cos (x[4]);
+	    }
 	    break;
 
 	  case 2:
-	    grad.coeffRef (2) = 1;
-	    grad.coeffRef (5) = -8.4 * std::sin (x[5]) * std::cos (x[5]);
+	    {
+	      static const int pattern[] = {2, 5};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (2) = 1;
+	      g (5) = -8.4 * std::sin (x[5]) * std::cos (x[5]);
+	    }
 	    break;
 
 	  case 3:
-	    grad.coeffRef (0) = 1;
-	    grad.coeffRef (1) = 2;
-	    grad.coeffRef (2) = 2;
-	    grad.coeffRef (6) = -14.4 * std::sin (x[6]) * std::cos (x[6]);
+	    {
+	      static const int pattern[] = {0, 1, 2, 6};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (0) = 1;
+	      g (1) = 2;
+	      g (2) = 2;
+	      g (6) = -14.4 * std::sin (x[6]) * std::cos (x[6]);
+	    }
 	    break;
 	  }
       }
@@ -179,75 +204,166 @@ namespace roboptim
 	    break;
 	  }
       }
-    } // end of namespace problem56.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
 
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref x, size_type) const
+      {
+	static const int pattern[][2] = {{0, 1}, {0, 2}, {1, 0}, {1, 2},
+	  {2, 0}, {2, 1}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 1) = -x[2];
+	h (0, 2) = -x[1];
+	h (1, 0) = -x[2];
+	h (1, 2) = -x[0];
+	h (2, 0) = -x[1];
+	h (2, 1) = -x[0];
+      }
 
-BOOST_AUTO_TEST_CASE (schittkowski_problem56)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem56;
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 1) = -x[2];
+	h (0, 2) = -x[1];
+	h (1, 0) = -x[2];
+	h (1, 2) = -x[0];
+	h (2, 0) = -x[1];
+	h (2, 1) = -x[0];
+      }
+
+      template <>
+      void
+      G<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref x, size_type functionId) const
+      {
+	switch (functionId)
+	  {
+	  case 0:
+	    {
+	      static const int pattern[][2] = {{3, 3}};
+	      StructuredHessian<hessian_t> h (hess, pattern);
+	      h (3, 3) = -8.4 * std::cos (2 * x[3]);
+	    }
+	    break;
+
+	  case 1:
+	    {
+	      static const int pattern[][2] = {{4, 4}};
+	      StructuredHessian<hessian_t> h (hess, pattern);
+	      h (4, 4) = -8.4 * std::cos (2 * x[4]);
+	    }
+	    break;
+
+	  case 2:
+	    {
+	      static const int pattern[][2] = {{5, 5}};
+	      StructuredHessian<hessian_t> h (hess, pattern);
+	      h (5, 5) = -8.4 * std::cos (2 * x[5]);
+	    }
+	    break;
 
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
+	  case 3:
+	    {
+	      static const int pattern[][2] = {{6, 6}};
+	      StructuredHessian<hessian_t> h (hess, pattern);
+	      h (6, 6) = -14.4 * std::cos (2 * x[6]);
+	    }
+	    break;
+	  }
+      }
 
-  ExpectedResult expectedResult;
-  expectedResult.f0 = -1.;
-  expectedResult.x = (ExpectedResult::argument_t (7)
-                      << 2.4, 1.2, 1.2, c, d, d, 0.5 * M_PI).finished ();
-  expectedResult.fx = -3.456;
+      template <typename T>
+      void
+      G<T>::impl_hessian
+      (hessian_ref h, const_argument_ref x, size_type functionId) const
+      {
+	h.setZero ();
 
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
+	switch (functionId)
+	  {
+	  case 0:
+	    h (3, 3) = -8.4 * std::cos (2 * x[3]);
+	    break;
 
-  boost::shared_ptr<G<functionType_t> > g =
-    boost::make_shared<G<functionType_t> > ();
+	  case 1:
+	    h (4, 4) = -8.4 * std::cos (2 * x[4]);
+	    break;
+
+	  case 2:
+	    h (5, 5) = -8.4 * std::cos (2 * x[5]);
+	    break;
 
-  solver_t::problem_t::intervals_t intervals;
-  for (F<functionType_t>::size_type i = 0; i < g->outputSize (); ++i)
-    intervals.push_back (G<functionType_t>::makeInterval (0., 0.));
-  solver_t::problem_t::scaling_t scaling
-    (static_cast<std::size_t> (g->outputSize ()), 1.);
+	  case 3:
+	    h (6, 6) = -14.4 * std::cos (2 * x[6]);
+	    break;
+	  }
+      }
 
-  problem.addConstraint (g, intervals, scaling);
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
 
-  F<functionType_t>::argument_t x (f->inputSize ());
-  x << 1, 1, 1, a, a, a, b;
-  problem.startingPoint () = x;
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+	boost::shared_ptr<G<T> > g =
+	  boost::make_shared<Instrumented<G<T> > > ();
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	typename problem_t::intervals_t intervals;
+	for (typename F<T>::size_type i = 0; i < g->outputSize (); ++i)
+	  intervals.push_back (G<T>::makeInterval (0., 0.));
+	typename problem_t::scaling_t scaling
+	  (static_cast<std::size_t> (g->outputSize ()), 1.);
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-56");
+	problem.addConstraint (g, intervals, scaling);
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+	typename F<T>::argument_t x (f->inputSize ());
+	x << 1, 1, 1, a, a, a, b;
+	problem.startingPoint () = x;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	return pb;
+      }
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem56";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-56";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = -1.;
+	problem.expected.x = (ExpectedResult::argument_t (7)
+			      << 2.4, 1.2, 1.2, c, d, d, 0.5 * M_PI).finished ();
+	problem.expected.fx = -3.456;
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem56.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem56)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem56::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
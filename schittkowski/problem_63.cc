@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,11 +25,11 @@ namespace roboptim
     namespace problem63
     {
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -36,11 +37,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (3, 1, "1000 - x₀² - 2x₁² - x₂² - x₀x₁ - x₀x₂")
       {}
 
@@ -59,9 +63,11 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = -2 * x[0] - x[1] - x[2];
-	grad.coeffRef (1) = -4 * x[1] - x[0];
-	grad.coeffRef (2) = -2 * x[2] - x[0];
+	static const int pattern[] = {0, 1, 2};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = -2 * x[0] - x[1] - x[2];
+	g (1) = -4 * x[1] - x[0];
+	g (2) = -2 * x[2] - x[0];
       }
 
       template <typename T>
@@ -75,11 +81,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G : public GenericDifferentiableFunction<T>
+      class G : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G ();
 	void
@@ -87,11 +93,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref, const_argument_ref, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       G<T>::G ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (3, 2, "8x₀ + 14x₁ + 7x₂ - 56, x₀² + x₁² + x₂² -25")
       {}
 
@@ -112,15 +121,23 @@ namespace roboptim
         switch (functionId)
           {
 	  case 0:
-	    grad.coeffRef (0) = 8;
-	    grad.coeffRef (1) = 14;
-	    grad.coeffRef (2) = 7;
+	    {
+	      static const int pattern[] = {0, 1, 2};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (0) = 8;
+	      g (1) = 14;
+	      g (2) = 7;
+	    }
 	    break;
 
 	  case 1:
-	    grad.coeffRef (0) = 2 * x[0];
-	    grad.coeffRef (1) = 2 * x[1];
-	    grad.coeffRef (2) = 2 * x[2];
+	    {
+	      static const int pattern[] = {0, 1, 2};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (0) = 2 * x[0];
+	      g (1) = 2 * x[1];
+	      g (2) = 2 * x[2];
+	    }
 	    break;
 	  }
       }
@@ -145,80 +162,145 @@ namespace roboptim
 	    break;
 	  }
       }
-    } // end of namespace problem63.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
-
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-BOOST_AUTO_TEST_CASE (schittkowski_problem63)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem63;
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {0, 1}, {0, 2}, {1, 0},
+	  {1, 1}, {2, 0}, {2, 2}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = -2.;
+	h (0, 1) = -1.;
+	h (0, 2) = -1.;
+	h (1, 0) = -1.;
+	h (1, 1) = -4.;
+	h (2, 0) = -1.;
+	h (2, 2) = -2.;
+      }
 
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = -2.;
+	h (0, 1) = -1.;
+	h (0, 2) = -1.;
+	h (1, 0) = -1.;
+	h (1, 1) = -4.;
+	h (2, 0) = -1.;
+	h (2, 2) = -2.;
+      }
 
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 976;
-  expectedResult.x = (ExpectedResult::argument_t (3)
-                      << 3.512118414, 0.2169881741, 3.552174034
-                     ).finished ();
-  expectedResult.fx = 961.7151721;
+      template <>
+      void
+      G<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref, size_type functionId) const
+      {
+	switch (functionId)
+	  {
+	  case 1:
+	    {
+	      static const int pattern[][2] = {{0, 0}, {1, 1}, {2, 2}};
+	      StructuredHessian<hessian_t> h (hess, pattern);
+	      h (0, 0) = 2.;
+	      h (1, 1) = 2.;
+	      h (2, 2) = 2.;
+	    }
+	    break;
 
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
+	  case 0:
+	    hess.setZero ();
+	    break;
+	  }
+      }
 
-  for (F<functionType_t>::size_type i = 0; i < f->inputSize (); ++i)
-    problem.argumentBounds ()[static_cast<std::size_t> (i)] =
-      F<functionType_t>::makeLowerInterval (0.);
+      template <typename T>
+      void
+      G<T>::impl_hessian
+      (hessian_ref h, const_argument_ref, size_type functionId) const
+      {
+	h.setZero ();
 
-  boost::shared_ptr<G<functionType_t> > g =
-    boost::make_shared<G<functionType_t> > ();
+	switch (functionId)
+	  {
+	  case 1:
+	    h (0, 0) = 2.;
+	    h (1, 1) = 2.;
+	    h (2, 2) = 2.;
+	    break;
+	  }
+      }
 
-  solver_t::problem_t::intervals_t intervals;
-  intervals.push_back (G<functionType_t>::makeInterval (0., 0.));
-  intervals.push_back (G<functionType_t>::makeInterval (0., 0.));
-  solver_t::problem_t::scaling_t scaling
-    (static_cast<std::size_t> (g->outputSize ()), 1.);
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
 
-  problem.addConstraint (g, intervals, scaling);
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
 
-  F<functionType_t>::argument_t x (f->inputSize ());
-  x << 2, 2, 2;
-  problem.startingPoint () = x;
+	for (typename F<T>::size_type i = 0; i < f->inputSize (); ++i)
+	  problem.argumentBounds ()[static_cast<std::size_t> (i)] =
+	    F<T>::makeLowerInterval (0.);
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+	boost::shared_ptr<G<T> > g =
+	  boost::make_shared<Instrumented<G<T> > > ();
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	typename problem_t::intervals_t intervals;
+	intervals.push_back (G<T>::makeInterval (0., 0.));
+	intervals.push_back (G<T>::makeInterval (0., 0.));
+	typename problem_t::scaling_t scaling
+	  (static_cast<std::size_t> (g->outputSize ()), 1.);
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-63");
+	problem.addConstraint (g, intervals, scaling);
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+	typename F<T>::argument_t x (f->inputSize ());
+	x << 2, 2, 2;
+	problem.startingPoint () = x;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	return pb;
+      }
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem63";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-63";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = 976;
+	problem.expected.x = (ExpectedResult::argument_t (3)
+			      << 3.512118414, 0.2169881741, 3.552174034
+			     ).finished ();
+	problem.expected.fx = 961.7151721;
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem63.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem63)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem63::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
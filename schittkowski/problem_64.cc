@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,11 +25,11 @@ namespace roboptim
     namespace problem64
     {
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -36,11 +37,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (3, 1, "5x₀ + 50000/x₀ + 20x₁ + 72000/x₁ + 10x₂ + 144000/x₂")
       {}
 
@@ -60,9 +64,11 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) =  5 -  50000. / (x[0] * x[0]);
-	grad.coeffRef (1) = 20 -  72000. / (x[1] * x[1]);
-	grad.coeffRef (2) = 10 - 144000. / (x[2] * x[2]);
+	static const int pattern[] = {0, 1, 2};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) =  5 -  50000. / (x[0] * x[0]);
+	g (1) = 20 -  72000. / (x[1] * x[1]);
+	g (2) = 10 - 144000. / (x[2] * x[2]);
       }
 
       template <typename T>
@@ -76,11 +82,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G : public GenericDifferentiableFunction<T>
+      class G : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G ();
 	void
@@ -88,11 +94,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	  const;
       };
 
       template <typename T>
       G<T>::G ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (3, 1, "1 - 4/x₀ - 32/x₁ - 120/x₃")
       {}
 
@@ -110,9 +119,11 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) =   4. / (x[0] * x[0]);
-	grad.coeffRef (1) =  32. / (x[1] * x[1]);
-	grad.coeffRef (2) = 120. / (x[2] * x[2]);
+	static const int pattern[] = {0, 1, 2};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) =   4. / (x[0] * x[0]);
+	g (1) =  32. / (x[1] * x[1]);
+	g (2) = 120. / (x[2] * x[2]);
       }
 
       template <typename T>
@@ -124,72 +135,111 @@ namespace roboptim
 	grad (1) =  32. / (x[1] * x[1]);
 	grad (2) = 120. / (x[2] * x[2]);
       }
-    } // end of namespace problem64.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
-
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-BOOST_AUTO_TEST_CASE (schittkowski_problem64)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem64;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
-
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 266035;
-  expectedResult.x = (ExpectedResult::argument_t (3)
-                      << 108.7347175, 85.12613942, 204.3247078).finished ();
-  expectedResult.fx = 6299.842428;
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref x, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {1, 1}, {2, 2}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = 100000 / std::pow (x[0], 3);
+	h (1, 1) = 144000 / std::pow (x[1], 3);
+	h (2, 2) = 288000 / std::pow (x[2], 3);
+      }
 
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = 100000 / std::pow (x[0], 3);
+	h (1, 1) = 144000 / std::pow (x[1], 3);
+	h (2, 2) = 288000 / std::pow (x[2], 3);
+      }
 
-  for (F<functionType_t>::size_type i = 0; i < f->inputSize (); ++i)
-    problem.argumentBounds ()[static_cast<std::size_t> (i)] =
-      F<functionType_t>::makeLowerInterval (1e-5);
+      template <>
+      void
+      G<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref x, size_type) const
+      {
+	static const int pattern[][2] = {{0, 0}, {1, 1}, {2, 2}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = -8 / std::pow (x[0], 3);
+	h (1, 1) = -64 / std::pow (x[1], 3);
+	h (2, 2) = -240 / std::pow (x[2], 3);
+      }
 
-  boost::shared_ptr<G<functionType_t> > g =
-    boost::make_shared<G<functionType_t> > ();
-  problem.addConstraint (g, G<functionType_t>::makeLowerInterval (0.));
+      template <typename T>
+      void
+      G<T>::impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 0) = -8 / std::pow (x[0], 3);
+	h (1, 1) = -64 / std::pow (x[1], 3);
+	h (2, 2) = -240 / std::pow (x[2], 3);
+      }
 
-  F<functionType_t>::argument_t x (f->inputSize ());
-  x << 1., 1., 1.;
-  problem.startingPoint () = x;
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	for (typename F<T>::size_type i = 0; i < f->inputSize (); ++i)
+	  problem.argumentBounds ()[static_cast<std::size_t> (i)] =
+	    F<T>::makeLowerInterval (1e-5);
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-64");
+	boost::shared_ptr<G<T> > g =
+	  boost::make_shared<Instrumented<G<T> > > ();
+	problem.addConstraint (g, G<T>::makeLowerInterval (0.));
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+	typename F<T>::argument_t x (f->inputSize ());
+	x << 1., 1., 1.;
+	problem.startingPoint () = x;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	return pb;
+      }
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem64";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-64";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = 266035;
+	problem.expected.x = (ExpectedResult::argument_t (3)
+			      << 108.7347175, 85.12613942, 204.3247078).finished ();
+	problem.expected.fx = 6299.842428;
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem64.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem64)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem64::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
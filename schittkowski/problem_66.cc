@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,11 +25,11 @@ namespace roboptim
     namespace problem66
     {
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -36,11 +37,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (3, 1, "0.2x₂ - 0.8x₀")
       {}
 
@@ -58,8 +62,10 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref, size_type)
 	const
       {
-	grad.coeffRef (0) = -0.8;
-	grad.coeffRef (2) = 0.2;
+	static const int pattern[] = {0, 2};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = -0.8;
+	g (2) = 0.2;
       }
 
       template <typename T>
@@ -73,11 +79,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G : public GenericDifferentiableFunction<T>
+      class G : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G ();
 	void
@@ -85,11 +91,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref, const_argument_ref, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	  const;
       };
 
       template <typename T>
       G<T>::G ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (3, 2, "x₁ - exp(x₀), x₂ - exp(x₁)")
       {}
 
@@ -110,13 +119,21 @@ namespace roboptim
         switch (functionId)
           {
 	  case 0:
-	    grad.coeffRef (0) = -std::exp (x[0]);
-	    grad.coeffRef (1) = 1;
+	    {
+	      static const int pattern[] = {0, 1};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (0) = -std::exp (x[0]);
+	      g (1) = 1;
+	    }
 	    break;
 
 	  case 1:
-	    grad.coeffRef (1) = -std::exp (x[1]);
-	    grad.coeffRef (2) = 1;
+	    {
+	      static const int pattern[] = {1, 2};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (1) = -std::exp (x[1]);
+	      g (2) = 1;
+	    }
 	    break;
 	  }
       }
@@ -141,80 +158,125 @@ namespace roboptim
 	    break;
 	  }
       }
-    } // end of namespace problem66.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
-
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-BOOST_AUTO_TEST_CASE (schittkowski_problem66)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem66;
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+      }
 
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
+      template <>
+      void
+      G<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref x, size_type functionId) const
+      {
+	switch (functionId)
+	  {
+	  case 0:
+	    {
+	      static const int pattern[][2] = {{0, 0}};
+	      StructuredHessian<hessian_t> h (hess, pattern);
+	      h (0, 0) = -std::exp (x[0]);
+	    }
+	    break;
 
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 0.58;
-  expectedResult.x = (ExpectedResult::argument_t (3)
-                      << 0.1841264879, 1.202167873, 3.327322322
-                     ).finished ();
-  expectedResult.fx = 0.5181632741;
+	  case 1:
+	    {
+	      static const int pattern[][2] = {{1, 1}};
+	      StructuredHessian<hessian_t> h (hess, pattern);
+	      h (1, 1) = -std::exp (x[1]);
+	    }
+	    break;
+	  }
+      }
 
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
+      template <typename T>
+      void
+      G<T>::impl_hessian
+      (hessian_ref h, const_argument_ref x, size_type functionId) const
+      {
+	h.setZero ();
 
-  problem.argumentBounds ()[0] = F<functionType_t>::makeInterval (0., 100.);
-  problem.argumentBounds ()[1] = F<functionType_t>::makeInterval (0., 100.);
-  problem.argumentBounds ()[2] = F<functionType_t>::makeInterval (0., 10.);
+	switch (functionId)
+	  {
+	  case 0:
+	    h (0, 0) = -std::exp (x[0]);
+	    break;
 
-  boost::shared_ptr<G<functionType_t> > g =
-    boost::make_shared<G<functionType_t> > ();
+	  case 1:
+	    h (1, 1) = -std::exp (x[1]);
+	    break;
+	  }
+      }
 
-  solver_t::problem_t::intervals_t intervals;
-  intervals.push_back (G<functionType_t>::makeLowerInterval (0.));
-  intervals.push_back (G<functionType_t>::makeLowerInterval (0.));
-  solver_t::problem_t::scaling_t scaling
-    (static_cast<std::size_t> (g->outputSize ()), 1.);
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
 
-  problem.addConstraint (g, intervals, scaling);
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
 
-  F<functionType_t>::argument_t x (f->inputSize ());
-  x << 0, 1.05, 2.9;
-  problem.startingPoint () = x;
+	problem.argumentBounds ()[0] = F<T>::makeInterval (0., 100.);
+	problem.argumentBounds ()[1] = F<T>::makeInterval (0., 100.);
+	problem.argumentBounds ()[2] = F<T>::makeInterval (0., 10.);
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+	boost::shared_ptr<G<T> > g =
+	  boost::make_shared<Instrumented<G<T> > > ();
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	typename problem_t::intervals_t intervals;
+	intervals.push_back (G<T>::makeLowerInterval (0.));
+	intervals.push_back (G<T>::makeLowerInterval (0.));
+	typename problem_t::scaling_t scaling
+	  (static_cast<std::size_t> (g->outputSize ()), 1.);
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-66");
+	problem.addConstraint (g, intervals, scaling);
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+	typename F<T>::argument_t x (f->inputSize ());
+	x << 0, 1.05, 2.9;
+	problem.startingPoint () = x;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	return pb;
+      }
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem66";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-66";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = 0.58;
+	problem.expected.x = (ExpectedResult::argument_t (3)
+			      << 0.1841264879, 1.202167873, 3.327322322
+			     ).finished ();
+	problem.expected.fx = 0.5181632741;
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem66.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem66)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem66::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
@@ -16,6 +16,8 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "fused.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,7 +26,8 @@ namespace roboptim
     namespace problem71
     {
       template <typename T>
-      struct F : public GenericTwiceDifferentiableFunction<T>
+      struct F : public GenericTwiceDifferentiableFunction<T>,
+		 public GenericFusedEvaluation<T>
       {
 	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
 	(GenericTwiceDifferentiableFunction<T>);
@@ -47,10 +50,16 @@ namespace roboptim
 	void
 	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
 	  const;
+
+	// Shares x₀ x₃ and x₀ + x₁ + x₂.
+	void
+	impl_valueAndGradient (result_ref result, gradient_ref grad,
+			       const_argument_ref x, size_type) const;
       };
 
       template <typename T>
-      struct G0 : public GenericTwiceDifferentiableFunction<T>
+      struct G0 : public GenericTwiceDifferentiableFunction<T>,
+		  public GenericFusedEvaluation<T>
       {
 	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
 	(GenericTwiceDifferentiableFunction<T>);
@@ -74,6 +83,11 @@ namespace roboptim
 	void
 	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
 	  const;
+
+	// Shares x₀ x₁ and x₂ x₃.
+	void
+	impl_valueAndGradient (result_ref result, gradient_ref grad,
+			       const_argument_ref x, size_type) const;
       };
 
       template <typename T>
@@ -110,11 +124,12 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.setZero ();
-	grad.coeffRef (0) = x[0] * x[3] + x[3] * (x[0] + x[1] + x[2]);
-	grad.coeffRef (1) = x[0] * x[3];
-	grad.coeffRef (2) = x[0] * x[3] + 1;
-	grad.coeffRef (3) = x[0] * (x[0] + x[1] + x[2]);
+	static const int pattern[] = {0, 1, 2, 3};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = x[0] * x[3] + x[3] * (x[0] + x[1] + x[2]);
+	g (1) = x[0] * x[3];
+	g (2) = x[0] * x[3] + 1;
+	g (3) = x[0] * (x[0] + x[1] + x[2]);
       }
 
       template <typename T>
@@ -136,11 +151,12 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.reserve (4);
-	grad.coeffRef (0) = x[1] * x[2] * x[3];
-	grad.coeffRef (1) = x[0] * x[2] * x[3];
-	grad.coeffRef (2) = x[0] * x[1] * x[3];
-	grad.coeffRef (3) = x[0] * x[1] * x[2];
+	static const int pattern[] = {0, 1, 2, 3};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = x[1] * x[2] * x[3];
+	g (1) = x[0] * x[2] * x[3];
+	g (2) = x[0] * x[1] * x[3];
+	g (3) = x[0] * x[1] * x[2];
       }
 
       template <typename T>
@@ -162,11 +178,12 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.reserve (4);
-	grad.coeffRef (0) = 2 * x[0];
-	grad.coeffRef (1) = 2 * x[1];
-	grad.coeffRef (2) = 2 * x[2];
-	grad.coeffRef (3) = 2 * x[3];
+	static const int pattern[] = {0, 1, 2, 3};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = 2 * x[0];
+	g (1) = 2 * x[1];
+	g (2) = 2 * x[2];
+	g (3) = 2 * x[3];
       }
 
       template <typename T>
@@ -181,6 +198,74 @@ namespace roboptim
 	grad[3] = 2 * x[3];
       }
 
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_valueAndGradient
+      (result_ref result, gradient_ref grad, const_argument_ref x, size_type)
+	const
+      {
+	value_type p = x[0] * x[3];
+	value_type s = x[0] + x[1] + x[2];
+	result[0] = p * s + x[2];
+
+	static const int pattern[] = {0, 1, 2, 3};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = p + x[3] * s;
+	g (1) = p;
+	g (2) = p + 1;
+	g (3) = x[0] * s;
+      }
+
+      template <typename T>
+      void
+      F<T>::impl_valueAndGradient
+      (result_ref result, gradient_ref grad, const_argument_ref x, size_type)
+	const
+      {
+	value_type p = x[0] * x[3];
+	value_type s = x[0] + x[1] + x[2];
+	result[0] = p * s + x[2];
+
+	grad[0] = p + x[3] * s;
+	grad[1] = p;
+	grad[2] = p + 1;
+	grad[3] = x[0] * s;
+      }
+
+      template <>
+      void
+      G0<EigenMatrixSparse>::impl_valueAndGradient
+      (result_ref result, gradient_ref grad, const_argument_ref x, size_type)
+	const
+      {
+	value_type a = x[0] * x[1];
+	value_type b = x[2] * x[3];
+	result[0] = a * b;
+
+	static const int pattern[] = {0, 1, 2, 3};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = x[1] * b;
+	g (1) = x[0] * b;
+	g (2) = a * x[3];
+	g (3) = a * x[2];
+      }
+
+      template <typename T>
+      void
+      G0<T>::impl_valueAndGradient
+      (result_ref result, gradient_ref grad, const_argument_ref x, size_type)
+	const
+      {
+	value_type a = x[0] * x[1];
+	value_type b = x[2] * x[3];
+	result[0] = a * b;
+
+	grad[0] = x[1] * b;
+	grad[1] = x[0] * b;
+	grad[2] = a * x[3];
+	grad[3] = a * x[2];
+      }
+
       template <>
       void
       F<EigenMatrixSparse>::impl_hessian
@@ -196,7 +281,7 @@ namespace roboptim
 	h.coeffRef (1, 3) = x[0];
 
 	h.coeffRef (2, 0) = x[3];
-	h.coeffRef (2, 3) = x[1];
+	h.coeffRef (2, 3) = x[0];
 
 	h.coeffRef (3, 0) = 2 * x[0] + x[1] + x[2];
 	h.coeffRef (3, 1) = x[0];
@@ -222,7 +307,7 @@ namespace roboptim
 	h (2, 0) = x[3];
 	h (2, 1) = 0.;
 	h (2, 2) = 0.;
-	h (2, 3) = x[1];
+	h (2, 3) = x[0];
 
 	h (3, 0) = 2 * x[0] + x[1] + x[2];
 	h (3, 1) = x[0];
@@ -320,6 +405,70 @@ namespace roboptim
 	h (3, 2) = 0.;
 	h (3, 3) = 2.;
       }
+
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
+
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
+
+	// Set bound for all variables.
+	// 1. < x_i < 5. (x_i in [1.;5.])
+	for (std::size_t i = 0;
+	     i < static_cast<std::size_t> (problem.function ().inputSize ()); ++i)
+	  problem.argumentBounds ()[i] = Function::makeInterval (1., 5.);
+
+	// Add constraints.
+	boost::shared_ptr<G0<T> >
+	  g0 (new Instrumented<G0<T> > ());
+	boost::shared_ptr<G1<T> >
+	  g1 (new Instrumented<G1<T> > ());
+
+	problem.addConstraint
+	  (boost::static_pointer_cast<
+	    GenericDifferentiableFunction<T>  > (g0),
+	   Function::makeLowerInterval (25.));
+	problem.addConstraint
+	  (boost::static_pointer_cast<
+	    GenericDifferentiableFunction<T> > (g1),
+	   Function::makeInterval (40., 40.));
+
+	// Set the starting point.
+	typename F<T>::argument_t x (4);
+	x << 1., 5., 5., 1.;
+	problem.startingPoint () = x;
+
+	return pb;
+      }
+
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "problem_71";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-71";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-6;
+	problem.tolerances.x = 1e-3;
+	problem.tolerances.f = 1e-3;
+
+	problem.expected.f0 = 16.;
+	problem.expected.x = (ExpectedResult::argument_t (4)
+			      << 1., 4.742994, 3.8211503, 1.3794082).finished ();
+	problem.expected.fx = 17.0140173;
+	return problem;
+      }
+
+      static ProblemRegistrar registrar (descriptor ());
     } // end of namespace problem71.
   } // end of namespace schittkowski.
 } // end of namespace roboptim.
@@ -328,67 +477,7 @@ BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
 BOOST_AUTO_TEST_CASE (problem_71)
 {
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem71;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-6;
-  double x_tol = 1e-3;
-  double f_tol = 1e-3;
-
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 16.;
-  expectedResult.x = (ExpectedResult::argument_t (4)
-                      << 1., 4.742994, 3.8211503, 1.3794082).finished ();
-  expectedResult.fx = 17.0140173;
-
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
-
-  // Set bound for all variables.
-  // 1. < x_i < 5. (x_i in [1.;5.])
-  for (std::size_t i = 0;
-       i < static_cast<std::size_t> (problem.function ().inputSize ()); ++i)
-    problem.argumentBounds ()[i] = Function::makeInterval (1., 5.);
-
-  // Add constraints.
-  boost::shared_ptr<G0<functionType_t> > g0 (new G0<functionType_t> ());
-  boost::shared_ptr<G1<functionType_t> > g1 (new G1<functionType_t> ());
-
-  problem.addConstraint
-    (boost::static_pointer_cast<
-      GenericDifferentiableFunction<functionType_t>  > (g0),
-     Function::makeLowerInterval (25.));
-  problem.addConstraint
-    (boost::static_pointer_cast<
-      GenericDifferentiableFunction<functionType_t> > (g1),
-     Function::makeInterval (40., 40.));
-
-  // Set the starting point.
-  F<functionType_t>::argument_t x (4);
-  x << 1., 5., 5., 1.;
-  problem.startingPoint () = x;
-
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
-
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-71");
-
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
-
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
-
-  // Display solver information.
-  std::cout << solver << std::endl;
-
-  // Process the result
-  PROCESS_RESULT();
+  roboptim::solveProblem (roboptim::schittkowski::problem71::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -85,11 +86,12 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.setZero ();
-	grad.coeffRef (0) = x[0] * x[3] + x[3] * (x[0] + x[1] + x[2]);
-	grad.coeffRef (1) = x[0] * x[3];
-	grad.coeffRef (2) = x[0] * x[3] + 1;
-	grad.coeffRef (3) = x[0] * (x[0] + x[1] + x[2]);
+	static const int pattern[] = {0, 1, 2, 3};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = x[0] * x[3] + x[3] * (x[0] + x[1] + x[2]);
+	g (1) = x[0] * x[3];
+	g (2) = x[0] * x[3] + 1;
+	g (3) = x[0] * (x[0] + x[1] + x[2]);
       }
 
       template <typename T>
@@ -112,20 +114,21 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type functionId)
 	const
       {
-	grad.setZero ();
+	static const int pattern[] = {0, 1, 2, 3};
+	StructuredGradient<gradient_t> g (grad, pattern);
 	if (functionId == 0)
 	  {
-	    grad.coeffRef (0) = x[1] * x[2] * x[3];
-	    grad.coeffRef (1) = x[0] * x[2] * x[3];
-	    grad.coeffRef (2) = x[0] * x[1] * x[3];
-	    grad.coeffRef (3) = x[0] * x[1] * x[2];
+	    g (0) = x[1] * x[2] * x[3];
+	    g (1) = x[0] * x[2] * x[3];
+	    g (2) = x[0] * x[1] * x[3];
+	    g (3) = x[0] * x[1] * x[2];
 	  }
 	else
 	  {
-	    grad.coeffRef (0) = 2 * x[0];
-	    grad.coeffRef (1) = 2 * x[1];
-	    grad.coeffRef (2) = 2 * x[2];
-	    grad.coeffRef (3) = 2 * x[3];
+	    g (0) = 2 * x[0];
+	    g (1) = 2 * x[1];
+	    g (2) = 2 * x[2];
+	    g (3) = 2 * x[3];
 	  }
       }
 
@@ -167,7 +170,7 @@ namespace roboptim
 	h.coeffRef (1, 3) = x[0];
 
 	h.coeffRef (2, 0) = x[3];
-	h.coeffRef (2, 3) = x[1];
+	h.coeffRef (2, 3) = x[0];
 
 	h.coeffRef (3, 0) = 2 * x[0] + x[1] + x[2];
 	h.coeffRef (3, 1) = x[0];
@@ -193,7 +196,7 @@ namespace roboptim
 	h (2, 0) = x[3];
 	h (2, 1) = 0.;
 	h (2, 2) = 0.;
-	h (2, 3) = x[1];
+	h (2, 3) = x[0];
 
 	h (3, 0) = 2 * x[0] + x[1] + x[2];
 	h (3, 1) = x[0];
@@ -206,6 +209,7 @@ namespace roboptim
       G<EigenMatrixSparse>::impl_hessian
       (hessian_ref h, const_argument_ref x, size_type functionId) const
       {
+	h.setZero ();
 	if (functionId == 0)
 	  {
 	    h.coeffRef (0, 1) = x[2] * x[3];
@@ -240,6 +244,7 @@ namespace roboptim
       (hessian_ref h, const_argument_ref x, size_type functionId)
 	const
       {
+	h.setZero ();
 	if (functionId == 0)
 	  {
 	    h (0, 0) = 0.;
@@ -270,6 +275,72 @@ namespace roboptim
 	    h (3, 3) = 2.;
 	  }
       }
+
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
+
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
+
+	// Set bound for all variables.
+	// 1. < x_i < 5. (x_i in [1.;5.])
+	for (std::size_t i = 0;
+	     i < static_cast<std::size_t> (problem.function ().inputSize ()); ++i)
+	  problem.argumentBounds ()[i] = Function::makeInterval (1., 5.);
+
+	// Add constraints.
+	boost::shared_ptr<G<T> >
+	  g (new Instrumented<G<T> > ());
+
+	typename F<T>::intervals_t bounds;
+	bounds.push_back(Function::makeLowerInterval (25.));
+	bounds.push_back(Function::makeInterval (40., 40.));
+
+	typename problem_t::scaling_t scaling;
+	scaling.push_back (1.);
+	scaling.push_back (1.);
+
+	problem.addConstraint
+	  (boost::static_pointer_cast<
+	   GenericDifferentiableFunction<T>  > (g),
+	   bounds, scaling);
+
+	// Set the starting point.
+	typename F<T>::argument_t x (4);
+	x << 1., 5., 5., 1.;
+	problem.startingPoint () = x;
+
+	return pb;
+      }
+
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "problem_71b";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-71b";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-6;
+	problem.tolerances.x = 1e-3;
+	problem.tolerances.f = 1e-3;
+
+	problem.expected.f0 = 16.;
+	problem.expected.x = (ExpectedResult::argument_t (4)
+			      << 1., 4.742994, 3.8211503, 1.3794082).finished ();
+	problem.expected.fx = 17.0140173;
+	return problem;
+      }
+
+      static ProblemRegistrar registrar (descriptor ());
     } // end of namespace problem71b.
   } // end of namespace schittkowski.
 } // end of namespace roboptim.
@@ -278,70 +349,7 @@ BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
 BOOST_AUTO_TEST_CASE (problem_71b)
 {
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem71b;
-
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-6;
-  double x_tol = 1e-3;
-  double f_tol = 1e-3;
-
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 16.;
-  expectedResult.x = (ExpectedResult::argument_t (4)
-                      << 1., 4.742994, 3.8211503, 1.3794082).finished ();
-  expectedResult.fx = 17.0140173;
-
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
-
-  // Set bound for all variables.
-  // 1. < x_i < 5. (x_i in [1.;5.])
-  for (std::size_t i = 0;
-       i < static_cast<std::size_t> (problem.function ().inputSize ()); ++i)
-    problem.argumentBounds ()[i] = Function::makeInterval (1., 5.);
-
-  // Add constraints.
-  boost::shared_ptr<G<functionType_t> > g (new G<functionType_t> ());
-
-  F<functionType_t>::intervals_t bounds;
-  bounds.push_back(Function::makeLowerInterval (25.));
-  bounds.push_back(Function::makeInterval (40., 40.));
-
-  solver_t::problem_t::scaling_t scaling;
-  scaling.push_back (1.);
-  scaling.push_back (1.);
-
-  problem.addConstraint
-    (boost::static_pointer_cast<
-     GenericDifferentiableFunction<functionType_t>  > (g),
-     bounds, scaling);
-
-  // Set the starting point.
-  F<functionType_t>::argument_t x (4);
-  x << 1., 5., 5., 1.;
-  problem.startingPoint () = x;
-
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
-
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-71b");
-
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
-
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
-
-  // Display solver information.
-  std::cout << solver << std::endl;
-
-  // Process the result
-  PROCESS_RESULT();
+  roboptim::solveProblem (roboptim::schittkowski::problem71b::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,11 +25,11 @@ namespace roboptim
     namespace problem72
     {
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -36,11 +37,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (4, 1, "1 + x₀ + x₁ + x₂ + x₃")
       {}
 
@@ -58,10 +62,12 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref, size_type)
 	const
       {
-	grad.coeffRef (0) = 1;
-	grad.coeffRef (1) = 1;
-	grad.coeffRef (2) = 1;
-	grad.coeffRef (3) = 1;
+	static const int pattern[] = {0, 1, 2, 3};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = 1;
+	g (1) = 1;
+	g (2) = 1;
+	g (3) = 1;
       }
 
       template <typename T>
@@ -76,11 +82,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G : public GenericDifferentiableFunction<T>
+      class G : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G ();
 	void
@@ -88,11 +94,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref, const_argument_ref, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	  const;
       };
 
       template <typename T>
       G<T>::G ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (4, 2, "0.0401 - 4/x₀ - 2.25/x₁ - 1/x₂ - 0.25/x₃, "
 	   "0.010085 - 0.16/x₀ - 0.36/x₁ - 0.64/x₂ - 0.64/x₃")
       {}
@@ -114,17 +123,25 @@ namespace roboptim
         switch (functionId)
           {
 	  case 0:
-	    grad.coeffRef (0) = 4.   / (x[0] * x[0]);
-	    grad.coeffRef (1) = 2.25 / (x[1] * x[1]);
-	    grad.coeffRef (2) = 1.   / (x[2] * x[2]);
-	    grad.coeffRef (3) = 0.25 / (x[3] * x[3]);
+	    {
+	      static const int pattern[] = {0, 1, 2, 3};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (0) = 4.   / (x[0] * x[0]);
+	      g (1) = 2.25 / (x[1] * x[1]);
+	      g (2) = 1.   / (x[2] * x[2]);
+	      g (3) = 0.25 / (x[3] * x[3]);
+	    }
 	    break;
 
 	  case 1:
-	    grad.coeffRef (0) = 0.16 / (x[0] * x[0]);
-	    grad.coeffRef (1) = 0.36 / (x[1] * x[1]);
-	    grad.coeffRef (2) = 0.64 / (x[2] * x[2]);
-	    grad.coeffRef (3) = 0.64 / (x[3] * x[3]);
+	    {
+	      static const int pattern[] = {0, 1, 2, 3};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (0) = 0.16 / (x[0] * x[0]);
+	      g (1) = 0.36 / (x[1] * x[1]);
+	      g (2) = 0.64 / (x[2] * x[2]);
+	      g (3) = 0.64 / (x[3] * x[3]);
+	    }
 	    break;
 	  }
       }
@@ -153,81 +170,138 @@ namespace roboptim
 	    break;
 	  }
       }
-    } // end of namespace problem72.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
-
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-BOOST_AUTO_TEST_CASE (schittkowski_problem72)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem72;
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref, size_type)
+	const
+      {
+	h.setZero ();
+      }
 
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
+      template <>
+      void
+      G<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref x, size_type functionId) const
+      {
+	switch (functionId)
+	  {
+	  case 0:
+	    {
+	      static const int pattern[][2] = {{0, 0}, {1, 1}, {2, 2}, {3, 3}};
+	      StructuredHessian<hessian_t> h (hess, pattern);
+	      h (0, 0) = -8 / std::pow (x[0], 3);
+	      h (1, 1) = -4.5 / std::pow (x[1], 3);
+	      h (2, 2) = -2 / std::pow (x[2], 3);
+	      h (3, 3) = -0.5 / std::pow (x[3], 3);
+	    }
+	    break;
 
-  ExpectedResult expectedResult;
-  expectedResult.f0 = 5;
-  expectedResult.x = (ExpectedResult::argument_t (4)
-                      << 193.4071, 179.5475, 185.0186, 168.7062
-                     ).finished ();
-  expectedResult.fx = 727.67937;
+	  case 1:
+	    {
+	      static const int pattern[][2] = {{0, 0}, {1, 1}, {2, 2}, {3, 3}};
+	      StructuredHessian<hessian_t> h (hess, pattern);
+	      h (0, 0) = -0.32 / std::pow (x[0], 3);
+	      h (1, 1) = -0.72 / std::pow (x[1], 3);
+	      h (2, 2) = -1.28 / std::pow (x[2], 3);
+	      h (3, 3) = -1.28 / std::pow (x[3], 3);
+	    }
+	    break;
+	  }
+      }
 
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
+      template <typename T>
+      void
+      G<T>::impl_hessian
+      (hessian_ref h, const_argument_ref x, size_type functionId) const
+      {
+	h.setZero ();
 
-  for (F<functionType_t>::size_type i = 0; i < f->inputSize (); ++i)
-    problem.argumentBounds ()[static_cast<std::size_t> (i)] =
-      F<functionType_t>::makeInterval
-      (1e-3, (4. - static_cast<double> (i)) * 1e5);
+	switch (functionId)
+	  {
+	  case 0:
+	    h (0, 0) = -8 / std::pow (x[0], 3);
+	    h (1, 1) = -4.5 / std::pow (x[1], 3);
+	    h (2, 2) = -2 / std::pow (x[2], 3);
+	    h (3, 3) = -0.5 / std::pow (x[3], 3);
+	    break;
 
-  boost::shared_ptr<G<functionType_t> > g =
-    boost::make_shared<G<functionType_t> > ();
+	  case 1:
+	    h (0, 0) = -0.32 / std::pow (x[0], 3);
+	    h (1, 1) = -0.72 / std::pow (x[1], 3);
+	    h (2, 2) = -1.28 / std::pow (x[2], 3);
+	    h (3, 3) = -1.28 / std::pow (x[3], 3);
+	    break;
+	  }
+      }
 
-  solver_t::problem_t::intervals_t intervals;
-  for (F<functionType_t>::size_type i = 0; i < g->outputSize (); ++i)
-    intervals.push_back (G<functionType_t>::makeLowerInterval (0.));
-  solver_t::problem_t::scaling_t scaling
-    (static_cast<std::size_t> (g->outputSize ()), 1.);
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
 
-  problem.addConstraint (g, intervals, scaling);
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
 
-  F<functionType_t>::argument_t x (f->inputSize ());
-  x << 1, 1, 1, 1;
-  problem.startingPoint () = x;
+	for (typename F<T>::size_type i = 0; i < f->inputSize (); ++i)
+	  problem.argumentBounds ()[static_cast<std::size_t> (i)] =
+	    F<T>::makeInterval
+	    (1e-3, (4. - static_cast<double> (i)) * 1e5);
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+	boost::shared_ptr<G<T> > g =
+	  boost::make_shared<Instrumented<G<T> > > ();
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	typename problem_t::intervals_t intervals;
+	for (typename F<T>::size_type i = 0; i < g->outputSize (); ++i)
+	  intervals.push_back (G<T>::makeLowerInterval (0.));
+	typename problem_t::scaling_t scaling
+	  (static_cast<std::size_t> (g->outputSize ()), 1.);
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-72");
+	problem.addConstraint (g, intervals, scaling);
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+	typename F<T>::argument_t x (f->inputSize ());
+	x << 1, 1, 1, 1;
+	problem.startingPoint () = x;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	return pb;
+      }
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem72";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-72";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = 5;
+	problem.expected.x = (ExpectedResult::argument_t (4)
+			      << 193.4071, 179.5475, 185.0186, 168.7062
+			     ).finished ();
+	problem.expected.fx = 727.67937;
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem72.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem72)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem72::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
@@ -16,6 +16,7 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,11 +25,11 @@ namespace roboptim
     namespace problem78
     {
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -36,11 +37,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (5, 1, "x₀x₁x₂x₃x₄")
       {}
 
@@ -58,11 +62,13 @@ namespace roboptim
       (gradient_ref grad, const_argument_ref x, size_type)
 	const
       {
-	grad.coeffRef (0) = x[1] * x[2] * x[3] * x[4];
-	grad.coeffRef (1) = x[0] * x[2] * x[3] * x[4];
-	grad.coeffRef (2) = x[0] * x[1] * x[3] * x[4];
-	grad.coeffRef (3) = x[0] * x[1] * x[2] * x[4];
-	grad.coeffRef (4) = x[0] * x[1] * x[2] * x[3];
+	static const int pattern[] = {0, 1, 2, 3, 4};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = x[1] * x[2] * x[3] * x[4];
+	g (1) = x[0] * x[2] * x[3] * x[4];
+	g (2) = x[0] * x[1] * x[3] * x[4];
+	g (3) = x[0] * x[1] * x[2] * x[4];
+	g (4) = x[0] * x[1] * x[2] * x[3];
       }
 
       template <typename T>
@@ -78,11 +84,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G : public GenericDifferentiableFunction<T>
+      class G : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G ();
 	void
@@ -90,11 +96,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref, const_argument_ref, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	  const;
       };
 
       template <typename T>
       G<T>::G ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (5, 3, "x₀² + x₁² + x₂² + x₃² + x₄² - 10, x₁x₂ - 5x₃x₄, x₀³ + x₁³ + 1")
       {}
 
@@ -117,23 +126,35 @@ namespace roboptim
         switch (functionId)
           {
 	  case 0:
-	    grad.coeffRef (0) = 2 * x[0];
-	    grad.coeffRef (1) = 2 * x[1];
-	    grad.coeffRef (2) = 2 * x[2];
-	    grad.coeffRef (3) = 2 * x[3];
-	    grad.coeffRef (4) = 2 * x[4];
+	    {
+	      static const int pattern[] = {0, 1, 2, 3, 4};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (0) = 2 * x[0];
+	      g (1) = 2 * x[1];
+	      g (2) = 2 * x[2];
+	      g (3) = 2 * x[3];
+	      g (4) = 2 * x[4];
+	    }
 	    break;
 
 	  case 1:
-	    grad.coeffRef (1) = x[2];
-	    grad.coeffRef (2) = x[1];
-	    grad.coeffRef (3) = -5 * x[4];
-	    grad.coeffRef (4) = -5 * x[3];
+	    {
+	      static const int pattern[] = {1, 2, 3, 4};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (1) = x[2];
+	      g (2) = x[1];
+	      g (3) = -5 * x[4];
+	      g (4) = -5 * x[3];
+	    }
 	    break;
 
 	  case 2:
-	    grad.coeffRef (0) = 3 * x[0] * x[0];
-	    grad.coeffRef (1) = 3 * x[1] * x[1];
+	    {
+	      static const int pattern[] = {0, 1};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (0) = 3 * x[0] * x[0];
+	      g (1) = 3 * x[1] * x[1];
+	    }
 	    break;
 	  }
       }
@@ -168,76 +189,201 @@ namespace roboptim
 	    break;
 	  }
       }
-    } // end of namespace problem78.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
 
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref x, size_type) const
+      {
+	static const int pattern[][2] = {{0, 1}, {0, 2}, {0, 3}, {0, 4},
+	  {1, 0}, {1, 2}, {1, 3}, {1, 4}, {2, 0}, {2, 1}, {2, 3}, {2, 4},
+	  {3, 0}, {3, 1}, {3, 2}, {3, 4}, {4, 0}, {4, 1}, {4, 2}, {4, 3}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 1) = x[2] * x[3] * x[4];
+	h (0, 2) = x[1] * x[3] * x[4];
+	h (0, 3) = x[1] * x[2] * x[4];
+	h (0, 4) = x[1] * x[2] * x[3];
+	h (1, 0) = x[2] * x[3] * x[4];
+	h (1, 2) = x[0] * x[3] * x[4];
+	h (1, 3) = x[0] * x[2] * x[4];
+	h (1, 4) = x[0] * x[2] * x[3];
+	h (2, 0) = x[1] * x[3] * x[4];
+	h (2, 1) = x[0] * x[3] * x[4];
+	h (2, 3) = x[0] * x[1] * x[4];
+	h (2, 4) = x[0] * x[1] * x[3];
+	h (3, 0) = x[1] * x[2] * x[4];
+	h (3, 1) = x[0] * x[2] * x[4];
+	h (3, 2) = x[0] * x[1] * x[4];
+	h (3, 4) = x[0] * x[1] * x[2];
+	h (4, 0) = x[1] * x[2] * x[3];
+	h (4, 1) = x[0] * x[2] * x[3];
+	h (4, 2) = x[0] * x[1] * x[3];
+	h (4, 3) = x[0] * x[1] * x[2];
+      }
 
-BOOST_AUTO_TEST_CASE (schittkowski_problem78)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem78;
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	const
+      {
+	h.setZero ();
+	h (0, 1) = x[2] * x[3] * x[4];
+	h (0, 2) = x[1] * x[3] * x[4];
+	h (0, 3) = x[1] * x[2] * x[4];
+	h (0, 4) = x[1] * x[2] * x[3];
+	h (1, 0) = x[2] * x[3] * x[4];
+	h (1, 2) = x[0] * x[3] * x[4];
+	h (1, 3) = x[0] * x[2] * x[4];
+	h (1, 4) = x[0] * x[2] * x[3];
+	h (2, 0) = x[1] * x[3] * x[4];
+	h (2, 1) = x[0] * x[3] * x[4];
+	h (2, 3) = x[0] * x[1] * x[4];
+	h (2, 4) = x[0] * x[1] * x[3];
+	h (3, 0) = x[1] * x[2] * x[4];
+	h (3, 1) = x[0] * x[2] * x[4];
+	h (3, 2) = x[0] * x[1] * x[4];
+	h (3, 4) = x[0] * x[1] * x[2];
+	h (4, 0) = x[1] * x[2] * x[3];
+	h (4, 1) = x[0] * x[2] * x[3];
+	h (4, 2) = x[0] * x[1] * x[3];
+	h (4, 3) = x[0] * x[1] * x[2];
+      }
+
+      template <>
+      void
+      G<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref x, size_type functionId) const
+      {
+	switch (functionId)
+	  {
+	  case 0:
+	    {
+	      static const int pattern[][2] = {{0, 0}, {1, 1}, {2, 2}, {3, 3},
+		{4, 4}};
+	      StructuredHessian<hessian_t> h (hess, pattern);
+	      h (0, 0) = 2.;
+	      h (1, 1) = 2.;
+	      h (2, 2) = 2.;
+	      h (3, 3) = 2.;
+	      h (4, 4) = 2.;
+	    }
+	    break;
+
+	  case 1:
+	    {
+	      static const int pattern[][2] = {{1, 2}, {2, 1}, {3, 4}, {4, 3}};
+	      StructuredHessian<hessian_t> h (hess, pattern);
+	      h (1, 2) = 1.;
+	      h (2, 1) = 1.;
+	      h (3, 4) = -5.;
+	      h (4, 3) = -5.;
+	    }
+	    break;
 
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
+	  case 2:
+	    {
+	      static const int pattern[][2] = {{0, 0}, {1, 1}};
+	      StructuredHessian<hessian_t> h (hess, pattern);
+	      h (0, 0) = 6 * x[0];
+	      h (1, 1) = 6 * x[1];
+	    }
+	    break;
+	  }
+      }
 
-  ExpectedResult expectedResult;
-  expectedResult.f0 = -6.;
-  expectedResult.x = (ExpectedResult::argument_t (5)
-                      << -1.717142, 1.595708, 1.827248, -0.7636429, -0.7636435
-                     ).finished ();
-  expectedResult.fx = -2.91970041;
+      template <typename T>
+      void
+      G<T>::impl_hessian
+      (hessian_ref h, const_argument_ref x, size_type functionId) const
+      {
+	h.setZero ();
 
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
+	switch (functionId)
+	  {
+	  case 0:
+	    h (0, 0) = 2.;
+	    h (1, 1) = 2.;
+	    h (2, 2) = 2.;
+	    h (3, 3) = 2.;
+	    h (4, 4) = 2.;
+	    break;
 
-  boost::shared_ptr<G<functionType_t> > g =
-    boost::make_shared<G<functionType_t> > ();
+	  case 1:
+	    h (1, 2) = 1.;
+	    h (2, 1) = 1.;
+	    h (3, 4) = -5.;
+	    h (4, 3) = -5.;
+	    break;
 
-  solver_t::problem_t::intervals_t intervals;
-  for (F<functionType_t>::size_type i = 0; i < g->outputSize (); ++i)
-    intervals.push_back (G<functionType_t>::makeInterval (0., 0.));
-  solver_t::problem_t::scaling_t scaling
-    (static_cast<std::size_t> (g->outputSize ()), 1.);
+	  case 2:
+	    h (0, 0) = 6 * x[0];
+	    h (1, 1) = 6 * x[1];
+	    break;
+	  }
+      }
 
-  problem.addConstraint (g, intervals, scaling);
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
 
-  F<functionType_t>::argument_t x (f->inputSize ());
-  x << -2, 1.5, 2, -1, -1;
-  problem.startingPoint () = x;
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+	boost::shared_ptr<G<T> > g =
+	  boost::make_shared<Instrumented<G<T> > > ();
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	typename problem_t::intervals_t intervals;
+	for (typename F<T>::size_type i = 0; i < g->outputSize (); ++i)
+	  intervals.push_back (G<T>::makeInterval (0., 0.));
+	typename problem_t::scaling_t scaling
+	  (static_cast<std::size_t> (g->outputSize ()), 1.);
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-78");
+	problem.addConstraint (g, intervals, scaling);
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+	typename F<T>::argument_t x (f->inputSize ());
+	x << -2, 1.5, 2, -1, -1;
+	problem.startingPoint () = x;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	return pb;
+      }
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem78";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-78";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = -6.;
+	problem.expected.x = (ExpectedResult::argument_t (5)
+			      << -1.717142, 1.595708, 1.827248, -0.7636429, -0.7636435
+			     ).finished ();
+	problem.expected.fx = -2.91970041;
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem78.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem78)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem78::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
@@ -16,6 +16,8 @@
 // along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "common.hh"
+#include "fused.hh"
+#include "sparsity.hh"
 
 namespace roboptim
 {
@@ -24,11 +26,12 @@ namespace roboptim
     namespace problem81
     {
       template <typename T>
-      class F : public GenericDifferentiableFunction<T>
+      class F : public GenericTwiceDifferentiableFunction<T>,
+		public GenericTwiceFusedEvaluation<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit F ();
 	void
@@ -36,11 +39,43 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref grad, const_argument_ref x, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	  const;
+	void
+	impl_valueAndGradient (result_ref result, gradient_ref grad,
+			       const_argument_ref x, size_type) const;
+	void
+	impl_valueGradientAndHessian (result_ref result, gradient_ref grad,
+				      hessian_ref h, const_argument_ref x,
+				      size_type) const;
+
+      private:
+	/// \brief Subexpressions shared by the value and the derivatives.
+	struct Terms
+	{
+	  /// \brief exp (x₀x₁x₂x₃x₄).
+	  value_type e;
+	  /// \brief x₀³ + x₁³ + 1.
+	  value_type b;
+	  /// \brief ∂(x₀x₁x₂x₃x₄)/∂xᵢ.
+	  value_type q[5];
+	};
+
+	void terms (Terms& t, const_argument_ref x) const;
+
+	template <typename G>
+	void writeGradient (G& grad, const Terms& t, const_argument_ref x)
+	  const;
+
+	template <typename H>
+	void writeHessian (H& h, const Terms& t, const_argument_ref x)
+	  const;
       };
 
       template <typename T>
       F<T>::F ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (5, 1, "exp(x₀x₁x₂x₃x₄) - 0.5(x₀³ + x₁³ + 1)²")
       {}
 
@@ -61,14 +96,15 @@ namespace roboptim
       {
 	double alpha = std::exp (x[0] * x[1] * x[2] * x[3] * x[4]);
 	double beta = std::pow (x[0], 3) + std::pow (x[1], 3) + 1;
-
-	grad.coeffRef (0) = (x[1] * x[2] * x[3] * x[4]) * alpha
+	static const int pattern[] = {0, 1, 2, 3, 4};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	g (0) = (x[1] * x[2] * x[3] * x[4]) * alpha
 	  - 3 * x[0] * x[0] * beta;
-	grad.coeffRef (1) = (x[0] * x[2] * x[3] * x[4]) * alpha
+	g (1) = (x[0] * x[2] * x[3] * x[4]) * alpha
 	  - 3 * x[1] * x[1] * beta;
-	grad.coeffRef (2) = (x[0] * x[1] * x[3] * x[4]) * alpha;
-	grad.coeffRef (3) = (x[0] * x[1] * x[2] * x[4]) * alpha;
-	grad.coeffRef (4) = (x[0] * x[1] * x[2] * x[3]) * alpha;
+	g (2) = (x[0] * x[1] * x[3] * x[4]) * alpha;
+	g (3) = (x[0] * x[1] * x[2] * x[4]) * alpha;
+	g (4) = (x[0] * x[1] * x[2] * x[3]) * alpha;
       }
 
       template <typename T>
@@ -89,11 +125,11 @@ namespace roboptim
       }
 
       template <typename T>
-      class G : public GenericDifferentiableFunction<T>
+      class G : public GenericTwiceDifferentiableFunction<T>
       {
       public:
-	ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
-	(GenericDifferentiableFunction<T>);
+	ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+	(GenericTwiceDifferentiableFunction<T>);
 
 	explicit G ();
 	void
@@ -101,11 +137,14 @@ namespace roboptim
 	void
 	impl_gradient (gradient_ref, const_argument_ref, size_type)
 	  const;
+	void
+	impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	  const;
       };
 
       template <typename T>
       G<T>::G ()
-	: GenericDifferentiableFunction<T>
+	: GenericTwiceDifferentiableFunction<T>
 	  (5, 3, "x₀² + x₁² + x₂² + x₃² + x₄² - 10, x₁x₂ - 5x₃x₄, x₀³ + x₁³ + 1")
       {}
 
@@ -128,23 +167,35 @@ namespace roboptim
 	switch (functionId)
 	  {
 	  case 0:
-	    grad.coeffRef (0) = 2 * x[0];
-	    grad.coeffRef (1) = 2 * x[1];
-	    grad.coeffRef (2) = 2 * x[2];
-	    grad.coeffRef (3) = 2 * x[3];
-	    grad.coeffRef (4) = 2 * x[4];
+	    {
+	      static const int pattern[] = {0, 1, 2, 3, 4};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (0) = 2 * x[0];
+	      g (1) = 2 * x[1];
+	      g (2) = 2 * x[2];
+	      g (3) = 2 * x[3];
+	      g (4) = 2 * x[4];
+	    }
 	    break;
 
 	  case 1:
-	    grad.coeffRef (1) = x[2];
-	    grad.coeffRef (2) = x[1];
-	    grad.coeffRef (3) = -5 * x[4];
-	    grad.coeffRef (4) = -5 * x[3];
+	    {
+	      static const int pattern[] = {1, 2, 3, 4};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (1) = x[2];
+	      g (2) = x[1];
+	      g (3) = -5 * x[4];
+	      g (4) = -5 * x[3];
+	    }
 	    break;
 
 	  case 2:
-	    grad.coeffRef (0) = 3 * x[0] * x[0];
-	    grad.coeffRef (1) = 3 * x[1] * x[1];
+	    {
+	      static const int pattern[] = {0, 1};
+	      StructuredGradient<gradient_t> g (grad, pattern);
+	      g (0) = 3 * x[0] * x[0];
+	      g (1) = 3 * x[1] * x[1];
+	    }
 	    break;
 	  }
       }
@@ -179,82 +230,386 @@ namespace roboptim
 	    break;
 	  }
       }
-    } // end of namespace problem81.
-  } // end of namespace schittkowski.
-} // end of namespace roboptim.
 
-BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
+      template <typename T>
+      void
+      F<T>::terms (Terms& t, const_argument_ref x) const
+      {
+	// Products of the other variables, without division (x may have
+	// zero entries).
+	value_type left = 1.;
+	for (int i = 0; i < 5; ++i)
+	  {
+	    t.q[i] = left;
+	    left *= x[i];
+	  }
+	value_type right = 1.;
+	for (int i = 4; i >= 0; --i)
+	  {
+	    t.q[i] *= right;
+	    right *= x[i];
+	  }
+	t.e = std::exp (left);
+	t.b = x[0] * x[0] * x[0] + x[1] * x[1] * x[1] + 1;
+      }
 
-BOOST_AUTO_TEST_CASE (schittkowski_problem81)
-{
-  using namespace roboptim;
-  using namespace roboptim::schittkowski::problem81;
+      template <typename T>
+      template <typename G>
+      void
+      F<T>::writeGradient (G& grad, const Terms& t, const_argument_ref x)
+	const
+      {
+	grad (0) = t.e * t.q[0] - 3 * x[0] * x[0] * t.b;
+	grad (1) = t.e * t.q[1] - 3 * x[1] * x[1] * t.b;
+	grad (2) = t.e * t.q[2];
+	grad (3) = t.e * t.q[3];
+	grad (4) = t.e * t.q[4];
+      }
+
+      template <typename T>
+      template <typename H>
+      void
+      F<T>::writeHessian (H& h, const Terms& t, const_argument_ref x)
+	const
+      {
+	// ∂(x₀³ + x₁³ + 1)/∂xᵢ.
+	const value_type db[] = {3 * x[0] * x[0], 3 * x[1] * x[1], 0., 0., 0.};
+	for (int i = 0; i < 5; ++i)
+	  for (int j = 0; j < 5; ++j)
+	    {
+	      // ∂²(x₀x₁x₂x₃x₄)/∂xᵢ∂xⱼ: product of the three other variables.
+	      value_type r = 0.;
+	      if (i != j)
+		{
+		  r = 1.;
+		  for (int k = 0; k < 5; ++k)
+		    if (k != i && k != j)
+		      r *= x[k];
+		}
+	      h (i, j) = t.e * (t.q[i] * t.q[j] + r) - db[i] * db[j]
+		- ((i == j && i < 2) ? 6 * x[i] * t.b : 0.);
+	    }
+      }
+
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_valueAndGradient
+      (result_ref result, gradient_ref grad, const_argument_ref x, size_type)
+	const
+      {
+	Terms t;
+	terms (t, x);
+	result[0] = t.e - 0.5 * t.b * t.b;
+
+	static const int pattern[] = {0, 1, 2, 3, 4};
+	StructuredGradient<gradient_t> g (grad, pattern);
+	writeGradient (g, t, x);
+      }
+
+      template <typename T>
+      void
+      F<T>::impl_valueAndGradient
+      (result_ref result, gradient_ref grad, const_argument_ref x, size_type)
+	const
+      {
+	Terms t;
+	terms (t, x);
+	result[0] = t.e - 0.5 * t.b * t.b;
+	writeGradient (grad, t, x);
+      }
+
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_valueGradientAndHessian
+      (result_ref result, gradient_ref grad, hessian_ref hess,
+       const_argument_ref x, size_type) const
+      {
+	Terms t;
+	terms (t, x);
+	result[0] = t.e - 0.5 * t.b * t.b;
+
+	static const int gradientPattern[] = {0, 1, 2, 3, 4};
+	StructuredGradient<gradient_t> g (grad, gradientPattern);
+	writeGradient (g, t, x);
+
+	static const int pattern[][2] = {{0, 0}, {0, 1}, {0, 2}, {0, 3},
+	  {0, 4}, {1, 0}, {1, 1}, {1, 2}, {1, 3}, {1, 4}, {2, 0}, {2, 1},
+	  {2, 2}, {2, 3}, {2, 4}, {3, 0}, {3, 1}, {3, 2}, {3, 3}, {3, 4},
+	  {4, 0}, {4, 1}, {4, 2}, {4, 3}, {4, 4}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	writeHessian (h, t, x);
+      }
+
+      template <typename T>
+      void
+      F<T>::impl_valueGradientAndHessian
+      (result_ref result, gradient_ref grad, hessian_ref h,
+       const_argument_ref x, size_type) const
+      {
+	Terms t;
+	terms (t, x);
+	result[0] = t.e - 0.5 * t.b * t.b;
+	writeGradient (grad, t, x);
+	writeHessian (h, t, x);
+      }
+
+      template <>
+      void
+      F<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref x, size_type) const
+      {
+	value_type e = std::exp (x[0] * x[1] * x[2] * x[3] * x[4]);
+	static const int pattern[][2] = {{0, 0}, {0, 1}, {0, 2}, {0, 3},
+	  {0, 4}, {1, 0}, {1, 1}, {1, 2}, {1, 3}, {1, 4}, {2, 0}, {2, 1},
+	  {2, 2}, {2, 3}, {2, 4}, {3, 0}, {3, 1}, {3, 2}, {3, 3}, {3, 4},
+	  {4, 0}, {4, 1}, {4, 2}, {4, 3}, {4, 4}};
+	StructuredHessian<hessian_t> h (hess, pattern);
+	h (0, 0) = e * x[1] * x[1] * x[2] * x[2] * x[3] * x[3] * x[4] * x[4]
+	  - 15 * std::pow (x[0], 4) - 6 * x[0] * std::pow (x[1], 3) - 6 * x[0];
+	h (0, 1) = e * x[0] * x[1] * x[2] * x[2] * x[3] * x[3] * x[4] * x[4]
+	  + e * x[2] * x[3] * x[4] - 9 * x[0] * x[0] * x[1] * x[1];
+	h (0, 2) =
+	  e * x[1] * x[3] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (0, 3) =
+	  e * x[1] * x[2] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (0, 4) =
+	  e * x[1] * x[2] * x[3] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (1, 0) = e * x[0] * x[1] * x[2] * x[2] * x[3] * x[3] * x[4] * x[4]
+	  + e * x[2] * x[3] * x[4] - 9 * x[0] * x[0] * x[1] * x[1];
+	h (1, 1) = e * x[0] * x[0] * x[2] * x[2] * x[3] * x[3] * x[4] * x[4]
+	  - 6 * x[1] * std::pow (x[0], 3) - 15 * std::pow (x[1], 4) - 6 * x[1];
+	h (1, 2) =
+	  e * x[0] * x[3] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (1, 3) =
+	  e * x[0] * x[2] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (1, 4) =
+	  e * x[0] * x[2] * x[3] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (2, 0) =
+	  e * x[1] * x[3] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (2, 1) =
+	  e * x[0] * x[3] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (2, 2) = e * x[0] * x[0] * x[1] * x[1] * x[3] * x[3] * x[4] * x[4];
+	h (2, 3) =
+	  e * x[0] * x[1] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (2, 4) =
+	  e * x[0] * x[1] * x[3] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (3, 0) =
+	  e * x[1] * x[2] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (3, 1) =
+	  e * x[0] * x[2] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (3, 2) =
+	  e * x[0] * x[1] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (3, 3) = e * x[0] * x[0] * x[1] * x[1] * x[2] * x[2] * x[4] * x[4];
+	h (3, 4) =
+	  e * x[0] * x[1] * x[2] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (4, 0) =
+	  e * x[1] * x[2] * x[3] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (4, 1) =
+	  e * x[0] * x[2] * x[3] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (4, 2) =
+	  e * x[0] * x[1] * x[3] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (4, 3) =
+	  e * x[0] * x[1] * x[2] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (4, 4) = e * x[0] * x[0] * x[1] * x[1] * x[2] * x[2] * x[3] * x[3];
+      }
 
-  // Tolerances for Boost checks.
-  double f0_tol = 1e-4;
-  double x_tol = 1e-4;
-  double f_tol = 1e-4;
+      template <typename T>
+      void
+      F<T>::impl_hessian (hessian_ref h, const_argument_ref x, size_type)
+	const
+      {
+	h.setZero ();
+	value_type e = std::exp (x[0] * x[1] * x[2] * x[3] * x[4]);
+	h (0, 0) = e * x[1] * x[1] * x[2] * x[2] * x[3] * x[3] * x[4] * x[4]
+	  - 15 * std::pow (x[0], 4) - 6 * x[0] * std::pow (x[1], 3) - 6 * x[0];
+	h (0, 1) = e * x[0] * x[1] * x[2] * x[2] * x[3] * x[3] * x[4] * x[4]
+	  + e * x[2] * x[3] * x[4] - 9 * x[0] * x[0] * x[1] * x[1];
+	h (0, 2) =
+	  e * x[1] * x[3] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (0, 3) =
+	  e * x[1] * x[2] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (0, 4) =
+	  e * x[1] * x[2] * x[3] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (1, 0) = e * x[0] * x[1] * x[2] * x[2] * x[3] * x[3] * x[4] * x[4]
+	  + e * x[2] * x[3] * x[4] - 9 * x[0] * x[0] * x[1] * x[1];
+	h (1, 1) = e * x[0] * x[0] * x[2] * x[2] * x[3] * x[3] * x[4] * x[4]
+	  - 6 * x[1] * std::pow (x[0], 3) - 15 * std::pow (x[1], 4) - 6 * x[1];
+	h (1, 2) =
+	  e * x[0] * x[3] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (1, 3) =
+	  e * x[0] * x[2] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (1, 4) =
+	  e * x[0] * x[2] * x[3] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (2, 0) =
+	  e * x[1] * x[3] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (2, 1) =
+	  e * x[0] * x[3] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (2, 2) = e * x[0] * x[0] * x[1] * x[1] * x[3] * x[3] * x[4] * x[4];
+	h (2, 3) =
+	  e * x[0] * x[1] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (2, 4) =
+	  e * x[0] * x[1] * x[3] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (3, 0) =
+	  e * x[1] * x[2] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (3, 1) =
+	  e * x[0] * x[2] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (3, 2) =
+	  e * x[0] * x[1] * x[4] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (3, 3) = e * x[0] * x[0] * x[1] * x[1] * x[2] * x[2] * x[4] * x[4];
+	h (3, 4) =
+	  e * x[0] * x[1] * x[2] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (4, 0) =
+	  e * x[1] * x[2] * x[3] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (4, 1) =
+	  e * x[0] * x[2] * x[3] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (4, 2) =
+	  e * x[0] * x[1] * x[3] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (4, 3) =
+	  e * x[0] * x[1] * x[2] * (x[0] * x[1] * x[2] * x[3] * x[4] + 1);
+	h (4, 4) = e * x[0] * x[0] * x[1] * x[1] * x[2] * x[2] * x[3] * x[3];
+      }
+
+      template <>
+      void
+      G<EigenMatrixSparse>::impl_hessian
+      (hessian_ref hess, const_argument_ref x, size_type functionId) const
+      {
+	switch (functionId)
+	  {
+	  case 0:
+	    {
+	      static const int pattern[][2] = {{0, 0}, {1, 1}, {2, 2}, {3, 3},
+		{4, 4}};
+	      StructuredHessian<hessian_t> h (hess, pattern);
+	      h (0, 0) = 2.;
+	      h (1, 1) = 2.;
+	      h (2, 2) = 2.;
+	      h (3, 3) = 2.;
+	      h (4, 4) = 2.;
+	    }
+	    break;
+
+	  case 1:
+	    {
+	      static const int pattern[][2] = {{1, 2}, {2, 1}, {3, 4}, {4, 3}};
+	      StructuredHessian<hessian_t> h (hess, pattern);
+	      h (1, 2) = 1.;
+	      h (2, 1) = 1.;
+	      h (3, 4) = -5.;
+	      h (4, 3) = -5.;
+	    }
+	    break;
+
+	  case 2:
+	    {
+	      static const int pattern[][2] = {{0, 0}, {1, 1}};
+	      StructuredHessian<hessian_t> h (hess, pattern);
+	      h (0, 0) = 6 * x[0];
+	      h (1, 1) = 6 * x[1];
+	    }
+	    break;
+	  }
+      }
 
-  ExpectedResult expectedResult;
-  expectedResult.f0 = std::exp (-8) - 0.5;
-  expectedResult.x = (ExpectedResult::argument_t (5)
-                      << -1.717142, 1.159571, 1.827248, -0.7636474, -0.7636390
-                     ).finished ();
-  expectedResult.fx = 0.0539498478;
+      template <typename T>
+      void
+      G<T>::impl_hessian
+      (hessian_ref h, const_argument_ref x, size_type functionId) const
+      {
+	h.setZero ();
 
-  // Build problem.
-  boost::shared_ptr<F<functionType_t> > f (new F<functionType_t> ());
-  solver_t::problem_t problem (f);
+	switch (functionId)
+	  {
+	  case 0:
+	    h (0, 0) = 2.;
+	    h (1, 1) = 2.;
+	    h (2, 2) = 2.;
+	    h (3, 3) = 2.;
+	    h (4, 4) = 2.;
+	    break;
 
-  problem.argumentBounds ()[0] = F<functionType_t>::makeInterval (-2.3, 2.3);
-  problem.argumentBounds ()[1] = F<functionType_t>::makeInterval (-2.3, 2.3);
-  problem.argumentBounds ()[2] = F<functionType_t>::makeInterval (-3.2, 3.2);
-  problem.argumentBounds ()[3] = F<functionType_t>::makeInterval (-3.2, 3.2);
-  problem.argumentBounds ()[4] = F<functionType_t>::makeInterval (-3.2, 3.2);
+	  case 1:
+	    h (1, 2) = 1.;
+	    h (2, 1) = 1.;
+	    h (3, 4) = -5.;
+	    h (4, 3) = -5.;
+	    break;
 
-  boost::shared_ptr<G<functionType_t> > g =
-    boost::make_shared<G<functionType_t> > ();
+	  case 2:
+	    h (0, 0) = 6 * x[0];
+	    h (1, 1) = 6 * x[1];
+	    break;
+	  }
+      }
 
-  solver_t::problem_t::intervals_t intervals;
-  for (F<functionType_t>::size_type i = 0; i < g->outputSize (); ++i)
-    intervals.push_back (G<functionType_t>::makeInterval (0., 0.));
-  solver_t::problem_t::scaling_t scaling
-    (static_cast<std::size_t> (g->outputSize ()), 1.);
+      template <typename T>
+      boost::shared_ptr<typename Solver<T>::problem_t>
+      buildProblem ()
+      {
+	typedef typename Solver<T>::problem_t problem_t;
 
-  problem.addConstraint (g, intervals, scaling);
+	boost::shared_ptr<F<T> >
+	  f (new Instrumented<F<T> > ());
+	boost::shared_ptr<problem_t> pb =
+	  boost::make_shared<problem_t> (f);
+	problem_t& problem = *pb;
 
-  F<functionType_t>::argument_t x (f->inputSize ());
-  x << -2, 2, 2, -1, -1;
-  problem.startingPoint () = x;
+	problem.argumentBounds ()[0] = F<T>::makeInterval (-2.3, 2.3);
+	problem.argumentBounds ()[1] = F<T>::makeInterval (-2.3, 2.3);
+	problem.argumentBounds ()[2] = F<T>::makeInterval (-3.2, 3.2);
+	problem.argumentBounds ()[3] = F<T>::makeInterval (-3.2, 3.2);
+	problem.argumentBounds ()[4] = F<T>::makeInterval (-3.2, 3.2);
 
-  BOOST_CHECK_SMALL_OR_CLOSE ((*f) (x)[0], expectedResult.f0, f0_tol);
+	boost::shared_ptr<G<T> > g =
+	  boost::make_shared<Instrumented<G<T> > > ();
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	typename problem_t::intervals_t intervals;
+	for (typename F<T>::size_type i = 0; i < g->outputSize (); ++i)
+	  intervals.push_back (G<T>::makeInterval (0., 0.));
+	typename problem_t::scaling_t scaling
+	  (static_cast<std::size_t> (g->outputSize ()), 1.);
 
-  // Initialize solver.
-  SolverFactory<solver_t> factory (SOLVER_NAME, problem);
-  solver_t& solver = factory ();
-  // Set optimization logger
-  SET_OPTIMIZATION_LOGGER (solver, "schittkowski/problem-81");
+	problem.addConstraint (g, intervals, scaling);
 
-  // Set optional log file for debugging
-  SET_LOG_FILE(solver);
+	typename F<T>::argument_t x (f->inputSize ());
+	x << -2, 2, 2, -1, -1;
+	problem.startingPoint () = x;
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+	return pb;
+      }
 
-  // Compute the minimum and retrieve the result.
-  solver_t::result_t res = solver.minimum ();
+      ProblemDescriptor descriptor ()
+      {
+	ProblemDescriptor problem;
+	problem.name = "schittkowski_problem81";
+	problem.category = "schittkowski";
+	problem.logName = "schittkowski/problem-81";
+	problem.dense = &buildProblem<EigenMatrixDense>;
+	problem.sparse = &buildProblem<EigenMatrixSparse>;
+
+	// Tolerances for Boost checks.
+	problem.tolerances.f0 = 1e-4;
+	problem.tolerances.x = 1e-4;
+	problem.tolerances.f = 1e-4;
+
+	problem.expected.f0 = std::exp (-8) - 0.5;
+	problem.expected.x = (ExpectedResult::argument_t (5)
+			      << -1.717142, 1.159571, 1.827248, -0.7636474, -0.7636390
+			     ).finished ();
+	problem.expected.fx = 0.0539498478;
+	return problem;
+      }
 
-  std::cout << f->inputSize () << std::endl;
-  std::cout << problem.function ().inputSize () << std::endl;
+      static ProblemRegistrar registrar (descriptor ());
+    } // end of namespace problem81.
+  } // end of namespace schittkowski.
+} // end of namespace roboptim.
 
-  // Display solver information.
-  std::cout << solver << std::endl;
+BOOST_FIXTURE_TEST_SUITE (schittkowski, TestSuiteConfiguration)
 
-  // Process the result
-  PROCESS_RESULT();
+BOOST_AUTO_TEST_CASE (schittkowski_problem81)
+{
+  roboptim::solveProblem (roboptim::schittkowski::problem81::descriptor ());
 }
 
 BOOST_AUTO_TEST_SUITE_END ()
@@ -3,7 +3,11 @@
 
 # include <Eigen/Sparse>
 # include <Eigen/Dense>
+# include <boost/mpl/int.hpp>
+# include <boost/mpl/integral_c_tag.hpp>
+# include <boost/serialization/array.hpp>
 # include <boost/serialization/split_free.hpp>
+# include <boost/serialization/version.hpp>
 # include <boost/serialization/vector.hpp>
 
 // Obtained from: https://gist.github.com/mtao/5798888
@@ -59,39 +63,67 @@ namespace boost {
       split_free (ar,m,version);
     }
 
+    // Sparse matrices are saved in compressed storage (version 1): the
+    // outer index, inner index and value arrays are written as they are,
+    // and read back directly into the matrix. Version 0 archives store
+    // triplets.
     template <class Archive, typename _Scalar, int _Options,typename _Index>
     void save (Archive & ar, const Eigen::SparseMatrix<_Scalar,_Options,_Index> & m, const unsigned int /*version*/)
     {
-      int innerSize = m.innerSize ();
-      int outerSize = m.outerSize ();
-      typedef typename Eigen::Triplet<_Scalar> Triplet;
-      std::vector<Triplet> triplets;
-      for (int i = 0; i < outerSize; ++i)
+      typedef Eigen::SparseMatrix<_Scalar,_Options,_Index> matrix_t;
+
+      // Uncompressed matrices are compressed in a copy.
+      matrix_t compressed;
+      const matrix_t* pm = &m;
+      if (!m.isCompressed ())
 	{
-	  for (typename Eigen::SparseMatrix<_Scalar,_Options,_Index>::InnerIterator it (m,i); it; ++it)
-	    {
-	      triplets.push_back (Triplet (it.row (), it.col (), it.value ()));
-	    }
+	  compressed = m;
+	  compressed.makeCompressed ();
+	  pm = &compressed;
 	}
-      ar & innerSize;
-      ar & outerSize;
-      ar & triplets;
+
+      typename matrix_t::Index rows = pm->rows ();
+      typename matrix_t::Index cols = pm->cols ();
+      typename matrix_t::Index nnz = pm->nonZeros ();
+      ar & rows;
+      ar & cols;
+      ar & nnz;
+      ar & boost::serialization::make_array (pm->outerIndexPtr (), static_cast<std::size_t> (pm->outerSize () + 1));
+      ar & boost::serialization::make_array (pm->innerIndexPtr (), static_cast<std::size_t> (nnz));
+      ar & boost::serialization::make_array (pm->valuePtr (), static_cast<std::size_t> (nnz));
     }
 
     template <class Archive, typename _Scalar, int _Options, typename _Index>
-    void load (Archive & ar, Eigen::SparseMatrix<_Scalar,_Options,_Index>  & m, const unsigned int /*version*/)
+    void load (Archive & ar, Eigen::SparseMatrix<_Scalar,_Options,_Index>  & m, const unsigned int version)
     {
-      int innerSize;
-      int outerSize;
-      ar & innerSize;
-      ar & outerSize;
-      int rows = m.IsRowMajor?outerSize:innerSize;
-      int cols = m.IsRowMajor?innerSize:outerSize;
-      m.resize (rows,cols);
-      typedef typename Eigen::Triplet<_Scalar> Triplet;
-      std::vector<Triplet> triplets;
-      ar & triplets;
-      m.setFromTriplets (triplets.begin (), triplets.end ());
+      if (version == 0)
+	{
+	  int innerSize;
+	  int outerSize;
+	  ar & innerSize;
+	  ar & outerSize;
+	  int rows = m.IsRowMajor?outerSize:innerSize;
+	  int cols = m.IsRowMajor?innerSize:outerSize;
+	  m.resize (rows,cols);
+	  typedef typename Eigen::Triplet<_Scalar> Triplet;
+	  std::vector<Triplet> triplets;
+	  ar & triplets;
+	  m.setFromTriplets (triplets.begin (), triplets.end ());
+	  return;
+	}
+
+      typedef Eigen::SparseMatrix<_Scalar,_Options,_Index> matrix_t;
+      typename matrix_t::Index rows, cols, nnz;
+      ar & rows;
+      ar & cols;
+      ar & nnz;
+
+      // resize () leaves the matrix empty and compressed.
+      m.resize (rows, cols);
+      m.resizeNonZeros (nnz);
+      ar & boost::serialization::make_array (m.outerIndexPtr (), static_cast<std::size_t> (m.outerSize () + 1));
+      ar & boost::serialization::make_array (m.innerIndexPtr (), static_cast<std::size_t> (nnz));
+      ar & boost::serialization::make_array (m.valuePtr (), static_cast<std::size_t> (nnz));
     }
 
     template <class Archive, typename _Scalar, int _Options, typename _Index>
@@ -99,6 +131,14 @@ namespace boost {
     {
       split_free (ar,m,version);
     }
+
+    template <typename _Scalar, int _Options, typename _Index>
+    struct version<Eigen::SparseMatrix<_Scalar,_Options,_Index> >
+    {
+      typedef mpl::int_<1> type;
+      typedef mpl::integral_c_tag tag;
+      BOOST_STATIC_CONSTANT (int, value = version::type::value);
+    };
   }
 }
 
@@ -0,0 +1,499 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_SPARSITY_HH
+# define ROBOPTIM_SHARED_TESTS_SPARSITY_HH
+# include <algorithm>
+# include <chrono>
+# include <cstddef>
+# include <iomanip>
+# include <iostream>
+# include <stdexcept>
+# include <vector>
+
+# include <boost/noncopyable.hpp>
+# include <boost/static_assert.hpp>
+# include <boost/type_traits/is_same.hpp>
+
+# include <Eigen/SparseCore>
+
+# include <roboptim/core/differentiable-function.hh>
+
+namespace roboptim
+{
+  /// \brief Strategy used to fill sparse gradients and Jacobians.
+  enum SparseFillMode
+  {
+    /// \brief Write the values into the pre-declared structure.
+    SPARSE_FILL_PATTERN,
+    /// \brief Insert each value with coeffRef (reference behavior).
+    SPARSE_FILL_INSERT
+  };
+
+  /// \brief Current fill strategy (used to benchmark both strategies on
+  /// the same problem code).
+  ///
+  /// The strategy is per thread, so that changing it does not affect the
+  /// functions evaluated by other threads (see runJobs). Use
+  /// ScopedSparseFillMode to change it.
+  inline SparseFillMode& sparseFillMode ()
+  {
+    static thread_local SparseFillMode mode = SPARSE_FILL_PATTERN;
+    return mode;
+  }
+
+  /// \brief Set the fill strategy of the current thread, and restore the
+  /// previous one when destroyed.
+  class ScopedSparseFillMode : boost::noncopyable
+  {
+  public:
+    explicit ScopedSparseFillMode (SparseFillMode mode)
+      : previous_ (sparseFillMode ())
+    {
+      sparseFillMode () = mode;
+    }
+
+    ~ScopedSparseFillMode ()
+    {
+      sparseFillMode () = previous_;
+    }
+
+  private:
+    SparseFillMode previous_;
+  };
+
+  /// \brief Writer for a sparse gradient with a pre-declared structure.
+  ///
+  /// The nonzero indices are declared once (e.g. as a static array) and
+  /// the values are then written in that order, directly into the value
+  /// array of the gradient. The structure is only (re)built when the
+  /// gradient does not already have it:
+  ///
+  /// \code
+  /// static const int pattern[] = {0, 2, 3};
+  /// StructuredGradient<gradient_t> g (grad, pattern);
+  /// g (0) = 2 * x[0];
+  /// g (2) = -1.;
+  /// g (3) = x[0] * x[0];
+  /// \endcode
+  ///
+  /// Writing a value out of the order of the pattern throws
+  /// std::runtime_error, since it would go to the wrong nonzero.
+  ///
+  /// \tparam V sparse vector type.
+  template <typename V>
+  class StructuredGradient
+  {
+  public:
+    typedef V gradient_t;
+    typedef typename gradient_t::Scalar value_type;
+
+    /// \param grad gradient to fill.
+    /// \param pattern sorted nonzero indices.
+    template <std::size_t N>
+    StructuredGradient (gradient_t& grad, const int (&pattern)[N])
+      : grad_ (grad),
+        pattern_ (pattern),
+        size_ (N),
+        values_ (0),
+        position_ (0)
+    {
+      init ();
+    }
+
+    /// \param grad gradient to fill.
+    /// \param pattern sorted nonzero indices.
+    /// \param size number of nonzeros.
+    StructuredGradient (gradient_t& grad, const int* pattern, std::size_t size)
+      : grad_ (grad),
+        pattern_ (pattern),
+        size_ (size),
+        values_ (0),
+        position_ (0)
+    {
+      init ();
+    }
+
+    /// \brief Next value of the pattern, at index i.
+    ///
+    /// \throw std::runtime_error if i is not the next index of the pattern.
+    value_type& operator () (std::ptrdiff_t i)
+    {
+      if (!values_)
+        return grad_.coeffRef (i);
+
+      if (position_ >= size_ || pattern_[position_] != i)
+        throw std::runtime_error
+          ("sparse gradient value written out of the order of its pattern");
+      return values_[position_++];
+    }
+
+  private:
+    void init ()
+    {
+      if (sparseFillMode () == SPARSE_FILL_INSERT)
+        return;
+
+      bool structured = static_cast<std::size_t> (grad_.nonZeros ()) == size_
+        && std::equal (pattern_, pattern_ + size_, grad_.innerIndexPtr ());
+
+      if (!structured)
+        {
+          grad_.setZero ();
+          grad_.reserve (static_cast<typename gradient_t::Index> (size_));
+          for (std::size_t k = 0; k < size_; ++k)
+            grad_.insertBack (pattern_[k]) = 0.;
+        }
+
+      values_ = grad_.valuePtr ();
+    }
+
+    gradient_t& grad_;
+    const int* pattern_;
+    std::size_t size_;
+    value_type* values_;
+    std::size_t position_;
+  };
+
+  /// \brief Nonzero structure of a row-major sparse Jacobian.
+  struct SparsityPattern
+  {
+    /// \brief Start of each row in inner (compressed row storage).
+    std::vector<int> outer;
+
+    /// \brief Column indices of the nonzeros, row by row.
+    std::vector<int> inner;
+
+    SparsityPattern ()
+      : outer (1, 0),
+        inner ()
+    {}
+
+    /// \brief Append a row with the given sorted column indices.
+    template <std::size_t N>
+    void addRow (const int (&cols)[N])
+    {
+      addRow (cols, N);
+    }
+
+    /// \brief Append a row with the given sorted column indices.
+    void addRow (const int* cols, std::size_t size)
+    {
+      inner.insert (inner.end (), cols, cols + size);
+      outer.push_back (static_cast<int> (inner.size ()));
+    }
+
+    /// \brief Column indices of a given row.
+    const int* row (std::size_t i) const
+    {
+      return inner.data () + outer[i];
+    }
+
+    /// \brief Number of nonzeros of a given row.
+    std::size_t rowSize (std::size_t i) const
+    {
+      return static_cast<std::size_t> (outer[i + 1] - outer[i]);
+    }
+
+    /// \brief Number of nonzeros.
+    std::size_t nonZeros () const
+    {
+      return inner.size ();
+    }
+  };
+
+  /// \brief Writer for a row-major sparse Jacobian with a pre-declared
+  /// structure (see StructuredGradient). Values are written row by row,
+  /// in the order of the pattern.
+  ///
+  /// \tparam M row-major sparse matrix type.
+  template <typename M>
+  class StructuredJacobian
+  {
+  public:
+    typedef M jacobian_t;
+    typedef typename jacobian_t::Scalar value_type;
+
+    BOOST_STATIC_ASSERT (jacobian_t::IsRowMajor);
+
+    StructuredJacobian (jacobian_t& jac, const SparsityPattern& pattern)
+      : jac_ (jac),
+        pattern_ (pattern),
+        values_ (0),
+        position_ (0)
+    {
+      if (sparseFillMode () == SPARSE_FILL_INSERT)
+        return;
+
+      bool structured = jac_.isCompressed ()
+        && static_cast<std::size_t> (jac_.nonZeros ()) == pattern_.nonZeros ()
+        && static_cast<std::size_t> (jac_.outerSize () + 1)
+        == pattern_.outer.size ()
+        && std::equal (pattern_.outer.begin (), pattern_.outer.end (),
+                       jac_.outerIndexPtr ())
+        && std::equal (pattern_.inner.begin (), pattern_.inner.end (),
+                       jac_.innerIndexPtr ());
+
+      if (!structured)
+        {
+          jac_.setZero ();
+          jac_.makeCompressed ();
+          jac_.reserve (static_cast<typename jacobian_t::Index>
+                        (pattern_.nonZeros ()));
+          for (std::size_t row = 0; row + 1 < pattern_.outer.size (); ++row)
+            {
+              jac_.startVec (static_cast<typename jacobian_t::Index> (row));
+              for (int k = pattern_.outer[row]; k < pattern_.outer[row + 1]; ++k)
+                jac_.insertBack (static_cast<typename jacobian_t::Index> (row),
+                                 pattern_.inner[k]) = 0.;
+            }
+          jac_.finalize ();
+        }
+
+      values_ = jac_.valuePtr ();
+    }
+
+    /// \brief Next value of the pattern, at (row, col).
+    ///
+    /// \throw std::runtime_error if (row, col) is not the next nonzero of
+    /// the pattern.
+    value_type& operator () (std::ptrdiff_t row, std::ptrdiff_t col)
+    {
+      if (!values_)
+        return jac_.coeffRef (row, col);
+
+      if (position_ >= pattern_.nonZeros ()
+          || row < 0
+          || static_cast<std::size_t> (row) + 1 >= pattern_.outer.size ()
+          || pattern_.inner[position_] != col
+          || pattern_.outer[static_cast<std::size_t> (row)]
+          > static_cast<int> (position_)
+          || static_cast<int> (position_)
+          >= pattern_.outer[static_cast<std::size_t> (row) + 1])
+        throw std::runtime_error
+          ("sparse Jacobian value written out of the order of its pattern");
+      return values_[position_++];
+    }
+
+  private:
+    jacobian_t& jac_;
+    const SparsityPattern& pattern_;
+    value_type* values_;
+    std::size_t position_;
+  };
+
+  /// \brief Writer for a row-major sparse Hessian with a pre-declared
+  /// structure (see StructuredGradient).
+  ///
+  /// The nonzeros are declared as (row, column) pairs sorted in row-major
+  /// order, both triangles included, and the values are written in that
+  /// order:
+  ///
+  /// \code
+  /// static const int pattern[][2] = {{0, 0}, {0, 1}, {1, 0}};
+  /// StructuredHessian<hessian_t> h (hess, pattern);
+  /// h (0, 0) = 2.;
+  /// h (0, 1) = x[2];
+  /// h (1, 0) = x[2];
+  /// \endcode
+  ///
+  /// \tparam M row-major sparse matrix type.
+  template <typename M>
+  class StructuredHessian
+  {
+  public:
+    typedef M hessian_t;
+    typedef typename hessian_t::Scalar value_type;
+    typedef typename hessian_t::Index index_t;
+
+    BOOST_STATIC_ASSERT (hessian_t::IsRowMajor);
+
+    /// \param hess Hessian to fill.
+    /// \param pattern sorted (row, column) pairs of the nonzeros.
+    template <std::size_t N>
+    StructuredHessian (hessian_t& hess, const int (&pattern)[N][2])
+      : hess_ (hess),
+        pattern_ (pattern),
+        size_ (N),
+        values_ (0),
+        position_ (0)
+    {
+      if (sparseFillMode () == SPARSE_FILL_INSERT)
+        {
+          hess_.setZero ();
+          return;
+        }
+
+      bool structured = hess_.isCompressed ()
+        && static_cast<std::size_t> (hess_.nonZeros ()) == size_;
+      for (std::size_t k = 0; structured && k < size_; ++k)
+        structured = hess_.innerIndexPtr ()[k] == pattern_[k][1]
+          && hess_.outerIndexPtr ()[pattern_[k][0]] <= static_cast<int> (k)
+          && static_cast<int> (k) < hess_.outerIndexPtr ()[pattern_[k][0] + 1];
+
+      if (!structured)
+        {
+          hess_.setZero ();
+          hess_.makeCompressed ();
+          hess_.reserve (static_cast<index_t> (size_));
+          std::size_t k = 0;
+          for (index_t row = 0; row < hess_.outerSize (); ++row)
+            {
+              hess_.startVec (row);
+              for (; k < size_ && pattern_[k][0] == row; ++k)
+                hess_.insertBack (row, pattern_[k][1]) = 0.;
+            }
+          hess_.finalize ();
+        }
+
+      values_ = hess_.valuePtr ();
+    }
+
+    /// \brief Next value of the pattern, at (row, col).
+    ///
+    /// \throw std::runtime_error if (row, col) is not the next nonzero of
+    /// the pattern.
+    value_type& operator () (std::ptrdiff_t row, std::ptrdiff_t col)
+    {
+      if (!values_)
+        return hess_.coeffRef (row, col);
+
+      if (position_ >= size_
+          || pattern_[position_][0] != row
+          || pattern_[position_][1] != col)
+        throw std::runtime_error
+          ("sparse Hessian value written out of the order of its pattern");
+      return values_[position_++];
+    }
+
+  private:
+    hessian_t& hess_;
+    const int (*pattern_)[2];
+    std::size_t size_;
+    value_type* values_;
+    std::size_t position_;
+  };
+
+  namespace detail
+  {
+    /// \brief Time needed to evaluate all the gradients of a function
+    /// (in seconds).
+    ///
+    /// \param f function.
+    /// \param x evaluation point.
+    /// \param reset whether to clear the gradient before each evaluation,
+    /// i.e. insert all the nonzeros.
+    template <typename F>
+    double gradientsTime (const F& f, const typename F::argument_t& x,
+                          bool reset)
+    {
+      typedef typename F::gradient_t gradient_t;
+      typedef typename F::size_type size_type;
+
+      std::vector<gradient_t> grads
+        (static_cast<std::size_t> (f.outputSize ()),
+         gradient_t (f.inputSize ()));
+      for (size_type i = 0; i < f.outputSize (); ++i)
+        f.gradient (grads[static_cast<std::size_t> (i)], x, i);
+
+      // Repeat until the measure is long enough to be meaningful.
+      for (long reps = 1; ; reps *= 2)
+        {
+          std::chrono::steady_clock::time_point start
+            = std::chrono::steady_clock::now ();
+          for (long r = 0; r < reps; ++r)
+            for (size_type i = 0; i < f.outputSize (); ++i)
+              {
+                gradient_t& g = grads[static_cast<std::size_t> (i)];
+                if (reset)
+                  g.setZero ();
+                f.gradient (g, x, i);
+              }
+          double t = std::chrono::duration<double>
+            (std::chrono::steady_clock::now () - start).count ();
+          if (t > 1e-2 || reps >= (1L << 24))
+            return t / static_cast<double> (reps);
+        }
+    }
+
+    /// \brief Largest difference between two matrices, relative to
+    /// 1 + |reference value|.
+    template <typename A, typename B>
+    double derivativeError (const A& a, const B& reference)
+    {
+      Eigen::MatrixXd da (a);
+      Eigen::MatrixXd db (reference);
+      return ((da - db).array ().abs ()
+              / (1. + db.array ().abs ())).maxCoeff ();
+    }
+  } // end of namespace detail
+
+  /// \brief Compare the sparse gradient fill strategies on a problem.
+  ///
+  /// For the cost function and all the constraints, print the time
+  /// needed to evaluate all the gradients at the starting point when:
+  ///  - inserting every nonzero in an empty gradient (coeffRef),
+  ///  - overwriting a gradient that already has the nonzeros (coeffRef),
+  ///  - writing into the pre-declared structure (StructuredGradient).
+  ///
+  /// Nothing is done for dense problems.
+  ///
+  /// \param o output stream.
+  /// \param problem problem.
+  template <typename P>
+  void benchmarkSparseFill (std::ostream& o, const P& problem)
+  {
+    typedef typename P::function_t function_t;
+    typedef typename function_t::traits_t traits_t;
+    typedef typename P::argument_t argument_t;
+
+    if (!boost::is_same<traits_t, EigenMatrixSparse>::value)
+      return;
+
+    argument_t x = problem.startingPoint ()
+      ? *problem.startingPoint ()
+      : argument_t (argument_t::Zero (problem.function ().inputSize ()));
+
+    double t[3] = {0., 0., 0.};
+    for (std::size_t c = 0; c <= problem.constraints ().size (); ++c)
+      {
+        const function_t& f = (c == 0)
+          ? problem.function () : *problem.constraints ()[c - 1];
+
+        {
+          ScopedSparseFillMode insert (SPARSE_FILL_INSERT);
+          t[0] += detail::gradientsTime (f, x, true);
+          t[1] += detail::gradientsTime (f, x, false);
+        }
+        ScopedSparseFillMode pattern (SPARSE_FILL_PATTERN);
+        t[2] += detail::gradientsTime (f, x, false);
+      }
+
+    o << "Sparse gradient fill (all functions, ns per evaluation):"
+      << std::endl
+      << std::setw (12) << "insert"
+      << std::setw (12) << "coeffRef"
+      << std::setw (12) << "pattern"
+      << std::setw (12) << "speedup" << std::endl
+      << std::setw (12) << 1e9 * t[0]
+      << std::setw (12) << 1e9 * t[1]
+      << std::setw (12) << 1e9 * t[2]
+      << std::setw (12) << t[0] / t[2] << std::endl;
+  }
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_SPARSITY_HH
@@ -0,0 +1,342 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_STACKED_HH
+# define ROBOPTIM_SHARED_TESTS_STACKED_HH
+# include <cstddef>
+# include <stdexcept>
+# include <string>
+# include <vector>
+
+# include <boost/make_shared.hpp>
+# include <boost/shared_ptr.hpp>
+
+# include <roboptim/core/linear-function.hh>
+# include <roboptim/core/twice-differentiable-function.hh>
+
+# include "registry.hh"
+
+namespace roboptim
+{
+  /// \brief Several constraints stacked in a single function, as the two
+  /// constraints of problem 71 in problem 71b.
+  ///
+  /// The outputs of the functions are concatenated in order. Each call is
+  /// forwarded to the functions (the gradient and Hessian of an output to
+  /// the function owning it), so that the evaluations of instrumented
+  /// functions are still counted. The Jacobian is assembled from the
+  /// gradients, as for the Schittkowski constraints.
+  ///
+  /// \tparam B function type of the stacked function
+  /// (GenericDifferentiableFunction, GenericLinearFunction...). The
+  /// Hessians are forwarded by GenericTwiceStackedFunction.
+  template <typename B>
+  class GenericStackedFunction : public B
+  {
+  public:
+    ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_ (B);
+
+    typedef GenericDifferentiableFunction<typename B::traits_t> component_t;
+    typedef boost::shared_ptr<const component_t> componentPtr_t;
+
+    /// \brief Stack functions with the same input size.
+    ///
+    /// \param functions stacked functions (at least one).
+    explicit GenericStackedFunction (const std::vector<componentPtr_t>& functions)
+      : B (functions.front ()->inputSize (), outputSize (functions),
+           name (functions)),
+        functions_ (functions),
+        offsets_ (),
+        component_ (),
+        local_ ()
+    {
+      size_type offset = 0;
+      for (std::size_t i = 0; i < functions_.size (); ++i)
+        {
+          if (functions_[i]->inputSize () != this->inputSize ())
+            throw std::runtime_error
+              ("cannot stack functions of different input sizes");
+
+          offsets_.push_back (offset);
+          for (size_type j = 0; j < functions_[i]->outputSize (); ++j)
+            {
+              component_.push_back (i);
+              local_.push_back (j);
+            }
+          offset += functions_[i]->outputSize ();
+        }
+    }
+
+    /// \brief Stacked functions.
+    const std::vector<componentPtr_t>& functions () const
+    {
+      return functions_;
+    }
+
+  protected:
+    void impl_compute (result_ref result, const_argument_ref x) const
+    {
+      for (std::size_t i = 0; i < functions_.size (); ++i)
+        (*functions_[i])
+          (result.segment (offsets_[i], functions_[i]->outputSize ()), x);
+    }
+
+    void impl_gradient (gradient_ref grad, const_argument_ref x,
+                        size_type functionId) const
+    {
+      std::size_t id = static_cast<std::size_t> (functionId);
+      functions_[component_[id]]->gradient (grad, x, local_[id]);
+    }
+
+    /// \brief Function owning each output.
+    const std::vector<std::size_t>& component () const
+    {
+      return component_;
+    }
+
+    /// \brief Index of each output in the function owning it.
+    const std::vector<size_type>& local () const
+    {
+      return local_;
+    }
+
+  private:
+    static size_type outputSize (const std::vector<componentPtr_t>& functions)
+    {
+      size_type m = 0;
+      for (std::size_t i = 0; i < functions.size (); ++i)
+        m += functions[i]->outputSize ();
+      return m;
+    }
+
+    static std::string name (const std::vector<componentPtr_t>& functions)
+    {
+      std::string names;
+      for (std::size_t i = 0; i < functions.size (); ++i)
+        names += (i ? "\n" : "") + functions[i]->getName ();
+      return names;
+    }
+
+    std::vector<componentPtr_t> functions_;
+    std::vector<size_type> offsets_;
+    std::vector<std::size_t> component_;
+    std::vector<size_type> local_;
+  };
+
+  /// \brief Twice-differentiable functions stacked in a single function.
+  template <typename T>
+  class GenericTwiceStackedFunction
+    : public GenericStackedFunction<GenericTwiceDifferentiableFunction<T> >
+  {
+  public:
+    typedef GenericStackedFunction<GenericTwiceDifferentiableFunction<T> >
+    stacked_t;
+    ROBOPTIM_TWICE_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_ (stacked_t);
+
+    typedef typename stacked_t::componentPtr_t componentPtr_t;
+
+    /// \brief Stack twice-differentiable functions with the same input
+    /// size.
+    explicit GenericTwiceStackedFunction
+    (const std::vector<componentPtr_t>& functions)
+      : stacked_t (functions),
+        twice_ ()
+    {
+      for (std::size_t i = 0; i < functions.size (); ++i)
+        {
+          twice_.push_back
+            (dynamic_cast<const GenericTwiceDifferentiableFunction<T>*>
+             (functions[i].get ()));
+          if (!twice_.back ())
+            throw std::runtime_error
+              (functions[i]->getName () + " is not twice differentiable");
+        }
+    }
+
+  protected:
+    void impl_hessian (hessian_ref h, const_argument_ref x,
+                       size_type functionId) const
+    {
+      std::size_t id = static_cast<std::size_t> (functionId);
+      twice_[this->component ()[id]]->hessian (h, x, this->local ()[id]);
+    }
+
+  private:
+    /// \brief Stacked functions, resolved once.
+    std::vector<const GenericTwiceDifferentiableFunction<T>*> twice_;
+  };
+
+  namespace detail
+  {
+    /// \brief Constraints of the same kind, stacked together by
+    /// stackConstraints.
+    template <typename T>
+    struct StackedGroup
+    {
+      typedef typename Solver<T>::problem_t problem_t;
+      typedef typename problem_t::constraints_t::value_type constraint_t;
+      typedef typename GenericStackedFunction<GenericDifferentiableFunction<T> >
+      ::componentPtr_t componentPtr_t;
+
+      std::vector<constraint_t> constraints;
+      std::vector<componentPtr_t> functions;
+      typename problem_t::intervals_t bounds;
+      typename problem_t::scaling_t scaling;
+
+      /// \brief Add the stacked constraint (or the only constraint) of the
+      /// group to a problem.
+      ///
+      /// \tparam S stacked function type.
+      /// \tparam B function type of the constraint in the problem.
+      template <typename S, typename B>
+      void addTo (problem_t& problem) const
+      {
+        if (constraints.empty ())
+          return;
+
+        if (constraints.size () == 1)
+          problem.addConstraint
+            (boost::dynamic_pointer_cast<B> (constraints.front ()),
+             bounds, scaling);
+        else
+          problem.addConstraint
+            (boost::static_pointer_cast<B>
+             (boost::make_shared<S> (functions)), bounds, scaling);
+      }
+    };
+  } // end of namespace detail
+
+  /// \brief Copy of a problem whose constraints of the same kind are
+  /// stacked in a single function, as in problem 71b.
+  ///
+  /// Linear constraints are stacked in a linear function, so that solvers
+  /// still see them as linear, and nonlinear constraints in a
+  /// twice-differentiable function if they all are, else in a
+  /// differentiable one. The cost function, argument bounds, scaling and
+  /// starting point are shared with the original problem, which is kept
+  /// alive by the copy.
+  ///
+  /// \param original problem to copy.
+  ///
+  /// \return problem with at most one constraint of each kind.
+  template <typename T>
+  boost::shared_ptr<typename Solver<T>::problem_t>
+  stackConstraints (const boost::shared_ptr<typename Solver<T>::problem_t>&
+                    original)
+  {
+    typedef typename Solver<T>::problem_t problem_t;
+    typedef typename problem_t::function_t function_t;
+    typedef detail::StackedGroup<T> group_t;
+
+    // The copy shares the cost function, and ownership of the original.
+    boost::shared_ptr<const function_t> cost (original, &original->function ());
+    boost::shared_ptr<problem_t> pb = boost::make_shared<problem_t> (cost);
+    pb->argumentBounds () = original->argumentBounds ();
+    pb->argumentScaling () = original->argumentScaling ();
+    pb->argumentNames () = original->argumentNames ();
+    pb->startingPoint () = original->startingPoint ();
+
+    group_t linear, twice, differentiable;
+    for (std::size_t i = 0; i < original->constraints ().size (); ++i)
+      {
+        typename group_t::componentPtr_t g =
+          boost::dynamic_pointer_cast<const GenericDifferentiableFunction<T> >
+          (original->constraints ()[i]);
+        if (!g)
+          throw std::runtime_error
+            ("cannot stack " + original->constraints ()[i]->getName ()
+             + ": not differentiable");
+
+        group_t& group =
+          boost::dynamic_pointer_cast<const GenericLinearFunction<T> > (g)
+          ? linear
+          : (boost::dynamic_pointer_cast
+             <const GenericTwiceDifferentiableFunction<T> > (g)
+             ? twice : differentiable);
+
+        group.constraints.push_back (original->constraints ()[i]);
+        group.functions.push_back (g);
+        group.bounds.insert (group.bounds.end (),
+                             original->boundsVector ()[i].begin (),
+                             original->boundsVector ()[i].end ());
+        group.scaling.insert (group.scaling.end (),
+                              original->scalingVector ()[i].begin (),
+                              original->scalingVector ()[i].end ());
+      }
+
+    // Mixing twice-differentiable and differentiable constraints gives a
+    // differentiable function.
+    if (!differentiable.constraints.empty ())
+      {
+        differentiable.constraints.insert (differentiable.constraints.begin (),
+                                           twice.constraints.begin (),
+                                           twice.constraints.end ());
+        differentiable.functions.insert (differentiable.functions.begin (),
+                                         twice.functions.begin (),
+                                         twice.functions.end ());
+        differentiable.bounds.insert (differentiable.bounds.begin (),
+                                      twice.bounds.begin (),
+                                      twice.bounds.end ());
+        differentiable.scaling.insert (differentiable.scaling.begin (),
+                                       twice.scaling.begin (),
+                                       twice.scaling.end ());
+        twice = group_t ();
+      }
+
+    linear.template addTo<GenericStackedFunction<GenericLinearFunction<T> >,
+                          GenericLinearFunction<T> > (*pb);
+    twice.template addTo<GenericTwiceStackedFunction<T>,
+                         GenericTwiceDifferentiableFunction<T> > (*pb);
+    differentiable.template addTo
+      <GenericStackedFunction<GenericDifferentiableFunction<T> >,
+       GenericDifferentiableFunction<T> > (*pb);
+    return pb;
+  }
+
+  /// \brief Whether stacking the constraints of a registered problem
+  /// reduces its number of constraint functions (see stackConstraints).
+  template <typename T>
+  bool hasStackableConstraints (const ProblemDescriptor& descriptor)
+  {
+    boost::shared_ptr<typename Solver<T>::problem_t> problem =
+      descriptor.build<T> ();
+    return stackConstraints<T> (problem)->constraints ().size ()
+      < problem->constraints ().size ();
+  }
+
+  /// \brief Variant of a registered problem with stacked constraints (see
+  /// stackConstraints), named after the original problem with a
+  /// "_stacked" suffix. The expected result and tolerances are the same.
+  inline ProblemDescriptor stackedDescriptor (const ProblemDescriptor& original)
+  {
+    ProblemDescriptor problem = original;
+    problem.name = original.name + "_stacked";
+    problem.logName = original.logName + "-stacked";
+
+    problem.dense = [original] ()
+      {
+        return stackConstraints<EigenMatrixDense> (original.dense ());
+      };
+    problem.sparse = [original] ()
+      {
+        return stackConstraints<EigenMatrixSparse> (original.sparse ());
+      };
+    return problem;
+  }
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_STACKED_HH
@@ -0,0 +1,315 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_SWEEP_HH
+# define ROBOPTIM_SHARED_TESTS_SWEEP_HH
+# include <algorithm>
+# include <cmath>
+# include <cstdlib>
+# include <iomanip>
+# include <iostream>
+# include <sstream>
+# include <string>
+# include <vector>
+
+# include "perf.hh"
+
+namespace roboptim
+{
+  /// \brief Options of a problem size sweep.
+  struct SweepOptions
+  {
+    SweepOptions ()
+      : minSize (1),
+        maxSize (1000),
+        factor (2.),
+        repetitions (3)
+    {}
+
+    /// \brief Smallest problem size.
+    long minSize;
+
+    /// \brief Largest problem size.
+    long maxSize;
+
+    /// \brief Ratio between two consecutive sizes.
+    double factor;
+
+    /// \brief Number of solves per size.
+    int repetitions;
+  };
+
+  /// \brief Parse sweep options from the command line.
+  ///
+  /// Expected arguments: sweep [MIN_SIZE [MAX_SIZE [FACTOR [REPETITIONS]]]]
+  ///
+  /// \param argc number of arguments.
+  /// \param argv arguments.
+  /// \param options parsed options.
+  ///
+  /// \return true if a sweep was requested.
+  inline bool parseSweepOptions (int argc, char** argv, SweepOptions& options)
+  {
+    if (argc < 2 || std::string (argv[1]) != "sweep")
+      return false;
+
+    if (argc > 2)
+      options.minSize = std::atol (argv[2]);
+    if (argc > 3)
+      options.maxSize = std::atol (argv[3]);
+    if (argc > 4)
+      options.factor = std::atof (argv[4]);
+    if (argc > 5)
+      options.repetitions = std::atoi (argv[5]);
+
+    if (options.minSize <= 0 || options.maxSize < options.minSize
+        || options.factor <= 1. || options.repetitions <= 0)
+      {
+        std::cerr << "Invalid sweep options. Usage: "
+                  << argv[0]
+                  << " sweep [MIN_SIZE [MAX_SIZE [FACTOR [REPETITIONS]]]]"
+                  << std::endl;
+        std::exit (EXIT_FAILURE);
+      }
+
+    return true;
+  }
+
+  /// \brief Geometric range of sizes between min and max (included).
+  ///
+  /// Sizes are rounded to integers, and duplicates are removed.
+  inline std::vector<long> geometricRange (long min, long max, double factor)
+  {
+    std::vector<long> sizes;
+    for (double s = static_cast<double> (min);
+         s < static_cast<double> (max) * (1. + 1e-9); s *= factor)
+      {
+        long size = static_cast<long> (std::floor (s + 0.5));
+        if (sizes.empty () || sizes.back () != size)
+          sizes.push_back (size);
+      }
+    if (sizes.empty () || sizes.back () != max)
+      sizes.push_back (max);
+    return sizes;
+  }
+
+  /// \brief Power law y = c xᵏ fitted in log-log space.
+  struct ComplexityFit
+  {
+    ComplexityFit ()
+      : exponent (0.),
+        coefficient (0.),
+        r2 (0.),
+        valid (false)
+    {}
+
+    /// \brief Empirical complexity exponent k.
+    double exponent;
+
+    /// \brief Coefficient c.
+    double coefficient;
+
+    /// \brief Coefficient of determination of the log-log regression.
+    double r2;
+
+    /// \brief Whether enough data was available for the fit.
+    bool valid;
+  };
+
+  /// \brief Fit y = c xᵏ by least squares on (log x, log y).
+  ///
+  /// Non-positive values are ignored.
+  inline ComplexityFit fitComplexity (const std::vector<double>& x,
+                                      const std::vector<double>& y)
+  {
+    ComplexityFit fit;
+
+    std::vector<double> lx, ly;
+    for (std::size_t i = 0; i < std::min (x.size (), y.size ()); ++i)
+      {
+        if (x[i] > 0. && y[i] > 0.)
+          {
+            lx.push_back (std::log (x[i]));
+            ly.push_back (std::log (y[i]));
+          }
+      }
+
+    const std::size_t n = lx.size ();
+    if (n < 2)
+      return fit;
+
+    double mx = 0., my = 0.;
+    for (std::size_t i = 0; i < n; ++i)
+      {
+        mx += lx[i];
+        my += ly[i];
+      }
+    mx /= static_cast<double> (n);
+    my /= static_cast<double> (n);
+
+    double sxx = 0., sxy = 0., syy = 0.;
+    for (std::size_t i = 0; i < n; ++i)
+      {
+        sxx += (lx[i] - mx) * (lx[i] - mx);
+        sxy += (lx[i] - mx) * (ly[i] - my);
+        syy += (ly[i] - my) * (ly[i] - my);
+      }
+
+    if (sxx <= 0.)
+      return fit;
+
+    fit.exponent = sxy / sxx;
+    fit.coefficient = std::exp (my - fit.exponent * mx);
+    fit.r2 = (syy > 0.) ? (sxy * sxy) / (sxx * syy) : 1.;
+    fit.valid = true;
+    return fit;
+  }
+
+  inline std::ostream& operator<< (std::ostream& o, const ComplexityFit& fit)
+  {
+    if (!fit.valid)
+      return o << "n/a";
+
+    std::ostringstream ss;
+    ss << std::fixed << "O(n^" << std::setprecision (2) << fit.exponent
+       << ") (R² = " << std::setprecision (3) << fit.r2 << ")";
+    return o << ss.str ();
+  }
+
+  /// \brief Median of a set of values.
+  inline double median (std::vector<double> values)
+  {
+    if (values.empty ())
+      return 0.;
+    std::sort (values.begin (), values.end ());
+    const std::size_t n = values.size ();
+    return (n % 2 == 1) ? values[n/2] : 0.5 * (values[n/2 - 1] + values[n/2]);
+  }
+
+  /// \brief Results of all the runs for a given problem size.
+  struct SweepPoint
+  {
+    SweepPoint ()
+      : size (0),
+        runs ()
+    {}
+
+    /// \brief Size parameter of the problem.
+    long size;
+
+    /// \brief Performance records of the repetitions.
+    std::vector<PerformanceRecord> runs;
+
+    /// \brief Whether all the repetitions succeeded.
+    bool success () const
+    {
+      for (std::size_t i = 0; i < runs.size (); ++i)
+        if (runs[i].status != "success")
+          return false;
+      return !runs.empty ();
+    }
+
+    double medianWallTime () const
+    {
+      std::vector<double> v;
+      for (std::size_t i = 0; i < runs.size (); ++i)
+        v.push_back (runs[i].wallTime);
+      return median (v);
+    }
+
+    double medianCpuTime () const
+    {
+      std::vector<double> v;
+      for (std::size_t i = 0; i < runs.size (); ++i)
+        v.push_back (runs[i].cpuTime);
+      return median (v);
+    }
+
+    double medianIterations () const
+    {
+      std::vector<double> v;
+      for (std::size_t i = 0; i < runs.size (); ++i)
+        v.push_back (static_cast<double> (runs[i].iterations));
+      return median (v);
+    }
+
+    double maxPeakMemory () const
+    {
+      double m = -1.;
+      for (std::size_t i = 0; i < runs.size (); ++i)
+        m = std::max (m, static_cast<double> (runs[i].peakMemory));
+      return m;
+    }
+  };
+
+  /// \brief Print a sweep summary table and the fitted complexities.
+  ///
+  /// Complexities are fitted against the number of variables of the
+  /// problem (PerformanceRecord::inputSize).
+  ///
+  /// \param o output stream.
+  /// \param points results of the sweep.
+  /// \param baselineMemory memory used before the sweep (in bytes),
+  /// subtracted from the peak memory before fitting.
+  inline void printSweepSummary (std::ostream& o,
+                                 const std::vector<SweepPoint>& points,
+                                 long baselineMemory = 0)
+  {
+    std::vector<double> vars, wall, cpu, iter, mem;
+
+    o << std::setw (10) << "size"
+      << std::setw (10) << "vars"
+      << std::setw (8) << "runs"
+      << std::setw (14) << "wall (s)"
+      << std::setw (14) << "cpu (s)"
+      << std::setw (12) << "iterations"
+      << std::setw (14) << "memory (MB)"
+      << std::setw (9) << "status" << std::endl;
+
+    for (std::size_t i = 0; i < points.size (); ++i)
+      {
+        const SweepPoint& p = points[i];
+        if (p.runs.empty ())
+          continue;
+
+        double n = static_cast<double> (p.runs.front ().inputSize);
+        vars.push_back (n);
+        wall.push_back (p.medianWallTime ());
+        cpu.push_back (p.medianCpuTime ());
+        iter.push_back (p.medianIterations ());
+        mem.push_back (p.maxPeakMemory ()
+                       - static_cast<double> (baselineMemory));
+
+        o << std::setw (10) << p.size
+          << std::setw (10) << p.runs.front ().inputSize
+          << std::setw (8) << p.runs.size ()
+          << std::setw (14) << wall.back ()
+          << std::setw (14) << cpu.back ()
+          << std::setw (12) << iter.back ()
+          << std::setw (14) << p.maxPeakMemory () / 1048576.
+          << std::setw (9) << (p.success () ? "ok" : "FAILED") << std::endl;
+      }
+
+    o << "Empirical complexity w.r.t. the number of variables:" << std::endl
+      << "  wall time:  " << fitComplexity (vars, wall) << std::endl
+      << "  CPU time:   " << fitComplexity (vars, cpu) << std::endl
+      << "  iterations: " << fitComplexity (vars, iter) << std::endl
+      << "  memory:     " << fitComplexity (vars, mem) << std::endl;
+  }
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_SWEEP_HH
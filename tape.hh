@@ -0,0 +1,604 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_TAPE_HH
+# define ROBOPTIM_SHARED_TESTS_TAPE_HH
+# include <algorithm>
+# include <cassert>
+# include <cmath>
+# include <cstddef>
+# include <limits>
+# include <stdexcept>
+# include <string>
+# include <vector>
+
+# include <roboptim/core/differentiable-function.hh>
+
+# include "autodiff.hh"
+
+namespace roboptim
+{
+  /// \brief Tape of the operations of a function, for reverse-mode
+  /// automatic differentiation.
+  ///
+  /// The tape is a sequence of nodes: the variables first, then one node
+  /// per elementary operation, referring to the nodes of its operands.
+  /// Once recorded, it can be replayed at any point (forward ()) and
+  /// differentiated (reverse ()), without reallocation. This is only valid
+  /// if the recorded operations do not depend on the point, i.e. if the
+  /// function has no branch on the values of its arguments.
+  class Tape
+  {
+  public:
+    /// \brief Elementary operations.
+    ///
+    /// For the *_CONSTANT operations, the second operand is the index of
+    /// a constant c.
+    enum Operation
+    {
+      VARIABLE,
+      ADD,
+      SUB,
+      MUL,
+      DIV,
+      NEG,
+      /// \brief a + c.
+      ADD_CONSTANT,
+      /// \brief c - a.
+      SUB_FROM_CONSTANT,
+      /// \brief a c.
+      MUL_CONSTANT,
+      /// \brief c / a.
+      DIV_CONSTANT,
+      /// \brief aᶜ.
+      POW_CONSTANT,
+      EXP,
+      LOG,
+      SQRT,
+      SIN,
+      COS,
+      ASIN
+    };
+
+    /// \brief Recorded operation.
+    struct Node
+    {
+      int operation;
+      int a;
+      int b;
+    };
+
+    Tape ()
+      : nodes_ (),
+        constants_ (),
+        values_ (),
+        adjoints_ (),
+        variables_ (0)
+    {}
+
+    /// \brief Remove all the nodes.
+    void clear ()
+    {
+      nodes_.clear ();
+      constants_.clear ();
+      values_.clear ();
+      adjoints_.clear ();
+      variables_ = 0;
+    }
+
+    /// \brief Number of nodes.
+    std::size_t size () const
+    {
+      return nodes_.size ();
+    }
+
+    /// \brief Number of variables.
+    std::size_t variables () const
+    {
+      return variables_;
+    }
+
+    /// \brief Value of a node at the last recorded or replayed point.
+    double value (int node) const
+    {
+      return values_[static_cast<std::size_t> (node)];
+    }
+
+    /// \brief Record a variable. Variables have to be recorded before
+    /// the operations.
+    int variable (double value)
+    {
+      assert (variables_ == nodes_.size ());
+      ++variables_;
+      return push (VARIABLE, -1, -1, value);
+    }
+
+    /// \brief Record an operation on nodes.
+    int operation (Operation op, int a, int b, double value)
+    {
+      return push (op, a, b, value);
+    }
+
+    /// \brief Record an operation on a node and a constant.
+    int operation (Operation op, int a, double c, double value)
+    {
+      constants_.push_back (c);
+      return push (op, a, static_cast<int> (constants_.size () - 1), value);
+    }
+
+    /// \brief Evaluate all the nodes at a new point.
+    ///
+    /// \param x values of the variables.
+    void forward (const double* x)
+    {
+      using std::exp;
+      using std::log;
+      using std::pow;
+
+      std::copy (x, x + variables_, values_.begin ());
+      double* v = values_.data ();
+      for (std::size_t k = variables_; k < nodes_.size (); ++k)
+        {
+          const Node& n = nodes_[k];
+          switch (n.operation)
+            {
+            case ADD:
+              v[k] = v[n.a] + v[n.b];
+              break;
+            case SUB:
+              v[k] = v[n.a] - v[n.b];
+              break;
+            case MUL:
+              v[k] = v[n.a] * v[n.b];
+              break;
+            case DIV:
+              v[k] = v[n.a] / v[n.b];
+              break;
+            case NEG:
+              v[k] = -v[n.a];
+              break;
+            case ADD_CONSTANT:
+              v[k] = v[n.a] + constants_[n.b];
+              break;
+            case SUB_FROM_CONSTANT:
+              v[k] = constants_[n.b] - v[n.a];
+              break;
+            case MUL_CONSTANT:
+              v[k] = v[n.a] * constants_[n.b];
+              break;
+            case DIV_CONSTANT:
+              v[k] = constants_[n.b] / v[n.a];
+              break;
+            case POW_CONSTANT:
+              v[k] = pow (v[n.a], constants_[n.b]);
+              break;
+            case EXP:
+              v[k] = exp (v[n.a]);
+              break;
+            case LOG:
+              v[k] = log (v[n.a]);
+              break;
+            case SQRT:
+              v[k] = std::sqrt (v[n.a]);
+              break;
+            case SIN:
+              v[k] = std::sin (v[n.a]);
+              break;
+            case COS:
+              v[k] = std::cos (v[n.a]);
+              break;
+            case ASIN:
+              v[k] = std::asin (v[n.a]);
+              break;
+            }
+        }
+    }
+
+    /// \brief Gradient of a node with respect to the variables, at the
+    /// last recorded or replayed point.
+    ///
+    /// \param node differentiated node (-1 for a constant).
+    /// \param gradient output, one value per variable.
+    void reverse (int node, double* gradient)
+    {
+      using std::pow;
+
+      if (node < 0)
+        {
+          std::fill (gradient, gradient + variables_, 0.);
+          return;
+        }
+
+      // Adjoints are reset as they are consumed, so that they are all
+      // zero again at the end of the sweep.
+      const double* v = values_.data ();
+      double* adj = adjoints_.data ();
+      adj[node] = 1.;
+      for (std::size_t k = static_cast<std::size_t> (node);
+           k >= variables_ && k < nodes_.size (); --k)
+        {
+          double d = adj[k];
+          if (d == 0.)
+            continue;
+          adj[k] = 0.;
+
+          const Node& n = nodes_[k];
+          switch (n.operation)
+            {
+            case ADD:
+              adj[n.a] += d;
+              adj[n.b] += d;
+              break;
+            case SUB:
+              adj[n.a] += d;
+              adj[n.b] -= d;
+              break;
+            case MUL:
+              adj[n.a] += d * v[n.b];
+              adj[n.b] += d * v[n.a];
+              break;
+            case DIV:
+              adj[n.a] += d / v[n.b];
+              adj[n.b] -= d * v[k] / v[n.b];
+              break;
+            case NEG:
+            case SUB_FROM_CONSTANT:
+              adj[n.a] -= d;
+              break;
+            case ADD_CONSTANT:
+              adj[n.a] += d;
+              break;
+            case MUL_CONSTANT:
+              adj[n.a] += d * constants_[n.b];
+              break;
+            case DIV_CONSTANT:
+              adj[n.a] -= d * v[k] / v[n.a];
+              break;
+            case POW_CONSTANT:
+              adj[n.a] += d * constants_[n.b]
+                * pow (v[n.a], constants_[n.b] - 1.);
+              break;
+            case EXP:
+              adj[n.a] += d * v[k];
+              break;
+            case LOG:
+              adj[n.a] += d / v[n.a];
+              break;
+            case SQRT:
+              adj[n.a] += d / (2. * v[k]);
+              break;
+            case SIN:
+              adj[n.a] += d * std::cos (v[n.a]);
+              break;
+            case COS:
+              adj[n.a] -= d * std::sin (v[n.a]);
+              break;
+            case ASIN:
+              adj[n.a] += d / std::sqrt (1. - v[n.a] * v[n.a]);
+              break;
+            }
+        }
+
+      std::copy (adjoints_.begin (), adjoints_.begin () + variables_,
+                 gradient);
+      std::fill (adjoints_.begin (), adjoints_.begin () + variables_, 0.);
+    }
+
+  private:
+    int push (int op, int a, int b, double value)
+    {
+      if (nodes_.size ()
+          >= static_cast<std::size_t> (std::numeric_limits<int>::max ()))
+        throw std::length_error ("tape too large");
+
+      Node n = {op, a, b};
+      nodes_.push_back (n);
+      values_.push_back (value);
+      adjoints_.push_back (0.);
+      return static_cast<int> (nodes_.size () - 1);
+    }
+
+    std::vector<Node> nodes_;
+    std::vector<double> constants_;
+    std::vector<double> values_;
+    std::vector<double> adjoints_;
+    std::size_t variables_;
+  };
+
+  /// \brief Scalar recording its operations on a tape.
+  ///
+  /// Scalars built from a double are constants: they are not recorded,
+  /// and operations between constants are evaluated directly. No
+  /// comparison is provided, since the tape cannot record branches.
+  class TapeScalar
+  {
+  public:
+    /// \brief Constant.
+    TapeScalar (double value = 0.)
+      : tape_ (0),
+        node_ (-1),
+        value_ (value)
+    {}
+
+    /// \brief Record a new variable on a tape.
+    static TapeScalar variable (Tape& tape, double value)
+    {
+      return TapeScalar (&tape, tape.variable (value), value);
+    }
+
+    /// \brief Tape of the scalar (null for a constant).
+    Tape* tape () const
+    {
+      return tape_;
+    }
+
+    /// \brief Node of the scalar (-1 for a constant).
+    int node () const
+    {
+      return node_;
+    }
+
+    /// \brief Value at the recorded point.
+    double value () const
+    {
+      return value_;
+    }
+
+    TapeScalar& operator+= (const TapeScalar& b)
+    {
+      return *this = *this + b;
+    }
+
+    TapeScalar& operator-= (const TapeScalar& b)
+    {
+      return *this = *this - b;
+    }
+
+    TapeScalar& operator*= (const TapeScalar& b)
+    {
+      return *this = *this * b;
+    }
+
+    TapeScalar& operator/= (const TapeScalar& b)
+    {
+      return *this = *this / b;
+    }
+
+    /// \brief Record a unary operation.
+    static TapeScalar record (Tape::Operation op, const TapeScalar& a,
+                              double value)
+    {
+      if (!a.tape_)
+        return TapeScalar (value);
+      return TapeScalar (a.tape_, a.tape_->operation (op, a.node_, -1, value),
+                         value);
+    }
+
+    /// \brief Record an operation with a constant.
+    static TapeScalar record (Tape::Operation op, const TapeScalar& a,
+                              double c, double value)
+    {
+      if (!a.tape_)
+        return TapeScalar (value);
+      return TapeScalar (a.tape_, a.tape_->operation (op, a.node_, c, value),
+                         value);
+    }
+
+    /// \brief Record a binary operation on two variables.
+    static TapeScalar record (Tape::Operation op, const TapeScalar& a,
+                              const TapeScalar& b, double value)
+    {
+      assert (a.tape_ && a.tape_ == b.tape_);
+      return TapeScalar (a.tape_,
+                         a.tape_->operation (op, a.node_, b.node_, value),
+                         value);
+    }
+
+    friend TapeScalar operator+ (const TapeScalar& a, const TapeScalar& b)
+    {
+      double v = a.value_ + b.value_;
+      if (!b.tape_)
+        return (b.value_ == 0.) ? a : record (Tape::ADD_CONSTANT, a, b.value_, v);
+      if (!a.tape_)
+        return (a.value_ == 0.) ? b : record (Tape::ADD_CONSTANT, b, a.value_, v);
+      return record (Tape::ADD, a, b, v);
+    }
+
+    friend TapeScalar operator- (const TapeScalar& a, const TapeScalar& b)
+    {
+      double v = a.value_ - b.value_;
+      if (!b.tape_)
+        return (b.value_ == 0.) ? a : record (Tape::ADD_CONSTANT, a, -b.value_, v);
+      if (!a.tape_)
+        return record (Tape::SUB_FROM_CONSTANT, b, a.value_, v);
+      return record (Tape::SUB, a, b, v);
+    }
+
+    friend TapeScalar operator* (const TapeScalar& a, const TapeScalar& b)
+    {
+      double v = a.value_ * b.value_;
+      if (!b.tape_)
+        return (b.value_ == 1.) ? a : record (Tape::MUL_CONSTANT, a, b.value_, v);
+      if (!a.tape_)
+        return (a.value_ == 1.) ? b : record (Tape::MUL_CONSTANT, b, a.value_, v);
+      return record (Tape::MUL, a, b, v);
+    }
+
+    friend TapeScalar operator/ (const TapeScalar& a, const TapeScalar& b)
+    {
+      double v = a.value_ / b.value_;
+      if (!b.tape_)
+        return record (Tape::MUL_CONSTANT, a, 1. / b.value_, v);
+      if (!a.tape_)
+        return record (Tape::DIV_CONSTANT, b, a.value_, v);
+      return record (Tape::DIV, a, b, v);
+    }
+
+    friend TapeScalar operator- (const TapeScalar& a)
+    {
+      return record (Tape::NEG, a, -a.value_);
+    }
+
+    friend TapeScalar operator+ (const TapeScalar& a)
+    {
+      return a;
+    }
+
+  private:
+    TapeScalar (Tape* tape, int node, double value)
+      : tape_ (tape),
+        node_ (node),
+        value_ (value)
+    {}
+
+    Tape* tape_;
+    int node_;
+    double value_;
+  };
+
+  inline TapeScalar exp (const TapeScalar& a)
+  {
+    return TapeScalar::record (Tape::EXP, a, std::exp (a.value ()));
+  }
+
+  inline TapeScalar log (const TapeScalar& a)
+  {
+    return TapeScalar::record (Tape::LOG, a, std::log (a.value ()));
+  }
+
+  inline TapeScalar sqrt (const TapeScalar& a)
+  {
+    return TapeScalar::record (Tape::SQRT, a, std::sqrt (a.value ()));
+  }
+
+  inline TapeScalar sin (const TapeScalar& a)
+  {
+    return TapeScalar::record (Tape::SIN, a, std::sin (a.value ()));
+  }
+
+  inline TapeScalar cos (const TapeScalar& a)
+  {
+    return TapeScalar::record (Tape::COS, a, std::cos (a.value ()));
+  }
+
+  inline TapeScalar asin (const TapeScalar& a)
+  {
+    return TapeScalar::record (Tape::ASIN, a, std::asin (a.value ()));
+  }
+
+  inline TapeScalar pow (const TapeScalar& a, double p)
+  {
+    if (p == 2.)
+      return a * a;
+    return TapeScalar::record (Tape::POW_CONSTANT, a, p,
+                               std::pow (a.value (), p));
+  }
+
+  inline TapeScalar pow (const TapeScalar& a, int p)
+  {
+    return pow (a, static_cast<double> (p));
+  }
+
+  /// \brief Differentiable function whose gradients are computed by
+  /// reverse-mode automatic differentiation.
+  ///
+  /// The derived class provides the same evaluate () member template as
+  /// for GenericAutoDiffFunction. It is evaluated on doubles to compute
+  /// the function, and once on TapeScalar, at the first gradient, to
+  /// record the tape. Each gradient then replays the tape at the new
+  /// point and propagates the adjoints backwards: its cost is a small
+  /// multiple of the cost of the function, whatever the number of
+  /// variables.
+  ///
+  /// The recorded operations must not depend on the argument (see Tape).
+  ///
+  /// \tparam T matrix type.
+  /// \tparam D derived class.
+  template <typename T, typename D>
+  class GenericTapeFunction : public GenericDifferentiableFunction<T>
+  {
+  public:
+    ROBOPTIM_DIFFERENTIABLE_FUNCTION_FWD_TYPEDEFS_
+    (GenericDifferentiableFunction<T>);
+
+    GenericTapeFunction (size_type inputSize, size_type outputSize,
+                         const std::string& name)
+      : GenericDifferentiableFunction<T> (inputSize, outputSize, name),
+        tape_ (),
+        outputs_ (),
+        gradient_ (inputSize)
+    {}
+
+    /// \brief Number of nodes of the tape (0 until the first gradient).
+    std::size_t tapeSize () const
+    {
+      return tape_.size ();
+    }
+
+  protected:
+    void impl_compute (result_ref result, const_argument_ref x) const
+    {
+      derived ().evaluate (result.data (), x.data ());
+    }
+
+    void impl_gradient (gradient_ref grad, const_argument_ref x,
+                        size_type functionId) const
+    {
+      if (outputs_.empty ())
+        record (x);
+      else
+        tape_.forward (x.data ());
+
+      tape_.reverse (outputs_[static_cast<std::size_t> (functionId)],
+                     gradient_.data ());
+      detail::AutoDiffWriter<T>::gradient (grad, gradient_);
+    }
+
+  private:
+    const D& derived () const
+    {
+      return static_cast<const D&> (*this);
+    }
+
+    /// \brief Record the tape at x.
+    void record (const_argument_ref x) const
+    {
+      tape_.clear ();
+      std::vector<TapeScalar> variables;
+      variables.reserve (static_cast<std::size_t> (this->inputSize ()));
+      for (size_type k = 0; k < this->inputSize (); ++k)
+        variables.push_back (TapeScalar::variable (tape_, x[k]));
+
+      std::vector<TapeScalar> result
+        (static_cast<std::size_t> (this->outputSize ()));
+      derived ().evaluate (&result[0], &variables[0]);
+
+      outputs_.resize (result.size ());
+      for (std::size_t i = 0; i < result.size (); ++i)
+        outputs_[i] = result[i].node ();
+    }
+
+    mutable Tape tape_;
+
+    /// \brief Node of each output (-1 for a constant output).
+    mutable std::vector<int> outputs_;
+
+    mutable Eigen::Matrix<value_type, Eigen::Dynamic, 1> gradient_;
+  };
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_TAPE_HH
@@ -19,9 +19,49 @@ INCLUDE_DIRECTORIES(${Boost_INCLUDE_DIRS})
 # Make Boost.Test generates the main function in test cases.
 ADD_DEFINITIONS(-DBOOST_TEST_DYN_LINK -DBOOST_TEST_MAIN)
 
+# Parallel runners (see runner.hh) use std::thread.
+FIND_PACKAGE(Threads REQUIRED)
+
+# Solver plug-ins that can solve problems concurrently (e.g.
+# `ipopt-sparse;cfsqp'). The solves of the other plug-ins are serialized
+# by the parallel runners, which then default to a single thread.
+SET(THREAD_SAFE_PLUGINS "" CACHE STRING
+  "Solver plug-ins whose solvers can run concurrently")
+
 # Add current directory to include directories.
 INCLUDE_DIRECTORIES(${CMAKE_CURRENT_SOURCE_DIR}/shared-tests)
 
+# Performance baselines: OFF, CHECK (fail tests that regress past the
+# tolerances) or UPDATE (store the current runs as baselines).
+SET(PERF_BASELINE "OFF" CACHE STRING
+  "Performance baseline mode (OFF, CHECK or UPDATE)")
+SET(PERF_BASELINE_TIME_TOLERANCE "0.5" CACHE STRING
+  "Allowed relative increase of the normalized solve time")
+SET(PERF_BASELINE_COUNT_TOLERANCE "0.2" CACHE STRING
+  "Allowed relative increase of iterations and evaluations")
+
+# Optimization logs: text files of the optimization logger, or a binary
+# trace of the iterations (see trace.hh), which is much cheaper to write
+# for large problems. `trace_convert [--csv] TRACE' converts a trace to
+# text or CSV.
+OPTION(BINARY_TRACE
+  "Write binary iteration traces instead of optimization logger files" OFF)
+# With ASYNC_TRACE, the trace is written by a background thread: the
+# iteration callback only copies the solver state (see async-trace.hh).
+OPTION(ASYNC_TRACE "Write binary iteration traces from a background thread" OFF)
+# With FAILURE_TRACE, the last FAILURE_TRACE_SIZE iterations are kept in
+# memory, and only written as a binary trace if the test fails (see
+# failure-trace.hh).
+OPTION(FAILURE_TRACE "Write binary iteration traces of failed tests only" OFF)
+SET(FAILURE_TRACE_SIZE "100" CACHE STRING
+  "Number of iterations kept by FAILURE_TRACE")
+
+IF(NOT TARGET trace_convert)
+  ADD_EXECUTABLE(trace_convert shared-tests/trace_convert.cc)
+  PKG_CONFIG_USE_DEPENDENCY(trace_convert roboptim-core)
+  TARGET_LINK_LIBRARIES(trace_convert ${Boost_LIBRARIES})
+ENDIF()
+
 # CHECK_TEST_PARAMETERS()
 # -----------------------
 #
@@ -44,6 +84,58 @@ MACRO(CHECK_TEST_PARAMETERS)
   ENDIF()
 ENDMACRO()
 
+# SET_TEST_DEFINITIONS(EXE_NAME)
+# ------------------------------
+#
+# Set the compile definitions of the test executable
+# `${EXE_NAME}${PROGRAM_SUFFIX}' (solver, plug-in path, function type,
+# log, performance record and baseline files).
+#
+MACRO(SET_TEST_DEFINITIONS EXE_NAME)
+  TARGET_COMPILE_DEFINITIONS(${EXE_NAME}${PROGRAM_SUFFIX}
+    PUBLIC
+    -DSOLVER_NAME="${SOLVER_NAME}"
+    -DPLUGIN_PATH="${PLUGIN_PATH}"
+    -DFUNCTION_TYPE=${FUNCTION_TYPE}
+    -DTESTS_DATA_DIR="${CMAKE_CURRENT_SOURCE_DIR}"
+    -DLOG_FILENAME="${EXE_NAME}${PROGRAM_SUFFIX}.log"
+    -DLOG_DIR="${EXE_NAME}${PROGRAM_SUFFIX}_log"
+    -DPERF_FILENAME="${CMAKE_CURRENT_BINARY_DIR}/perf/${EXE_NAME}${PROGRAM_SUFFIX}.json")
+
+  IF(PERF_BASELINE STREQUAL "CHECK" OR PERF_BASELINE STREQUAL "UPDATE")
+    TARGET_COMPILE_DEFINITIONS(${EXE_NAME}${PROGRAM_SUFFIX}
+      PUBLIC
+      -DPERF_BASELINE_${PERF_BASELINE}
+      -DPERF_BASELINE_FILENAME="${CMAKE_CURRENT_SOURCE_DIR}/baselines/${SOLVER_NAME}/${EXE_NAME}${PROGRAM_SUFFIX}.json"
+      -DPERF_BASELINE_TIME_TOLERANCE=${PERF_BASELINE_TIME_TOLERANCE}
+      -DPERF_BASELINE_COUNT_TOLERANCE=${PERF_BASELINE_COUNT_TOLERANCE})
+  ENDIF()
+
+  IF(SPARSE_FILL_BENCHMARK)
+    TARGET_COMPILE_DEFINITIONS(${EXE_NAME}${PROGRAM_SUFFIX}
+      PUBLIC -DSPARSE_FILL_BENCHMARK)
+  ENDIF()
+
+  IF(THREAD_SAFE_PLUGINS)
+    STRING(REPLACE ";" "," THREAD_SAFE_PLUGINS_LIST "${THREAD_SAFE_PLUGINS}")
+    TARGET_COMPILE_DEFINITIONS(${EXE_NAME}${PROGRAM_SUFFIX}
+      PUBLIC -DTHREAD_SAFE_PLUGINS="${THREAD_SAFE_PLUGINS_LIST}")
+  ENDIF()
+
+  IF(BINARY_TRACE OR ASYNC_TRACE)
+    TARGET_COMPILE_DEFINITIONS(${EXE_NAME}${PROGRAM_SUFFIX}
+      PUBLIC -DBINARY_TRACE)
+  ENDIF()
+  IF(ASYNC_TRACE)
+    TARGET_COMPILE_DEFINITIONS(${EXE_NAME}${PROGRAM_SUFFIX}
+      PUBLIC -DASYNC_TRACE)
+  ENDIF()
+  IF(FAILURE_TRACE)
+    TARGET_COMPILE_DEFINITIONS(${EXE_NAME}${PROGRAM_SUFFIX}
+      PUBLIC -DFAILURE_TRACE -DFAILURE_TRACE_SIZE=${FAILURE_TRACE_SIZE})
+  ENDIF()
+ENDMACRO()
+
 # BUILD_TEST(FILE_NAME)
 # ---------------------
 #
@@ -53,6 +145,19 @@ ENDMACRO()
 # This macro will create a binary from `${NAME}.cc', link it
 # against Boost and add it to the test suite as `${NAME}${PROGRAM_SUFFIX}'.
 #
+# Each test writes a performance record (wall/CPU time, iterations and
+# evaluation counts, in JSON Lines format) to
+# `perf/${NAME}${PROGRAM_SUFFIX}.json' in the current binary directory.
+#
+# Successful runs are compared to (PERF_BASELINE=CHECK) or stored as
+# (PERF_BASELINE=UPDATE) the performance baselines of
+# `baselines/${SOLVER_NAME}/${NAME}${PROGRAM_SUFFIX}.json' in the tests
+# data directory (iterations, evaluations and normalized solve time).
+#
+# If SPARSE_FILL_BENCHMARK is set, each test also compares the sparse
+# gradient fill strategies (coeffRef insertion vs pre-declared structure)
+# before solving.
+#
 MACRO(BUILD_TEST FILE_NAME)
   CHECK_TEST_PARAMETERS()
 
@@ -60,14 +165,7 @@ MACRO(BUILD_TEST FILE_NAME)
   ADD_EXECUTABLE(${EXE_NAME}${PROGRAM_SUFFIX}
     shared-tests/${FILE_NAME}.cc)
 
-  TARGET_COMPILE_DEFINITIONS(${EXE_NAME}${PROGRAM_SUFFIX}
-    PUBLIC
-    -DSOLVER_NAME="${SOLVER_NAME}"
-    -DPLUGIN_PATH="${PLUGIN_PATH}"
-    -DFUNCTION_TYPE=${FUNCTION_TYPE}
-    -DTESTS_DATA_DIR="${CMAKE_CURRENT_SOURCE_DIR}"
-    -DLOG_FILENAME="${EXE_NAME}${PROGRAM_SUFFIX}.log"
-    -DLOG_DIR="${EXE_NAME}${PROGRAM_SUFFIX}_log")
+  SET_TEST_DEFINITIONS(${EXE_NAME})
 
   ADD_TEST(${EXE_NAME}${PROGRAM_SUFFIX}
     ${RUNTIME_OUTPUT_DIRECTORY}/${EXE_NAME}${PROGRAM_SUFFIX})
@@ -75,10 +173,114 @@ MACRO(BUILD_TEST FILE_NAME)
   PKG_CONFIG_USE_DEPENDENCY(${EXE_NAME}${PROGRAM_SUFFIX} roboptim-core)
 
   # Link against Boost.
-  TARGET_LINK_LIBRARIES(${EXE_NAME}${PROGRAM_SUFFIX} ${Boost_LIBRARIES})
+  TARGET_LINK_LIBRARIES(${EXE_NAME}${PROGRAM_SUFFIX} ${Boost_LIBRARIES}
+    ${CMAKE_THREAD_LIBS_INIT})
+ENDMACRO()
+
+
+# BUILD_AGGREGATE_TEST(NAME FILE_NAMES...)
+# ----------------------------------------
+#
+# Define a test named `${NAME}${PROGRAM_SUFFIX}' that links all the given
+# tests (e.g. `schittkowski/problem_1') in a single executable.
+#
+# The test environment (log4cxx, libltdl, solver plug-in) is set up once
+# for the whole process by `aggregate.cc', which also prints the solve
+# time of each test, without the startup time, at the end of the run.
+# Test case names must be unique among the given tests.
+#
+# `${NAME}${PROGRAM_SUFFIX} --run_test=aggregate -- parallel [THREADS]'
+# solves all the registered problems (see registry.hh) on a thread pool
+# instead, and `${NAME}${PROGRAM_SUFFIX} --run_test=aggregate -- stacked
+# [REPEAT]' compares the solve times of the problems having several
+# constraints with and without stacked constraints (see stacked.hh).
+#
+MACRO(BUILD_AGGREGATE_TEST NAME)
+  BUILD_AGGREGATE_EXECUTABLE(${NAME} ${ARGN})
+
+  ADD_TEST(${NAME}${PROGRAM_SUFFIX}
+    ${RUNTIME_OUTPUT_DIRECTORY}/${NAME}${PROGRAM_SUFFIX})
+ENDMACRO()
+
+
+# BUILD_AGGREGATE_EXECUTABLE(NAME FILE_NAMES...)
+# ----------------------------------------------
+#
+# Same as BUILD_AGGREGATE_TEST, without defining the test: the caller
+# adds the tests it needs, e.g. running a single test suite with
+# `--run_test=SUITE'.
+#
+MACRO(BUILD_AGGREGATE_EXECUTABLE NAME)
+  CHECK_TEST_PARAMETERS()
+
+  SET(AGGREGATE_SOURCES shared-tests/aggregate.cc)
+  FOREACH(FILE_NAME ${ARGN})
+    LIST(APPEND AGGREGATE_SOURCES shared-tests/${FILE_NAME}.cc)
+  ENDFOREACH()
+  ADD_EXECUTABLE(${NAME}${PROGRAM_SUFFIX} ${AGGREGATE_SOURCES})
+
+  SET_TEST_DEFINITIONS(${NAME})
+  TARGET_COMPILE_DEFINITIONS(${NAME}${PROGRAM_SUFFIX}
+    PUBLIC -DROBOPTIM_SHARED_TESTS_AGGREGATE)
+
+  PKG_CONFIG_USE_DEPENDENCY(${NAME}${PROGRAM_SUFFIX} roboptim-core)
+
+  # Link against Boost.
+  TARGET_LINK_LIBRARIES(${NAME}${PROGRAM_SUFFIX} ${Boost_LIBRARIES}
+    ${CMAKE_THREAD_LIBS_INIT})
 ENDMACRO()
 
 
+# BUILD_SUITE_AGGREGATE()
+# -----------------------
+#
+# Define a test named `suite_all${PROGRAM_SUFFIX}' (see
+# BUILD_AGGREGATE_TEST) linking the Schittkowski, QP, RobOptim and
+# benchmark problems built so far: call it after the BUILD_*_PROBLEMS
+# macros. Schittkowski problems that are expected to fail are left out.
+#
+# If COMPARISON_PLUGINS is set (e.g. `ipopt;cfsqp'), the test
+# `solver_matrix${PROGRAM_SUFFIX}' solves every problem with each of
+# these plug-ins in the same process, prints the solver × problem
+# matrix of status, time and iterations, and writes it to
+# `perf/suite_all${PROGRAM_SUFFIX}.matrix.csv'. The plug-ins must be in
+# the plug-in search path and support the function type of the tests.
+# Performance profiles (time, evaluations) and data profiles
+# (evaluations) are written next to it, as CSV files and gnuplot
+# scripts (see profile.hh).
+#
+# `suite_all${PROGRAM_SUFFIX} --run_test=aggregate -- profile PREFIX
+# FILES...' computes the same profiles from existing performance record
+# files, e.g. of test executables built with different solvers.
+#
+MACRO(BUILD_SUITE_AGGREGATE)
+  SET(SUITE_FILES)
+  FOREACH(PROBLEM ${SCHITTKOWSKI_PROBLEMS})
+    LIST(FIND SCHITTKOWSKI_PROBLEMS_FAIL ${PROBLEM} ExpectedFailure)
+    IF(${ExpectedFailure} EQUAL -1)
+      LIST(APPEND SUITE_FILES "schittkowski/problem_${PROBLEM}")
+    ENDIF()
+  ENDFOREACH()
+  FOREACH(PROBLEM ${QP_PROBLEMS})
+    LIST(APPEND SUITE_FILES "qp/${PROBLEM}")
+  ENDFOREACH()
+  FOREACH(PROBLEM ${ROBOPTIM_PROBLEMS})
+    LIST(APPEND SUITE_FILES "roboptim/${PROBLEM}")
+  ENDFOREACH()
+  FOREACH(PROBLEM ${BENCHMARK_PROBLEMS})
+    LIST(APPEND SUITE_FILES "benchmark/${PROBLEM}")
+  ENDFOREACH()
+  BUILD_AGGREGATE_TEST(suite_all ${SUITE_FILES})
+
+  SET(COMPARISON_PLUGINS "" CACHE STRING
+    "Solver plug-ins compared by the solver_matrix test")
+  IF(COMPARISON_PLUGINS)
+    ADD_TEST(solver_matrix${PROGRAM_SUFFIX}
+      ${RUNTIME_OUTPUT_DIRECTORY}/suite_all${PROGRAM_SUFFIX}
+      --run_test=aggregate -- matrix ${COMPARISON_PLUGINS})
+  ENDIF()
+ENDMACRO()
+
 # BUILD_TEST_MANIFOLDS(FILE_NAME)
 # ---------------------
 #
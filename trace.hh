@@ -0,0 +1,623 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROBOPTIM_SHARED_TESTS_TRACE_HH
+# define ROBOPTIM_SHARED_TESTS_TRACE_HH
+# include <algorithm>
+# include <cstddef>
+# include <cstring>
+# include <fstream>
+# include <iomanip>
+# include <iostream>
+# include <limits>
+# include <sstream>
+# include <stdexcept>
+# include <string>
+# include <vector>
+
+# include <boost/cstdint.hpp>
+# include <boost/filesystem.hpp>
+# include <boost/variant/apply_visitor.hpp>
+# include <boost/variant/static_visitor.hpp>
+
+# include <Eigen/Core>
+
+namespace roboptim
+{
+  /// \brief Binary iteration trace format.
+  ///
+  /// A trace file starts with a fixed header:
+  ///
+  /// | field           | type        | content                        |
+  /// |-----------------|-------------|--------------------------------|
+  /// | magic           | char[8]     | "RBOTRACE"                     |
+  /// | version         | uint32      | 1                              |
+  /// | byte order      | uint32      | 0x01020304 (writer's order)    |
+  /// | input size      | uint64      | n                              |
+  /// | constraint size | uint64      | m (constraint outputs)         |
+  /// | name            | char[64]    | log name, zero-padded          |
+  ///
+  /// followed by records appended as the solver runs. Each record is a
+  /// type (uint32) and a payload size in bytes (uint32), followed by the
+  /// payload:
+  ///
+  /// - ITERATION: iteration (uint64), cost (double), constraint
+  ///   violation (double), number k of multipliers (uint64), x (n
+  ///   doubles) and the multipliers (k doubles). Unknown values are NaN.
+  /// - TEXT: characters (e.g. the result and the solver printed at the
+  ///   end of the run).
+  ///
+  /// Values are written in the byte order of the writer. The payload size
+  /// lets readers skip unknown record types, and a truncated last record
+  /// (e.g. after a crash) is ignored.
+  namespace trace
+  {
+    static const char magic[8] = {'R', 'B', 'O', 'T', 'R', 'A', 'C', 'E'};
+    static const boost::uint32_t version = 1;
+    static const boost::uint32_t byteOrder = 0x01020304;
+    static const std::size_t nameSize = 64;
+
+    enum RecordType
+    {
+      ITERATION = 1,
+      TEXT = 2
+    };
+  } // end of namespace trace
+
+  /// \brief Header of a trace file.
+  struct TraceHeader
+  {
+    TraceHeader ()
+      : inputSize (0),
+        constraintsSize (0),
+        name ()
+    {}
+
+    /// \brief Number of optimization variables (size of x).
+    boost::uint64_t inputSize;
+
+    /// \brief Total number of constraint outputs.
+    boost::uint64_t constraintsSize;
+
+    /// \brief Name of the run (truncated to 63 characters).
+    std::string name;
+  };
+
+  /// \brief Record of a trace file.
+  ///
+  /// The vectors are reused from one record to the next, so that writing
+  /// or reading records of the same size does not allocate.
+  struct TraceRecord
+  {
+    typedef Eigen::VectorXd vector_t;
+    typedef vector_t::Index index_t;
+
+    TraceRecord ()
+      : type (trace::ITERATION),
+        iteration (0),
+        cost (std::numeric_limits<double>::quiet_NaN ()),
+        constraintViolation (std::numeric_limits<double>::quiet_NaN ()),
+        x (),
+        multipliers (),
+        text ()
+    {}
+
+    /// \brief Record type (see trace::RecordType).
+    boost::uint32_t type;
+
+    /// \brief Iteration number, from 0.
+    boost::uint64_t iteration;
+
+    /// \brief Cost at x (NaN if unknown).
+    double cost;
+
+    /// \brief Constraint violation at x (NaN if unknown).
+    double constraintViolation;
+
+    /// \brief Current point.
+    vector_t x;
+
+    /// \brief Lagrange multipliers (empty if unknown).
+    vector_t multipliers;
+
+    /// \brief Text of TEXT records.
+    std::string text;
+  };
+
+  /// \brief Append-only writer of trace files.
+  class TraceWriter
+  {
+  public:
+    /// \brief Create (truncate) a trace file and write its header.
+    ///
+    /// \param file trace file, its directory is created if needed.
+    /// \param header header of the trace.
+    TraceWriter (const boost::filesystem::path& file, const TraceHeader& header)
+      : buffer_ (1 << 20),
+        ofs_ (),
+        payload_ (),
+        header_ (header)
+    {
+      if (file.has_parent_path ())
+        boost::filesystem::create_directories (file.parent_path ());
+
+      // Large stream buffer: records are flushed by blocks.
+      ofs_.rdbuf ()->pubsetbuf (&buffer_[0],
+                                static_cast<std::streamsize> (buffer_.size ()));
+      ofs_.open (file.c_str (), std::ios::binary | std::ios::trunc);
+      if (!ofs_)
+        throw std::runtime_error ("cannot open trace file " + file.string ());
+
+      char name[trace::nameSize] = {};
+      std::strncpy (name, header.name.c_str (), trace::nameSize - 1);
+
+      ofs_.write (trace::magic, sizeof (trace::magic));
+      put (trace::version);
+      put (trace::byteOrder);
+      put (header.inputSize);
+      put (header.constraintsSize);
+      ofs_.write (name, sizeof (name));
+    }
+
+    /// \brief Append a record.
+    void write (const TraceRecord& record)
+    {
+      payload_.clear ();
+      if (record.type == trace::ITERATION)
+        {
+          append (record.iteration);
+          append (record.cost);
+          append (record.constraintViolation);
+          append (static_cast<boost::uint64_t> (record.multipliers.size ()));
+          append (record.x.data (),
+                  static_cast<std::size_t> (record.x.size ()));
+          append (record.multipliers.data (),
+                  static_cast<std::size_t> (record.multipliers.size ()));
+        }
+      else
+        payload_.assign (record.text.begin (), record.text.end ());
+
+      put (record.type);
+      put (static_cast<boost::uint32_t> (payload_.size ()));
+      if (!payload_.empty ())
+        ofs_.write (&payload_[0],
+                    static_cast<std::streamsize> (payload_.size ()));
+    }
+
+    /// \brief Append a TEXT record.
+    void write (const std::string& text)
+    {
+      TraceRecord record;
+      record.type = trace::TEXT;
+      record.text = text;
+      write (record);
+    }
+
+    /// \brief Write the buffered records to the file.
+    void flush ()
+    {
+      ofs_.flush ();
+    }
+
+    /// \brief Whether all the records written so far could be written.
+    bool good () const
+    {
+      return ofs_.good ();
+    }
+
+    const TraceHeader& header () const
+    {
+      return header_;
+    }
+
+  private:
+    template <typename U>
+    void put (const U& value)
+    {
+      ofs_.write (reinterpret_cast<const char*> (&value), sizeof (U));
+    }
+
+    template <typename U>
+    void append (const U& value)
+    {
+      append (&value, 1);
+    }
+
+    template <typename U>
+    void append (const U* values, std::size_t size)
+    {
+      const char* data = reinterpret_cast<const char*> (values);
+      payload_.insert (payload_.end (), data, data + size * sizeof (U));
+    }
+
+    /// \brief Stream buffer (must outlive the stream).
+    std::vector<char> buffer_;
+    std::ofstream ofs_;
+
+    /// \brief Payload of the record being written.
+    std::vector<char> payload_;
+
+    TraceHeader header_;
+  };
+
+  /// \brief Sequential reader of trace files.
+  class TraceReader
+  {
+  public:
+    /// \brief Open a trace file and read its header.
+    explicit TraceReader (const boost::filesystem::path& file)
+      : ifs_ (file.c_str (), std::ios::binary),
+        header_ (),
+        payload_ ()
+    {
+      if (!ifs_)
+        throw std::runtime_error ("cannot open trace file " + file.string ());
+
+      char m[sizeof (trace::magic)];
+      boost::uint32_t v = 0, order = 0;
+      char name[trace::nameSize] = {};
+
+      ifs_.read (m, sizeof (m));
+      get (v);
+      get (order);
+      if (!ifs_ || std::memcmp (m, trace::magic, sizeof (m)) != 0)
+        throw std::runtime_error (file.string () + " is not a trace file");
+      if (order != trace::byteOrder)
+        throw std::runtime_error (file.string ()
+                                  + ": trace written with another byte order");
+      if (v != trace::version)
+        throw std::runtime_error (file.string ()
+                                  + ": unsupported trace version");
+
+      get (header_.inputSize);
+      get (header_.constraintsSize);
+      ifs_.read (name, sizeof (name));
+      name[trace::nameSize - 1] = 0;
+      header_.name = name;
+      if (!ifs_)
+        throw std::runtime_error (file.string () + ": truncated trace header");
+    }
+
+    const TraceHeader& header () const
+    {
+      return header_;
+    }
+
+    /// \brief Read the next record.
+    ///
+    /// Records of unknown types are skipped.
+    ///
+    /// \param record record to fill.
+    /// \return false at the end of the file or on a truncated record.
+    bool next (TraceRecord& record)
+    {
+      for (;;)
+        {
+          boost::uint32_t size = 0;
+          get (record.type);
+          get (size);
+          if (!ifs_)
+            return false;
+
+          payload_.resize (size);
+          if (size)
+            ifs_.read (&payload_[0], size);
+          if (!ifs_)
+            return false;
+
+          if (record.type == trace::TEXT)
+            {
+              record.text.assign (payload_.begin (), payload_.end ());
+              return true;
+            }
+          if (record.type == trace::ITERATION && parseIteration (record))
+            return true;
+        }
+    }
+
+  private:
+    template <typename U>
+    void get (U& value)
+    {
+      ifs_.read (reinterpret_cast<char*> (&value), sizeof (U));
+    }
+
+    bool parseIteration (TraceRecord& record) const
+    {
+      const std::size_t fixed = 2 * sizeof (boost::uint64_t) + 2 * sizeof (double);
+      if (payload_.size () < fixed)
+        return false;
+
+      const char* p = &payload_[0];
+      boost::uint64_t k = 0;
+      std::memcpy (&record.iteration, p, sizeof (boost::uint64_t));
+      std::memcpy (&record.cost, p + 8, sizeof (double));
+      std::memcpy (&record.constraintViolation, p + 16, sizeof (double));
+      std::memcpy (&k, p + 24, sizeof (boost::uint64_t));
+
+      std::size_t n = static_cast<std::size_t> (header_.inputSize);
+      if (payload_.size () != fixed + (n + k) * sizeof (double))
+        return false;
+
+      record.x.resize (static_cast<TraceRecord::index_t> (n));
+      record.multipliers.resize (static_cast<TraceRecord::index_t> (k));
+      std::memcpy (record.x.data (), p + fixed, n * sizeof (double));
+      std::memcpy (record.multipliers.data (), p + fixed + n * sizeof (double),
+                   k * sizeof (double));
+      return true;
+    }
+
+    std::ifstream ifs_;
+    TraceHeader header_;
+    std::vector<char> payload_;
+  };
+
+  /// \brief Print a trace as text: one line per iteration, followed by the
+  /// text records.
+  inline void printTrace (std::ostream& o, TraceReader& reader)
+  {
+    const TraceHeader& header = reader.header ();
+    o << "trace: " << header.name << std::endl
+      << "n = " << header.inputSize << ", m = " << header.constraintsSize
+      << std::endl;
+
+    Eigen::IOFormat format (Eigen::FullPrecision, Eigen::DontAlignCols,
+                            ", ", ", ", "", "", "[", "]");
+    TraceRecord record;
+    while (reader.next (record))
+      {
+        if (record.type == trace::TEXT)
+          {
+            o << record.text << std::endl;
+            continue;
+          }
+
+        o << "iteration " << record.iteration
+          << ": f = " << record.cost
+          << ", violation = " << record.constraintViolation
+          << ", x = " << record.x.transpose ().format (format);
+        if (record.multipliers.size ())
+          o << ", multipliers = "
+            << record.multipliers.transpose ().format (format);
+        o << std::endl;
+      }
+  }
+
+  /// \brief Write the iterations of a trace as CSV: iteration, cost,
+  /// violation, x_0 ... x_{n-1}, then the multipliers lambda_0 ... (empty
+  /// fields when an iteration has fewer multipliers). Text records are
+  /// left out.
+  ///
+  /// \param o output stream.
+  /// \param file trace file, read twice (to size the multiplier columns).
+  inline void writeTraceCsv (std::ostream& o,
+                             const boost::filesystem::path& file)
+  {
+    TraceRecord record;
+    TraceRecord::index_t k = 0;
+    {
+      TraceReader reader (file);
+      while (reader.next (record))
+        if (record.type == trace::ITERATION)
+          k = std::max (k, record.multipliers.size ());
+    }
+
+    TraceReader reader (file);
+    o << "iteration,cost,violation";
+    for (boost::uint64_t i = 0; i < reader.header ().inputSize; ++i)
+      o << ",x_" << i;
+    for (TraceRecord::index_t i = 0; i < k; ++i)
+      o << ",lambda_" << i;
+    o << "\n";
+
+    o << std::setprecision (std::numeric_limits<double>::digits10 + 2);
+    while (reader.next (record))
+      {
+        if (record.type != trace::ITERATION)
+          continue;
+
+        o << record.iteration << "," << record.cost
+          << "," << record.constraintViolation;
+        for (TraceRecord::index_t i = 0; i < record.x.size (); ++i)
+          o << "," << record.x[i];
+        for (TraceRecord::index_t i = 0; i < k; ++i)
+          {
+            o << ",";
+            if (i < record.multipliers.size ())
+              o << record.multipliers[i];
+          }
+        o << "\n";
+      }
+  }
+
+  namespace detail
+  {
+    /// \brief Copy a vector parameter of the solver state, whatever the
+    /// types held by the parameter variant.
+    struct VectorParameter : public boost::static_visitor<bool>
+    {
+      explicit VectorParameter (Eigen::VectorXd& v)
+        : vector (v)
+      {}
+
+      template <typename U>
+      bool operator () (const U&) const
+      {
+        return false;
+      }
+
+      bool operator () (const Eigen::VectorXd& v) const
+      {
+        vector = v;
+        return true;
+      }
+
+      Eigen::VectorXd& vector;
+    };
+
+    /// \brief Whether a solver parameter holds Lagrange multipliers, i.e.
+    /// its name ends with "lambda" or "multipliers" (e.g. ipopt.lambda).
+    inline bool isMultipliersParameter (const std::string& key)
+    {
+      const char* suffixes[] = {"lambda", "multipliers"};
+      for (std::size_t i = 0; i < 2; ++i)
+        {
+          std::size_t size = std::strlen (suffixes[i]);
+          if (key.size () >= size
+              && key.compare (key.size () - size, size, suffixes[i]) == 0)
+            return true;
+        }
+      return false;
+    }
+
+    /// \brief Header of the trace of a problem.
+    ///
+    /// \param problem traced problem.
+    /// \param path log directory, used as name of the run.
+    template <typename P>
+    TraceHeader traceHeader (const P& problem,
+                             const boost::filesystem::path& path)
+    {
+      TraceHeader header;
+      header.inputSize =
+        static_cast<boost::uint64_t> (problem.function ().inputSize ());
+      for (std::size_t i = 0; i < problem.boundsVector ().size (); ++i)
+        header.constraintsSize += problem.boundsVector ()[i].size ();
+      header.name = path.string ();
+      return header;
+    }
+
+    /// \brief Fill an iteration record from a solver state.
+    template <typename State>
+    void traceRecord (TraceRecord& record, boost::uint64_t iteration,
+                      const State& state)
+    {
+      record.type = trace::ITERATION;
+      record.iteration = iteration;
+      record.x = state.x ();
+      record.cost = state.cost ()
+        ? *state.cost () : std::numeric_limits<double>::quiet_NaN ();
+      record.constraintViolation = state.constraintViolation ()
+        ? *state.constraintViolation ()
+        : std::numeric_limits<double>::quiet_NaN ();
+
+      // The multipliers are copied into the vector of the record, which
+      // does not allocate when its size is already the right one.
+      for (typename State::parameters_t::const_iterator
+             it = state.parameters ().begin ();
+           it != state.parameters ().end (); ++it)
+        if (isMultipliersParameter (it->first)
+            && boost::apply_visitor (VectorParameter (record.multipliers),
+                                     it->second.value))
+          return;
+      record.multipliers.resize (0);
+    }
+  } // end of namespace detail
+
+  /// \brief Optimization logger writing a binary trace (see trace) instead
+  /// of text files, so that logging stays cheap at large sizes.
+  ///
+  /// It has the interface of OptimizationLogger used by the shared tests:
+  /// the iterations are written to `<path>/trace.bin' by the iteration
+  /// callback, and the data streamed into the logger (result, solver) as
+  /// TEXT records. Use `trace_convert' to convert a trace to text or CSV.
+  ///
+  /// Each iteration record contains x, the cost and the constraint
+  /// violation when the solver provides them, and the first vector
+  /// parameter of the solver state whose name ends with "lambda" or
+  /// "multipliers".
+  ///
+  /// \tparam S solver type.
+  template <typename S>
+  class BinaryTraceLogger
+  {
+  public:
+    typedef S solver_t;
+    typedef typename solver_t::problem_t problem_t;
+    typedef typename solver_t::solverState_t solverState_t;
+    typedef typename solver_t::callback_t callback_t;
+
+    /// \brief Create a trace for a solver.
+    ///
+    /// \param solver solver to trace.
+    /// \param path directory of the trace.
+    /// \param selfRegister whether to register the iteration callback.
+    BinaryTraceLogger (solver_t& solver, const boost::filesystem::path& path,
+                       bool selfRegister = true)
+      : writer_ (path / "trace.bin",
+                 detail::traceHeader (solver.problem (), path)),
+        record_ (),
+        iteration_ (0)
+    {
+      if (!selfRegister)
+        return;
+
+      // Not all solvers support per-iteration callbacks.
+      try
+        {
+          solver.setIterationCallback (callback ());
+        }
+      catch (std::runtime_error&)
+        {
+        }
+    }
+
+    /// \brief Iteration callback writing the solver state.
+    callback_t callback ()
+    {
+      IterationWriter writer = {this};
+      return writer;
+    }
+
+    /// \brief Append data (result, solver...) as a TEXT record.
+    template <typename U>
+    BinaryTraceLogger& operator<< (const U& data)
+    {
+      std::ostringstream ss;
+      ss << data;
+      writer_.write (ss.str ());
+      return *this;
+    }
+
+  private:
+    /// \brief Iteration callback forwarding to perIterationCallback.
+    struct IterationWriter
+    {
+      BinaryTraceLogger* logger;
+
+      void operator () (const problem_t& pb, solverState_t& state)
+      {
+        logger->perIterationCallback (pb, state);
+      }
+    };
+
+    void perIterationCallback (const problem_t&, solverState_t& state)
+    {
+      detail::traceRecord (record_, iteration_++, state);
+      writer_.write (record_);
+    }
+
+    TraceWriter writer_;
+
+    /// \brief Record reused by the iterations.
+    TraceRecord record_;
+
+    boost::uint64_t iteration_;
+  };
+} // end of namespace roboptim
+
+#endif //! ROBOPTIM_SHARED_TESTS_TRACE_HH
@@ -0,0 +1,57 @@
+// Copyright (C) 2016 by the roboptim developers.
+//
+// This file is part of the roboptim.
+//
+// roboptim is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// roboptim is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with roboptim.  If not, see <http://www.gnu.org/licenses/>.
+
+// Convert the binary iteration traces written by BinaryTraceLogger (see
+// trace.hh) to text or CSV:
+//
+//   trace_convert [--csv] TRACE
+//
+// The result is written to the standard output.
+
+#include "trace.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+int main (int argc, char** argv)
+{
+  bool csv = argc == 3 && std::string (argv[1]) == "--csv";
+  if (argc != 2 && !csv)
+    {
+      std::cerr << "usage: " << argv[0] << " [--csv] TRACE" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  try
+    {
+      if (csv)
+        roboptim::writeTraceCsv (std::cout, argv[2]);
+      else
+        {
+          roboptim::TraceReader reader (argv[1]);
+          roboptim::printTrace (std::cout, reader);
+        }
+    }
+  catch (const std::exception& e)
+    {
+      std::cerr << e.what () << std::endl;
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
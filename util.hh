@@ -21,7 +21,10 @@
 // Serialization with Boost
 # include <boost/archive/text_oarchive.hpp>
 # include <boost/archive/text_iarchive.hpp>
+# include <boost/make_shared.hpp>
+# include <boost/shared_ptr.hpp>
 
+# include "matrix-file.hh"
 # include "serialize.hh"
 
 typedef boost::filesystem::path path_t;
@@ -35,6 +38,10 @@ typedef boost::filesystem::path path_t;
 /// \param file file containing matrix data. The given relative path
 /// should be relative to the tests data directory.
 ///
+/// Binary matrix files (see matrix-file.hh) are detected, other files
+/// are read as Boost text archives. Sparse binary matrix files require
+/// Eigen 3.3 or later.
+///
 /// \return matrix containing the proper data.
 template <typename M>
 M readMatrix (const path_t& file)
@@ -45,6 +52,12 @@ M readMatrix (const path_t& file)
 
   path_t full_path = path_t (TESTS_DATA_DIR) / file;
 
+  if (::roboptim::MatrixFile::isMatrixFile (full_path))
+    {
+      ::roboptim::readBinaryMatrix (full_path, m);
+      return m;
+    }
+
   std::ifstream ifs (full_path.c_str ());
   boost::archive::text_iarchive ia (ifs);
 
@@ -60,16 +73,41 @@ M readMatrix (const path_t& file)
 ///
 /// \tparam M Eigen matrix type.
 /// \param file file containing matrix data. The given relative path
-/// should be relative to the tests data directory.
+/// should be relative to the tests data directory. Files with a ".bin"
+/// extension are written as binary matrix files (see matrix-file.hh),
+/// other files as Boost text archives.
 template <typename M>
 void writeMatrix (const path_t& file, const M& m)
 {
   path_t full_path = path_t (TESTS_DATA_DIR) / file;
 
+  if (full_path.extension () == ".bin")
+    {
+      ::roboptim::writeBinaryMatrix (full_path, m);
+      return;
+    }
+
   std::ofstream ofs (full_path.c_str ());
   boost::archive::text_oarchive oa (ofs);
 
   oa << m;
 }
 
+/// \brief Map a binary matrix file in memory.
+///
+/// Unlike readMatrix, the data is not copied: the matrices returned by
+/// the dense and sparse methods of the file point to the mapped file,
+/// which is faster for large reference matrices.
+///
+/// \param file binary matrix file. The given relative path should be
+/// relative to the tests data directory.
+///
+/// \return mapped file.
+inline boost::shared_ptr<const ::roboptim::MatrixFile>
+mapMatrix (const path_t& file)
+{
+  return boost::make_shared< ::roboptim::MatrixFile>
+    (path_t (TESTS_DATA_DIR) / file);
+}
+
 # endif //! ROBOPTIM_SHARED_TESTS_UTIL_HH